@@ -0,0 +1,460 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <vector>
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../source/public/MediaConsumer.h"
+#include "../source/public/MediaProducer.h"
+
+using std::chrono::steady_clock;
+
+namespace
+{
+	//The settings for a single benchmark run
+	struct BenchmarkSettings
+	{
+		uint32_t width;
+		uint32_t height;
+		MediaIPC::VideoFormat videoFormat;
+		MediaIPC::AudioFormat audioFormat;
+		uint32_t samplesPerBuffer;
+		uint32_t consumers;
+	};
+	
+	//The results reported by each consumer process
+	struct ConsumerResults
+	{
+		uint64_t videoFrames;
+		uint64_t videoBytes;
+		uint64_t audioBytes;
+		double p50;
+		double p99;
+		double p999;
+	};
+	
+	//Returns the current time as nanoseconds since the steady clock epoch
+	//(Under Linux the steady clock is CLOCK_MONOTONIC, which is shared between processes)
+	uint64_t nowNanoseconds() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(steady_clock::now().time_since_epoch()).count();
+	}
+	
+	//Computes the specified percentile of a sorted list of latencies
+	double percentile(const vector<uint64_t>& sorted, double p)
+	{
+		if (sorted.empty()) {
+			return 0.0;
+		}
+		
+		size_t index = std::min(sorted.size() - 1, (size_t)(p * (double)(sorted.size())));
+		return (double)(sorted[index]);
+	}
+	
+	//Writes a complete buffer to a file descriptor
+	void writeAll(int fd, const void* data, size_t length)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		while (length > 0)
+		{
+			ssize_t written = write(fd, bytes, length);
+			if (written <= 0) {
+				return;
+			}
+			
+			bytes += written;
+			length -= written;
+		}
+	}
+	
+	//Reads a complete buffer from a file descriptor
+	bool readAll(int fd, void* data, size_t length)
+	{
+		uint8_t* bytes = (uint8_t*)data;
+		while (length > 0)
+		{
+			ssize_t bytesRead = read(fd, bytes, length);
+			if (bytesRead <= 0) {
+				return false;
+			}
+			
+			bytes += bytesRead;
+			length -= bytesRead;
+		}
+		
+		return true;
+	}
+	
+	//Runs a consumer process, reporting readiness and then results through the supplied pipes
+	void runConsumer(const string& prefix, bool views, int readyFd, int resultsFd)
+	{
+		ConsumerResults results;
+		std::memset(&results, 0, sizeof(ConsumerResults));
+		vector<uint64_t> latencies;
+		latencies.reserve(1 << 20);
+		
+		std::unique_ptr<MediaIPC::FunctionConsumerDelegate> delegate( new MediaIPC::FunctionConsumerDelegate() );
+		delegate->setControlBlockHandler([readyFd](const MediaIPC::ControlBlock&)
+		{
+			uint8_t ready = 1;
+			writeAll(readyFd, &ready, sizeof(ready));
+		});
+		
+		//The producer embeds its submission timestamp in the first eight bytes of each frame
+		auto videoHandler = [&results, &latencies](const uint8_t* buffer, uint64_t length)
+		{
+			uint64_t timestamp = 0;
+			std::memcpy(&timestamp, buffer, sizeof(uint64_t));
+			latencies.push_back(nowNanoseconds() - timestamp);
+			results.videoFrames++;
+			results.videoBytes += length;
+		};
+		
+		//Frames are either copied out of shared memory or received as views, depending on the path being measured
+		if (views == true) {
+			delegate->setVideoViewHandler([videoHandler](MediaIPC::VideoFrameView& view) { videoHandler(view.data(), view.length()); });
+		}
+		else {
+			delegate->setVideoHandler(videoHandler);
+		}
+		
+		delegate->setAudioHandler([&results](const uint8_t*, uint64_t length) {
+			results.audioBytes += length;
+		});
+		
+		//Consume data until the producer stops
+		MediaIPC::MediaConsumer consumer(prefix, std::move(delegate), MediaIPC::SamplingMode::Notification);
+		
+		//Compute our latency percentiles in microseconds
+		std::sort(latencies.begin(), latencies.end());
+		results.p50 = percentile(latencies, 0.5) / 1000.0;
+		results.p99 = percentile(latencies, 0.99) / 1000.0;
+		results.p999 = percentile(latencies, 0.999) / 1000.0;
+		writeAll(resultsFd, &results, sizeof(ConsumerResults));
+	}
+	
+	//Waits for every consumer to report readiness, returning false if any of them exits before doing so
+	bool awaitConsumers(int readyFd, const vector<pid_t>& children)
+	{
+		uint32_t ready = 0;
+		while (ready < children.size())
+		{
+			//Poll with a timeout so that we notice consumers which exit without writing anything
+			pollfd descriptor = { readyFd, POLLIN, 0 };
+			int result = poll(&descriptor, 1, 100);
+			if (result > 0)
+			{
+				//A failed read means every consumer has closed its end of the pipe
+				uint8_t byte = 0;
+				if (readAll(readyFd, &byte, sizeof(byte)) == false) {
+					return false;
+				}
+				
+				ready++;
+				continue;
+			}
+			
+			if (result < 0 && errno != EINTR) {
+				return false;
+			}
+			
+			//Any consumer that has exited (or that we cannot query) at this point has failed
+			for (pid_t child : children)
+			{
+				if (waitpid(child, nullptr, WNOHANG) != 0) {
+					return false;
+				}
+			}
+		}
+		
+		return true;
+	}
+	
+	//Waits for every consumer to exit, returning false if any of them failed
+	bool reapConsumers(const vector<pid_t>& children)
+	{
+		bool succeeded = true;
+		for (pid_t child : children)
+		{
+			int status = 0;
+			if (waitpid(child, &status, 0) != child || WIFEXITED(status) == false || WEXITSTATUS(status) != 0) {
+				succeeded = false;
+			}
+		}
+		
+		return succeeded;
+	}
+	
+	//Runs a single benchmark and prints its results
+	void runBenchmark(const BenchmarkSettings& settings, const MediaIPC::ProducerOptions& options, uint32_t alignment, double duration, bool views, bool csv)
+	{
+		//Populate the control block
+		MediaIPC::ControlBlock cb;
+		cb.width = settings.width;
+		cb.height = settings.height;
+		cb.frameRate = 60;
+		cb.videoFormat = settings.videoFormat;
+		
+		//If requested, pad each row and align each frame to the specified boundary
+		if (alignment != 0)
+		{
+			cb.videoStride = MediaIPC::FormatDetails::alignedStride(settings.videoFormat, settings.width, alignment);
+			cb.videoAlignment = alignment;
+		}
+		
+		cb.channels = 2;
+		cb.sampleRate = 48000;
+		cb.samplesPerBuffer = settings.samplesPerBuffer;
+		cb.audioFormat = settings.audioFormat;
+		
+		//Create the producer before forking, so that the shared memory exists when the consumers start
+		string prefix = "MediaIPCBenchmark" + std::to_string(getpid());
+		std::unique_ptr<MediaIPC::MediaProducer> producer( new MediaIPC::MediaProducer(prefix, cb, options) );
+		
+		//Spawn our consumer processes
+		int readyPipe[2];
+		int resultsPipe[2];
+		if (pipe(readyPipe) != 0 || pipe(resultsPipe) != 0) {
+			throw std::runtime_error("failed to create pipes");
+		}
+		
+		vector<pid_t> children;
+		for (uint32_t i = 0; i < settings.consumers; ++i)
+		{
+			pid_t pid = fork();
+			if (pid == 0)
+			{
+				//Never let an exception unwind into the copy of the parent's stack
+				try {
+					runConsumer(prefix, views, readyPipe[1], resultsPipe[1]);
+				}
+				catch (std::exception& e)
+				{
+					std::cerr << "Consumer error: " << e.what() << endl;
+					_exit(1);
+				}
+				catch (...)
+				{
+					std::cerr << "Consumer error: unknown exception" << endl;
+					_exit(1);
+				}
+				
+				_exit(0);
+			}
+			
+			if (pid < 0) {
+				break;
+			}
+			
+			children.push_back(pid);
+		}
+		
+		//Close our copies of the write ends, so that reads fail once every consumer has exited
+		close(readyPipe[1]);
+		close(resultsPipe[1]);
+		
+		//Wait for every consumer to receive the control block
+		if (children.size() != settings.consumers || awaitConsumers(readyPipe[0], children) == false)
+		{
+			//Stopping the producer releases any consumers that are still running
+			producer->stop();
+			reapConsumers(children);
+			close(readyPipe[0]);
+			close(resultsPipe[0]);
+			throw std::runtime_error("a consumer process failed to start");
+		}
+		
+		//Submit data as fast as possible for the requested duration
+		uint64_t videoBufsize = cb.calculateVideoBufsize();
+		uint64_t audioBufsize = cb.calculateAudioBufsize();
+		vector<uint8_t> videoBuf(videoBufsize, 0x80);
+		vector<uint8_t> audioBuf(audioBufsize, 0x80);
+		uint64_t framesSubmitted = 0;
+		steady_clock::time_point start = steady_clock::now();
+		steady_clock::time_point end = start + std::chrono::duration_cast<steady_clock::duration>(std::chrono::duration<double>(duration));
+		while (steady_clock::now() < end)
+		{
+			uint64_t timestamp = nowNanoseconds();
+			std::memcpy(videoBuf.data(), &timestamp, sizeof(uint64_t));
+			producer->submitVideoFrame(videoBuf.data(), videoBufsize);
+			producer->submitAudioSamples(audioBuf.data(), audioBufsize);
+			framesSubmitted++;
+		}
+		double elapsed = std::chrono::duration<double>(steady_clock::now() - start).count();
+		producer->stop();
+		
+		//Gather the results from our consumers
+		ConsumerResults total;
+		std::memset(&total, 0, sizeof(ConsumerResults));
+		bool succeeded = true;
+		for (uint32_t i = 0; i < settings.consumers; ++i)
+		{
+			ConsumerResults results;
+			if (readAll(resultsPipe[0], &results, sizeof(ConsumerResults)) == false)
+			{
+				succeeded = false;
+				break;
+			}
+			
+			total.videoFrames += results.videoFrames;
+			total.videoBytes += results.videoBytes;
+			total.audioBytes += results.audioBytes;
+			total.p50 = std::max(total.p50, results.p50);
+			total.p99 = std::max(total.p99, results.p99);
+			total.p999 = std::max(total.p999, results.p999);
+		}
+		
+		succeeded = reapConsumers(children) && succeeded;
+		close(readyPipe[0]);
+		close(resultsPipe[0]);
+		if (succeeded == false) {
+			throw std::runtime_error("a consumer process failed");
+		}
+		
+		//Print the results
+		std::stringstream resolution;
+		resolution << settings.width << "x" << settings.height;
+		double producerFps = (double)(framesSubmitted) / elapsed;
+		double producerGBps = (double)(framesSubmitted * (videoBufsize + audioBufsize)) / elapsed / 1e9;
+		double consumerFps = (double)(total.videoFrames) / elapsed / settings.consumers;
+		double consumerGBps = (double)(total.videoBytes + total.audioBytes) / elapsed / 1e9;
+		
+		if (csv == true)
+		{
+			cout << resolution.str() << "," << MediaIPC::FormatDetails::description(settings.videoFormat) << ","
+			     << MediaIPC::FormatDetails::description(settings.audioFormat) << "," << settings.samplesPerBuffer << ","
+			     << settings.consumers << "," << producerFps << "," << producerGBps << "," << consumerFps << ","
+			     << consumerGBps << "," << total.p50 << "," << total.p99 << "," << total.p999 << endl;
+		}
+		else
+		{
+			cout << std::fixed << std::setprecision(2)
+			     << std::setw(10) << resolution.str()
+			     << std::setw(10) << (videoBufsize * 8) / ((uint64_t)(settings.width) * settings.height) << "bpp"
+			     << std::setw(8) << (uint32_t)(MediaIPC::FormatDetails::bytesPerSample(settings.audioFormat)) << "B"
+			     << std::setw(8) << settings.samplesPerBuffer
+			     << std::setw(6) << settings.consumers
+			     << std::setw(12) << producerFps
+			     << std::setw(10) << producerGBps
+			     << std::setw(12) << consumerFps
+			     << std::setw(10) << consumerGBps
+			     << std::setw(12) << total.p50
+			     << std::setw(12) << total.p99
+			     << std::setw(12) << total.p999 << endl;
+		}
+	}
+}
+
+int main (int argc, char* argv[])
+{
+	try
+	{
+		//Parse our command-line arguments
+		double duration = 1.0;
+		bool csv = false;
+		bool quick = false;
+		bool views = false;
+		uint32_t alignment = 0;
+		MediaIPC::ProducerOptions options;
+		for (int i = 1; i < argc; ++i)
+		{
+			string arg = argv[i];
+			if (arg == "--csv") {
+				csv = true;
+			}
+			else if (arg == "--quick") {
+				quick = true;
+			}
+			else if (arg == "--views") {
+				views = true;
+			}
+			else if (arg == "--huge-pages") {
+				options.hugePages = true;
+			}
+			else if (arg == "--prefault") {
+				options.prefault = true;
+			}
+			else if (arg == "--numa-node" && i + 1 < argc) {
+				options.numaNode = std::atoi(argv[++i]);
+			}
+			else if (arg == "--align" && i + 1 < argc) {
+				alignment = (uint32_t)(std::atoi(argv[++i]));
+			}
+			else if (arg == "--duration" && i + 1 < argc) {
+				duration = std::atof(argv[++i]);
+			}
+			else
+			{
+				cout << "Usage:" << endl << "  mediaipc_benchmark [--duration SECONDS] [--quick] [--views] [--huge-pages] [--prefault] [--numa-node NODE] [--align BYTES] [--csv]" << endl;
+				return 1;
+			}
+		}
+		
+		//The matrix of settings that we benchmark
+		vector< std::pair<uint32_t, uint32_t> > resolutions = { {1280, 720}, {1920, 1080}, {3840, 2160} };
+		vector<MediaIPC::VideoFormat> videoFormats = { MediaIPC::VideoFormat::I420, MediaIPC::VideoFormat::RGB, MediaIPC::VideoFormat::RGBA };
+		vector<MediaIPC::AudioFormat> audioFormats = { MediaIPC::AudioFormat::PCM_S16LE, MediaIPC::AudioFormat::PCM_F32LE };
+		vector<uint32_t> samplesPerBuffer = { 256, 1024 };
+		vector<uint32_t> consumerCounts = { 1, 4 };
+		
+		//The quick matrix only covers a single representative configuration for each consumer count
+		if (quick == true)
+		{
+			resolutions = { {1920, 1080} };
+			videoFormats = { MediaIPC::VideoFormat::RGBA };
+			audioFormats = { MediaIPC::AudioFormat::PCM_F32LE };
+			samplesPerBuffer = { 1024 };
+		}
+		
+		//Print our header row
+		if (csv == true) {
+			cout << "resolution,video_format,audio_format,samples_per_buffer,consumers,producer_fps,producer_gbps,consumer_fps,consumer_gbps,p50_us,p99_us,p999_us" << endl;
+		}
+		else
+		{
+			cout << std::setw(10) << "res" << std::setw(13) << "video" << std::setw(9) << "audio"
+			     << std::setw(8) << "spb" << std::setw(6) << "cons" << std::setw(12) << "prod fps"
+			     << std::setw(10) << "prod GB/s" << std::setw(12) << "cons fps" << std::setw(10) << "cons GB/s"
+			     << std::setw(12) << "p50 us" << std::setw(12) << "p99 us" << std::setw(12) << "p99.9 us" << endl;
+		}
+		
+		//Run the benchmark matrix
+		for (auto resolution : resolutions)
+		{
+			for (auto videoFormat : videoFormats)
+			{
+				for (auto audioFormat : audioFormats)
+				{
+					for (auto spb : samplesPerBuffer)
+					{
+						for (auto consumers : consumerCounts)
+						{
+							BenchmarkSettings settings = { resolution.first, resolution.second, videoFormat, audioFormat, spb, consumers };
+							runBenchmark(settings, options, alignment, duration, views, csv);
+						}
+					}
+				}
+			}
+		}
+	}
+	catch (std::runtime_error& e) {
+		cout << "Error: " << e.what() << endl;
+	}
+	
+	return 0;
+}
@@ -17,6 +17,7 @@ void printControlBlock(const MediaIPC::ControlBlock& cb, std::ostream& stream)
 		stream << "width = " << cb.width << std::endl;
 		stream << "height = " << cb.height << std::endl;
 		stream << "bytesPerPixel = " << (uint32_t)MediaIPC::FormatDetails::bytesPerPixel(cb.videoFormat) << std::endl;
+		stream << "planes = " << (uint32_t)MediaIPC::FormatDetails::planeCount(cb.videoFormat) << std::endl;
 		stream << "frameRate = " << cb.frameRate << std::endl;
 	}
 	
@@ -1,4 +1,5 @@
 #include <boost/asio/io_service.hpp>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -15,6 +16,7 @@ using std::stringstream;
 using std::vector;
 
 //When building your own consumers, this will be #include <MediaIPC/MediaConsumer.h>
+#include "../../source/public/FormatConverter.h"
 #include "../../source/public/MediaConsumer.h"
 #include "../common/common.h"
 
@@ -60,6 +62,10 @@ int main (int argc, char* argv[])
 		{MediaIPC::VideoFormat::BGRA,     "bgra"},
 		{MediaIPC::VideoFormat::ARGB,     "argb"},
 		{MediaIPC::VideoFormat::ABGR,     "abgr"},
+		{MediaIPC::VideoFormat::I420,     "yuv420p"},
+		{MediaIPC::VideoFormat::NV12,     "nv12"},
+		{MediaIPC::VideoFormat::YUY2,     "yuyv422"},
+		{MediaIPC::VideoFormat::P010,     "p010le"},
 		{MediaIPC::VideoFormat::None,     "none"}
 	};
 	
@@ -123,16 +129,32 @@ int main (int argc, char* argv[])
 		//The thread that will run our ffmpeg child process
 		std::thread ffmpegThread;
 		
+		//The video parameters, which we need in order to strip any row padding from the frames, since ffmpeg expects tightly packed rows
+		MediaIPC::ControlBlock format;
+		
+		//Set if the producer reconfigures the stream, since our ffmpeg child process cannot change its input parameters mid-stream
+		std::atomic<bool> reconfigured(false);
+		
 		//Create our consumer delegate
 		std::unique_ptr<MediaIPC::FunctionConsumerDelegate> delegate( new MediaIPC::FunctionConsumerDelegate() );
 		
 		//Bind our callback for when the control block data is received
-		delegate->setControlBlockHandler([&ffmpegThread, &videoPipe, &audioPipe, videoFormats, audioFormats, ffmpegExtraArgs](const MediaIPC::ControlBlock& cb)
+		delegate->setControlBlockHandler([&ffmpegThread, &videoPipe, &audioPipe, &format, &reconfigured, videoFormats, audioFormats, ffmpegExtraArgs](const MediaIPC::ControlBlock& cb)
 		{
 			//Print the control block contents
 			cout << "Received Control Block:" << endl << endl;
 			printControlBlock(cb, cout);
 			
+			//If our ffmpeg child process is already running then we have to discard the remainder of the stream
+			if (ffmpegThread.joinable() == true)
+			{
+				cout << "The producer reconfigured the stream, ignoring the remaining stream data." << endl;
+				reconfigured = true;
+				return;
+			}
+			
+			format = cb;
+			
 			//Build the command to run our ffmpeg child process
 			stringstream command;
 			command << "ffmpeg";
@@ -165,10 +187,23 @@ int main (int argc, char* argv[])
 		});
 		
 		//Bind our callback for when video data is received
-		delegate->setVideoHandler([&videoPipe, &videoThread](const uint8_t* buffer, uint64_t length)
+		delegate->setVideoHandler([&videoPipe, &videoThread, &format, &reconfigured](const uint8_t* buffer, uint64_t length)
 		{
-			//Create a temporary buffer to hold a copy of the received data
-			vector<uint8_t> bufferCopy(buffer, buffer + length);
+			if (reconfigured == true) {
+				return;
+			}
+			
+			//Create a temporary buffer to hold a copy of the received data, stripping any row padding
+			vector<uint8_t> bufferCopy;
+			if (format.videoStride != 0)
+			{
+				length = MediaIPC::FormatDetails::frameSize(format.videoFormat, format.width, format.height);
+				bufferCopy.resize(length);
+				MediaIPC::FormatConverter::convert(buffer, format.videoFormat, format.videoStride, bufferCopy.data(), format.videoFormat, 0, format.width, format.height);
+			}
+			else {
+				bufferCopy.assign(buffer, buffer + length);
+			}
 			
 			//Write the data to the named pipe on the video pipe thread
 			videoThread.loop.post([&videoPipe, bufferCopy, length]() {
@@ -177,8 +212,12 @@ int main (int argc, char* argv[])
 		});
 		
 		//Bind our callback for when audio data is received
-		delegate->setAudioHandler([&audioPipe, &audioThread](const uint8_t* buffer, uint64_t length)
+		delegate->setAudioHandler([&audioPipe, &audioThread, &reconfigured](const uint8_t* buffer, uint64_t length)
 		{
+			if (reconfigured == true) {
+				return;
+			}
+			
 			//Create a temporary buffer to hold a copy of the received data
 			vector<uint8_t> bufferCopy(buffer, buffer + length);
 			
@@ -1,3 +1,4 @@
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -14,6 +15,8 @@ using std::stringstream;
 using std::vector;
 
 //When building your own consumers, this will be #include <MediaIPC/MediaConsumer.h>
+#include "../../source/public/DelegateDispatcher.h"
+#include "../../source/public/FormatConverter.h"
 #include "../../source/public/MediaConsumer.h"
 #include "../common/common.h"
 
@@ -49,6 +52,10 @@ int main (int argc, char* argv[])
 		{MediaIPC::VideoFormat::BGRA,     "bgra"},
 		{MediaIPC::VideoFormat::ARGB,     "argb"},
 		{MediaIPC::VideoFormat::ABGR,     "abgr"},
+		{MediaIPC::VideoFormat::I420,     "yuv420p"},
+		{MediaIPC::VideoFormat::NV12,     "nv12"},
+		{MediaIPC::VideoFormat::YUY2,     "yuyv422"},
+		{MediaIPC::VideoFormat::P010,     "p010le"},
 		{MediaIPC::VideoFormat::None,     "none"}
 	};
 	
@@ -123,21 +130,52 @@ int main (int argc, char* argv[])
 		NamedPipe videoPipe("videoPipe");
 		NamedPipe audioPipe("audioPipe");
 		
+		//Packed RGB video is converted to I420 before it is piped to ffmpeg, so that ffmpeg can skip its own (slower) conversion
+		//(Producers that publish I420 or another YUV format directly have their frames passed straight through,
+		//unless the producer pads its rows, in which case the frames are repacked since ffmpeg expects tightly packed rows)
+		MediaIPC::ControlBlock format;
+		MediaIPC::VideoFormat pipeFormat = MediaIPC::VideoFormat::None;
+		bool repack = false;
+		vector<uint8_t> pipeFrame;
+		
+		//Set if the producer reconfigures the stream, since our ffmpeg child processes cannot change their input parameters mid-stream
+		bool started = false;
+		std::atomic<bool> reconfigured(false);
+		
 		//Create our consumer delegate
 		std::unique_ptr<MediaIPC::FunctionConsumerDelegate> delegate( new MediaIPC::FunctionConsumerDelegate() );
 		
 		//Bind our callback for when the control block data is received
-		delegate->setControlBlockHandler([&videoThread, &audioThread, &videoPipe, &audioPipe, videoFormats, audioFormats, videoDest, audioDest, profile](const MediaIPC::ControlBlock& cb)
+		delegate->setControlBlockHandler([&videoThread, &audioThread, &videoPipe, &audioPipe, &format, &pipeFormat, &repack, &pipeFrame, &started, &reconfigured, videoFormats, audioFormats, videoDest, audioDest, profile](const MediaIPC::ControlBlock& cb)
 		{
 			//Print the control block contents
 			cout << "Received Control Block:" << endl << endl;
 			printControlBlock(cb, cout);
 			
+			//If our ffmpeg child processes are already running then we have to discard the remainder of the stream
+			if (started == true)
+			{
+				cout << "The producer reconfigured the stream, ignoring the remaining stream data." << endl;
+				reconfigured = true;
+				return;
+			}
+			
+			started = true;
+			
+			//Determine if we will be converting or repacking the video frames
+			format = cb;
+			bool packedRGB = (cb.videoFormat != MediaIPC::VideoFormat::I420 && MediaIPC::FormatConverter::canConvert(cb.videoFormat, MediaIPC::VideoFormat::I420));
+			pipeFormat = ((packedRGB == true) ? MediaIPC::VideoFormat::I420 : cb.videoFormat);
+			repack = (packedRGB == true || cb.videoStride != 0);
+			if (repack == true) {
+				pipeFrame.resize(MediaIPC::FormatDetails::frameSize(pipeFormat, cb.width, cb.height));
+			}
+			
 			//Build the command to run the ffmpeg video child process
 			stringstream videoCommand;
 			videoCommand << "ffmpeg";
 			videoCommand << " -f rawvideo";
-			videoCommand << " -pixel_format " << videoFormats.at(cb.videoFormat);
+			videoCommand << " -pixel_format " << videoFormats.at(pipeFormat);
 			videoCommand << " -video_size " << cb.width << "x" << cb.height;
 			videoCommand << " -framerate " << cb.frameRate;
 			videoCommand << " -i " << videoPipe.path();
@@ -182,18 +220,43 @@ int main (int argc, char* argv[])
 		});
 		
 		//Bind our callback for when video data is received
-		delegate->setVideoHandler([&videoPipe](const uint8_t* buffer, uint64_t length) {
-			videoPipe.write(buffer, length);
+		delegate->setVideoHandler([&videoPipe, &format, &pipeFormat, &repack, &pipeFrame, &reconfigured](const uint8_t* buffer, uint64_t length)
+		{
+			if (reconfigured == true) {
+				return;
+			}
+			
+			if (repack == false)
+			{
+				videoPipe.write(buffer, length);
+				return;
+			}
+			
+			//Convert the frame to I420 (or simply strip the row padding) using the SIMD conversion kernels
+			MediaIPC::FormatConverter::convert(buffer, format.videoFormat, format.videoStride, pipeFrame.data(), pipeFormat, 0, format.width, format.height);
+			videoPipe.write(pipeFrame.data(), pipeFrame.size());
 		});
 		
 		//Bind our callback for when audio data is received
-		delegate->setAudioHandler([&audioPipe](const uint8_t* buffer, uint64_t length) {
-			audioPipe.write(buffer, length);
+		delegate->setAudioHandler([&audioPipe, &reconfigured](const uint8_t* buffer, uint64_t length)
+		{
+			if (reconfigured == false) {
+				audioPipe.write(buffer, length);
+			}
 		});
 		
-		//Consume data until the stream completes
+		//Run our delegate on worker threads, so that blocking writes to the pipes do not delay the sampling of the stream
+		//(Two workers let the video and audio pipes be written concurrently, since ffmpeg may block reading one input until it
+		//receives data from the other; if ffmpeg falls behind then the oldest queued frames are discarded rather than delaying
+		//the newest ones)
+		MediaIPC::DispatchOptions dispatchOptions;
+		dispatchOptions.workers = 2;
+		MediaIPC::DelegateDispatcher dispatcher(dispatchOptions);
+		
+		//Consume data until the stream completes, and then wait for the data that is still queued to be written to the pipes
 		cout << "Awaiting control block from producer process..." << endl << endl;
-		MediaIPC::MediaConsumer consumer(prefix, std::move(delegate));
+		MediaIPC::MediaConsumer consumer(prefix, dispatcher.wrap(std::move(delegate), "ffmpeg"));
+		dispatcher.drain();
 		
 		//Close our pipes
 		cout << "Stream complete." << endl;
@@ -40,11 +40,12 @@ int main (int argc, char* argv[])
 		});
 		
 		//Bind our callback for when video data is received (will be called on the video thread)
+		//(We only read each frame once, so we receive views of the frames in shared memory rather than copies)
 		ofstream videoFile("video.raw", std::ios::binary);
-		delegate->setVideoHandler([&videoFile](const uint8_t* buffer, uint64_t length)
+		delegate->setVideoViewHandler([&videoFile](MediaIPC::VideoFrameView& view)
 		{
 			//cout << "Video frame received!" << endl;
-			videoFile.write((const char*)buffer, length);
+			videoFile.write((const char*)view.data(), view.length());
 		});
 		
 		//Bind our callback for when audio data is received (will be called on the audio thread)
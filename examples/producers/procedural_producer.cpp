@@ -29,12 +29,15 @@ int main (int argc, char* argv[])
 		//If the user supplied a prefix string, use it instead of our default
 		std::string prefix = ((argc > 1) ? argv[1] : "TestPrefix");
 		
+		//If the user specified "i420" as the second argument, generate planar YUV video instead of packed RGB
+		bool planar = (argc > 2 && std::string(argv[2]) == "i420");
+		
 		//Populate the control block to send to the consumer
 		MediaIPC::ControlBlock cb;
 		cb.width = 1920;
 		cb.height = 1080;
 		cb.frameRate = 30;
-		cb.videoFormat = MediaIPC::VideoFormat::RGB;
+		cb.videoFormat = ((planar == true) ? MediaIPC::VideoFormat::I420 : MediaIPC::VideoFormat::RGB);
 		cb.channels = 2;
 		cb.sampleRate = 44100;
 		cb.samplesPerBuffer = 1;
@@ -62,9 +65,7 @@ int main (int argc, char* argv[])
 		
 		//Procedurally generate data until the user terminates the stream
 		uint64_t frameNum = 0;
-		uint64_t videoBufsize = cb.calculateVideoBufsize();
 		uint64_t audioBufsize = cb.calculateAudioBufsize();
-		std::unique_ptr<uint8_t[]> videoBuf( new uint8_t[videoBufsize] );
 		std::unique_ptr<uint8_t[]> audioBuf( new uint8_t[audioBufsize] );
 		while (shouldExit == false)
 		{
@@ -72,17 +73,36 @@ int main (int argc, char* argv[])
 			lastSample = nextSample;
 			nextSample = lastSample + samplingFrequency;
 			
-			//Generate our video framebuffer
-			uint64_t bpp = MediaIPC::FormatDetails::bytesPerPixel(cb.videoFormat);
-			for (unsigned int y = 0; y < cb.height; ++y)
+			//Generate our video framebuffer directly in the shared memory frame slot
+			uint8_t* videoBuf = producer.acquireVideoFrame();
+			if (planar == true)
+			{
+				//Fill each plane of the I420 frame directly, with no RGB conversion step
+				for (uint8_t plane = 0; plane < MediaIPC::FormatDetails::planeCount(cb.videoFormat); ++plane)
+				{
+					MediaIPC::PlaneLayout layout = cb.calculateVideoPlaneLayout(plane);
+					for (unsigned int y = 0; y < layout.rows; ++y)
+					{
+						uint8_t* row = videoBuf + layout.offset + (y * layout.stride);
+						for (unsigned int x = 0; x < layout.stride; ++x) {
+							row[x] = (uint8_t)(((plane == 0) ? x + y : (plane * 64) + y) + frameNum);
+						}
+					}
+				}
+			}
+			else
 			{
-				for (unsigned int x = 0; x < cb.width; ++x)
+				uint64_t bpp = MediaIPC::FormatDetails::bytesPerPixel(cb.videoFormat);
+				for (unsigned int y = 0; y < cb.height; ++y)
 				{
-					uint32_t i = (y*cb.width*bpp) + (x*bpp);
-					uint8_t val = i + frameNum % 255;
-					videoBuf[i] = val;
-					videoBuf[i+1] = val + 50 % 255;
-					videoBuf[i+2] = val - 50 % 255;
+					for (unsigned int x = 0; x < cb.width; ++x)
+					{
+						uint32_t i = (y*cb.width*bpp) + (x*bpp);
+						uint8_t val = i + frameNum % 255;
+						videoBuf[i] = val;
+						videoBuf[i+1] = val + 50 % 255;
+						videoBuf[i+2] = val - 50 % 255;
+					}
 				}
 			}
 			
@@ -93,7 +113,7 @@ int main (int argc, char* argv[])
 			}
 			
 			//Submit the samples
-			producer.submitVideoFrame(videoBuf.get(), videoBufsize);
+			producer.commitVideoFrame();
 			producer.submitAudioSamples(audioBuf.get(), audioBufsize);
 			frameNum++;
 			
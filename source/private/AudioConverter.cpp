@@ -0,0 +1,320 @@
+#include "../public/AudioConverter.h"
+#include "AudioKernels.h"
+#include "CpuFeatures.h"
+#include <atomic>
+#include <cstring>
+
+namespace MediaIPC {
+
+namespace
+{
+	//The number of samples that are converted at a time, which bounds the size of our stack buffers
+	const uint64_t ChunkSamples = AudioConverter::MaxChannels;
+	
+	//Retrieves the layout of the samples of an audio format, returning false for AudioFormat::None
+	bool sampleLayout(AudioFormat format, SampleLayout& layout)
+	{
+		switch (format)
+		{
+			case AudioFormat::PCM_S8:    layout = { 1, false, true,  false }; return true;
+			case AudioFormat::PCM_U8:    layout = { 1, false, false, false }; return true;
+			case AudioFormat::PCM_S16BE: layout = { 2, true,  true,  false }; return true;
+			case AudioFormat::PCM_S16LE: layout = { 2, false, true,  false }; return true;
+			case AudioFormat::PCM_U16BE: layout = { 2, true,  false, false }; return true;
+			case AudioFormat::PCM_U16LE: layout = { 2, false, false, false }; return true;
+			case AudioFormat::PCM_S24BE: layout = { 3, true,  true,  false }; return true;
+			case AudioFormat::PCM_S24LE: layout = { 3, false, true,  false }; return true;
+			case AudioFormat::PCM_U24BE: layout = { 3, true,  false, false }; return true;
+			case AudioFormat::PCM_U24LE: layout = { 3, false, false, false }; return true;
+			case AudioFormat::PCM_S32BE: layout = { 4, true,  true,  false }; return true;
+			case AudioFormat::PCM_S32LE: layout = { 4, false, true,  false }; return true;
+			case AudioFormat::PCM_U32BE: layout = { 4, true,  false, false }; return true;
+			case AudioFormat::PCM_U32LE: layout = { 4, false, false, false }; return true;
+			case AudioFormat::PCM_F32BE: layout = { 4, true,  true,  true  }; return true;
+			case AudioFormat::PCM_F32LE: layout = { 4, false, true,  true  }; return true;
+			case AudioFormat::PCM_F64BE: layout = { 8, true,  true,  true  }; return true;
+			case AudioFormat::PCM_F64LE: layout = { 8, false, true,  true  }; return true;
+			default: return false;
+		}
+	}
+	
+	//Selects the best kernels that are supported by both the build and the CPU
+	const AudioKernels* detectKernels()
+	{
+		if (avx2AudioKernels() != nullptr && cpuSupportsAVX2() == true) {
+			return avx2AudioKernels();
+		}
+		
+		//SSE2 is part of the baseline for every x86 target that the SSE2 kernels are built for
+		if (sse2AudioKernels() != nullptr) {
+			return sse2AudioKernels();
+		}
+		
+		return scalarAudioKernels();
+	}
+	
+	//The kernels that are currently in use
+	std::atomic<const AudioKernels*> activeKernels(nullptr);
+	
+	const AudioKernels* kernels()
+	{
+		const AudioKernels* current = activeKernels.load(std::memory_order_acquire);
+		if (current == nullptr)
+		{
+			current = detectKernels();
+			activeKernels.store(current, std::memory_order_release);
+		}
+		
+		return current;
+	}
+	
+	//Seeds the dither generator for each conversion, so that concurrent conversions do not share any state
+	std::atomic<uint32_t> ditherSeed(0x9E3779B9u);
+	
+	//Holds a chunk of samples in the intermediate representation of a conversion
+	//(Samples are held as signed 32-bit values unless both formats are floating-point, in which case they are held as 32-bit floats)
+	struct Chunk
+	{
+		int32_t integers[ChunkSamples];
+		float floats[ChunkSamples];
+	};
+	
+	//Holds the state of a single conversion
+	struct Conversion
+	{
+		const AudioKernels* kernels;
+		SampleLayout source;
+		SampleLayout dest;
+		
+		//The bit depth to dither to, or zero if no dither is applied
+		uint32_t ditherBits;
+		uint32_t ditherState;
+		
+		//Determines if samples can be converted without the intermediate representation, which is the case when only the
+		//byte order or signedness differ (this is also the only lossless way to convert 64-bit floats to 64-bit floats)
+		bool reorders() const {
+			return (this->source.bytes == this->dest.bytes && this->source.isFloat == this->dest.isFloat);
+		}
+		
+		//Determines if the intermediate representation holds signed 32-bit values rather than floats
+		//(Holding integers whenever either format is an integer format means 64-bit floats can be converted to and from
+		//them directly, without losing the bits that a 32-bit float cannot hold)
+		bool holdsIntegers() const {
+			return (this->source.isFloat == false || this->dest.isFloat == false);
+		}
+		
+		//Decodes samples into the intermediate representation, starting at the specified offset within the chunk
+		void decode(const uint8_t* samples, Chunk& chunk, uint64_t offset, uint64_t count) const
+		{
+			if (this->source.isFloat == false) {
+				this->kernels->decodeInteger(samples, this->source, chunk.integers + offset, count);
+			}
+			else if (this->holdsIntegers() == false) {
+				this->kernels->decodeFloat(samples, this->source, chunk.floats + offset, count);
+			}
+			else if (this->source.bytes == sizeof(double)) {
+				this->kernels->decodeDouble(samples, this->source, chunk.integers + offset, count);
+			}
+			else
+			{
+				this->kernels->decodeFloat(samples, this->source, chunk.floats + offset, count);
+				this->kernels->floatToInteger(chunk.floats + offset, chunk.integers + offset, count);
+			}
+		}
+		
+		//Encodes samples from the intermediate representation, starting at the specified offset within the chunk
+		void encode(Chunk& chunk, uint64_t offset, uint8_t* samples, uint64_t count)
+		{
+			if (this->dest.isFloat == false)
+			{
+				if (this->ditherBits != 0) {
+					this->kernels->dither(chunk.integers + offset, count, this->ditherBits, &this->ditherState);
+				}
+				
+				this->kernels->encodeInteger(chunk.integers + offset, this->dest, samples, count);
+			}
+			else if (this->holdsIntegers() == false) {
+				this->kernels->encodeFloat(chunk.floats + offset, this->dest, samples, count);
+			}
+			else if (this->dest.bytes == sizeof(double)) {
+				this->kernels->encodeDouble(chunk.integers + offset, this->dest, samples, count);
+			}
+			else
+			{
+				this->kernels->integerToFloat(chunk.integers + offset, chunk.floats + offset, count);
+				this->kernels->encodeFloat(chunk.floats + offset, this->dest, samples, count);
+			}
+		}
+		
+		//Moves the intermediate representation of the samples in one chunk into another, reordering the channels
+		void shuffle(const Chunk& source, Chunk& dest, uint32_t channels, uint64_t frames, bool toPlanar) const
+		{
+			const void* in = ((this->holdsIntegers() == false) ? (const void*)(source.floats) : (const void*)(source.integers));
+			void* out = ((this->holdsIntegers() == false) ? (void*)(dest.floats) : (void*)(dest.integers));
+			if (toPlanar == true) {
+				this->kernels->deinterleave(in, out, channels, frames);
+			}
+			else {
+				this->kernels->interleave(in, out, channels, frames);
+			}
+		}
+	};
+	
+	//Prepares a conversion between two formats, returning false if this is unsupported
+	bool prepare(AudioFormat sourceFormat, AudioFormat destFormat, bool dither, Conversion& conversion)
+	{
+		if (sampleLayout(sourceFormat, conversion.source) == false || sampleLayout(destFormat, conversion.dest) == false) {
+			return false;
+		}
+		
+		//Dither only helps when the destination has fewer significant bits than the source
+		//(32-bit floats carry 24 bits of precision, so converting them to 32-bit integers loses nothing, while 64-bit floats
+		//carry more bits than the 32-bit intermediate representation can hold)
+		uint32_t sourceBits = ((conversion.source.isFloat == true) ? ((conversion.source.bytes == sizeof(double)) ? 32 : 24) : conversion.source.bytes * 8);
+		uint32_t destBits = conversion.dest.bytes * 8;
+		conversion.kernels = kernels();
+		conversion.ditherBits = ((dither == true && conversion.dest.isFloat == false && destBits < sourceBits) ? destBits : 0);
+		conversion.ditherState = ditherSeed.fetch_add(0x9E3779B9u, std::memory_order_relaxed);
+		conversion.ditherState = ((conversion.ditherState != 0) ? conversion.ditherState : 1);
+		return true;
+	}
+}
+
+bool AudioConverter::canConvert(AudioFormat source, AudioFormat dest)
+{
+	SampleLayout sourceLayout;
+	SampleLayout destLayout;
+	return (sampleLayout(source, sourceLayout) == true && sampleLayout(dest, destLayout) == true);
+}
+
+bool AudioConverter::convert(const uint8_t* source, AudioFormat sourceFormat, uint8_t* dest, AudioFormat destFormat, uint64_t samples, bool dither)
+{
+	Conversion conversion;
+	if (prepare(sourceFormat, destFormat, dither, conversion) == false) {
+		return false;
+	}
+	
+	//Identical formats are simply copied
+	if (sourceFormat == destFormat)
+	{
+		std::memcpy(dest, source, samples * conversion.source.bytes);
+		return true;
+	}
+	
+	if (conversion.reorders() == true)
+	{
+		conversion.kernels->reorder(source, conversion.source, dest, conversion.dest, samples);
+		return true;
+	}
+	
+	Chunk chunk;
+	for (uint64_t start = 0; start < samples; start += ChunkSamples)
+	{
+		uint64_t count = ((samples - start < ChunkSamples) ? samples - start : ChunkSamples);
+		conversion.decode(source + (start * conversion.source.bytes), chunk, 0, count);
+		conversion.encode(chunk, 0, dest + (start * conversion.dest.bytes), count);
+	}
+	
+	return true;
+}
+
+bool AudioConverter::deinterleave(const uint8_t* source, AudioFormat sourceFormat, uint8_t* const* planes, AudioFormat destFormat, uint32_t channels, uint64_t frames, bool dither)
+{
+	Conversion conversion;
+	if (channels == 0 || channels > AudioConverter::MaxChannels || prepare(sourceFormat, destFormat, dither, conversion) == false) {
+		return false;
+	}
+	
+	//64-bit floats cannot pass through the intermediate representation without losing precision, so they are reordered one sample
+	//at a time (this is the only conversion that is not vectorised)
+	if (conversion.reorders() == true && conversion.source.bytes == sizeof(double))
+	{
+		for (uint64_t frame = 0; frame < frames; ++frame)
+		{
+			for (uint32_t channel = 0; channel < channels; ++channel) {
+				reorderScalar(source + (((frame * channels) + channel) * sizeof(double)), conversion.source, planes[channel] + (frame * sizeof(double)), conversion.dest, 0, 1);
+			}
+		}
+		
+		return true;
+	}
+	
+	//Decode a chunk of frames, split it into planes, and then encode each plane
+	Chunk interleaved;
+	Chunk planar;
+	uint64_t chunkFrames = ChunkSamples / channels;
+	for (uint64_t start = 0; start < frames; start += chunkFrames)
+	{
+		uint64_t count = ((frames - start < chunkFrames) ? frames - start : chunkFrames);
+		conversion.decode(source + (start * channels * conversion.source.bytes), interleaved, 0, count * channels);
+		conversion.shuffle(interleaved, planar, channels, count, true);
+		for (uint32_t channel = 0; channel < channels; ++channel) {
+			conversion.encode(planar, channel * count, planes[channel] + (start * conversion.dest.bytes), count);
+		}
+	}
+	
+	return true;
+}
+
+bool AudioConverter::interleave(const uint8_t* const* planes, AudioFormat sourceFormat, uint8_t* dest, AudioFormat destFormat, uint32_t channels, uint64_t frames, bool dither)
+{
+	Conversion conversion;
+	if (channels == 0 || channels > AudioConverter::MaxChannels || prepare(sourceFormat, destFormat, dither, conversion) == false) {
+		return false;
+	}
+	
+	if (conversion.reorders() == true && conversion.source.bytes == sizeof(double))
+	{
+		for (uint64_t frame = 0; frame < frames; ++frame)
+		{
+			for (uint32_t channel = 0; channel < channels; ++channel) {
+				reorderScalar(planes[channel] + (frame * sizeof(double)), conversion.source, dest + (((frame * channels) + channel) * sizeof(double)), conversion.dest, 0, 1);
+			}
+		}
+		
+		return true;
+	}
+	
+	//Decode a chunk of frames from each plane, interleave them, and then encode the interleaved samples
+	Chunk planar;
+	Chunk interleaved;
+	uint64_t chunkFrames = ChunkSamples / channels;
+	for (uint64_t start = 0; start < frames; start += chunkFrames)
+	{
+		uint64_t count = ((frames - start < chunkFrames) ? frames - start : chunkFrames);
+		for (uint32_t channel = 0; channel < channels; ++channel) {
+			conversion.decode(planes[channel] + (start * conversion.source.bytes), planar, channel * count, count);
+		}
+		
+		conversion.shuffle(planar, interleaved, channels, count, false);
+		conversion.encode(interleaved, 0, dest + (start * channels * conversion.dest.bytes), count * channels);
+	}
+	
+	return true;
+}
+
+std::string AudioConverter::instructionSet() {
+	return kernels()->name;
+}
+
+bool AudioConverter::setInstructionSet(const std::string& name)
+{
+	const AudioKernels* candidates[] = {
+		((cpuSupportsAVX2() == true) ? avx2AudioKernels() : nullptr),
+		sse2AudioKernels(),
+		scalarAudioKernels()
+	};
+	
+	for (const AudioKernels* candidate : candidates)
+	{
+		if (candidate != nullptr && name == candidate->name)
+		{
+			activeKernels.store(candidate, std::memory_order_release);
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+} //End MediaIPC
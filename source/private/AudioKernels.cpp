@@ -0,0 +1,267 @@
+#include "AudioKernels.h"
+#include <math.h>
+#include <string.h>
+
+namespace MediaIPC {
+
+namespace
+{
+	//The scale between signed 32-bit values and floats, and the largest float that converts to a signed 32-bit value without overflowing
+	const float integerScale = 2147483648.0f;
+	const float largestInteger = 2147483520.0f;
+	
+	//The same for doubles, which can hold the largest signed 32-bit value exactly
+	const double integerScaleDouble = 2147483648.0;
+	const double largestIntegerDouble = 2147483647.0;
+	
+	//Reads a sample of up to eight bytes as an unsigned value in the specified byte order
+	inline uint64_t readSample(const uint8_t* sample, uint8_t bytes, bool bigEndian)
+	{
+		uint64_t value = 0;
+		for (uint8_t byte = 0; byte < bytes; ++byte) {
+			value = (value << 8) | sample[(bigEndian == true) ? byte : (bytes - 1 - byte)];
+		}
+		
+		return value;
+	}
+	
+	//Writes a sample of up to eight bytes in the specified byte order
+	inline void writeSample(uint8_t* sample, uint64_t value, uint8_t bytes, bool bigEndian)
+	{
+		for (uint8_t byte = 0; byte < bytes; ++byte) {
+			sample[(bigEndian == true) ? (bytes - 1 - byte) : byte] = (uint8_t)(value >> (byte * 8));
+		}
+	}
+	
+	//Adds two signed 32-bit values, saturating rather than wrapping
+	inline int32_t saturatingAdd(int32_t value, int32_t offset)
+	{
+		int64_t sum = (int64_t)(value) + offset;
+		return (int32_t)((sum > INT32_MAX) ? INT32_MAX : ((sum < INT32_MIN) ? INT32_MIN : sum));
+	}
+	
+	void reorderFull(const uint8_t* source, const SampleLayout& sourceLayout, uint8_t* dest, const SampleLayout& destLayout, uint64_t count) {
+		reorderScalar(source, sourceLayout, dest, destLayout, 0, count);
+	}
+	
+	void decodeIntegerFull(const uint8_t* source, const SampleLayout& layout, int32_t* dest, uint64_t count) {
+		decodeIntegerScalar(source, layout, dest, 0, count);
+	}
+	
+	void encodeIntegerFull(const int32_t* source, const SampleLayout& layout, uint8_t* dest, uint64_t count) {
+		encodeIntegerScalar(source, layout, dest, 0, count);
+	}
+	
+	void decodeFloatFull(const uint8_t* source, const SampleLayout& layout, float* dest, uint64_t count) {
+		decodeFloatScalar(source, layout, dest, 0, count);
+	}
+	
+	void encodeFloatFull(const float* source, const SampleLayout& layout, uint8_t* dest, uint64_t count) {
+		encodeFloatScalar(source, layout, dest, 0, count);
+	}
+	
+	void integerToFloatFull(const int32_t* source, float* dest, uint64_t count) {
+		integerToFloatScalar(source, dest, 0, count);
+	}
+	
+	void floatToIntegerFull(const float* source, int32_t* dest, uint64_t count) {
+		floatToIntegerScalar(source, dest, 0, count);
+	}
+	
+	void decodeDoubleFull(const uint8_t* source, const SampleLayout& layout, int32_t* dest, uint64_t count) {
+		decodeDoubleScalar(source, layout, dest, 0, count);
+	}
+	
+	void encodeDoubleFull(const int32_t* source, const SampleLayout& layout, uint8_t* dest, uint64_t count) {
+		encodeDoubleScalar(source, layout, dest, 0, count);
+	}
+	
+	void ditherFull(int32_t* samples, uint64_t count, uint32_t bits, uint32_t* state) {
+		ditherScalar(samples, 0, count, bits, state);
+	}
+	
+	void deinterleaveFull(const void* source, void* dest, uint32_t channels, uint64_t frames) {
+		deinterleaveScalar(source, dest, channels, 0, frames);
+	}
+	
+	void interleaveFull(const void* source, void* dest, uint32_t channels, uint64_t frames) {
+		interleaveScalar(source, dest, channels, 0, frames);
+	}
+	
+	const AudioKernels kernels = {
+		"Scalar",
+		&reorderFull,
+		&decodeIntegerFull,
+		&encodeIntegerFull,
+		&decodeFloatFull,
+		&encodeFloatFull,
+		&integerToFloatFull,
+		&floatToIntegerFull,
+		&decodeDoubleFull,
+		&encodeDoubleFull,
+		&ditherFull,
+		&deinterleaveFull,
+		&interleaveFull
+	};
+}
+
+void reorderScalar(const uint8_t* source, const SampleLayout& sourceLayout, uint8_t* dest, const SampleLayout& destLayout, uint64_t start, uint64_t count)
+{
+	//Flipping the most significant bit converts between signed and unsigned (offset binary) integers
+	uint64_t flip = ((sourceLayout.isSigned != destLayout.isSigned) ? (uint64_t)(1) << ((sourceLayout.bytes * 8) - 1) : 0);
+	for (uint64_t index = start; index < count; ++index)
+	{
+		uint64_t value = readSample(source + (index * sourceLayout.bytes), sourceLayout.bytes, sourceLayout.bigEndian);
+		writeSample(dest + (index * destLayout.bytes), value ^ flip, destLayout.bytes, destLayout.bigEndian);
+	}
+}
+
+void decodeIntegerScalar(const uint8_t* source, const SampleLayout& layout, int32_t* dest, uint64_t start, uint64_t count)
+{
+	uint32_t shift = 32 - (layout.bytes * 8);
+	uint32_t flip = ((layout.isSigned == false) ? 0x80000000u : 0);
+	for (uint64_t index = start; index < count; ++index)
+	{
+		uint32_t value = (uint32_t)(readSample(source + (index * layout.bytes), layout.bytes, layout.bigEndian));
+		dest[index] = (int32_t)((value << shift) ^ flip);
+	}
+}
+
+void encodeIntegerScalar(const int32_t* source, const SampleLayout& layout, uint8_t* dest, uint64_t start, uint64_t count)
+{
+	uint32_t shift = 32 - (layout.bytes * 8);
+	uint32_t flip = ((layout.isSigned == false) ? 0x80000000u : 0);
+	for (uint64_t index = start; index < count; ++index) {
+		writeSample(dest + (index * layout.bytes), (((uint32_t)(source[index]) ^ flip) >> shift), layout.bytes, layout.bigEndian);
+	}
+}
+
+void decodeFloatScalar(const uint8_t* source, const SampleLayout& layout, float* dest, uint64_t start, uint64_t count)
+{
+	for (uint64_t index = start; index < count; ++index)
+	{
+		uint64_t bits = readSample(source + (index * layout.bytes), layout.bytes, layout.bigEndian);
+		if (layout.bytes == sizeof(double))
+		{
+			double value = 0.0;
+			memcpy(&value, &bits, sizeof(double));
+			dest[index] = (float)(value);
+		}
+		else
+		{
+			uint32_t narrow = (uint32_t)(bits);
+			memcpy(&dest[index], &narrow, sizeof(float));
+		}
+	}
+}
+
+void encodeFloatScalar(const float* source, const SampleLayout& layout, uint8_t* dest, uint64_t start, uint64_t count)
+{
+	for (uint64_t index = start; index < count; ++index)
+	{
+		uint64_t bits = 0;
+		if (layout.bytes == sizeof(double))
+		{
+			double value = source[index];
+			memcpy(&bits, &value, sizeof(double));
+		}
+		else
+		{
+			uint32_t narrow = 0;
+			memcpy(&narrow, &source[index], sizeof(float));
+			bits = narrow;
+		}
+		
+		writeSample(dest + (index * layout.bytes), bits, layout.bytes, layout.bigEndian);
+	}
+}
+
+void integerToFloatScalar(const int32_t* source, float* dest, uint64_t start, uint64_t count)
+{
+	for (uint64_t index = start; index < count; ++index) {
+		dest[index] = (float)(source[index]) * (1.0f / integerScale);
+	}
+}
+
+void floatToIntegerScalar(const float* source, int32_t* dest, uint64_t start, uint64_t count)
+{
+	//Round to the nearest value with ties to even, as the SIMD conversion instructions do under the default rounding mode
+	for (uint64_t index = start; index < count; ++index)
+	{
+		float scaled = source[index] * integerScale;
+		scaled = ((scaled < largestInteger) ? scaled : largestInteger);
+		scaled = ((scaled > -integerScale) ? scaled : -integerScale);
+		dest[index] = (int32_t)(nearbyintf(scaled));
+	}
+}
+
+void decodeDoubleScalar(const uint8_t* source, const SampleLayout& layout, int32_t* dest, uint64_t start, uint64_t count)
+{
+	for (uint64_t index = start; index < count; ++index)
+	{
+		uint64_t bits = readSample(source + (index * sizeof(double)), sizeof(double), layout.bigEndian);
+		double value = 0.0;
+		memcpy(&value, &bits, sizeof(double));
+		
+		double scaled = value * integerScaleDouble;
+		scaled = ((scaled < largestIntegerDouble) ? scaled : largestIntegerDouble);
+		scaled = ((scaled > -integerScaleDouble) ? scaled : -integerScaleDouble);
+		dest[index] = (int32_t)(nearbyint(scaled));
+	}
+}
+
+void encodeDoubleScalar(const int32_t* source, const SampleLayout& layout, uint8_t* dest, uint64_t start, uint64_t count)
+{
+	for (uint64_t index = start; index < count; ++index)
+	{
+		double value = (double)(source[index]) * (1.0 / integerScaleDouble);
+		uint64_t bits = 0;
+		memcpy(&bits, &value, sizeof(double));
+		writeSample(dest + (index * sizeof(double)), bits, sizeof(double), layout.bigEndian);
+	}
+}
+
+void ditherScalar(int32_t* samples, uint64_t start, uint64_t count, uint32_t bits, uint32_t* state)
+{
+	//The difference of two uniform values spanning one step has a triangular distribution spanning two steps
+	uint32_t generator = *state;
+	int32_t half = (int32_t)(1u << (31 - bits));
+	for (uint64_t index = start; index < count; ++index)
+	{
+		int32_t first = (int32_t)(xorshift(generator) >> bits);
+		int32_t second = (int32_t)(xorshift(generator) >> bits);
+		samples[index] = saturatingAdd(samples[index], (first - second) + half);
+	}
+	
+	*state = generator;
+}
+
+void deinterleaveScalar(const void* source, void* dest, uint32_t channels, uint64_t start, uint64_t frames)
+{
+	const uint8_t* in = (const uint8_t*)(source);
+	uint8_t* out = (uint8_t*)(dest);
+	for (uint64_t frame = start; frame < frames; ++frame)
+	{
+		for (uint32_t channel = 0; channel < channels; ++channel) {
+			memcpy(out + (((channel * frames) + frame) * 4), in + (((frame * channels) + channel) * 4), 4);
+		}
+	}
+}
+
+void interleaveScalar(const void* source, void* dest, uint32_t channels, uint64_t start, uint64_t frames)
+{
+	const uint8_t* in = (const uint8_t*)(source);
+	uint8_t* out = (uint8_t*)(dest);
+	for (uint64_t frame = start; frame < frames; ++frame)
+	{
+		for (uint32_t channel = 0; channel < channels; ++channel) {
+			memcpy(out + (((frame * channels) + channel) * 4), in + (((channel * frames) + frame) * 4), 4);
+		}
+	}
+}
+
+const AudioKernels* scalarAudioKernels() {
+	return &kernels;
+}
+
+} //End MediaIPC
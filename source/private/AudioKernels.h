@@ -0,0 +1,93 @@
+#ifndef _MEDIA_IPC_AUDIO_KERNELS
+#define _MEDIA_IPC_AUDIO_KERNELS
+
+#include <stdint.h>
+
+namespace MediaIPC {
+
+//Describes how a PCM sample format stores each sample
+struct SampleLayout
+{
+	//The number of bytes per sample (1, 2, 3, 4 or 8)
+	uint8_t bytes;
+	
+	//Whether the most significant byte is stored first
+	bool bigEndian;
+	
+	//Whether integer samples are signed (always true for floating-point samples)
+	bool isSigned;
+	
+	//Whether samples are IEEE floating-point values
+	bool isFloat;
+};
+
+//Block-level audio sample conversion kernels for a particular instruction set
+//(Integer samples are converted via signed 32-bit values holding the sample in their most significant bits, and floating-point
+//samples via 32-bit floats nominally in the range [-1.0, 1.0), so every format only needs to be decoded and encoded once)
+//(Note that the SIMD kernels are compiled with instruction set flags, so this header must not pull in any inline library code)
+struct AudioKernels
+{
+	//The name of the instruction set
+	const char* name;
+	
+	//Converts samples between two layouts of the same width that differ only in byte order or signedness
+	void (*reorder)(const uint8_t* source, const SampleLayout& sourceLayout, uint8_t* dest, const SampleLayout& destLayout, uint64_t count);
+	
+	//Converts integer samples to and from signed 32-bit values (encoding simply discards the bits that do not fit)
+	void (*decodeInteger)(const uint8_t* source, const SampleLayout& layout, int32_t* dest, uint64_t count);
+	void (*encodeInteger)(const int32_t* source, const SampleLayout& layout, uint8_t* dest, uint64_t count);
+	
+	//Converts floating-point samples to and from 32-bit floats
+	void (*decodeFloat)(const uint8_t* source, const SampleLayout& layout, float* dest, uint64_t count);
+	void (*encodeFloat)(const float* source, const SampleLayout& layout, uint8_t* dest, uint64_t count);
+	
+	//Converts between signed 32-bit values and floats, clamping floats outside [-1.0, 1.0) and rounding to the nearest value
+	void (*integerToFloat)(const int32_t* source, float* dest, uint64_t count);
+	void (*floatToInteger)(const float* source, int32_t* dest, uint64_t count);
+	
+	//Converts 64-bit float samples directly to and from signed 32-bit values, since 32-bit floats only hold 24 bits of each
+	//(Decoding clamps and rounds like floatToInteger(), and encoding is exact)
+	void (*decodeDouble)(const uint8_t* source, const SampleLayout& layout, int32_t* dest, uint64_t count);
+	void (*encodeDouble)(const int32_t* source, const SampleLayout& layout, uint8_t* dest, uint64_t count);
+	
+	//Adds triangular dither of one step at the specified bit depth to signed 32-bit values, offset by half a step so that the
+	//bits discarded by encodeInteger() are rounded rather than truncated, saturating rather than wrapping
+	//(The state is that of a xorshift generator, and must be non-zero)
+	void (*dither)(int32_t* samples, uint64_t count, uint32_t bits, uint32_t* state);
+	
+	//Splits interleaved 32-bit values into consecutive planes of the specified number of frames each, and the reverse
+	void (*deinterleave)(const void* source, void* dest, uint32_t channels, uint64_t frames);
+	void (*interleave)(const void* source, void* dest, uint32_t channels, uint64_t frames);
+};
+
+//Scalar kernels that start at the specified sample or frame, which the SIMD kernels use to process the remainder of each block
+void reorderScalar(const uint8_t* source, const SampleLayout& sourceLayout, uint8_t* dest, const SampleLayout& destLayout, uint64_t start, uint64_t count);
+void decodeIntegerScalar(const uint8_t* source, const SampleLayout& layout, int32_t* dest, uint64_t start, uint64_t count);
+void encodeIntegerScalar(const int32_t* source, const SampleLayout& layout, uint8_t* dest, uint64_t start, uint64_t count);
+void decodeFloatScalar(const uint8_t* source, const SampleLayout& layout, float* dest, uint64_t start, uint64_t count);
+void encodeFloatScalar(const float* source, const SampleLayout& layout, uint8_t* dest, uint64_t start, uint64_t count);
+void integerToFloatScalar(const int32_t* source, float* dest, uint64_t start, uint64_t count);
+void floatToIntegerScalar(const float* source, int32_t* dest, uint64_t start, uint64_t count);
+void decodeDoubleScalar(const uint8_t* source, const SampleLayout& layout, int32_t* dest, uint64_t start, uint64_t count);
+void encodeDoubleScalar(const int32_t* source, const SampleLayout& layout, uint8_t* dest, uint64_t start, uint64_t count);
+void ditherScalar(int32_t* samples, uint64_t start, uint64_t count, uint32_t bits, uint32_t* state);
+void deinterleaveScalar(const void* source, void* dest, uint32_t channels, uint64_t start, uint64_t frames);
+void interleaveScalar(const void* source, void* dest, uint32_t channels, uint64_t start, uint64_t frames);
+
+//Advances a xorshift generator and returns its new state
+inline uint32_t xorshift(uint32_t& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+//Retrieves the kernels for each instruction set (nullptr if the library was built without support for the instruction set)
+const AudioKernels* scalarAudioKernels();
+const AudioKernels* sse2AudioKernels();
+const AudioKernels* avx2AudioKernels();
+
+} //End MediaIPC
+
+#endif
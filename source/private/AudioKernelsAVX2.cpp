@@ -0,0 +1,432 @@
+#include "AudioKernels.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+
+namespace MediaIPC {
+
+namespace
+{
+	//Builds a shuffle mask that reverses the bytes of each sample of the specified width within each 128-bit lane
+	__m256i swapMask(uint8_t bytes)
+	{
+		int8_t mask[32];
+		for (uint32_t index = 0; index < 32; ++index) {
+			mask[index] = (int8_t)((((index % 16) / bytes) * bytes) + (bytes - 1 - (index % bytes)));
+		}
+		
+		return _mm256_loadu_si256((const __m256i*)(mask));
+	}
+	
+	//Builds a mask that selects the most significant bit of each sample of the specified width and byte order
+	__m256i signMask(uint8_t bytes, bool bigEndian)
+	{
+		uint8_t mask[32] = {0};
+		for (uint32_t sample = 0; sample < 32; sample += bytes) {
+			mask[sample + ((bigEndian == true) ? 0 : bytes - 1)] = 0x80;
+		}
+		
+		return _mm256_loadu_si256((const __m256i*)(mask));
+	}
+	
+	//Builds a shuffle mask that widens four packed 24-bit samples in each 128-bit lane into the top of 32-bit values
+	__m256i unpack24Mask(bool bigEndian)
+	{
+		int8_t mask[32];
+		for (uint32_t index = 0; index < 32; ++index)
+		{
+			uint32_t sample = (index % 16) / 4;
+			uint32_t byte = index % 4;
+			mask[index] = (int8_t)((byte == 0) ? -1 : (sample * 3) + ((bigEndian == true) ? 3 - byte : byte - 1));
+		}
+		
+		return _mm256_loadu_si256((const __m256i*)(mask));
+	}
+	
+	//Builds a shuffle mask that narrows the top of four 32-bit values in each 128-bit lane into packed 24-bit samples
+	__m256i pack24Mask(bool bigEndian)
+	{
+		int8_t mask[32];
+		for (uint32_t index = 0; index < 32; ++index)
+		{
+			uint32_t sample = (index % 16) / 3;
+			uint32_t byte = (index % 16) % 3;
+			mask[index] = (int8_t)(((index % 16) >= 12) ? -1 : (sample * 4) + ((bigEndian == true) ? 3 - byte : byte + 1));
+		}
+		
+		return _mm256_loadu_si256((const __m256i*)(mask));
+	}
+	
+	//Adds signed 32-bit values, saturating rather than wrapping
+	inline __m256i saturatingAdd(__m256i values, __m256i offsets)
+	{
+		__m256i sum = _mm256_add_epi32(values, offsets);
+		__m256i overflowed = _mm256_srai_epi32(_mm256_and_si256(_mm256_xor_si256(values, sum), _mm256_xor_si256(offsets, sum)), 31);
+		__m256i saturated = _mm256_xor_si256(_mm256_srai_epi32(values, 31), _mm256_set1_epi32(0x7FFFFFFF));
+		return _mm256_blendv_epi8(sum, saturated, overflowed);
+	}
+	
+	//Advances eight xorshift generators at once
+	inline __m256i xorshift8(__m256i state)
+	{
+		state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 13));
+		state = _mm256_xor_si256(state, _mm256_srli_epi32(state, 17));
+		return _mm256_xor_si256(state, _mm256_slli_epi32(state, 5));
+	}
+	
+	void reorder(const uint8_t* source, const SampleLayout& sourceLayout, uint8_t* dest, const SampleLayout& destLayout, uint64_t count)
+	{
+		//Packed 24-bit samples straddle the vectors, so they are left to the scalar kernel
+		uint64_t index = 0;
+		uint8_t bytes = sourceLayout.bytes;
+		if (bytes != 3)
+		{
+			bool swap = (sourceLayout.bigEndian != destLayout.bigEndian && bytes > 1);
+			__m256i shuffle = swapMask(bytes);
+			__m256i flip = ((sourceLayout.isSigned != destLayout.isSigned) ? signMask(bytes, destLayout.bigEndian) : _mm256_setzero_si256());
+			uint64_t step = 32 / bytes;
+			for (; index + step <= count; index += step)
+			{
+				__m256i values = _mm256_loadu_si256((const __m256i*)(source + (index * bytes)));
+				values = ((swap == true) ? _mm256_shuffle_epi8(values, shuffle) : values);
+				_mm256_storeu_si256((__m256i*)(dest + (index * bytes)), _mm256_xor_si256(values, flip));
+			}
+		}
+		
+		reorderScalar(source, sourceLayout, dest, destLayout, index, count);
+	}
+	
+	void decodeInteger(const uint8_t* source, const SampleLayout& layout, int32_t* dest, uint64_t count)
+	{
+		uint64_t index = 0;
+		bool swap = (layout.bigEndian == true);
+		__m256i flip = _mm256_set1_epi32((layout.isSigned == false) ? (int)(0x80000000u) : 0);
+		if (layout.bytes == 1)
+		{
+			for (; index + 8 <= count; index += 8)
+			{
+				__m256i values = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(source + index)));
+				_mm256_storeu_si256((__m256i*)(dest + index), _mm256_xor_si256(_mm256_slli_epi32(values, 24), flip));
+			}
+		}
+		else if (layout.bytes == 2)
+		{
+			__m128i shuffle = _mm256_castsi256_si128(swapMask(2));
+			for (; index + 8 <= count; index += 8)
+			{
+				__m128i packed = _mm_loadu_si128((const __m128i*)(source + (index * 2)));
+				__m256i values = _mm256_cvtepu16_epi32((swap == true) ? _mm_shuffle_epi8(packed, shuffle) : packed);
+				_mm256_storeu_si256((__m256i*)(dest + index), _mm256_xor_si256(_mm256_slli_epi32(values, 16), flip));
+			}
+		}
+		else if (layout.bytes == 3)
+		{
+			//Each iteration reads 32 bytes but only consumes 24 of them, so stop while the read stays inside the block
+			//(The permutation moves the second group of four samples, which starts at byte 12, into the upper lane)
+			__m256i shuffle = unpack24Mask(swap);
+			__m256i permutation = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+			for (; index + 11 <= count; index += 8)
+			{
+				__m256i values = _mm256_loadu_si256((const __m256i*)(source + (index * 3)));
+				values = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(values, permutation), shuffle);
+				_mm256_storeu_si256((__m256i*)(dest + index), _mm256_xor_si256(values, flip));
+			}
+		}
+		else if (layout.bytes == 4)
+		{
+			__m256i shuffle = swapMask(4);
+			for (; index + 8 <= count; index += 8)
+			{
+				__m256i values = _mm256_loadu_si256((const __m256i*)(source + (index * 4)));
+				values = ((swap == true) ? _mm256_shuffle_epi8(values, shuffle) : values);
+				_mm256_storeu_si256((__m256i*)(dest + index), _mm256_xor_si256(values, flip));
+			}
+		}
+		
+		decodeIntegerScalar(source, layout, dest, index, count);
+	}
+	
+	void encodeInteger(const int32_t* source, const SampleLayout& layout, uint8_t* dest, uint64_t count)
+	{
+		uint64_t index = 0;
+		bool swap = (layout.bigEndian == true);
+		if (layout.bytes == 1)
+		{
+			__m128i flip = _mm_set1_epi8((layout.isSigned == false) ? (char)(0x80) : 0);
+			for (; index + 8 <= count; index += 8)
+			{
+				__m256i values = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i*)(source + index)), 24);
+				__m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1));
+				_mm_storel_epi64((__m128i*)(dest + index), _mm_xor_si128(_mm_packs_epi16(packed, packed), flip));
+			}
+		}
+		else if (layout.bytes == 2)
+		{
+			__m128i flip = _mm_set1_epi16((layout.isSigned == false) ? (short)(0x8000) : 0);
+			__m128i shuffle = _mm256_castsi256_si128(swapMask(2));
+			for (; index + 8 <= count; index += 8)
+			{
+				__m256i values = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i*)(source + index)), 16);
+				__m128i packed = _mm_xor_si128(_mm_packs_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1)), flip);
+				_mm_storeu_si128((__m128i*)(dest + (index * 2)), ((swap == true) ? _mm_shuffle_epi8(packed, shuffle) : packed));
+			}
+		}
+		else if (layout.bytes == 3)
+		{
+			//Pack each lane into its lowest 12 bytes, then close the gap between the lanes and write exactly 24 bytes
+			__m256i flip = _mm256_set1_epi32((layout.isSigned == false) ? (int)(0x80000000u) : 0);
+			__m256i shuffle = pack24Mask(swap);
+			__m256i permutation = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+			for (; index + 8 <= count; index += 8)
+			{
+				__m256i values = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(source + index)), flip);
+				values = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(values, shuffle), permutation);
+				_mm_storeu_si128((__m128i*)(dest + (index * 3)), _mm256_castsi256_si128(values));
+				_mm_storel_epi64((__m128i*)(dest + (index * 3) + 16), _mm256_extracti128_si256(values, 1));
+			}
+		}
+		else if (layout.bytes == 4)
+		{
+			__m256i flip = _mm256_set1_epi32((layout.isSigned == false) ? (int)(0x80000000u) : 0);
+			__m256i shuffle = swapMask(4);
+			for (; index + 8 <= count; index += 8)
+			{
+				__m256i values = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(source + index)), flip);
+				_mm256_storeu_si256((__m256i*)(dest + (index * 4)), ((swap == true) ? _mm256_shuffle_epi8(values, shuffle) : values));
+			}
+		}
+		
+		encodeIntegerScalar(source, layout, dest, index, count);
+	}
+	
+	void decodeFloat(const uint8_t* source, const SampleLayout& layout, float* dest, uint64_t count)
+	{
+		uint64_t index = 0;
+		bool swap = (layout.bigEndian == true);
+		__m256i shuffle = swapMask(layout.bytes);
+		if (layout.bytes == 4)
+		{
+			for (; index + 8 <= count; index += 8)
+			{
+				__m256i values = _mm256_loadu_si256((const __m256i*)(source + (index * 4)));
+				values = ((swap == true) ? _mm256_shuffle_epi8(values, shuffle) : values);
+				_mm256_storeu_ps(dest + index, _mm256_castsi256_ps(values));
+			}
+		}
+		else
+		{
+			for (; index + 8 <= count; index += 8)
+			{
+				__m256i first = _mm256_loadu_si256((const __m256i*)(source + (index * 8)));
+				__m256i second = _mm256_loadu_si256((const __m256i*)(source + (index * 8) + 32));
+				__m128 low = _mm256_cvtpd_ps(_mm256_castsi256_pd((swap == true) ? _mm256_shuffle_epi8(first, shuffle) : first));
+				__m128 high = _mm256_cvtpd_ps(_mm256_castsi256_pd((swap == true) ? _mm256_shuffle_epi8(second, shuffle) : second));
+				_mm256_storeu_ps(dest + index, _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1));
+			}
+		}
+		
+		decodeFloatScalar(source, layout, dest, index, count);
+	}
+	
+	void encodeFloat(const float* source, const SampleLayout& layout, uint8_t* dest, uint64_t count)
+	{
+		uint64_t index = 0;
+		bool swap = (layout.bigEndian == true);
+		__m256i shuffle = swapMask(layout.bytes);
+		if (layout.bytes == 4)
+		{
+			for (; index + 8 <= count; index += 8)
+			{
+				__m256i values = _mm256_castps_si256(_mm256_loadu_ps(source + index));
+				_mm256_storeu_si256((__m256i*)(dest + (index * 4)), ((swap == true) ? _mm256_shuffle_epi8(values, shuffle) : values));
+			}
+		}
+		else
+		{
+			for (; index + 8 <= count; index += 8)
+			{
+				__m256 values = _mm256_loadu_ps(source + index);
+				__m256i low = _mm256_castpd_si256(_mm256_cvtps_pd(_mm256_castps256_ps128(values)));
+				__m256i high = _mm256_castpd_si256(_mm256_cvtps_pd(_mm256_extractf128_ps(values, 1)));
+				_mm256_storeu_si256((__m256i*)(dest + (index * 8)), ((swap == true) ? _mm256_shuffle_epi8(low, shuffle) : low));
+				_mm256_storeu_si256((__m256i*)(dest + (index * 8) + 32), ((swap == true) ? _mm256_shuffle_epi8(high, shuffle) : high));
+			}
+		}
+		
+		encodeFloatScalar(source, layout, dest, index, count);
+	}
+	
+	void integerToFloat(const int32_t* source, float* dest, uint64_t count)
+	{
+		uint64_t index = 0;
+		__m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+		for (; index + 8 <= count; index += 8) {
+			_mm256_storeu_ps(dest + index, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(source + index))), scale));
+		}
+		
+		integerToFloatScalar(source, dest, index, count);
+	}
+	
+	void floatToInteger(const float* source, int32_t* dest, uint64_t count)
+	{
+		uint64_t index = 0;
+		__m256 scale = _mm256_set1_ps(2147483648.0f);
+		__m256 largest = _mm256_set1_ps(2147483520.0f);
+		__m256 smallest = _mm256_set1_ps(-2147483648.0f);
+		for (; index + 8 <= count; index += 8)
+		{
+			__m256 scaled = _mm256_max_ps(_mm256_min_ps(_mm256_mul_ps(_mm256_loadu_ps(source + index), scale), largest), smallest);
+			_mm256_storeu_si256((__m256i*)(dest + index), _mm256_cvtps_epi32(scaled));
+		}
+		
+		floatToIntegerScalar(source, dest, index, count);
+	}
+	
+	void decodeDouble(const uint8_t* source, const SampleLayout& layout, int32_t* dest, uint64_t count)
+	{
+		uint64_t index = 0;
+		bool swap = (layout.bigEndian == true);
+		__m256i shuffle = swapMask(8);
+		__m256d scale = _mm256_set1_pd(2147483648.0);
+		__m256d largest = _mm256_set1_pd(2147483647.0);
+		__m256d smallest = _mm256_set1_pd(-2147483648.0);
+		for (; index + 8 <= count; index += 8)
+		{
+			__m256i first = _mm256_loadu_si256((const __m256i*)(source + (index * 8)));
+			__m256i second = _mm256_loadu_si256((const __m256i*)(source + (index * 8) + 32));
+			__m256d low = _mm256_castsi256_pd((swap == true) ? _mm256_shuffle_epi8(first, shuffle) : first);
+			__m256d high = _mm256_castsi256_pd((swap == true) ? _mm256_shuffle_epi8(second, shuffle) : second);
+			low = _mm256_max_pd(_mm256_min_pd(_mm256_mul_pd(low, scale), largest), smallest);
+			high = _mm256_max_pd(_mm256_min_pd(_mm256_mul_pd(high, scale), largest), smallest);
+			__m256i packed = _mm256_insertf128_si256(_mm256_castsi128_si256(_mm256_cvtpd_epi32(low)), _mm256_cvtpd_epi32(high), 1);
+			_mm256_storeu_si256((__m256i*)(dest + index), packed);
+		}
+		
+		decodeDoubleScalar(source, layout, dest, index, count);
+	}
+	
+	void encodeDouble(const int32_t* source, const SampleLayout& layout, uint8_t* dest, uint64_t count)
+	{
+		uint64_t index = 0;
+		bool swap = (layout.bigEndian == true);
+		__m256i shuffle = swapMask(8);
+		__m256d scale = _mm256_set1_pd(1.0 / 2147483648.0);
+		for (; index + 8 <= count; index += 8)
+		{
+			__m256i values = _mm256_loadu_si256((const __m256i*)(source + index));
+			__m256i low = _mm256_castpd_si256(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(values)), scale));
+			__m256i high = _mm256_castpd_si256(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(values, 1)), scale));
+			_mm256_storeu_si256((__m256i*)(dest + (index * 8)), ((swap == true) ? _mm256_shuffle_epi8(low, shuffle) : low));
+			_mm256_storeu_si256((__m256i*)(dest + (index * 8) + 32), ((swap == true) ? _mm256_shuffle_epi8(high, shuffle) : high));
+		}
+		
+		encodeDoubleScalar(source, layout, dest, index, count);
+	}
+	
+	void dither(int32_t* samples, uint64_t count, uint32_t bits, uint32_t* state)
+	{
+		//Give each lane its own generator, seeded from the caller's generator
+		uint64_t index = 0;
+		if (count >= 8)
+		{
+			uint32_t seeds[8];
+			for (uint32_t lane = 0; lane < 8; ++lane) {
+				seeds[lane] = xorshift(*state);
+			}
+			
+			__m256i generators = _mm256_loadu_si256((const __m256i*)(seeds));
+			__m128i shift = _mm_cvtsi32_si128((int)(bits));
+			__m256i half = _mm256_set1_epi32((int)(1u << (31 - bits)));
+			for (; index + 8 <= count; index += 8)
+			{
+				generators = xorshift8(generators);
+				__m256i first = _mm256_srl_epi32(generators, shift);
+				generators = xorshift8(generators);
+				__m256i second = _mm256_srl_epi32(generators, shift);
+				__m256i noise = _mm256_add_epi32(_mm256_sub_epi32(first, second), half);
+				__m256i values = _mm256_loadu_si256((const __m256i*)(samples + index));
+				_mm256_storeu_si256((__m256i*)(samples + index), saturatingAdd(values, noise));
+			}
+			
+			*state = (uint32_t)(_mm256_extract_epi32(generators, 0));
+		}
+		
+		ditherScalar(samples, index, count, bits, state);
+	}
+	
+	void deinterleave(const void* source, void* dest, uint32_t channels, uint64_t frames)
+	{
+		//Only stereo is common enough to warrant a dedicated kernel
+		uint64_t frame = 0;
+		if (channels == 2)
+		{
+			const int32_t* in = (const int32_t*)(source);
+			int32_t* out = (int32_t*)(dest);
+			__m256i permutation = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+			for (; frame + 8 <= frames; frame += 8)
+			{
+				__m256i first = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)(in + (frame * 2))), permutation);
+				__m256i second = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)(in + (frame * 2) + 8)), permutation);
+				_mm256_storeu_si256((__m256i*)(out + frame), _mm256_permute2x128_si256(first, second, 0x20));
+				_mm256_storeu_si256((__m256i*)(out + frames + frame), _mm256_permute2x128_si256(first, second, 0x31));
+			}
+		}
+		
+		deinterleaveScalar(source, dest, channels, frame, frames);
+	}
+	
+	void interleave(const void* source, void* dest, uint32_t channels, uint64_t frames)
+	{
+		uint64_t frame = 0;
+		if (channels == 2)
+		{
+			const int32_t* in = (const int32_t*)(source);
+			int32_t* out = (int32_t*)(dest);
+			for (; frame + 8 <= frames; frame += 8)
+			{
+				__m256i left = _mm256_loadu_si256((const __m256i*)(in + frame));
+				__m256i right = _mm256_loadu_si256((const __m256i*)(in + frames + frame));
+				__m256i low = _mm256_unpacklo_epi32(left, right);
+				__m256i high = _mm256_unpackhi_epi32(left, right);
+				_mm256_storeu_si256((__m256i*)(out + (frame * 2)), _mm256_permute2x128_si256(low, high, 0x20));
+				_mm256_storeu_si256((__m256i*)(out + (frame * 2) + 8), _mm256_permute2x128_si256(low, high, 0x31));
+			}
+		}
+		
+		interleaveScalar(source, dest, channels, frame, frames);
+	}
+	
+	const AudioKernels kernels = {
+		"AVX2",
+		&reorder,
+		&decodeInteger,
+		&encodeInteger,
+		&decodeFloat,
+		&encodeFloat,
+		&integerToFloat,
+		&floatToInteger,
+		&decodeDouble,
+		&encodeDouble,
+		&dither,
+		&deinterleave,
+		&interleave
+	};
+}
+
+const AudioKernels* avx2AudioKernels() {
+	return &kernels;
+}
+
+} //End MediaIPC
+
+#else
+
+namespace MediaIPC {
+
+const AudioKernels* avx2AudioKernels() {
+	return nullptr;
+}
+
+} //End MediaIPC
+
+#endif
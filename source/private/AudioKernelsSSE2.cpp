@@ -0,0 +1,390 @@
+#include "AudioKernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+
+namespace MediaIPC {
+
+namespace
+{
+	//Reverses the bytes of each 16-bit, 32-bit or 64-bit value
+	inline __m128i swap16(__m128i values) {
+		return _mm_or_si128(_mm_slli_epi16(values, 8), _mm_srli_epi16(values, 8));
+	}
+	
+	inline __m128i swap32(__m128i values) {
+		return swap16(_mm_shufflehi_epi16(_mm_shufflelo_epi16(values, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1)));
+	}
+	
+	inline __m128i swap64(__m128i values) {
+		return _mm_shuffle_epi32(swap32(values), _MM_SHUFFLE(2, 3, 0, 1));
+	}
+	
+	inline __m128i swapBytes(__m128i values, uint8_t bytes)
+	{
+		switch (bytes)
+		{
+			case 2: return swap16(values);
+			case 4: return swap32(values);
+			case 8: return swap64(values);
+			default: return values;
+		}
+	}
+	
+	//Builds a mask that selects the most significant bit of each sample of the specified width and byte order
+	__m128i signMask(uint8_t bytes, bool bigEndian)
+	{
+		uint8_t mask[16] = {0};
+		for (uint32_t sample = 0; sample < 16; sample += bytes) {
+			mask[sample + ((bigEndian == true) ? 0 : bytes - 1)] = 0x80;
+		}
+		
+		return _mm_loadu_si128((const __m128i*)(mask));
+	}
+	
+	//Adds signed 32-bit values, saturating rather than wrapping
+	inline __m128i saturatingAdd(__m128i values, __m128i offsets)
+	{
+		__m128i sum = _mm_add_epi32(values, offsets);
+		__m128i overflowed = _mm_srai_epi32(_mm_and_si128(_mm_xor_si128(values, sum), _mm_xor_si128(offsets, sum)), 31);
+		__m128i saturated = _mm_xor_si128(_mm_srai_epi32(values, 31), _mm_set1_epi32(0x7FFFFFFF));
+		return _mm_or_si128(_mm_and_si128(overflowed, saturated), _mm_andnot_si128(overflowed, sum));
+	}
+	
+	//Advances four xorshift generators at once
+	inline __m128i xorshift4(__m128i state)
+	{
+		state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+		state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+		return _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+	}
+	
+	void reorder(const uint8_t* source, const SampleLayout& sourceLayout, uint8_t* dest, const SampleLayout& destLayout, uint64_t count)
+	{
+		//Packed 24-bit samples straddle the vectors, so they are left to the scalar kernel
+		uint64_t index = 0;
+		uint8_t bytes = sourceLayout.bytes;
+		if (bytes != 3)
+		{
+			bool swap = (sourceLayout.bigEndian != destLayout.bigEndian);
+			__m128i flip = ((sourceLayout.isSigned != destLayout.isSigned) ? signMask(bytes, destLayout.bigEndian) : _mm_setzero_si128());
+			uint64_t step = 16 / bytes;
+			for (; index + step <= count; index += step)
+			{
+				__m128i values = _mm_loadu_si128((const __m128i*)(source + (index * bytes)));
+				values = ((swap == true) ? swapBytes(values, bytes) : values);
+				_mm_storeu_si128((__m128i*)(dest + (index * bytes)), _mm_xor_si128(values, flip));
+			}
+		}
+		
+		reorderScalar(source, sourceLayout, dest, destLayout, index, count);
+	}
+	
+	void decodeInteger(const uint8_t* source, const SampleLayout& layout, int32_t* dest, uint64_t count)
+	{
+		uint64_t index = 0;
+		bool swap = (layout.bigEndian == true);
+		__m128i zero = _mm_setzero_si128();
+		if (layout.bytes == 1)
+		{
+			//Flipping the sign bit of unsigned bytes first means every byte can simply be shifted into the top of its value
+			__m128i flip = _mm_set1_epi8((layout.isSigned == false) ? (char)(0x80) : 0);
+			for (; index + 16 <= count; index += 16)
+			{
+				__m128i values = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(source + index)), flip);
+				__m128i low = _mm_unpacklo_epi8(zero, values);
+				__m128i high = _mm_unpackhi_epi8(zero, values);
+				_mm_storeu_si128((__m128i*)(dest + index), _mm_unpacklo_epi16(zero, low));
+				_mm_storeu_si128((__m128i*)(dest + index + 4), _mm_unpackhi_epi16(zero, low));
+				_mm_storeu_si128((__m128i*)(dest + index + 8), _mm_unpacklo_epi16(zero, high));
+				_mm_storeu_si128((__m128i*)(dest + index + 12), _mm_unpackhi_epi16(zero, high));
+			}
+		}
+		else if (layout.bytes == 2)
+		{
+			__m128i flip = _mm_set1_epi16((layout.isSigned == false) ? (short)(0x8000) : 0);
+			for (; index + 8 <= count; index += 8)
+			{
+				__m128i values = _mm_loadu_si128((const __m128i*)(source + (index * 2)));
+				values = _mm_xor_si128(((swap == true) ? swap16(values) : values), flip);
+				_mm_storeu_si128((__m128i*)(dest + index), _mm_unpacklo_epi16(zero, values));
+				_mm_storeu_si128((__m128i*)(dest + index + 4), _mm_unpackhi_epi16(zero, values));
+			}
+		}
+		else if (layout.bytes == 4)
+		{
+			__m128i flip = _mm_set1_epi32((layout.isSigned == false) ? (int)(0x80000000u) : 0);
+			for (; index + 4 <= count; index += 4)
+			{
+				__m128i values = _mm_loadu_si128((const __m128i*)(source + (index * 4)));
+				values = ((swap == true) ? swap32(values) : values);
+				_mm_storeu_si128((__m128i*)(dest + index), _mm_xor_si128(values, flip));
+			}
+		}
+		
+		decodeIntegerScalar(source, layout, dest, index, count);
+	}
+	
+	void encodeInteger(const int32_t* source, const SampleLayout& layout, uint8_t* dest, uint64_t count)
+	{
+		uint64_t index = 0;
+		bool swap = (layout.bigEndian == true);
+		if (layout.bytes == 1)
+		{
+			__m128i flip = _mm_set1_epi8((layout.isSigned == false) ? (char)(0x80) : 0);
+			for (; index + 16 <= count; index += 16)
+			{
+				__m128i first = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(source + index)), 24);
+				__m128i second = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(source + index + 4)), 24);
+				__m128i third = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(source + index + 8)), 24);
+				__m128i fourth = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(source + index + 12)), 24);
+				__m128i packed = _mm_packs_epi16(_mm_packs_epi32(first, second), _mm_packs_epi32(third, fourth));
+				_mm_storeu_si128((__m128i*)(dest + index), _mm_xor_si128(packed, flip));
+			}
+		}
+		else if (layout.bytes == 2)
+		{
+			__m128i flip = _mm_set1_epi16((layout.isSigned == false) ? (short)(0x8000) : 0);
+			for (; index + 8 <= count; index += 8)
+			{
+				__m128i first = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(source + index)), 16);
+				__m128i second = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(source + index + 4)), 16);
+				__m128i packed = _mm_xor_si128(_mm_packs_epi32(first, second), flip);
+				_mm_storeu_si128((__m128i*)(dest + (index * 2)), ((swap == true) ? swap16(packed) : packed));
+			}
+		}
+		else if (layout.bytes == 4)
+		{
+			__m128i flip = _mm_set1_epi32((layout.isSigned == false) ? (int)(0x80000000u) : 0);
+			for (; index + 4 <= count; index += 4)
+			{
+				__m128i values = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(source + index)), flip);
+				_mm_storeu_si128((__m128i*)(dest + (index * 4)), ((swap == true) ? swap32(values) : values));
+			}
+		}
+		
+		encodeIntegerScalar(source, layout, dest, index, count);
+	}
+	
+	void decodeFloat(const uint8_t* source, const SampleLayout& layout, float* dest, uint64_t count)
+	{
+		uint64_t index = 0;
+		bool swap = (layout.bigEndian == true);
+		if (layout.bytes == 4)
+		{
+			for (; index + 4 <= count; index += 4)
+			{
+				__m128i values = _mm_loadu_si128((const __m128i*)(source + (index * 4)));
+				_mm_storeu_ps(dest + index, _mm_castsi128_ps((swap == true) ? swap32(values) : values));
+			}
+		}
+		else
+		{
+			for (; index + 4 <= count; index += 4)
+			{
+				__m128i first = _mm_loadu_si128((const __m128i*)(source + (index * 8)));
+				__m128i second = _mm_loadu_si128((const __m128i*)(source + (index * 8) + 16));
+				__m128 low = _mm_cvtpd_ps(_mm_castsi128_pd((swap == true) ? swap64(first) : first));
+				__m128 high = _mm_cvtpd_ps(_mm_castsi128_pd((swap == true) ? swap64(second) : second));
+				_mm_storeu_ps(dest + index, _mm_movelh_ps(low, high));
+			}
+		}
+		
+		decodeFloatScalar(source, layout, dest, index, count);
+	}
+	
+	void encodeFloat(const float* source, const SampleLayout& layout, uint8_t* dest, uint64_t count)
+	{
+		uint64_t index = 0;
+		bool swap = (layout.bigEndian == true);
+		if (layout.bytes == 4)
+		{
+			for (; index + 4 <= count; index += 4)
+			{
+				__m128i values = _mm_castps_si128(_mm_loadu_ps(source + index));
+				_mm_storeu_si128((__m128i*)(dest + (index * 4)), ((swap == true) ? swap32(values) : values));
+			}
+		}
+		else
+		{
+			for (; index + 4 <= count; index += 4)
+			{
+				__m128 values = _mm_loadu_ps(source + index);
+				__m128i low = _mm_castpd_si128(_mm_cvtps_pd(values));
+				__m128i high = _mm_castpd_si128(_mm_cvtps_pd(_mm_movehl_ps(values, values)));
+				_mm_storeu_si128((__m128i*)(dest + (index * 8)), ((swap == true) ? swap64(low) : low));
+				_mm_storeu_si128((__m128i*)(dest + (index * 8) + 16), ((swap == true) ? swap64(high) : high));
+			}
+		}
+		
+		encodeFloatScalar(source, layout, dest, index, count);
+	}
+	
+	void integerToFloat(const int32_t* source, float* dest, uint64_t count)
+	{
+		uint64_t index = 0;
+		__m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+		for (; index + 4 <= count; index += 4) {
+			_mm_storeu_ps(dest + index, _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(source + index))), scale));
+		}
+		
+		integerToFloatScalar(source, dest, index, count);
+	}
+	
+	void floatToInteger(const float* source, int32_t* dest, uint64_t count)
+	{
+		uint64_t index = 0;
+		__m128 scale = _mm_set1_ps(2147483648.0f);
+		__m128 largest = _mm_set1_ps(2147483520.0f);
+		__m128 smallest = _mm_set1_ps(-2147483648.0f);
+		for (; index + 4 <= count; index += 4)
+		{
+			__m128 scaled = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(source + index), scale), largest), smallest);
+			_mm_storeu_si128((__m128i*)(dest + index), _mm_cvtps_epi32(scaled));
+		}
+		
+		floatToIntegerScalar(source, dest, index, count);
+	}
+	
+	void decodeDouble(const uint8_t* source, const SampleLayout& layout, int32_t* dest, uint64_t count)
+	{
+		uint64_t index = 0;
+		bool swap = (layout.bigEndian == true);
+		__m128d scale = _mm_set1_pd(2147483648.0);
+		__m128d largest = _mm_set1_pd(2147483647.0);
+		__m128d smallest = _mm_set1_pd(-2147483648.0);
+		for (; index + 4 <= count; index += 4)
+		{
+			__m128i first = _mm_loadu_si128((const __m128i*)(source + (index * 8)));
+			__m128i second = _mm_loadu_si128((const __m128i*)(source + (index * 8) + 16));
+			__m128d low = _mm_castsi128_pd((swap == true) ? swap64(first) : first);
+			__m128d high = _mm_castsi128_pd((swap == true) ? swap64(second) : second);
+			low = _mm_max_pd(_mm_min_pd(_mm_mul_pd(low, scale), largest), smallest);
+			high = _mm_max_pd(_mm_min_pd(_mm_mul_pd(high, scale), largest), smallest);
+			_mm_storeu_si128((__m128i*)(dest + index), _mm_unpacklo_epi64(_mm_cvtpd_epi32(low), _mm_cvtpd_epi32(high)));
+		}
+		
+		decodeDoubleScalar(source, layout, dest, index, count);
+	}
+	
+	void encodeDouble(const int32_t* source, const SampleLayout& layout, uint8_t* dest, uint64_t count)
+	{
+		uint64_t index = 0;
+		bool swap = (layout.bigEndian == true);
+		__m128d scale = _mm_set1_pd(1.0 / 2147483648.0);
+		for (; index + 4 <= count; index += 4)
+		{
+			__m128i values = _mm_loadu_si128((const __m128i*)(source + index));
+			__m128i low = _mm_castpd_si128(_mm_mul_pd(_mm_cvtepi32_pd(values), scale));
+			__m128i high = _mm_castpd_si128(_mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(values, _MM_SHUFFLE(1, 0, 3, 2))), scale));
+			_mm_storeu_si128((__m128i*)(dest + (index * 8)), ((swap == true) ? swap64(low) : low));
+			_mm_storeu_si128((__m128i*)(dest + (index * 8) + 16), ((swap == true) ? swap64(high) : high));
+		}
+		
+		encodeDoubleScalar(source, layout, dest, index, count);
+	}
+	
+	void dither(int32_t* samples, uint64_t count, uint32_t bits, uint32_t* state)
+	{
+		//Give each lane its own generator, seeded from the caller's generator
+		uint64_t index = 0;
+		if (count >= 4)
+		{
+			uint32_t seeds[4];
+			for (uint32_t lane = 0; lane < 4; ++lane) {
+				seeds[lane] = xorshift(*state);
+			}
+			
+			__m128i generators = _mm_loadu_si128((const __m128i*)(seeds));
+			__m128i shift = _mm_cvtsi32_si128((int)(bits));
+			__m128i half = _mm_set1_epi32((int)(1u << (31 - bits)));
+			for (; index + 4 <= count; index += 4)
+			{
+				generators = xorshift4(generators);
+				__m128i first = _mm_srl_epi32(generators, shift);
+				generators = xorshift4(generators);
+				__m128i second = _mm_srl_epi32(generators, shift);
+				__m128i noise = _mm_add_epi32(_mm_sub_epi32(first, second), half);
+				__m128i values = _mm_loadu_si128((const __m128i*)(samples + index));
+				_mm_storeu_si128((__m128i*)(samples + index), saturatingAdd(values, noise));
+			}
+			
+			*state = (uint32_t)(_mm_cvtsi128_si32(generators));
+		}
+		
+		ditherScalar(samples, index, count, bits, state);
+	}
+	
+	void deinterleave(const void* source, void* dest, uint32_t channels, uint64_t frames)
+	{
+		//Only stereo is common enough to warrant a dedicated kernel
+		uint64_t frame = 0;
+		if (channels == 2)
+		{
+			const float* in = (const float*)(source);
+			float* out = (float*)(dest);
+			for (; frame + 4 <= frames; frame += 4)
+			{
+				__m128 first = _mm_loadu_ps(in + (frame * 2));
+				__m128 second = _mm_loadu_ps(in + (frame * 2) + 4);
+				_mm_storeu_ps(out + frame, _mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)));
+				_mm_storeu_ps(out + frames + frame, _mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)));
+			}
+		}
+		
+		deinterleaveScalar(source, dest, channels, frame, frames);
+	}
+	
+	void interleave(const void* source, void* dest, uint32_t channels, uint64_t frames)
+	{
+		uint64_t frame = 0;
+		if (channels == 2)
+		{
+			const float* in = (const float*)(source);
+			float* out = (float*)(dest);
+			for (; frame + 4 <= frames; frame += 4)
+			{
+				__m128 left = _mm_loadu_ps(in + frame);
+				__m128 right = _mm_loadu_ps(in + frames + frame);
+				_mm_storeu_ps(out + (frame * 2), _mm_unpacklo_ps(left, right));
+				_mm_storeu_ps(out + (frame * 2) + 4, _mm_unpackhi_ps(left, right));
+			}
+		}
+		
+		interleaveScalar(source, dest, channels, frame, frames);
+	}
+	
+	const AudioKernels kernels = {
+		"SSE2",
+		&reorder,
+		&decodeInteger,
+		&encodeInteger,
+		&decodeFloat,
+		&encodeFloat,
+		&integerToFloat,
+		&floatToInteger,
+		&decodeDouble,
+		&encodeDouble,
+		&dither,
+		&deinterleave,
+		&interleave
+	};
+}
+
+const AudioKernels* sse2AudioKernels() {
+	return &kernels;
+}
+
+} //End MediaIPC
+
+#else
+
+namespace MediaIPC {
+
+const AudioKernels* sse2AudioKernels() {
+	return nullptr;
+}
+
+} //End MediaIPC
+
+#endif
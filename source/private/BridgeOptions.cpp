@@ -0,0 +1,16 @@
+#include "../public/BridgeOptions.h"
+
+namespace MediaIPC {
+
+BridgeOptions::BridgeOptions()
+{
+	this->samplingMode = SamplingMode::Notification;
+	this->connectTimeout = std::chrono::milliseconds(5000);
+	this->maxBatchMessages = 64;
+	this->maxBatchBytes = 4 * 1024 * 1024;
+	this->zeroCopy = false;
+	this->zeroCopyThreshold = 16 * 1024;
+	this->socketBufferSize = 0;
+}
+
+} //End MediaIPC
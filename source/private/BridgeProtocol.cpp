@@ -0,0 +1,162 @@
+#include "BridgeProtocol.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace MediaIPC {
+
+BridgeMessageHeader makeHeader(BridgeMessageType type, uint32_t track, uint64_t length, const FrameInfo& info)
+{
+	BridgeMessageHeader header;
+	header.type = (uint32_t)(type);
+	header.track = track;
+	header.length = length;
+	header.sequence = info.sequence;
+	header.timestamp = info.timestamp;
+	header.pts = info.pts;
+	return header;
+}
+
+BridgeWireControlBlock toWire(const ControlBlock& cb)
+{
+	BridgeWireControlBlock wire;
+	std::memset(&wire, 0, sizeof(wire));
+	wire.width = cb.width;
+	wire.height = cb.height;
+	wire.frameRate = cb.frameRate;
+	wire.videoSlots = cb.videoSlots;
+	wire.videoStride = cb.videoStride;
+	wire.videoAlignment = cb.videoAlignment;
+	wire.channels = cb.channels;
+	wire.sampleRate = cb.sampleRate;
+	wire.samplesPerBuffer = cb.samplesPerBuffer;
+	wire.audioRingBuffers = cb.audioRingBuffers;
+	wire.videoFormat = (uint8_t)(cb.videoFormat);
+	wire.audioFormat = (uint8_t)(cb.audioFormat);
+	return wire;
+}
+
+ControlBlock fromWire(const BridgeWireControlBlock& wire)
+{
+	ControlBlock cb;
+	cb.width = wire.width;
+	cb.height = wire.height;
+	cb.frameRate = wire.frameRate;
+	cb.videoSlots = wire.videoSlots;
+	cb.videoStride = wire.videoStride;
+	cb.videoAlignment = wire.videoAlignment;
+	cb.channels = wire.channels;
+	cb.sampleRate = wire.sampleRate;
+	cb.samplesPerBuffer = wire.samplesPerBuffer;
+	cb.audioRingBuffers = wire.audioRingBuffers;
+	cb.videoFormat = (VideoFormat)(wire.videoFormat);
+	cb.audioFormat = (AudioFormat)(wire.audioFormat);
+	return cb;
+}
+
+std::vector<uint8_t> encodeHello(const std::vector<Track>& tracks)
+{
+	BridgeHello hello;
+	hello.magic = MEDIA_IPC_BRIDGE_MAGIC;
+	hello.version = MEDIA_IPC_BRIDGE_VERSION;
+	hello.trackCount = (uint32_t)(tracks.size());
+	hello.reserved = 0;
+	
+	std::vector<uint8_t> body(sizeof(BridgeHello) + (tracks.size() * sizeof(BridgeWireTrack)), 0);
+	std::memcpy(body.data(), &hello, sizeof(BridgeHello));
+	for (uint32_t index = 0; index < tracks.size(); ++index)
+	{
+		BridgeWireTrack wire;
+		std::memset(&wire, 0, sizeof(wire));
+		std::memcpy(wire.name, tracks[index].name.c_str(), std::min(tracks[index].name.size(), (size_t)(MEDIA_IPC_MAX_TRACK_NAME - 1)));
+		wire.controlBlock = toWire(tracks[index].controlBlock);
+		std::memcpy(body.data() + sizeof(BridgeHello) + (index * sizeof(BridgeWireTrack)), &wire, sizeof(wire));
+	}
+	
+	return body;
+}
+
+std::vector<Track> decodeHello(const std::vector<uint8_t>& body)
+{
+	BridgeHello hello;
+	if (body.size() < sizeof(BridgeHello)) {
+		throw std::runtime_error("the bridge sender sent a truncated greeting");
+	}
+	
+	std::memcpy(&hello, body.data(), sizeof(BridgeHello));
+	if (hello.magic != MEDIA_IPC_BRIDGE_MAGIC) {
+		throw std::runtime_error("the bridge peer is not a MediaIPC bridge sender, or uses a different byte order");
+	}
+	
+	if (hello.version != MEDIA_IPC_BRIDGE_VERSION) {
+		throw std::runtime_error("the bridge sender uses protocol version " + std::to_string(hello.version) + ", but we only support version " + std::to_string(MEDIA_IPC_BRIDGE_VERSION));
+	}
+	
+	if (hello.trackCount == 0 || hello.trackCount > MEDIA_IPC_MAX_TRACKS || body.size() != sizeof(BridgeHello) + (hello.trackCount * sizeof(BridgeWireTrack))) {
+		throw std::runtime_error("the bridge sender sent an invalid track table");
+	}
+	
+	std::vector<Track> tracks;
+	for (uint32_t index = 0; index < hello.trackCount; ++index)
+	{
+		BridgeWireTrack wire;
+		std::memcpy(&wire, body.data() + sizeof(BridgeHello) + (index * sizeof(BridgeWireTrack)), sizeof(wire));
+		wire.name[MEDIA_IPC_MAX_TRACK_NAME - 1] = '\0';
+		tracks.push_back(Track(wire.name, fromWire(wire.controlBlock)));
+	}
+	
+	return tracks;
+}
+
+BridgeCounters::BridgeCounters()
+{
+	this->videoFrames.store(0, std::memory_order_relaxed);
+	this->audioBlocks.store(0, std::memory_order_relaxed);
+	this->controlBlocks.store(0, std::memory_order_relaxed);
+	this->bytes.store(0, std::memory_order_relaxed);
+	this->batches.store(0, std::memory_order_relaxed);
+	this->videoFramesDropped.store(0, std::memory_order_relaxed);
+	this->videoFramesTorn.store(0, std::memory_order_relaxed);
+	this->zeroCopyWrites.store(0, std::memory_order_relaxed);
+	this->zeroCopyCopied.store(0, std::memory_order_relaxed);
+	this->localLatencyNanoseconds.store(0, std::memory_order_relaxed);
+	this->localLatencyMaxNanoseconds.store(0, std::memory_order_relaxed);
+	this->localLatencySamples.store(0, std::memory_order_relaxed);
+	this->roundTripNanoseconds.store(0, std::memory_order_relaxed);
+	this->roundTripMaxNanoseconds.store(0, std::memory_order_relaxed);
+	this->roundTripSamples.store(0, std::memory_order_relaxed);
+}
+
+void BridgeCounters::recordLatency(std::atomic<uint64_t>& total, std::atomic<uint64_t>& maximum, std::atomic<uint64_t>& samples, uint64_t latency)
+{
+	//Each latency is only ever recorded by a single thread, so the maximum does not need a compare-and-swap loop
+	total.fetch_add(latency, std::memory_order_relaxed);
+	samples.fetch_add(1, std::memory_order_relaxed);
+	if (latency > maximum.load(std::memory_order_relaxed)) {
+		maximum.store(latency, std::memory_order_relaxed);
+	}
+}
+
+BridgeStats BridgeCounters::snapshot() const
+{
+	BridgeStats stats;
+	stats.videoFrames = this->videoFrames.load(std::memory_order_relaxed);
+	stats.audioBlocks = this->audioBlocks.load(std::memory_order_relaxed);
+	stats.controlBlocks = this->controlBlocks.load(std::memory_order_relaxed);
+	stats.bytes = this->bytes.load(std::memory_order_relaxed);
+	stats.batches = this->batches.load(std::memory_order_relaxed);
+	stats.videoFramesDropped = this->videoFramesDropped.load(std::memory_order_relaxed);
+	stats.videoFramesTorn = this->videoFramesTorn.load(std::memory_order_relaxed);
+	stats.zeroCopyWrites = this->zeroCopyWrites.load(std::memory_order_relaxed);
+	stats.zeroCopyCopied = this->zeroCopyCopied.load(std::memory_order_relaxed);
+	stats.localLatencyNanoseconds = this->localLatencyNanoseconds.load(std::memory_order_relaxed);
+	stats.localLatencyMaxNanoseconds = this->localLatencyMaxNanoseconds.load(std::memory_order_relaxed);
+	stats.localLatencySamples = this->localLatencySamples.load(std::memory_order_relaxed);
+	stats.roundTripNanoseconds = this->roundTripNanoseconds.load(std::memory_order_relaxed);
+	stats.roundTripMaxNanoseconds = this->roundTripMaxNanoseconds.load(std::memory_order_relaxed);
+	stats.roundTripSamples = this->roundTripSamples.load(std::memory_order_relaxed);
+	return stats;
+}
+
+} //End MediaIPC
@@ -0,0 +1,129 @@
+#ifndef _MEDIA_IPC_BRIDGE_PROTOCOL
+#define _MEDIA_IPC_BRIDGE_PROTOCOL
+
+#include "../public/BridgeStats.h"
+#include "../public/ControlBlock.h"
+#include "../public/FrameInfo.h"
+#include "../public/Track.h"
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+namespace MediaIPC {
+
+//Identifies a bridge connection ("MIPC" in little-endian byte order) and the version of the protocol it speaks
+//(All values are transmitted in the sender's native byte order, so both hosts must share the same byte order)
+#define MEDIA_IPC_BRIDGE_MAGIC 0x4350494d
+#define MEDIA_IPC_BRIDGE_VERSION 1
+
+//The types of message sent over a bridge connection
+enum class BridgeMessageType : uint32_t
+{
+	//Sent once by the sender when it connects, followed by a BridgeHello and a BridgeWireTrack for each track
+	Hello = 1,
+	
+	//New parameters for a track, followed by a BridgeWireControlBlock
+	ControlBlock = 2,
+	
+	//A video frame or a block of audio samples for a track, followed by the frame data or samples
+	VideoFrame = 3,
+	AudioBlock = 4,
+	
+	//Sent by the sender when the stream it relays has ended
+	End = 5,
+	
+	//Sent back to the sender by the receiver once it has republished a video frame, echoing the frame's sequence number and timestamp
+	Ack = 6
+};
+
+//Header preceding each message
+struct BridgeMessageHeader
+{
+	uint32_t type;
+	uint32_t track;
+	
+	//The length of the data that follows the header
+	uint64_t length;
+	
+	//For frames and blocks, the sequence number, the producer's publish time (on the sender's steady clock) and the presentation timestamp
+	uint64_t sequence;
+	uint64_t timestamp;
+	int64_t pts;
+};
+
+//The public parameters of a control block, with fixed-size fields
+struct BridgeWireControlBlock
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t frameRate;
+	uint32_t videoSlots;
+	uint64_t videoStride;
+	uint32_t videoAlignment;
+	uint32_t channels;
+	uint32_t sampleRate;
+	uint32_t samplesPerBuffer;
+	uint32_t audioRingBuffers;
+	uint8_t videoFormat;
+	uint8_t audioFormat;
+	uint8_t padding[2];
+};
+
+//The body of a Hello message, which is followed by the details of each track
+struct BridgeHello
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t trackCount;
+	uint32_t reserved;
+};
+
+struct BridgeWireTrack
+{
+	char name[MEDIA_IPC_MAX_TRACK_NAME];
+	BridgeWireControlBlock controlBlock;
+};
+
+//Creates the header for a message, with the sequence number and timestamps of a frame or block of samples if it carries one
+BridgeMessageHeader makeHeader(BridgeMessageType type, uint32_t track, uint64_t length, const FrameInfo& info = FrameInfo());
+
+//Converts control blocks to and from their wire representation
+BridgeWireControlBlock toWire(const ControlBlock& cb);
+ControlBlock fromWire(const BridgeWireControlBlock& wire);
+
+//Encodes the body of a Hello message for the specified tracks, and decodes it again (throwing std::runtime_error if it is invalid)
+std::vector<uint8_t> encodeHello(const std::vector<Track>& tracks);
+std::vector<Track> decodeHello(const std::vector<uint8_t>& body);
+
+//The counters for one side of a bridge, which are updated by its threads while another thread takes snapshots
+struct BridgeCounters
+{
+	std::atomic<uint64_t> videoFrames;
+	std::atomic<uint64_t> audioBlocks;
+	std::atomic<uint64_t> controlBlocks;
+	std::atomic<uint64_t> bytes;
+	std::atomic<uint64_t> batches;
+	std::atomic<uint64_t> videoFramesDropped;
+	std::atomic<uint64_t> videoFramesTorn;
+	std::atomic<uint64_t> zeroCopyWrites;
+	std::atomic<uint64_t> zeroCopyCopied;
+	std::atomic<uint64_t> localLatencyNanoseconds;
+	std::atomic<uint64_t> localLatencyMaxNanoseconds;
+	std::atomic<uint64_t> localLatencySamples;
+	std::atomic<uint64_t> roundTripNanoseconds;
+	std::atomic<uint64_t> roundTripMaxNanoseconds;
+	std::atomic<uint64_t> roundTripSamples;
+	
+	//Zeroes all of the counters
+	BridgeCounters();
+	
+	//Records a single latency measurement
+	static void recordLatency(std::atomic<uint64_t>& total, std::atomic<uint64_t>& maximum, std::atomic<uint64_t>& samples, uint64_t latency);
+	
+	//Reads the current values of the counters
+	BridgeStats snapshot() const;
+};
+
+} //End MediaIPC
+
+#endif
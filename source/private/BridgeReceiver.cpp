@@ -0,0 +1,167 @@
+#include "../public/BridgeReceiver.h"
+#include "../public/MediaProducer.h"
+#include "BridgeProtocol.h"
+#include "BridgeSocket.h"
+#include "Telemetry.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace MediaIPC {
+
+//The listening socket and the counters for a receiver
+struct BridgeReceiverState
+{
+	BridgeListener listener;
+	BridgeCounters counters;
+	
+	BridgeReceiverState(const std::string& endpoint) : listener(endpoint) {}
+};
+
+namespace
+{
+	//Reads the data that follows a message header, treating the end of the connection as an error
+	void readBody(BridgeSocket& socket, void* destination, uint64_t length)
+	{
+		if (length > 0 && socket.readExact(destination, length) == false) {
+			throw std::runtime_error("the bridge sender closed the connection part-way through a message");
+		}
+	}
+	
+	//The largest greeting we accept, which is far larger than any valid greeting
+	const uint64_t maxHelloSize = 1024 * 1024;
+}
+
+BridgeReceiver::BridgeReceiver(const std::string& endpoint, const std::string& prefix, const BridgeOptions& options) :
+	prefix(prefix), options(options), state(new BridgeReceiverState(endpoint))
+{}
+
+//Needed so that client code doesn't require definitions for our forward-declared types
+BridgeReceiver::~BridgeReceiver() {}
+
+uint16_t BridgeReceiver::port() const {
+	return this->state->listener.port();
+}
+
+BridgeStats BridgeReceiver::stats() const {
+	return this->state->counters.snapshot();
+}
+
+void BridgeReceiver::run()
+{
+	BridgeSocket socket = this->state->listener.accept();
+	socket.configure(this->options);
+	
+	//The sender always begins by telling us the names and parameters of its tracks
+	BridgeMessageHeader header;
+	if (socket.readExact(&header, sizeof(header)) == false) {
+		throw std::runtime_error("the bridge sender closed the connection without sending anything");
+	}
+	
+	if (header.type != (uint32_t)(BridgeMessageType::Hello) || header.length > maxHelloSize) {
+		throw std::runtime_error("the bridge peer did not begin with a greeting");
+	}
+	
+	std::vector<uint8_t> body((size_t)(header.length));
+	readBody(socket, body.data(), header.length);
+	std::vector<Track> tracks = decodeHello(body);
+	
+	//Republish the stream with the same tracks, stopping the producer however the stream ends
+	std::vector<ControlBlock> controlBlocks;
+	for (const Track& track : tracks) {
+		controlBlocks.push_back(track.controlBlock);
+	}
+	
+	MediaProducer producer(this->prefix, tracks, this->options.producerOptions);
+	try {
+		this->relay(socket, producer, controlBlocks);
+	}
+	catch (std::runtime_error&)
+	{
+		producer.stop();
+		throw;
+	}
+	
+	producer.stop();
+}
+
+void BridgeReceiver::relay(BridgeSocket& socket, MediaProducer& producer, std::vector<ControlBlock>& controlBlocks)
+{
+	BridgeCounters& counters = this->state->counters;
+	std::vector<uint8_t> samples;
+	while (true)
+	{
+		BridgeMessageHeader header;
+		if (socket.readExact(&header, sizeof(header)) == false) {
+			throw std::runtime_error("the bridge sender closed the connection before the stream ended");
+		}
+		
+		uint64_t started = telemetryTimestamp();
+		if (header.type == (uint32_t)(BridgeMessageType::End)) {
+			return;
+		}
+		
+		if (header.track >= controlBlocks.size()) {
+			throw std::runtime_error("the bridge sender sent data for a track that does not exist");
+		}
+		
+		ControlBlock& cb = controlBlocks[header.track];
+		if (header.type == (uint32_t)(BridgeMessageType::ControlBlock))
+		{
+			if (header.length != sizeof(BridgeWireControlBlock)) {
+				throw std::runtime_error("the bridge sender sent an invalid control block");
+			}
+			
+			//The sender passes on the parameters of each track when it starts, so only reconfigure if they have actually changed
+			BridgeWireControlBlock wire;
+			readBody(socket, &wire, sizeof(wire));
+			BridgeWireControlBlock previous = toWire(cb);
+			if (std::memcmp(&wire, &previous, sizeof(wire)) != 0)
+			{
+				cb = fromWire(wire);
+				producer.reconfigure(header.track, cb);
+			}
+			
+			countEvent(counters.controlBlocks);
+		}
+		else if (header.type == (uint32_t)(BridgeMessageType::VideoFrame))
+		{
+			if (header.length != cb.calculateVideoBufsize()) {
+				throw std::runtime_error("the bridge sender sent a video frame whose size does not match the track's parameters");
+			}
+			
+			//Read the frame straight into the next slot of the track's video ring
+			readBody(socket, producer.acquireVideoFrame(header.track), header.length);
+			producer.commitVideoFrame(header.track, header.pts);
+			countEvent(counters.videoFrames);
+			uint64_t now = telemetryTimestamp();
+			BridgeCounters::recordLatency(counters.localLatencyNanoseconds, counters.localLatencyMaxNanoseconds, counters.localLatencySamples, now - started);
+			
+			//Acknowledge the frame so that the sender can measure the round trip, unless doing so would block
+			//(The sender reads acknowledgements between writes, so the send buffer only fills if the sender has stalled)
+			FrameInfo info;
+			info.sequence = header.sequence;
+			info.timestamp = header.timestamp;
+			BridgeMessageHeader ack = makeHeader(BridgeMessageType::Ack, header.track, 0, info);
+			socket.tryWrite(&ack, sizeof(ack));
+		}
+		else if (header.type == (uint32_t)(BridgeMessageType::AudioBlock))
+		{
+			if (header.length > cb.calculateAudioRingSize()) {
+				throw std::runtime_error("the bridge sender sent a block of audio samples larger than the track's ring");
+			}
+			
+			samples.resize((size_t)(header.length));
+			readBody(socket, samples.data(), header.length);
+			producer.submitAudioSamples(header.track, samples.data(), header.length, header.pts);
+			countEvent(counters.audioBlocks);
+		}
+		else {
+			throw std::runtime_error("the bridge sender sent an unexpected message");
+		}
+		
+		countEvent(counters.bytes, sizeof(header) + header.length);
+		counters.batches.store(socket.reads(), std::memory_order_relaxed);
+	}
+}
+
+} //End MediaIPC
@@ -0,0 +1,331 @@
+#include "../public/BridgeSender.h"
+#include "../public/MediaConsumer.h"
+#include "BridgeProtocol.h"
+#include "BridgeSocket.h"
+#include "Telemetry.h"
+#include "TrackRecordQueue.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#include <poll.h>
+
+namespace MediaIPC {
+
+//A batch of messages written using MSG_ZEROCOPY, which is kept until the kernel has completed the last of its writes
+struct ZeroCopyBatch
+{
+	uint32_t lastWrite;
+	RecordList messages;
+};
+
+//The state shared between the sampling threads of our consumer and our writer thread
+struct BridgeSenderState
+{
+	BridgeSocket socket;
+	BridgeCounters counters;
+	TrackRecordQueue messages;
+	
+	//The writer thread's private state: the batch being written, whether zero-copy writes are enabled, the number of zero-copy
+	//writes made and completed so far, the batches awaiting completion, the acknowledgement bytes not yet processed, the
+	//number of frames the receiver has yet to acknowledge, and whether the end of the stream has been written
+	RecordList batch;
+	bool zeroCopy;
+	uint32_t zeroCopyWrites;
+	uint32_t zeroCopyCompleted;
+	std::deque<ZeroCopyBatch> inflight;
+	std::vector<uint8_t> acknowledgements;
+	uint64_t unacknowledged;
+	bool ended;
+	
+	BridgeSenderState() : messages(counters.videoFramesTorn), zeroCopy(false), zeroCopyWrites(0), zeroCopyCompleted(0), unacknowledged(0), ended(false) {}
+};
+
+namespace
+{
+	//Determines if one zero-copy write number precedes another, allowing for the counter wrapping around
+	bool writePrecedes(uint32_t write, uint32_t other) {
+		return ((int32_t)(write - other) < 0);
+	}
+}
+
+BridgeSender::BridgeSender(const std::string& prefix, const std::string& endpoint, const BridgeOptions& options) :
+	prefix(prefix), options(options), state(new BridgeSenderState())
+{
+	//Determine which tracks the producer publishes, and then connect to the receiver
+	this->tracks = MediaConsumer::publishedTracks(prefix, options.consumerOptions);
+	this->state->socket = BridgeSocket::connect(endpoint, options);
+	this->state->zeroCopy = (options.zeroCopy == true && this->state->socket.enableZeroCopy() == true);
+	
+	for (const Track& track : this->tracks) {
+		this->state->messages.addTrack(track.controlBlock);
+	}
+}
+
+BridgeSender::~BridgeSender() {
+	this->finish();
+}
+
+void BridgeSender::run()
+{
+	//Greet the receiver with the names and parameters of our tracks before anything else is sent
+	std::unique_ptr<QueuedRecord> hello(new QueuedRecord());
+	hello->payload = encodeHello(this->tracks);
+	hello->header = makeHeader(BridgeMessageType::Hello, 0, hello->payload.size());
+	this->state->messages.enqueue(std::move(hello));
+	
+	//Relay every track until the stream ends, then tell the receiver that the stream has ended and wait for everything we queued to be written
+	this->state->messages.run(
+		this->prefix,
+		this->tracks,
+		this->options.samplingMode,
+		this->options.consumerOptions,
+		std::bind(&BridgeSender::writeLoop, this),
+		std::bind(&BridgeSender::enqueueVideoFrame, this, std::placeholders::_1, std::placeholders::_2)
+	);
+}
+
+BridgeStats BridgeSender::stats() const {
+	return this->state->counters.snapshot();
+}
+
+void BridgeSender::enqueueVideoFrame(uint32_t track, VideoFrameView& view)
+{
+	BridgeSenderState& state = *this->state;
+	TrackRecordQueue& messages = state.messages;
+	std::unique_ptr<QueuedRecord> message(new QueuedRecord());
+	message->header = makeHeader(BridgeMessageType::VideoFrame, track, view.length(), view.info());
+	message->view = std::move(view);
+	{
+		std::lock_guard<std::mutex> lock(messages.mutex);
+		if (messages.failed == true) {
+			return;
+		}
+		
+		//If an earlier frame from the same track is still waiting to be written then the socket is not keeping up, so we send
+		//the newer frame in its place (unless new parameters for the track were queued after it, which must be sent first)
+		for (auto queued = messages.records.rbegin(); queued != messages.records.rend(); ++queued)
+		{
+			const BridgeMessageHeader& header = (*queued)->header;
+			if (header.track != track || header.type == (uint32_t)(BridgeMessageType::AudioBlock)) {
+				continue;
+			}
+			
+			if (header.type == (uint32_t)(BridgeMessageType::VideoFrame))
+			{
+				//The replaced frame is released once we have unlocked the mutex
+				std::swap(*queued, message);
+				countEvent(state.counters.videoFramesDropped);
+				return;
+			}
+			
+			break;
+		}
+		
+		//Don't pin so many frames that the producer has to overwrite one of them
+		if (messages.pinned[track] >= messages.pinLimit[track])
+		{
+			countEvent(state.counters.videoFramesDropped);
+			return;
+		}
+		
+		messages.pinned[track] += 1;
+		messages.records.push_back(std::move(message));
+	}
+	
+	messages.wake.notify_one();
+}
+
+void BridgeSender::writeLoop()
+{
+	BridgeSenderState& state = *this->state;
+	try
+	{
+		bool done = false;
+		while (done == false)
+		{
+			//Wait for messages to be queued, waking periodically to process acknowledgements and zero-copy completions
+			//(We wake more often while frames are awaiting acknowledgement, so that we measure the round trip accurately)
+			uint32_t timeout = (state.unacknowledged > 0) ? 1 : 10;
+			done = state.messages.take(state.batch, this->options.maxBatchMessages, this->options.maxBatchBytes, timeout);
+			if (state.batch.empty() == false) {
+				this->writeBatch();
+			}
+			
+			//(The end of the stream can be written before the queue reports that it has finished, and the receiver may close the
+			//connection as soon as it arrives)
+			this->processAcknowledgements(done == true || state.ended == true);
+			this->processCompletions(false);
+		}
+		
+		//Wait for the kernel to finish with any zero-copy writes before the frames they refer to are released
+		this->processCompletions(true);
+	}
+	catch (std::runtime_error& e)
+	{
+		//Discard everything we were holding, so that the producer can reuse the slots we had pinned
+		state.messages.fail(e.what());
+		state.batch.clear();
+		state.inflight.clear();
+	}
+}
+
+void BridgeSender::writeBatch()
+{
+	//Gather the headers and data of every message in the batch, so that they can be written with a single system call
+	BridgeSenderState& state = *this->state;
+	std::vector<struct iovec> buffers;
+	uint64_t bytes = 0;
+	bool zeroCopy = false;
+	for (auto& message : state.batch)
+	{
+		struct iovec header;
+		header.iov_base = &message->header;
+		header.iov_len = sizeof(BridgeMessageHeader);
+		buffers.push_back(header);
+		bytes += sizeof(BridgeMessageHeader);
+		
+		if (message->header.length > 0)
+		{
+			struct iovec data;
+			data.iov_base = (void*)((message->view.isValid() == true) ? message->view.data() : message->payload.data());
+			data.iov_len = (size_t)(message->header.length);
+			buffers.push_back(data);
+			bytes += message->header.length;
+			
+			//Only frames in shared memory are large enough to be worth the cost of zero-copy writes
+			if (state.zeroCopy == true && message->view.isValid() == true && message->header.length >= this->options.zeroCopyThreshold) {
+				zeroCopy = true;
+			}
+		}
+	}
+	
+	uint32_t zeroCopyWrites = 0;
+	uint64_t calls = state.socket.writeAll(buffers.data(), buffers.size(), zeroCopy, zeroCopyWrites);
+	countEvent(state.counters.batches, calls);
+	countEvent(state.counters.bytes, bytes);
+	countEvent(state.counters.zeroCopyWrites, zeroCopyWrites);
+	
+	//Record how long each frame took to reach the socket after the producer published it
+	uint64_t now = telemetryTimestamp();
+	for (auto& message : state.batch)
+	{
+		const BridgeMessageHeader& header = message->header;
+		if (header.type == (uint32_t)(BridgeMessageType::VideoFrame))
+		{
+			state.unacknowledged += 1;
+			countEvent(state.counters.videoFrames);
+			BridgeCounters::recordLatency(state.counters.localLatencyNanoseconds, state.counters.localLatencyMaxNanoseconds, state.counters.localLatencySamples, now - std::min(now, header.timestamp));
+		}
+		else if (header.type == (uint32_t)(BridgeMessageType::AudioBlock)) {
+			countEvent(state.counters.audioBlocks);
+		}
+		else if (header.type == (uint32_t)(BridgeMessageType::ControlBlock)) {
+			countEvent(state.counters.controlBlocks);
+		}
+		else if (header.type == (uint32_t)(BridgeMessageType::End)) {
+			state.ended = true;
+		}
+	}
+	
+	//Frames written without zero-copy were copied into the kernel before the write returned, so they can be released immediately
+	RecordList messages;
+	messages.swap(state.batch);
+	if (zeroCopyWrites > 0)
+	{
+		state.zeroCopyWrites += zeroCopyWrites;
+		ZeroCopyBatch inflight;
+		inflight.lastWrite = state.zeroCopyWrites - 1;
+		inflight.messages = std::move(messages);
+		state.inflight.push_back(std::move(inflight));
+	}
+	else {
+		state.messages.release(messages);
+	}
+}
+
+void BridgeSender::processAcknowledgements(bool ending)
+{
+	//The receiver closes the connection once it has received the end of the stream, which is only an error before then
+	BridgeSenderState& state = *this->state;
+	if (state.socket.readAvailable(state.acknowledgements) == false && ending == false) {
+		throw std::runtime_error("the bridge receiver closed the connection");
+	}
+	
+	//Record how long each frame took to be republished by the receiver, as measured on our own clock
+	uint64_t now = telemetryTimestamp();
+	size_t offset = 0;
+	while (state.acknowledgements.size() - offset >= sizeof(BridgeMessageHeader))
+	{
+		BridgeMessageHeader header;
+		std::memcpy(&header, state.acknowledgements.data() + offset, sizeof(BridgeMessageHeader));
+		if (header.type != (uint32_t)(BridgeMessageType::Ack) || header.length != 0) {
+			throw std::runtime_error("the bridge receiver sent an unexpected message");
+		}
+		
+		BridgeCounters::recordLatency(state.counters.roundTripNanoseconds, state.counters.roundTripMaxNanoseconds, state.counters.roundTripSamples, now - std::min(now, header.timestamp));
+		state.unacknowledged -= std::min(state.unacknowledged, (uint64_t)(1));
+		offset += sizeof(BridgeMessageHeader);
+	}
+	
+	state.acknowledgements.erase(state.acknowledgements.begin(), state.acknowledgements.begin() + offset);
+}
+
+void BridgeSender::processCompletions(bool wait)
+{
+	BridgeSenderState& state = *this->state;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+	while (state.inflight.empty() == false)
+	{
+		//TCP completes zero-copy writes in the order they were made, so each range extends the writes completed so far
+		std::vector< std::pair<uint32_t, uint32_t> > ranges;
+		uint64_t copied = 0;
+		state.socket.reapCompletions(ranges, copied);
+		countEvent(state.counters.zeroCopyCopied, copied);
+		for (const auto& range : ranges)
+		{
+			if (writePrecedes(state.zeroCopyCompleted, range.second + 1) == true) {
+				state.zeroCopyCompleted = range.second + 1;
+			}
+		}
+		
+		while (state.inflight.empty() == false && writePrecedes(state.inflight.front().lastWrite, state.zeroCopyCompleted) == true)
+		{
+			state.messages.release(state.inflight.front().messages);
+			state.inflight.pop_front();
+		}
+		
+		if (wait == false || state.inflight.empty() == true) {
+			return;
+		}
+		
+		//Completion notifications arrive on the socket's error queue, which poll() reports as an error condition
+		//(If the kernel never completes the writes then we give up waiting, since the stream has ended anyway)
+		if (std::chrono::steady_clock::now() >= deadline)
+		{
+			while (state.inflight.empty() == false)
+			{
+				state.messages.release(state.inflight.front().messages);
+				state.inflight.pop_front();
+			}
+			
+			return;
+		}
+		
+		struct pollfd descriptor;
+		descriptor.fd = state.socket.descriptor();
+		descriptor.events = 0;
+		descriptor.revents = 0;
+		poll(&descriptor, 1, 10);
+	}
+}
+
+void BridgeSender::finish() {
+	this->state->messages.finish();
+}
+
+} //End MediaIPC
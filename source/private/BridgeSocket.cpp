@@ -0,0 +1,560 @@
+#include "BridgeSocket.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifdef __linux__
+	#include <linux/errqueue.h>
+#endif
+
+//Writes to a socket whose peer has gone away should fail rather than raising SIGPIPE
+//(Under macOS there is no MSG_NOSIGNAL, so we set SO_NOSIGPIPE on each socket instead)
+#ifdef MSG_NOSIGNAL
+	#define MEDIA_IPC_SEND_FLAGS MSG_NOSIGNAL
+#else
+	#define MEDIA_IPC_SEND_FLAGS 0
+#endif
+
+namespace MediaIPC {
+
+namespace
+{
+	//The size of the buffer used to coalesce small reads
+	const size_t readBufferSize = 256 * 1024;
+	
+	//Throws an exception describing the most recent socket error
+	void throwError(const std::string& operation) {
+		throw std::runtime_error("failed to " + operation + ": " + std::string(std::strerror(errno)));
+	}
+	
+	//A resolved endpoint
+	struct Endpoint
+	{
+		int family;
+		std::string unixPath;
+		std::string host;
+		std::string port;
+	};
+	
+	//Parses an endpoint specification
+	Endpoint parseEndpoint(const std::string& spec)
+	{
+		Endpoint endpoint;
+		if (spec.compare(0, 5, "unix:") == 0)
+		{
+			endpoint.family = AF_UNIX;
+			endpoint.unixPath = spec.substr(5);
+			if (endpoint.unixPath.empty() || endpoint.unixPath.size() >= sizeof(((sockaddr_un*)(nullptr))->sun_path)) {
+				throw std::runtime_error("invalid Unix domain socket path in bridge endpoint \"" + spec + "\"");
+			}
+			
+			return endpoint;
+		}
+		
+		//The port follows the last colon, so that the host may itself contain colons (such as an IPv6 address in brackets)
+		std::string address = ((spec.compare(0, 4, "tcp:") == 0) ? spec.substr(4) : spec);
+		size_t separator = address.rfind(':');
+		if (separator == std::string::npos || separator + 1 == address.size()) {
+			throw std::runtime_error("bridge endpoint \"" + spec + "\" does not specify a port");
+		}
+		
+		endpoint.family = AF_INET;
+		endpoint.host = address.substr(0, separator);
+		endpoint.port = address.substr(separator + 1);
+		if (endpoint.host.size() >= 2 && endpoint.host.front() == '[' && endpoint.host.back() == ']') {
+			endpoint.host = endpoint.host.substr(1, endpoint.host.size() - 2);
+		}
+		
+		return endpoint;
+	}
+	
+	//Fills in the address of a Unix domain socket
+	sockaddr_un unixAddress(const std::string& path)
+	{
+		sockaddr_un address;
+		std::memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		std::memcpy(address.sun_path, path.c_str(), path.size());
+		return address;
+	}
+	
+	//Resolves the addresses for a TCP endpoint (an empty host resolves to the wildcard address when listening)
+	addrinfo* resolve(const Endpoint& endpoint, bool passive)
+	{
+		addrinfo hints;
+		std::memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = (passive == true) ? AI_PASSIVE : 0;
+		
+		addrinfo* results = nullptr;
+		int result = getaddrinfo((endpoint.host.empty() || endpoint.host == "*") ? nullptr : endpoint.host.c_str(), endpoint.port.c_str(), &hints, &results);
+		if (result != 0) {
+			throw std::runtime_error("failed to resolve bridge endpoint \"" + endpoint.host + ":" + endpoint.port + "\": " + std::string(gai_strerror(result)));
+		}
+		
+		return results;
+	}
+	
+	//Creates a socket that does not raise SIGPIPE and is not inherited by child processes
+	int createSocket(int family)
+	{
+		int descriptor = ::socket(family, SOCK_STREAM, 0);
+		if (descriptor == -1) {
+			throwError("create socket");
+		}
+		
+		fcntl(descriptor, F_SETFD, FD_CLOEXEC);
+		#ifdef SO_NOSIGPIPE
+		int enabled = 1;
+		setsockopt(descriptor, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+		#endif
+		
+		return descriptor;
+	}
+	
+	//Attempts to connect to an endpoint once, returning -1 if nothing is listening yet
+	int tryConnect(const Endpoint& endpoint)
+	{
+		if (endpoint.family == AF_UNIX)
+		{
+			int descriptor = createSocket(AF_UNIX);
+			sockaddr_un address = unixAddress(endpoint.unixPath);
+			if (::connect(descriptor, (sockaddr*)(&address), sizeof(address)) == 0) {
+				return descriptor;
+			}
+			
+			int error = errno;
+			close(descriptor);
+			if (error != ENOENT && error != ECONNREFUSED)
+			{
+				errno = error;
+				throwError("connect to bridge endpoint \"unix:" + endpoint.unixPath + "\"");
+			}
+			
+			return -1;
+		}
+		
+		//Try each of the resolved addresses in turn
+		addrinfo* results = resolve(endpoint, false);
+		int connected = -1;
+		int error = ECONNREFUSED;
+		for (addrinfo* candidate = results; candidate != nullptr && connected == -1; candidate = candidate->ai_next)
+		{
+			int descriptor = createSocket(candidate->ai_family);
+			if (::connect(descriptor, candidate->ai_addr, candidate->ai_addrlen) == 0) {
+				connected = descriptor;
+			}
+			else
+			{
+				error = errno;
+				close(descriptor);
+			}
+		}
+		
+		freeaddrinfo(results);
+		if (connected == -1 && error != ECONNREFUSED)
+		{
+			errno = error;
+			throwError("connect to bridge endpoint \"" + endpoint.host + ":" + endpoint.port + "\"");
+		}
+		
+		return connected;
+	}
+}
+
+BridgeSocket BridgeSocket::connect(const std::string& endpoint, const BridgeOptions& options)
+{
+	//Retry at short intervals while nothing is listening, so that the sender and receiver can be started in either order
+	Endpoint parsed = parseEndpoint(endpoint);
+	auto deadline = std::chrono::steady_clock::now() + options.connectTimeout;
+	while (true)
+	{
+		int descriptor = tryConnect(parsed);
+		if (descriptor != -1)
+		{
+			BridgeSocket socket(descriptor);
+			socket.configure(options);
+			return socket;
+		}
+		
+		if (std::chrono::steady_clock::now() >= deadline) {
+			throw std::runtime_error("timed out waiting for a bridge receiver to listen on \"" + endpoint + "\"");
+		}
+		
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+}
+
+BridgeSocket::BridgeSocket(int descriptor)
+{
+	this->socket = descriptor;
+	this->readBuffer.reset(new uint8_t[readBufferSize]);
+	this->readOffset = 0;
+	this->readLength = 0;
+	this->readCalls = 0;
+}
+
+BridgeSocket::~BridgeSocket()
+{
+	if (this->socket != -1) {
+		close(this->socket);
+	}
+}
+
+BridgeSocket::BridgeSocket(BridgeSocket&& other) : socket(-1) {
+	*this = std::move(other);
+}
+
+BridgeSocket& BridgeSocket::operator=(BridgeSocket&& other)
+{
+	if (this != &other)
+	{
+		if (this->socket != -1) {
+			close(this->socket);
+		}
+		
+		this->socket = other.socket;
+		this->readBuffer = std::move(other.readBuffer);
+		this->readOffset = other.readOffset;
+		this->readLength = other.readLength;
+		this->readCalls = other.readCalls;
+		other.socket = -1;
+	}
+	
+	return *this;
+}
+
+void BridgeSocket::configure(const BridgeOptions& options)
+{
+	//Nagle's algorithm only adds latency, since we already batch our writes (this fails harmlessly for Unix domain sockets)
+	int enabled = 1;
+	setsockopt(this->socket, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+	
+	if (options.socketBufferSize != 0)
+	{
+		int size = (int)(options.socketBufferSize);
+		setsockopt(this->socket, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+		setsockopt(this->socket, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+	}
+}
+
+bool BridgeSocket::enableZeroCopy()
+{
+	#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+	int enabled = 1;
+	return (setsockopt(this->socket, SOL_SOCKET, SO_ZEROCOPY, &enabled, sizeof(enabled)) == 0);
+	#else
+	return false;
+	#endif
+}
+
+uint64_t BridgeSocket::writeAll(struct iovec* buffers, size_t count, bool zeroCopy, uint32_t& zeroCopyWrites)
+{
+	int flags = MEDIA_IPC_SEND_FLAGS;
+	#if defined(__linux__) && defined(MSG_ZEROCOPY)
+	if (zeroCopy == true) {
+		flags |= MSG_ZEROCOPY;
+	}
+	#endif
+	
+	//Keep writing until every buffer has been consumed, skipping past whatever each partial write managed to send
+	uint64_t calls = 0;
+	while (count > 0)
+	{
+		msghdr message;
+		std::memset(&message, 0, sizeof(message));
+		message.msg_iov = buffers;
+		message.msg_iovlen = std::min(count, (size_t)(IOV_MAX));
+		
+		ssize_t written = sendmsg(this->socket, &message, flags);
+		calls += 1;
+		if (written < 0)
+		{
+			if (errno == EINTR) {
+				continue;
+			}
+			
+			//The kernel refuses zero-copy writes if pinning the pages would exceed the locked memory limit, so fall back to copying
+			#if defined(__linux__) && defined(MSG_ZEROCOPY)
+			if (errno == ENOBUFS && (flags & MSG_ZEROCOPY) != 0)
+			{
+				flags &= ~MSG_ZEROCOPY;
+				continue;
+			}
+			#endif
+			
+			throwError("write to the bridge socket");
+		}
+		
+		#if defined(__linux__) && defined(MSG_ZEROCOPY)
+		if ((flags & MSG_ZEROCOPY) != 0) {
+			zeroCopyWrites += 1;
+		}
+		#endif
+		
+		size_t remaining = (size_t)(written);
+		while (count > 0 && remaining >= buffers->iov_len)
+		{
+			remaining -= buffers->iov_len;
+			buffers += 1;
+			count -= 1;
+		}
+		
+		if (count > 0)
+		{
+			buffers->iov_base = (uint8_t*)(buffers->iov_base) + remaining;
+			buffers->iov_len -= remaining;
+		}
+	}
+	
+	return calls;
+}
+
+bool BridgeSocket::tryWrite(const void* data, size_t length)
+{
+	ssize_t written = send(this->socket, data, length, MEDIA_IPC_SEND_FLAGS | MSG_DONTWAIT);
+	if (written < 0)
+	{
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			throwError("write to the bridge socket");
+		}
+		
+		return false;
+	}
+	
+	//If only part of the data fit then we must finish writing it, since the peer would otherwise lose track of message boundaries
+	if ((size_t)(written) < length)
+	{
+		struct iovec remainder;
+		remainder.iov_base = (uint8_t*)(data) + written;
+		remainder.iov_len = length - (size_t)(written);
+		uint32_t zeroCopyWrites = 0;
+		this->writeAll(&remainder, 1, false, zeroCopyWrites);
+	}
+	
+	return true;
+}
+
+bool BridgeSocket::readExact(void* destination, uint64_t length)
+{
+	uint8_t* output = (uint8_t*)(destination);
+	uint64_t remaining = length;
+	while (remaining > 0)
+	{
+		//Serve as much as we can from the data we have already buffered
+		if (this->readOffset < this->readLength)
+		{
+			size_t available = std::min((uint64_t)(this->readLength - this->readOffset), remaining);
+			std::memcpy(output, this->readBuffer.get() + this->readOffset, available);
+			this->readOffset += available;
+			output += available;
+			remaining -= available;
+			continue;
+		}
+		
+		//Large reads go straight into the destination, while small reads refill the buffer
+		bool direct = (remaining >= readBufferSize / 2);
+		size_t received = 0;
+		if (direct == true) {
+			received = this->receive(output, (size_t)(std::min(remaining, (uint64_t)(SSIZE_MAX))));
+		}
+		else
+		{
+			received = this->receive(this->readBuffer.get(), readBufferSize);
+			this->readOffset = 0;
+			this->readLength = received;
+		}
+		
+		if (received == 0)
+		{
+			if (remaining == length) {
+				return false;
+			}
+			
+			throw std::runtime_error("the bridge peer closed the connection part-way through a message");
+		}
+		
+		if (direct == true)
+		{
+			output += received;
+			remaining -= received;
+		}
+	}
+	
+	return true;
+}
+
+bool BridgeSocket::readAvailable(std::vector<uint8_t>& destination)
+{
+	uint8_t buffer[4096];
+	while (true)
+	{
+		ssize_t received = recv(this->socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+		this->readCalls += 1;
+		if (received > 0) {
+			destination.insert(destination.end(), buffer, buffer + received);
+		}
+		else if (received == 0) {
+			return false;
+		}
+		else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return true;
+		}
+		else if (errno != EINTR) {
+			throwError("read from the bridge socket");
+		}
+	}
+}
+
+void BridgeSocket::reapCompletions(std::vector< std::pair<uint32_t, uint32_t> >& ranges, uint64_t& copied)
+{
+	#if defined(__linux__) && defined(MSG_ZEROCOPY)
+	
+	//Completion notifications are delivered through the socket's error queue, and never block
+	while (true)
+	{
+		uint8_t control[128];
+		msghdr message;
+		std::memset(&message, 0, sizeof(message));
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+		if (recvmsg(this->socket, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+			return;
+		}
+		
+		for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header))
+		{
+			sock_extended_err error;
+			std::memcpy(&error, CMSG_DATA(header), sizeof(error));
+			if (error.ee_origin != SO_EE_ORIGIN_ZEROCOPY || error.ee_errno != 0) {
+				continue;
+			}
+			
+			ranges.push_back(std::make_pair(error.ee_info, error.ee_data));
+			if ((error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0) {
+				copied += (uint64_t)(error.ee_data - error.ee_info) + 1;
+			}
+		}
+	}
+	
+	#endif
+}
+
+uint64_t BridgeSocket::reads() const {
+	return this->readCalls;
+}
+
+int BridgeSocket::descriptor() const {
+	return this->socket;
+}
+
+size_t BridgeSocket::receive(void* destination, size_t length)
+{
+	while (true)
+	{
+		ssize_t received = recv(this->socket, destination, length, 0);
+		this->readCalls += 1;
+		if (received >= 0) {
+			return (size_t)(received);
+		}
+		
+		if (errno != EINTR) {
+			throwError("read from the bridge socket");
+		}
+	}
+}
+
+BridgeListener::BridgeListener(const std::string& endpoint)
+{
+	Endpoint parsed = parseEndpoint(endpoint);
+	this->listeningPort = 0;
+	if (parsed.family == AF_UNIX)
+	{
+		this->socket = createSocket(AF_UNIX);
+		this->unixPath = parsed.unixPath;
+		unlink(this->unixPath.c_str());
+		sockaddr_un address = unixAddress(this->unixPath);
+		if (bind(this->socket, (sockaddr*)(&address), sizeof(address)) != 0)
+		{
+			close(this->socket);
+			throwError("bind to bridge endpoint \"" + endpoint + "\"");
+		}
+	}
+	else
+	{
+		//Bind to the first address that resolves, allowing the port to be reused immediately after a previous receiver exits
+		addrinfo* results = resolve(parsed, true);
+		this->socket = createSocket(results->ai_family);
+		int enabled = 1;
+		setsockopt(this->socket, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled));
+		int result = bind(this->socket, results->ai_addr, results->ai_addrlen);
+		freeaddrinfo(results);
+		if (result != 0)
+		{
+			close(this->socket);
+			throwError("bind to bridge endpoint \"" + endpoint + "\"");
+		}
+		
+		//Determine which port we were bound to, in case we requested port zero
+		sockaddr_storage address;
+		socklen_t length = sizeof(address);
+		getsockname(this->socket, (sockaddr*)(&address), &length);
+		if (address.ss_family == AF_INET) {
+			this->listeningPort = ntohs(((sockaddr_in*)(&address))->sin_port);
+		}
+		else if (address.ss_family == AF_INET6) {
+			this->listeningPort = ntohs(((sockaddr_in6*)(&address))->sin6_port);
+		}
+	}
+	
+	if (listen(this->socket, 1) != 0)
+	{
+		close(this->socket);
+		throwError("listen on bridge endpoint \"" + endpoint + "\"");
+	}
+}
+
+BridgeListener::~BridgeListener()
+{
+	close(this->socket);
+	if (this->unixPath.empty() == false) {
+		unlink(this->unixPath.c_str());
+	}
+}
+
+uint16_t BridgeListener::port() const {
+	return this->listeningPort;
+}
+
+BridgeSocket BridgeListener::accept()
+{
+	while (true)
+	{
+		int descriptor = ::accept(this->socket, nullptr, nullptr);
+		if (descriptor != -1)
+		{
+			fcntl(descriptor, F_SETFD, FD_CLOEXEC);
+			return BridgeSocket(descriptor);
+		}
+		
+		if (errno != EINTR && errno != ECONNABORTED) {
+			throwError("accept a bridge connection");
+		}
+	}
+}
+
+} //End MediaIPC
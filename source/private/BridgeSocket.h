@@ -0,0 +1,105 @@
+#ifndef _MEDIA_IPC_BRIDGE_SOCKET
+#define _MEDIA_IPC_BRIDGE_SOCKET
+
+#include "../public/BridgeOptions.h"
+#include <stdint.h>
+#include <sys/uio.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace MediaIPC {
+
+//A connected stream socket, used by both sides of a bridge
+//(Endpoints are specified as "unix:PATH" for a Unix domain socket, or as "tcp:HOST:PORT" or simply "HOST:PORT" for TCP)
+class BridgeSocket
+{
+	public:
+		
+		//Connects to the specified endpoint, retrying until the timeout expires while nothing is listening on it
+		static BridgeSocket connect(const std::string& endpoint, const BridgeOptions& options);
+		
+		//Wraps a connected socket descriptor, or creates an unconnected socket if the descriptor is -1
+		BridgeSocket(int descriptor = -1);
+		~BridgeSocket();
+		
+		//BridgeSocket objects cannot be copied, only moved
+		BridgeSocket(const BridgeSocket& other) = delete;
+		BridgeSocket& operator=(const BridgeSocket& other) = delete;
+		BridgeSocket(BridgeSocket&& other);
+		BridgeSocket& operator=(BridgeSocket&& other);
+		
+		//Applies the socket options for a bridge connection (disabling Nagle's algorithm for TCP, and resizing the kernel buffers if requested)
+		void configure(const BridgeOptions& options);
+		
+		//Requests that writes be allowed to use MSG_ZEROCOPY, returning false if the socket does not support it
+		bool enableZeroCopy();
+		
+		//Writes the entire contents of the specified buffers, returning the number of system calls this required
+		//(The buffers are modified to track partial writes, and the number of zero-copy writes made is added to zeroCopyWrites,
+		//since the memory they refer to must remain unchanged until the kernel reports that it has completed them)
+		uint64_t writeAll(struct iovec* buffers, size_t count, bool zeroCopy, uint32_t& zeroCopyWrites);
+		
+		//Writes the specified bytes only if the kernel's send buffer has room for them, returning false if it was full
+		//(If only some of the bytes fit then the rest are written before returning, so that message boundaries are preserved)
+		bool tryWrite(const void* data, size_t length);
+		
+		//Reads exactly the specified number of bytes, returning false if the peer closed the connection before sending any of them
+		//(Small reads are served from an internal buffer, so that a burst of small messages costs a single system call)
+		bool readExact(void* destination, uint64_t length);
+		
+		//Reads whatever bytes are available without blocking, returning false if the peer has closed the connection
+		bool readAvailable(std::vector<uint8_t>& destination);
+		
+		//Collects the ranges of zero-copy writes that the kernel has finished with, counting those that it completed by copying
+		//(Zero-copy writes are numbered from zero in the order they were made, and each range holds the first and last write it covers)
+		void reapCompletions(std::vector< std::pair<uint32_t, uint32_t> >& ranges, uint64_t& copied);
+		
+		//Returns the number of system calls made to read from the socket
+		uint64_t reads() const;
+		
+		//Returns the underlying socket descriptor
+		int descriptor() const;
+		
+	private:
+		
+		//Receives into the specified buffer, returning the number of bytes received (zero if the peer closed the connection)
+		size_t receive(void* destination, size_t length);
+		
+		int socket;
+		std::unique_ptr<uint8_t[]> readBuffer;
+		size_t readOffset;
+		size_t readLength;
+		uint64_t readCalls;
+};
+
+//A socket listening for a bridge connection
+class BridgeListener
+{
+	public:
+		
+		//Listens on the specified endpoint (binding TCP port zero selects a free port, which port() then reports)
+		//(An existing Unix domain socket at the same path is replaced, and the path is removed again when the listener is destroyed)
+		BridgeListener(const std::string& endpoint);
+		~BridgeListener();
+		
+		//BridgeListener objects cannot be copied or moved
+		BridgeListener(const BridgeListener& other) = delete;
+		BridgeListener& operator=(const BridgeListener& other) = delete;
+		
+		//Returns the TCP port we are listening on (zero for Unix domain sockets)
+		uint16_t port() const;
+		
+		//Waits for a sender to connect
+		BridgeSocket accept();
+		
+	private:
+		int socket;
+		std::string unixPath;
+		uint16_t listeningPort;
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,24 @@
+#include "../public/BridgeStats.h"
+
+namespace MediaIPC {
+
+BridgeStats::BridgeStats()
+{
+	this->videoFrames = 0;
+	this->audioBlocks = 0;
+	this->controlBlocks = 0;
+	this->bytes = 0;
+	this->batches = 0;
+	this->videoFramesDropped = 0;
+	this->videoFramesTorn = 0;
+	this->zeroCopyWrites = 0;
+	this->zeroCopyCopied = 0;
+	this->localLatencyNanoseconds = 0;
+	this->localLatencyMaxNanoseconds = 0;
+	this->localLatencySamples = 0;
+	this->roundTripNanoseconds = 0;
+	this->roundTripMaxNanoseconds = 0;
+	this->roundTripSamples = 0;
+}
+
+} //End MediaIPC
@@ -4,11 +4,54 @@ namespace MediaIPC {
 
 ConsumerDelegate::~ConsumerDelegate() {}
 
+void ConsumerDelegate::videoFrameInfoReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info) {
+	this->videoFrameReceived(buffer, length);
+}
+
+void ConsumerDelegate::audioSamplesInfoReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info) {
+	this->audioSamplesReceived(buffer, length);
+}
+
+void ConsumerDelegate::videoFrameDamageReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info, const FrameDamage& damage) {
+	this->videoFrameInfoReceived(buffer, length, info);
+}
+
+void ConsumerDelegate::audioOverrun(uint64_t bytesLost) {}
+
+void ConsumerDelegate::audioUnderrun(uint64_t bytesMissing) {}
+
+bool ConsumerDelegate::receivesFrameViews() const {
+	return false;
+}
+
+void ConsumerDelegate::videoFrameViewReceived(VideoFrameView& view) {
+	this->videoFrameDamageReceived(view.data(), view.length(), view.info(), view.damage());
+}
+
+void ConsumerDelegate::videoFrameHandleReceived(FrameHandle& frame) {
+	this->videoFrameDamageReceived(frame.data(), frame.length(), frame.info(), frame.damage());
+}
+
+void ConsumerDelegate::audioSamplesHandleReceived(FrameHandle& samples) {
+	this->audioSamplesInfoReceived(samples.data(), samples.length(), samples.info());
+}
+
+AudioFormat ConsumerDelegate::requestedAudioFormat() const {
+	return AudioFormat::None;
+}
+
+bool ConsumerDelegate::receivesPlanarAudio() const {
+	return false;
+}
+
 FunctionConsumerDelegate::FunctionConsumerDelegate()
 {
 	this->setControlBlockHandler( [](const ControlBlock&){} );
 	this->setVideoHandler( [](const uint8_t*, uint64_t){} );
 	this->setAudioHandler( [](const uint8_t*, uint64_t){} );
+	this->setAudioOverrunHandler( [](uint64_t){} );
+	this->setAudioUnderrunHandler( [](uint64_t){} );
+	this->setRequestedAudioFormat(AudioFormat::None);
 }
 
 void FunctionConsumerDelegate::setControlBlockHandler(ControlBlockCallback cbHandler) {
@@ -23,6 +66,44 @@ void FunctionConsumerDelegate::setAudioHandler(DataCallback audioHandler) {
 	this->audioHandler = audioHandler;
 }
 
+void FunctionConsumerDelegate::setVideoInfoHandler(InfoDataCallback videoInfoHandler) {
+	this->videoInfoHandler = videoInfoHandler;
+}
+
+void FunctionConsumerDelegate::setAudioInfoHandler(InfoDataCallback audioInfoHandler) {
+	this->audioInfoHandler = audioInfoHandler;
+}
+
+void FunctionConsumerDelegate::setVideoDamageHandler(DamageDataCallback videoDamageHandler) {
+	this->videoDamageHandler = videoDamageHandler;
+}
+
+void FunctionConsumerDelegate::setAudioOverrunHandler(CountCallback overrunHandler) {
+	this->overrunHandler = overrunHandler;
+}
+
+void FunctionConsumerDelegate::setAudioUnderrunHandler(CountCallback underrunHandler) {
+	this->underrunHandler = underrunHandler;
+}
+
+void FunctionConsumerDelegate::setVideoViewHandler(ViewCallback videoViewHandler) {
+	this->videoViewHandler = videoViewHandler;
+}
+
+void FunctionConsumerDelegate::setVideoHandleHandler(HandleCallback videoHandleHandler) {
+	this->videoHandleHandler = videoHandleHandler;
+}
+
+void FunctionConsumerDelegate::setAudioHandleHandler(HandleCallback audioHandleHandler) {
+	this->audioHandleHandler = audioHandleHandler;
+}
+
+void FunctionConsumerDelegate::setRequestedAudioFormat(AudioFormat format, bool planar)
+{
+	this->audioFormat = format;
+	this->planarAudio = planar;
+}
+
 void FunctionConsumerDelegate::controlBlockReceived(const ControlBlock& cb) {
 	this->cbHandler(cb);
 }
@@ -35,4 +116,78 @@ void FunctionConsumerDelegate::audioSamplesReceived(const uint8_t* buffer, uint6
 	this->audioHandler(buffer, length);
 }
 
+void FunctionConsumerDelegate::videoFrameInfoReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info)
+{
+	if (this->videoInfoHandler) {
+		this->videoInfoHandler(buffer, length, info);
+	}
+	else {
+		this->videoHandler(buffer, length);
+	}
+}
+
+void FunctionConsumerDelegate::audioSamplesInfoReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info)
+{
+	if (this->audioInfoHandler) {
+		this->audioInfoHandler(buffer, length, info);
+	}
+	else {
+		this->audioHandler(buffer, length);
+	}
+}
+
+void FunctionConsumerDelegate::videoFrameDamageReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info, const FrameDamage& damage)
+{
+	if (this->videoDamageHandler) {
+		this->videoDamageHandler(buffer, length, info, damage);
+	}
+	else {
+		this->videoFrameInfoReceived(buffer, length, info);
+	}
+}
+
+void FunctionConsumerDelegate::audioOverrun(uint64_t bytesLost) {
+	this->overrunHandler(bytesLost);
+}
+
+void FunctionConsumerDelegate::audioUnderrun(uint64_t bytesMissing) {
+	this->underrunHandler(bytesMissing);
+}
+
+bool FunctionConsumerDelegate::receivesFrameViews() const {
+	return (bool)(this->videoViewHandler);
+}
+
+void FunctionConsumerDelegate::videoFrameViewReceived(VideoFrameView& view) {
+	this->videoViewHandler(view);
+}
+
+void FunctionConsumerDelegate::videoFrameHandleReceived(FrameHandle& frame)
+{
+	if (this->videoHandleHandler) {
+		this->videoHandleHandler(frame);
+	}
+	else {
+		ConsumerDelegate::videoFrameHandleReceived(frame);
+	}
+}
+
+void FunctionConsumerDelegate::audioSamplesHandleReceived(FrameHandle& samples)
+{
+	if (this->audioHandleHandler) {
+		this->audioHandleHandler(samples);
+	}
+	else {
+		ConsumerDelegate::audioSamplesHandleReceived(samples);
+	}
+}
+
+AudioFormat FunctionConsumerDelegate::requestedAudioFormat() const {
+	return this->audioFormat;
+}
+
+bool FunctionConsumerDelegate::receivesPlanarAudio() const {
+	return this->planarAudio;
+}
+
 } //End MediaIPC
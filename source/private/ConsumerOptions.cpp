@@ -0,0 +1,9 @@
+#include "../public/ConsumerOptions.h"
+
+namespace MediaIPC {
+
+ConsumerOptions::ConsumerOptions() {
+	this->attachTimeout = std::chrono::milliseconds::max();
+}
+
+} //End MediaIPC
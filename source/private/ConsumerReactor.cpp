@@ -0,0 +1,402 @@
+#include "../public/ConsumerReactor.h"
+#include "../public/MediaConsumer.h"
+#include "Doorbell.h"
+#include "Telemetry.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace MediaIPC {
+
+//A stream consumed by the reactor, which only one worker takes a turn with at a time
+struct ReactorStream
+{
+	uint64_t id;
+	std::string prefix;
+	std::unique_ptr<MediaConsumer> consumer;
+	
+	//Held for the duration of each turn, and set once the stream has been removed so that pending turns are skipped
+	std::mutex turnMutex;
+	bool removed;
+	
+	//The steady clock time at which the stream's last turn began, in nanoseconds since the clock's epoch
+	std::atomic<uint64_t> lastTurn;
+	
+	//Counters for the stats, which are only updated by the worker taking a turn
+	std::atomic<uint64_t> turns;
+	std::atomic<uint64_t> wakeups;
+	std::atomic<uint64_t> wakeLatencyNanoseconds;
+	std::atomic<uint64_t> wakeLatencyMaxNanoseconds;
+	std::atomic<uint64_t> wakeLatencySamples;
+	std::atomic<uint64_t> turnNanoseconds;
+	std::atomic<uint64_t> turnMaxNanoseconds;
+	
+	ReactorStream(uint64_t id, const std::string& prefix, std::unique_ptr<MediaConsumer>&& consumer) :
+		id(id), prefix(prefix), consumer(std::move(consumer)), removed(false), lastTurn(telemetryTimestamp()),
+		turns(0), wakeups(0), wakeLatencyNanoseconds(0), wakeLatencyMaxNanoseconds(0), wakeLatencySamples(0),
+		turnNanoseconds(0), turnMaxNanoseconds(0)
+	{}
+};
+
+//The epoll instance shared by the workers, along with the streams they consume
+struct ReactorState
+{
+	//The epoll instance, and an eventfd that wakes every worker when the reactor is destroyed
+	//(Each stream's descriptor is registered with the stream's ID, and the eventfd with an ID of zero)
+	int epoll;
+	int wakeup;
+	std::atomic<bool> stopping;
+	
+	//The streams being consumed, keyed by ID, and the final counters of streams that failed which stats() has yet to report
+	std::mutex mutex;
+	std::map< uint64_t, std::shared_ptr<ReactorStream> > streams;
+	std::vector<ReactorStats> failed;
+	uint64_t nextStream;
+	
+	std::vector<std::thread> workers;
+	
+	//The steady clock time at which idle streams are next checked (whichever worker notices first performs the check)
+	std::mutex checkMutex;
+	std::atomic<uint64_t> nextCheck;
+	
+	ReactorState() : epoll(-1), wakeup(-1), stopping(false), nextStream(1), nextCheck(0) {}
+};
+
+namespace
+{
+	//Records a latency that is only ever recorded by a single thread at a time, so the maximum does not need a compare-and-swap loop
+	void recordLatency(std::atomic<uint64_t>& total, std::atomic<uint64_t>& maximum, std::atomic<uint64_t>* samples, uint64_t latency)
+	{
+		total.fetch_add(latency, std::memory_order_relaxed);
+		if (samples != nullptr) {
+			samples->fetch_add(1, std::memory_order_relaxed);
+		}
+		
+		if (latency > maximum.load(std::memory_order_relaxed)) {
+			maximum.store(latency, std::memory_order_relaxed);
+		}
+	}
+	
+	//Registers or re-arms a descriptor so that exactly one worker is woken the next time it becomes readable
+	bool watchDescriptor(int epoll, int operation, int descriptor, uint64_t stream)
+	{
+		epoll_event event;
+		std::memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN | EPOLLONESHOT;
+		event.data.u64 = stream;
+		return (epoll_ctl(epoll, operation, descriptor, &event) == 0);
+	}
+}
+
+ConsumerReactor::ConsumerReactor(const ReactorOptions& options) : options(options), state(new ReactorState())
+{
+	ReactorState& state = *this->state;
+	state.epoll = epoll_create1(EPOLL_CLOEXEC);
+	if (state.epoll == -1) {
+		throw std::runtime_error("failed to create an epoll instance: " + std::string(std::strerror(errno)));
+	}
+	
+	//The eventfd is level-triggered, so once it has been written to it wakes every worker
+	state.wakeup = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	epoll_event event;
+	std::memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.u64 = 0;
+	if (state.wakeup == -1 || epoll_ctl(state.epoll, EPOLL_CTL_ADD, state.wakeup, &event) != 0)
+	{
+		std::string error = std::strerror(errno);
+		if (state.wakeup != -1) {
+			close(state.wakeup);
+		}
+		
+		close(state.epoll);
+		throw std::runtime_error("failed to create the reactor's wakeup eventfd: " + error);
+	}
+	
+	state.nextCheck = telemetryTimestamp() + std::chrono::duration_cast<std::chrono::nanoseconds>(this->options.checkInterval).count();
+	for (uint32_t index = 0; index < std::max(this->options.threads, (uint32_t)(1)); ++index) {
+		state.workers.push_back(std::thread(std::bind(&ConsumerReactor::workerLoop, this)));
+	}
+}
+
+ConsumerReactor::~ConsumerReactor()
+{
+	//Wake every worker and wait for any turns in progress to finish
+	ReactorState& state = *this->state;
+	state.stopping = true;
+	//(The eventfd only rejects a write if its counter would overflow, in which case it is already readable)
+	uint64_t value = 1;
+	ssize_t written = write(state.wakeup, &value, sizeof(value));
+	(void)(written);
+	
+	for (std::thread& worker : state.workers) {
+		worker.join();
+	}
+	
+	//Detach from every stream before closing the epoll instance that their descriptors are registered with
+	state.streams.clear();
+	close(state.wakeup);
+	close(state.epoll);
+}
+
+uint64_t ConsumerReactor::add(const std::string& prefix, std::unique_ptr<ConsumerDelegate>&& delegate)
+{
+	std::unique_ptr<MediaConsumer> consumer(new MediaConsumer(prefix, this->options.consumerOptions));
+	std::map< std::string, std::unique_ptr<ConsumerDelegate> > delegates;
+	delegates[consumer->trackParameters().front().name] = std::move(delegate);
+	return this->attach(std::move(consumer), std::move(delegates));
+}
+
+uint64_t ConsumerReactor::add(const std::string& prefix, std::map< std::string, std::unique_ptr<ConsumerDelegate> >&& delegates)
+{
+	std::unique_ptr<MediaConsumer> consumer(new MediaConsumer(prefix, this->options.consumerOptions));
+	return this->attach(std::move(consumer), std::move(delegates));
+}
+
+uint64_t ConsumerReactor::attach(std::unique_ptr<MediaConsumer>&& consumer, std::map< std::string, std::unique_ptr<ConsumerDelegate> >&& delegates)
+{
+	ReactorState& state = *this->state;
+	int descriptor = consumer->descriptor();
+	if (descriptor == -1) {
+		throw std::runtime_error("the producer with prefix \"" + consumer->prefix + "\" has no room in its registry for another consumer");
+	}
+	
+	//Hand the tracks to their delegates before any worker can take a turn with the stream
+	consumer->bindDelegates(std::move(delegates));
+	consumer->beginDispatch();
+	
+	std::shared_ptr<ReactorStream> stream;
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		stream.reset(new ReactorStream(state.nextStream++, consumer->prefix, std::move(consumer)));
+		state.streams[stream->id] = stream;
+	}
+	
+	//Ring the doorbell ourselves so that the stream takes its first turn straight away, delivering anything already published
+	//(Holding the stream's mutex means a worker cannot finish that turn and re-arm the descriptor before we have added it)
+	{
+		std::lock_guard<std::mutex> lock(stream->turnMutex);
+		stream->consumer->doorbell->ring();
+		if (watchDescriptor(state.epoll, EPOLL_CTL_ADD, descriptor, stream->id) == false)
+		{
+			std::string error = std::strerror(errno);
+			{
+				std::lock_guard<std::mutex> mapLock(state.mutex);
+				state.streams.erase(stream->id);
+			}
+			
+			stream->removed = true;
+			stream->consumer.reset();
+			throw std::runtime_error("failed to watch the descriptor of the stream with prefix \"" + stream->prefix + "\": " + error);
+		}
+	}
+	
+	return stream->id;
+}
+
+void ConsumerReactor::remove(uint64_t id)
+{
+	//Once the stream is no longer in the map no new turns can begin, so we only need to wait for any turn in progress
+	ReactorState& state = *this->state;
+	std::shared_ptr<ReactorStream> stream;
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		auto iter = state.streams.find(id);
+		if (iter == state.streams.end()) {
+			return;
+		}
+		
+		stream = iter->second;
+		state.streams.erase(iter);
+	}
+	
+	std::lock_guard<std::mutex> lock(stream->turnMutex);
+	stream->removed = true;
+	epoll_ctl(state.epoll, EPOLL_CTL_DEL, stream->consumer->descriptor(), nullptr);
+	stream->consumer.reset();
+}
+
+size_t ConsumerReactor::streamCount() const
+{
+	std::lock_guard<std::mutex> lock(this->state->mutex);
+	return this->state->streams.size();
+}
+
+std::vector<ReactorStats> ConsumerReactor::stats() const
+{
+	//Streams are removed from the map before their consumers are destroyed, so holding the mutex keeps every consumer alive
+	std::vector<ReactorStats> snapshots;
+	std::lock_guard<std::mutex> lock(this->state->mutex);
+	for (auto& pair : this->state->streams) {
+		snapshots.push_back(ConsumerReactor::snapshot(*pair.second));
+	}
+	
+	//Each failed stream is only reported once
+	snapshots.insert(snapshots.end(), this->state->failed.begin(), this->state->failed.end());
+	this->state->failed.clear();
+	return snapshots;
+}
+
+ReactorStats ConsumerReactor::snapshot(const ReactorStream& stream)
+{
+	const ConsumerCounters& counters = *stream.consumer->counters;
+	ReactorStats stats;
+	stats.stream = stream.id;
+	stats.prefix = stream.prefix;
+	stats.turns = stream.turns.load(std::memory_order_relaxed);
+	stats.wakeups = stream.wakeups.load(std::memory_order_relaxed);
+	stats.wakeLatencyNanoseconds = stream.wakeLatencyNanoseconds.load(std::memory_order_relaxed);
+	stats.wakeLatencyMaxNanoseconds = stream.wakeLatencyMaxNanoseconds.load(std::memory_order_relaxed);
+	stats.wakeLatencySamples = stream.wakeLatencySamples.load(std::memory_order_relaxed);
+	stats.turnNanoseconds = stream.turnNanoseconds.load(std::memory_order_relaxed);
+	stats.turnMaxNanoseconds = stream.turnMaxNanoseconds.load(std::memory_order_relaxed);
+	stats.videoFramesConsumed = counters.videoFramesConsumed.load(std::memory_order_relaxed);
+	stats.videoFramesSkipped = counters.videoFramesSkipped.load(std::memory_order_relaxed);
+	stats.audioBuffersConsumed = counters.audioBuffersConsumed.load(std::memory_order_relaxed);
+	stats.audioBytesLost = counters.audioBytesLost.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void ConsumerReactor::workerLoop()
+{
+	ReactorState& state = *this->state;
+	uint32_t batchSize = std::max(this->options.batchSize, (uint32_t)(1));
+	std::vector<epoll_event> events(batchSize);
+	int timeout = (int)(std::max(this->options.checkInterval.count(), (std::chrono::milliseconds::rep)(1)));
+	while (state.stopping == false)
+	{
+		int ready = epoll_wait(state.epoll, events.data(), (int)(batchSize), timeout);
+		if (state.stopping == true) {
+			break;
+		}
+		
+		//Each stream's descriptor is registered as one-shot, so no other worker can have received the same stream
+		for (int index = 0; index < ready; ++index)
+		{
+			if (events[index].data.u64 != 0) {
+				this->turn(events[index].data.u64);
+			}
+		}
+		
+		if (telemetryTimestamp() >= state.nextCheck.load(std::memory_order_relaxed)) {
+			this->checkIdleStreams();
+		}
+	}
+}
+
+void ConsumerReactor::turn(uint64_t id)
+{
+	ReactorState& state = *this->state;
+	std::shared_ptr<ReactorStream> stream;
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		auto iter = state.streams.find(id);
+		if (iter == state.streams.end()) {
+			return;
+		}
+		
+		stream = iter->second;
+	}
+	
+	std::lock_guard<std::mutex> lock(stream->turnMutex);
+	if (stream->removed == true) {
+		return;
+	}
+	
+	//Measure how long the stream waited for a worker after its producer woke us
+	MediaConsumer& consumer = *stream->consumer;
+	uint64_t began = telemetryTimestamp();
+	uint64_t rung = consumer.doorbell->drain();
+	stream->turns.fetch_add(1, std::memory_order_relaxed);
+	stream->lastTurn.store(began, std::memory_order_relaxed);
+	if (rung != 0)
+	{
+		stream->wakeups.fetch_add(1, std::memory_order_relaxed);
+		recordLatency(stream->wakeLatencyNanoseconds, stream->wakeLatencyMaxNanoseconds, &stream->wakeLatencySamples, began - std::min(began, rung));
+	}
+	
+	//Arm the doorbell before sampling, so that anything published while the delegates run wakes us again
+	//(The descriptor is then readable when we re-arm it, which sends the stream to the back of the queue rather than
+	//letting a busy stream keep the worker to itself)
+	//(Workers are shared by every stream, so an exception thrown by a delegate or by remapping the stream's buffers only
+	//detaches the stream that threw it)
+	bool active = false;
+	bool failed = false;
+	std::string error;
+	try
+	{
+		consumer.prepareWait();
+		active = consumer.dispatch();
+	}
+	catch (std::exception& e)
+	{
+		failed = true;
+		error = e.what();
+	}
+	
+	if (active == true)
+	{
+		watchDescriptor(state.epoll, EPOLL_CTL_MOD, consumer.descriptor(), id);
+		recordLatency(stream->turnNanoseconds, stream->turnMaxNanoseconds, nullptr, telemetryTimestamp() - began);
+		return;
+	}
+	
+	//The producer has stopped or the stream has failed, so detach from the stream, keeping the final counters of a failed stream for stats()
+	{
+		std::lock_guard<std::mutex> mapLock(state.mutex);
+		state.streams.erase(id);
+		if (failed == true)
+		{
+			ReactorStats stats = ConsumerReactor::snapshot(*stream);
+			stats.error = error;
+			state.failed.push_back(stats);
+		}
+	}
+	
+	stream->removed = true;
+	epoll_ctl(state.epoll, EPOLL_CTL_DEL, consumer.descriptor(), nullptr);
+	stream->consumer.reset();
+}
+
+void ConsumerReactor::checkIdleStreams()
+{
+	//Only one worker performs each check
+	ReactorState& state = *this->state;
+	std::unique_lock<std::mutex> checkLock(state.checkMutex, std::try_to_lock);
+	uint64_t now = telemetryTimestamp();
+	if (checkLock.owns_lock() == false || now < state.nextCheck.load(std::memory_order_relaxed)) {
+		return;
+	}
+	
+	uint64_t interval = std::chrono::duration_cast<std::chrono::nanoseconds>(this->options.checkInterval).count();
+	state.nextCheck.store(now + interval, std::memory_order_relaxed);
+	std::vector< std::shared_ptr<ReactorStream> > streams;
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		for (auto& pair : state.streams) {
+			streams.push_back(pair.second);
+		}
+	}
+	
+	//Ring the doorbell of each stream that has not had a turn recently, so that a stream whose producer could not ring it
+	//still notices when the stream ends (streams that are taking a turn right now are skipped rather than waited for)
+	for (auto& stream : streams)
+	{
+		std::unique_lock<std::mutex> lock(stream->turnMutex, std::try_to_lock);
+		if (lock.owns_lock() == true && stream->removed == false && now - std::min(now, stream->lastTurn.load(std::memory_order_relaxed)) >= interval) {
+			stream->consumer->doorbell->ring();
+		}
+	}
+}
+
+} //End MediaIPC
@@ -10,15 +10,20 @@ ControlBlock::ControlBlock()
 	this->height = 0;
 	this->frameRate = 0;
 	this->videoFormat = VideoFormat::None;
+	this->videoSlots = 3;
+	this->videoStride = 0;
+	this->videoAlignment = 64;
 	
 	this->channels = 0;
 	this->sampleRate = 0;
 	this->samplesPerBuffer = 0;
 	this->audioFormat = AudioFormat::None;
+	this->audioRingBuffers = 4;
 	
 	this->active = false;
-	this->lastBuffer = VideoBuffer::FrontBuffer;
-	this->ringHead = 0;
+	this->videoBacking = 0;
+	this->audioBacking = 0;
+	this->prefault = false;
 }
 
 uint64_t ControlBlock::calculateVideoBufsize() const
@@ -27,7 +32,11 @@ uint64_t ControlBlock::calculateVideoBufsize() const
 		return 0;
 	}
 	
-	return this->width * this->height * FormatDetails::bytesPerPixel(this->videoFormat);
+	return FormatDetails::frameSize(this->videoFormat, this->width, this->height, this->videoStride);
+}
+
+PlaneLayout ControlBlock::calculateVideoPlaneLayout(uint8_t plane) const {
+	return FormatDetails::planeLayout(this->videoFormat, this->width, this->height, plane, this->videoStride);
 }
 
 uint64_t ControlBlock::calculateAudioBufsize() const
@@ -39,6 +48,10 @@ uint64_t ControlBlock::calculateAudioBufsize() const
 	return this->channels * FormatDetails::bytesPerSample(this->audioFormat) * this->samplesPerBuffer;
 }
 
+uint64_t ControlBlock::calculateAudioRingSize() const {
+	return this->calculateAudioBufsize() * this->audioRingBuffers;
+}
+
 std::chrono::microseconds ControlBlock::calculateVideoInterval() const
 {
 	double microseconds = (1.0 / (double)this->frameRate) * MICROSECONDS;
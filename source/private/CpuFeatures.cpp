@@ -0,0 +1,27 @@
+#include "CpuFeatures.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#include <intrin.h>
+	#include <immintrin.h>
+#endif
+
+namespace MediaIPC {
+
+bool cpuSupportsAVX2()
+{
+	#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+		__builtin_cpu_init();
+		return (__builtin_cpu_supports("avx2") != 0);
+	#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		int info[4];
+		__cpuid(info, 1);
+		bool osxsave = ((info[2] & (1 << 27)) != 0);
+		__cpuidex(info, 7, 0);
+		bool avx2 = ((info[1] & (1 << 5)) != 0);
+		return (osxsave == true && avx2 == true && (_xgetbv(0) & 0x6) == 0x6);
+	#else
+		return false;
+	#endif
+}
+
+} //End MediaIPC
@@ -0,0 +1,12 @@
+#ifndef _MEDIA_IPC_CPU_FEATURES
+#define _MEDIA_IPC_CPU_FEATURES
+
+namespace MediaIPC {
+
+//Determines if the CPU and operating system support AVX2
+//(This is shared by the video and audio conversion code, which select their SIMD kernels at runtime)
+bool cpuSupportsAVX2();
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,159 @@
+#include "DamageList.h"
+#include <algorithm>
+#include <cstring>
+
+namespace MediaIPC {
+
+namespace
+{
+	//Divides and rounds up to the nearest whole number
+	uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+		return (value + divisor - 1) / divisor;
+	}
+}
+
+void DamageList::clear()
+{
+	this->full = 0;
+	this->count = 0;
+}
+
+void DamageList::setFull()
+{
+	this->full = 1;
+	this->count = 0;
+}
+
+void DamageList::add(const DamageRect& rect)
+{
+	if (this->full != 0) {
+		return;
+	}
+	
+	if (this->count < MEDIA_IPC_MAX_DAMAGE_RECTS)
+	{
+		this->rects[this->count] = rect;
+		this->count += 1;
+		return;
+	}
+	
+	//The list is at capacity, so replace its contents with the bounding box of every rectangle
+	uint32_t left = rect.x;
+	uint32_t top = rect.y;
+	uint32_t right = rect.x + rect.width;
+	uint32_t bottom = rect.y + rect.height;
+	for (uint32_t index = 0; index < this->count; ++index)
+	{
+		const DamageRect& existing = this->rects[index];
+		left = std::min(left, existing.x);
+		top = std::min(top, existing.y);
+		right = std::max(right, existing.x + existing.width);
+		bottom = std::max(bottom, existing.y + existing.height);
+	}
+	
+	this->rects[0] = DamageRect(left, top, right - left, bottom - top);
+	this->count = 1;
+}
+
+void DamageList::merge(const DamageList& other)
+{
+	if (other.full != 0)
+	{
+		this->setFull();
+		return;
+	}
+	
+	for (uint32_t index = 0; index < other.count; ++index) {
+		this->add(other.rects[index]);
+	}
+}
+
+void DamageList::toFrameDamage(FrameDamage& damage) const
+{
+	damage.full = (this->full != 0);
+	damage.rects.assign(this->rects, this->rects + ((this->full != 0) ? 0 : this->count));
+}
+
+DamageCopier::DamageCopier() : width(0), height(0), frameSize(0), planes(0) {}
+
+DamageCopier::DamageCopier(const ControlBlock& cb)
+{
+	this->width = cb.width;
+	this->height = cb.height;
+	this->frameSize = cb.calculateVideoBufsize();
+	this->planes = std::min(FormatDetails::planeCount(cb.videoFormat), (uint8_t)(4));
+	
+	//Chroma planes have one sample for each block of subsampled pixels, and so does the single plane of a packed format
+	//with chroma subsampling (such as YUY2, in which each pair of pixels shares a four-byte macropixel)
+	uint32_t subsampleX = FormatDetails::subsamplingX(cb.videoFormat);
+	uint32_t subsampleY = FormatDetails::subsamplingY(cb.videoFormat);
+	uint32_t bytes = FormatDetails::bytesPerPixel(cb.videoFormat);
+	for (uint8_t plane = 0; plane < this->planes; ++plane)
+	{
+		PlaneLayout layout = cb.calculateVideoPlaneLayout(plane);
+		Plane& target = this->layouts[plane];
+		target.offset = layout.offset;
+		target.stride = layout.stride;
+		target.rows = layout.rows;
+		if (plane == 0)
+		{
+			target.pixelsX = (this->planes == 1) ? subsampleX : 1;
+			target.pixelsY = 1;
+			target.bytesPerSample = bytes * target.pixelsX;
+		}
+		else
+		{
+			//Semi-planar formats interleave both chroma components in a single plane
+			target.pixelsX = subsampleX;
+			target.pixelsY = subsampleY;
+			target.bytesPerSample = bytes * ((this->planes == 2) ? 2 : 1);
+		}
+	}
+}
+
+bool DamageCopier::clamp(DamageRect& rect) const
+{
+	if (rect.x >= this->width || rect.y >= this->height) {
+		return false;
+	}
+	
+	rect.width = std::min(rect.width, this->width - rect.x);
+	rect.height = std::min(rect.height, this->height - rect.y);
+	return (rect.width > 0 && rect.height > 0);
+}
+
+uint64_t DamageCopier::copy(uint8_t* destination, const uint8_t* source, const DamageList& damage) const
+{
+	if (damage.full != 0)
+	{
+		std::memcpy(destination, source, this->frameSize);
+		return this->frameSize;
+	}
+	
+	//Copy the rows of each plane that the rectangle covers, widening the rectangle to whole samples in subsampled planes
+	uint64_t copied = 0;
+	for (uint32_t index = 0; index < damage.count; ++index)
+	{
+		const DamageRect& rect = damage.rects[index];
+		for (uint8_t plane = 0; plane < this->planes; ++plane)
+		{
+			const Plane& layout = this->layouts[plane];
+			uint32_t left = rect.x / layout.pixelsX;
+			uint32_t right = divideRoundUp(rect.x + rect.width, layout.pixelsX);
+			uint32_t top = rect.y / layout.pixelsY;
+			uint32_t bottom = std::min(divideRoundUp(rect.y + rect.height, layout.pixelsY), layout.rows);
+			uint64_t length = (uint64_t)(right - left) * layout.bytesPerSample;
+			for (uint32_t row = top; row < bottom; ++row)
+			{
+				uint64_t offset = layout.offset + (row * layout.stride) + ((uint64_t)(left) * layout.bytesPerSample);
+				std::memcpy(destination + offset, source + offset, length);
+			}
+			
+			copied += length * (bottom - top);
+		}
+	}
+	
+	return copied;
+}
+
+} //End MediaIPC
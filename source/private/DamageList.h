@@ -0,0 +1,75 @@
+#ifndef _MEDIA_IPC_DAMAGE_LIST
+#define _MEDIA_IPC_DAMAGE_LIST
+
+#include "../public/ControlBlock.h"
+#include "../public/FrameDamage.h"
+#include <stdint.h>
+
+namespace MediaIPC {
+
+//Bounded list of damaged rectangles, stored in the header of each frame slot in shared memory
+struct DamageList
+{
+	//Non-zero if the whole frame is damaged, in which case the rectangles are ignored
+	uint32_t full;
+	
+	//The number of rectangles in use
+	uint32_t count;
+	DamageRect rects[MEDIA_IPC_MAX_DAMAGE_RECTS];
+	
+	//Marks nothing or everything as damaged
+	void clear();
+	void setFull();
+	
+	//Adds a rectangle, collapsing the list into its bounding box if it is already at capacity
+	void add(const DamageRect& rect);
+	
+	//Adds every rectangle from another list (which marks everything as damaged if the other list does)
+	void merge(const DamageList& other);
+	
+	//Copies the list into the public representation that is passed to delegates
+	void toFrameDamage(FrameDamage& damage) const;
+};
+
+//Copies the damaged regions of a video frame between two buffers holding frames with the same parameters,
+//taking the planes and chroma subsampling of the pixel format into account
+class DamageCopier
+{
+	public:
+		
+		//Creates a copier for frames with no video (which never copies anything)
+		DamageCopier();
+		
+		//Creates a copier for frames with the video parameters of the specified control block
+		DamageCopier(const ControlBlock& cb);
+		
+		//Clamps a rectangle to the bounds of the frame, returning false if nothing remains
+		bool clamp(DamageRect& rect) const;
+		
+		//Copies the damaged regions (or the whole frame) from the source to the destination, returning the number of bytes copied
+		uint64_t copy(uint8_t* destination, const uint8_t* source, const DamageList& damage) const;
+		
+	private:
+		
+		//The location of a plane, the number of pixels horizontally and vertically that share each of its samples,
+		//and the number of bytes occupied by each sample
+		struct Plane
+		{
+			uint64_t offset;
+			uint64_t stride;
+			uint32_t rows;
+			uint32_t pixelsX;
+			uint32_t pixelsY;
+			uint32_t bytesPerSample;
+		};
+		
+		uint32_t width;
+		uint32_t height;
+		uint64_t frameSize;
+		uint8_t planes;
+		Plane layouts[4];
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,641 @@
+#include "../public/DelegateDispatcher.h"
+#include "FramePool.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+using std::chrono::steady_clock;
+
+namespace MediaIPC {
+
+class DispatchingDelegate;
+
+//The types of entries in a delegate's queues
+enum class DispatchItemType : uint8_t
+{
+	ControlBlock,
+	VideoFrame,
+	AudioSamples,
+	AudioOverrun,
+	AudioUnderrun
+};
+
+//An entry in one of a delegate's queues
+struct DispatchItem
+{
+	DispatchItemType type;
+	
+	//The pooled buffer holding a video frame or block of audio samples
+	FrameHandle handle;
+	
+	//The parameters for a control block update
+	ControlBlock controlBlock;
+	
+	//For control blocks, the number of updates queued for the delegate up to and including this one; for video frames, the
+	//sequence number of the frame the wrapper received before this one; and for overruns and underruns, the number of bytes
+	uint64_t value;
+	
+	//When the entry was queued
+	steady_clock::time_point queued;
+};
+
+//A queue of video or audio data for a single delegate, stored as a ring that only grows if control blocks or notifications
+//accumulate behind a delegate that has stalled
+//(Everything other than the ring's contents is protected by the dispatcher's mutex, apart from lastDelivered, which is
+//only accessed by the worker that is currently passing an entry to the delegate)
+struct DispatchLane
+{
+	DispatchLane(DispatchingDelegate* owner, uint32_t depth) :
+		owner(owner), items(depth + 4), head(0), count(0), media(0), depth(depth), busy(false), lastDelivered(0)
+	{}
+	
+	//Returns the entry at the specified position, counting from the oldest
+	DispatchItem& at(size_t position) {
+		return this->items[(this->head + position) % this->items.size()];
+	}
+	
+	//Appends an entry, doubling the size of the ring if it is full
+	void push(DispatchItem&& item)
+	{
+		if (this->count == this->items.size())
+		{
+			std::vector<DispatchItem> grown(this->items.size() * 2);
+			for (size_t position = 0; position < this->count; ++position) {
+				grown[position] = std::move(this->at(position));
+			}
+			
+			this->items.swap(grown);
+			this->head = 0;
+		}
+		
+		this->at(this->count) = std::move(item);
+		this->count += 1;
+	}
+	
+	//Removes and returns the oldest entry
+	DispatchItem pop()
+	{
+		DispatchItem item = std::move(this->at(0));
+		this->head = (this->head + 1) % this->items.size();
+		this->count -= 1;
+		return item;
+	}
+	
+	//Removes the oldest video frame or block of samples, moving the entries queued before it along by one
+	void dropOldest()
+	{
+		size_t position = 0;
+		while (position < this->count && this->at(position).type != DispatchItemType::VideoFrame && this->at(position).type != DispatchItemType::AudioSamples) {
+			++position;
+		}
+		
+		if (position < this->count)
+		{
+			this->at(position).handle.release();
+			for (; position > 0; --position) {
+				this->at(position) = std::move(this->at(position - 1));
+			}
+			
+			this->head = (this->head + 1) % this->items.size();
+			this->count -= 1;
+			this->media -= 1;
+		}
+	}
+	
+	//Determines if everything queued has been passed to the delegate
+	bool drained() const {
+		return (this->count == 0 && this->busy == false);
+	}
+	
+	DispatchingDelegate* owner;
+	std::vector<DispatchItem> items;
+	size_t head;
+	size_t count;
+	
+	//The number of video frames or blocks of samples queued (including one that a sampling thread is about to queue), and the limit
+	uint32_t media;
+	uint32_t depth;
+	
+	//Whether a worker is currently passing an entry to the delegate
+	bool busy;
+	
+	//The sequence number of the last video frame passed to the delegate
+	uint64_t lastDelivered;
+	
+	//Notified whenever an entry is removed, for sampling threads waiting for room under DispatchPolicy::Block
+	std::condition_variable space;
+};
+
+//The worker threads and the queues they serve
+struct DispatcherState
+{
+	//Runs on each worker thread, passing queued entries to their delegates until the dispatcher stops and the queues are empty
+	void workLoop();
+	
+	//Selects the next queue with entries that is not already being served by another worker, in round-robin order
+	DispatchLane* nextLane();
+	
+	DispatchOptions options;
+	
+	//Protects the queues, the list of delegates and the counters
+	mutable std::mutex mutex;
+	
+	//Notified when entries are queued, and whenever a worker finishes passing an entry to its delegate
+	std::condition_variable work;
+	std::condition_variable idle;
+	
+	//The queues of every delegate we run, and the delegates themselves in the order they were wrapped
+	std::vector<DispatchLane*> lanes;
+	std::vector<DispatchingDelegate*> delegates;
+	size_t next;
+	
+	//Set when the dispatcher begins shutting down, and once the workers have exited
+	bool stopping;
+	bool stopped;
+	
+	std::vector<std::thread> workers;
+};
+
+//Wraps a delegate, queueing the data it receives on the sampling threads for our worker threads to pass on
+class DispatchingDelegate : public ConsumerDelegate
+{
+	public:
+		DispatchingDelegate(std::shared_ptr<DispatcherState> state, std::unique_ptr<ConsumerDelegate>&& delegate, const std::string& name);
+		~DispatchingDelegate();
+		
+		void controlBlockReceived(const ControlBlock& cb);
+		void videoFrameReceived(const uint8_t* buffer, uint64_t length);
+		void audioSamplesReceived(const uint8_t* buffer, uint64_t length);
+		void videoFrameInfoReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info);
+		void audioSamplesInfoReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info);
+		void videoFrameDamageReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info, const FrameDamage& damage);
+		void audioOverrun(uint64_t bytesLost);
+		void audioUnderrun(uint64_t bytesMissing);
+		bool receivesFrameViews() const;
+		void videoFrameViewReceived(VideoFrameView& view);
+		AudioFormat requestedAudioFormat() const;
+		bool receivesPlanarAudio() const;
+		
+		//Passes a queued entry to the delegate (called without holding the dispatcher's mutex) and records the time it took
+		void deliver(DispatchLane& lane, DispatchItem& item);
+		void record(DispatchLane& lane, DispatchItemType type, uint64_t queueNanoseconds, uint64_t handlerNanoseconds);
+		
+		//Returns the current values of our counters (the caller must hold the dispatcher's mutex)
+		DispatchStats stats() const;
+		
+		DispatchLane videoLane;
+		DispatchLane audioLane;
+		
+	private:
+		
+		//Reserves room for a video frame or block of samples according to the dispatch policy, returning false if it is to be discarded
+		bool admit(DispatchLane& lane);
+		
+		//Queues an entry, or passes it straight to the delegate if the workers have already stopped
+		void enqueue(DispatchLane& lane, DispatchItem&& item);
+		
+		//Queues a notification of an overrun or underrun, merging it with one that is still queued
+		void enqueueNotification(DispatchItemType type, uint64_t bytes);
+		
+		//Copies a video frame or block of samples into a pooled buffer and queues it
+		void queueData(DispatchLane& lane, FramePool& pool, DispatchItemType type, const uint8_t* buffer, uint64_t length, const FrameInfo& info, const FrameDamage* damage, uint64_t value);
+		
+		std::shared_ptr<DispatcherState> state;
+		std::unique_ptr<ConsumerDelegate> delegate;
+		
+		//The pooled buffers for each queue
+		FramePool videoPool;
+		FramePool audioPool;
+		
+		//The number of control block updates queued and the number passed to the delegate
+		//(Updates are queued for both the video and audio queues, and whichever worker reaches an update first passes it on,
+		//so that neither queue passes data using the new parameters before the delegate has seen them)
+		std::mutex reconfigureMutex;
+		uint64_t controlBlocksQueued;
+		uint64_t controlBlocksDelivered;
+		
+		//The sequence number of the last video frame we received from the sampling thread
+		uint64_t previousSequence;
+		
+		DispatchStats counters;
+};
+
+namespace
+{
+	//Records a duration in a running total and maximum
+	void recordDuration(uint64_t& total, uint64_t& maximum, uint64_t nanoseconds)
+	{
+		total += nanoseconds;
+		maximum = std::max(maximum, nanoseconds);
+	}
+	
+	uint64_t elapsedNanoseconds(steady_clock::time_point start, steady_clock::time_point end) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	}
+}
+
+void DispatcherState::workLoop()
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+	while (true)
+	{
+		//Wait for a queue with entries, exiting once we are stopping and every queue is empty (or being emptied by another worker)
+		DispatchLane* lane = this->nextLane();
+		if (lane == nullptr)
+		{
+			if (this->stopping == true) {
+				return;
+			}
+			
+			this->work.wait(lock);
+			continue;
+		}
+		
+		//Take the oldest entry, letting any sampling thread waiting for room know that there is now room
+		DispatchItem item = lane->pop();
+		lane->busy = true;
+		if (item.type == DispatchItemType::VideoFrame || item.type == DispatchItemType::AudioSamples)
+		{
+			lane->media -= 1;
+			lane->space.notify_all();
+		}
+		
+		//Pass the entry to its delegate without holding the mutex, returning the buffer to its pool straight afterwards
+		lock.unlock();
+		steady_clock::time_point start = steady_clock::now();
+		lane->owner->deliver(*lane, item);
+		steady_clock::time_point end = steady_clock::now();
+		item.handle.release();
+		lock.lock();
+		
+		lane->busy = false;
+		lane->owner->record(*lane, item.type, elapsedNanoseconds(item.queued, start), elapsedNanoseconds(start, end));
+		this->idle.notify_all();
+	}
+}
+
+DispatchLane* DispatcherState::nextLane()
+{
+	for (size_t offset = 0; offset < this->lanes.size(); ++offset)
+	{
+		DispatchLane* lane = this->lanes[(this->next + offset) % this->lanes.size()];
+		if (lane->count > 0 && lane->busy == false)
+		{
+			this->next = (this->next + offset + 1) % this->lanes.size();
+			return lane;
+		}
+	}
+	
+	return nullptr;
+}
+
+DispatchingDelegate::DispatchingDelegate(std::shared_ptr<DispatcherState> state, std::unique_ptr<ConsumerDelegate>&& delegate, const std::string& name) :
+	videoLane(this, state->options.videoQueueDepth), audioLane(this, state->options.audioQueueDepth)
+{
+	this->state = state;
+	this->delegate = std::move(delegate);
+	this->controlBlocksQueued = 0;
+	this->controlBlocksDelivered = 0;
+	this->previousSequence = 0;
+	this->counters.name = name;
+	
+	std::lock_guard<std::mutex> lock(this->state->mutex);
+	this->state->lanes.push_back(&this->videoLane);
+	this->state->lanes.push_back(&this->audioLane);
+	this->state->delegates.push_back(this);
+}
+
+DispatchingDelegate::~DispatchingDelegate()
+{
+	//Wait for our queues to empty, and then stop the workers from serving them
+	{
+		std::unique_lock<std::mutex> lock(this->state->mutex);
+		while (this->state->stopped == false && (this->videoLane.drained() == false || this->audioLane.drained() == false)) {
+			this->state->idle.wait(lock);
+		}
+		
+		std::vector<DispatchLane*>& lanes = this->state->lanes;
+		lanes.erase(std::remove(lanes.begin(), lanes.end(), &this->videoLane), lanes.end());
+		lanes.erase(std::remove(lanes.begin(), lanes.end(), &this->audioLane), lanes.end());
+		std::vector<DispatchingDelegate*>& delegates = this->state->delegates;
+		delegates.erase(std::remove(delegates.begin(), delegates.end(), this), delegates.end());
+	}
+	
+	//Destroy the delegate before our pools, since it may still hold handles to their buffers
+	this->delegate.reset();
+}
+
+void DispatchingDelegate::controlBlockReceived(const ControlBlock& cb)
+{
+	DispatchItem item;
+	item.type = DispatchItemType::ControlBlock;
+	item.controlBlock = cb;
+	item.queued = steady_clock::now();
+	
+	std::unique_lock<std::mutex> lock(this->state->mutex);
+	this->controlBlocksQueued += 1;
+	item.value = this->controlBlocksQueued;
+	if (this->state->stopped == true)
+	{
+		lock.unlock();
+		this->deliver(this->videoLane, item);
+		return;
+	}
+	
+	DispatchItem copy = item;
+	this->videoLane.push(std::move(item));
+	this->audioLane.push(std::move(copy));
+	this->state->work.notify_all();
+}
+
+void DispatchingDelegate::videoFrameReceived(const uint8_t* buffer, uint64_t length) {
+	this->videoFrameInfoReceived(buffer, length, FrameInfo());
+}
+
+void DispatchingDelegate::audioSamplesReceived(const uint8_t* buffer, uint64_t length) {
+	this->audioSamplesInfoReceived(buffer, length, FrameInfo());
+}
+
+void DispatchingDelegate::videoFrameInfoReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info) {
+	this->videoFrameDamageReceived(buffer, length, info, FrameDamage());
+}
+
+void DispatchingDelegate::audioSamplesInfoReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info) {
+	this->queueData(this->audioLane, this->audioPool, DispatchItemType::AudioSamples, buffer, length, info, nullptr, 0);
+}
+
+void DispatchingDelegate::videoFrameDamageReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info, const FrameDamage& damage)
+{
+	//Remember which frame the damage is measured against, so that the worker can tell whether that frame reached the delegate
+	uint64_t previous = this->previousSequence;
+	this->previousSequence = info.sequence;
+	this->queueData(this->videoLane, this->videoPool, DispatchItemType::VideoFrame, buffer, length, info, &damage, previous);
+}
+
+void DispatchingDelegate::audioOverrun(uint64_t bytesLost) {
+	this->enqueueNotification(DispatchItemType::AudioOverrun, bytesLost);
+}
+
+void DispatchingDelegate::audioUnderrun(uint64_t bytesMissing) {
+	this->enqueueNotification(DispatchItemType::AudioUnderrun, bytesMissing);
+}
+
+bool DispatchingDelegate::receivesFrameViews() const {
+	return true;
+}
+
+void DispatchingDelegate::videoFrameViewReceived(VideoFrameView& view)
+{
+	//Copy the frame straight from shared memory into a pooled buffer, releasing the pin as soon as we have done so
+	this->videoFrameDamageReceived(view.data(), view.length(), view.info(), view.damage());
+	view.release();
+}
+
+AudioFormat DispatchingDelegate::requestedAudioFormat() const {
+	return this->delegate->requestedAudioFormat();
+}
+
+bool DispatchingDelegate::receivesPlanarAudio() const {
+	return this->delegate->receivesPlanarAudio();
+}
+
+void DispatchingDelegate::deliver(DispatchLane& lane, DispatchItem& item)
+{
+	switch (item.type)
+	{
+		case DispatchItemType::ControlBlock:
+		{
+			std::lock_guard<std::mutex> lock(this->reconfigureMutex);
+			if (this->controlBlocksDelivered < item.value)
+			{
+				this->delegate->controlBlockReceived(item.controlBlock);
+				this->controlBlocksDelivered = item.value;
+			}
+			
+			break;
+		}
+		
+		case DispatchItemType::VideoFrame:
+		{
+			//If the frame the damage is measured against was discarded then the delegate has not seen it, so the whole frame has changed
+			FrameBuffer& buffer = FramePool::buffer(item.handle);
+			if (item.value != lane.lastDelivered)
+			{
+				buffer.damage.full = true;
+				buffer.damage.rects.clear();
+			}
+			
+			lane.lastDelivered = buffer.info.sequence;
+			this->delegate->videoFrameHandleReceived(item.handle);
+			break;
+		}
+		
+		case DispatchItemType::AudioSamples:
+			this->delegate->audioSamplesHandleReceived(item.handle);
+			break;
+			
+		case DispatchItemType::AudioOverrun:
+			this->delegate->audioOverrun(item.value);
+			break;
+			
+		case DispatchItemType::AudioUnderrun:
+			this->delegate->audioUnderrun(item.value);
+			break;
+	}
+}
+
+void DispatchingDelegate::record(DispatchLane& lane, DispatchItemType type, uint64_t queueNanoseconds, uint64_t handlerNanoseconds)
+{
+	if (type == DispatchItemType::VideoFrame)
+	{
+		this->counters.videoFramesDelivered += 1;
+		recordDuration(this->counters.videoQueueNanoseconds, this->counters.videoQueueMaxNanoseconds, queueNanoseconds);
+		recordDuration(this->counters.videoHandlerNanoseconds, this->counters.videoHandlerMaxNanoseconds, handlerNanoseconds);
+	}
+	else if (type == DispatchItemType::AudioSamples)
+	{
+		this->counters.audioBlocksDelivered += 1;
+		recordDuration(this->counters.audioQueueNanoseconds, this->counters.audioQueueMaxNanoseconds, queueNanoseconds);
+		recordDuration(this->counters.audioHandlerNanoseconds, this->counters.audioHandlerMaxNanoseconds, handlerNanoseconds);
+	}
+}
+
+DispatchStats DispatchingDelegate::stats() const
+{
+	DispatchStats stats = this->counters;
+	stats.videoFramesQueued = this->videoLane.media;
+	stats.audioBlocksQueued = this->audioLane.media;
+	return stats;
+}
+
+bool DispatchingDelegate::admit(DispatchLane& lane)
+{
+	std::unique_lock<std::mutex> lock(this->state->mutex);
+	uint64_t& dropped = ((&lane == &this->videoLane) ? this->counters.videoFramesDropped : this->counters.audioBlocksDropped);
+	if (lane.media >= lane.depth && this->state->stopped == false)
+	{
+		switch (this->state->options.policy)
+		{
+			case DispatchPolicy::DropNewest:
+				dropped += 1;
+				return false;
+				
+			case DispatchPolicy::DropOldest:
+				lane.dropOldest();
+				dropped += 1;
+				break;
+				
+			case DispatchPolicy::Block:
+			{
+				steady_clock::time_point start = steady_clock::now();
+				while (lane.media >= lane.depth && this->state->stopped == false) {
+					lane.space.wait(lock);
+				}
+				
+				this->counters.blockedNanoseconds += elapsedNanoseconds(start, steady_clock::now());
+				break;
+			}
+		}
+	}
+	
+	lane.media += 1;
+	return true;
+}
+
+void DispatchingDelegate::enqueue(DispatchLane& lane, DispatchItem&& item)
+{
+	std::unique_lock<std::mutex> lock(this->state->mutex);
+	if (this->state->stopped == true)
+	{
+		lock.unlock();
+		this->deliver(lane, item);
+		return;
+	}
+	
+	lane.push(std::move(item));
+	this->state->work.notify_one();
+}
+
+void DispatchingDelegate::enqueueNotification(DispatchItemType type, uint64_t bytes)
+{
+	//Merge the notification with the most recently queued one if it is of the same type, so that notifications cannot accumulate
+	//without bound behind a stalled delegate (lost bytes are added together, while an underrun reports the latest shortfall)
+	{
+		std::lock_guard<std::mutex> lock(this->state->mutex);
+		DispatchLane& lane = this->audioLane;
+		if (this->state->stopped == false && lane.count > 0 && lane.at(lane.count - 1).type == type)
+		{
+			DispatchItem& last = lane.at(lane.count - 1);
+			last.value = (type == DispatchItemType::AudioOverrun) ? last.value + bytes : bytes;
+			return;
+		}
+	}
+	
+	DispatchItem item;
+	item.type = type;
+	item.value = bytes;
+	item.queued = steady_clock::now();
+	this->enqueue(this->audioLane, std::move(item));
+}
+
+void DispatchingDelegate::queueData(DispatchLane& lane, FramePool& pool, DispatchItemType type, const uint8_t* buffer, uint64_t length, const FrameInfo& info, const FrameDamage* damage, uint64_t value)
+{
+	if (this->admit(lane) == false) {
+		return;
+	}
+	
+	//Only the sampling thread for this queue copies into its pool's buffers, so there is no need to hold the mutex while copying
+	DispatchItem item;
+	item.type = type;
+	item.handle = pool.acquire(length);
+	item.value = value;
+	
+	FrameBuffer& target = FramePool::buffer(item.handle);
+	std::memcpy(target.data.get(), buffer, length);
+	target.info = info;
+	if (damage != nullptr) {
+		target.damage = *damage;
+	}
+	
+	item.queued = steady_clock::now();
+	this->enqueue(lane, std::move(item));
+}
+
+DelegateDispatcher::DelegateDispatcher(const DispatchOptions& options)
+{
+	if (options.workers == 0 || options.videoQueueDepth == 0 || options.audioQueueDepth == 0) {
+		throw std::runtime_error("a delegate dispatcher requires at least one worker and a queue depth of at least one");
+	}
+	
+	this->state.reset(new DispatcherState());
+	this->state->options = options;
+	this->state->next = 0;
+	this->state->stopping = false;
+	this->state->stopped = false;
+	for (uint32_t index = 0; index < options.workers; ++index) {
+		this->state->workers.push_back(std::thread(std::bind(&DispatcherState::workLoop, this->state.get())));
+	}
+}
+
+DelegateDispatcher::~DelegateDispatcher()
+{
+	//Let the workers finish emptying the queues and exit
+	{
+		std::lock_guard<std::mutex> lock(this->state->mutex);
+		this->state->stopping = true;
+		this->state->work.notify_all();
+	}
+	
+	for (auto& worker : this->state->workers) {
+		worker.join();
+	}
+	
+	//Any wrappers that outlive us pass their data straight to their delegates from now on
+	std::lock_guard<std::mutex> lock(this->state->mutex);
+	this->state->stopped = true;
+	this->state->idle.notify_all();
+	for (DispatchLane* lane : this->state->lanes) {
+		lane->space.notify_all();
+	}
+}
+
+std::unique_ptr<ConsumerDelegate> DelegateDispatcher::wrap(std::unique_ptr<ConsumerDelegate>&& delegate, const std::string& name) {
+	return std::unique_ptr<ConsumerDelegate>(new DispatchingDelegate(this->state, std::move(delegate), name));
+}
+
+void DelegateDispatcher::drain()
+{
+	std::unique_lock<std::mutex> lock(this->state->mutex);
+	while (true)
+	{
+		bool drained = true;
+		for (DispatchLane* lane : this->state->lanes) {
+			drained = (drained == true && lane->drained() == true);
+		}
+		
+		if (drained == true) {
+			return;
+		}
+		
+		this->state->idle.wait(lock);
+	}
+}
+
+std::vector<DispatchStats> DelegateDispatcher::stats() const
+{
+	std::vector<DispatchStats> stats;
+	std::lock_guard<std::mutex> lock(this->state->mutex);
+	for (DispatchingDelegate* delegate : this->state->delegates) {
+		stats.push_back(delegate->stats());
+	}
+	
+	return stats;
+}
+
+} //End MediaIPC
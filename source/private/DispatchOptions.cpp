@@ -0,0 +1,13 @@
+#include "../public/DispatchOptions.h"
+
+namespace MediaIPC {
+
+DispatchOptions::DispatchOptions()
+{
+	this->workers = 1;
+	this->videoQueueDepth = 3;
+	this->audioQueueDepth = 32;
+	this->policy = DispatchPolicy::DropOldest;
+}
+
+} //End MediaIPC
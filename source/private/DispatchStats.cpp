@@ -0,0 +1,24 @@
+#include "../public/DispatchStats.h"
+
+namespace MediaIPC {
+
+DispatchStats::DispatchStats()
+{
+	this->videoFramesDelivered = 0;
+	this->videoFramesDropped = 0;
+	this->audioBlocksDelivered = 0;
+	this->audioBlocksDropped = 0;
+	this->videoFramesQueued = 0;
+	this->audioBlocksQueued = 0;
+	this->blockedNanoseconds = 0;
+	this->videoQueueNanoseconds = 0;
+	this->videoQueueMaxNanoseconds = 0;
+	this->audioQueueNanoseconds = 0;
+	this->audioQueueMaxNanoseconds = 0;
+	this->videoHandlerNanoseconds = 0;
+	this->videoHandlerMaxNanoseconds = 0;
+	this->audioHandlerNanoseconds = 0;
+	this->audioHandlerMaxNanoseconds = 0;
+}
+
+} //End MediaIPC
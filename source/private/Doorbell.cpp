@@ -0,0 +1,197 @@
+#include "Doorbell.h"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <sys/socket.h>
+	#include <sys/types.h>
+	#include <sys/un.h>
+	#include <unistd.h>
+#endif
+
+namespace MediaIPC {
+
+#ifndef _WIN32
+namespace
+{
+	//Distinguishes the doorbells created by our process
+	std::atomic<uint32_t> nextDoorbell(1);
+	
+	//Makes a socket non-blocking and ensures it is not inherited by child processes
+	void configureSocket(int descriptor)
+	{
+		fcntl(descriptor, F_SETFL, fcntl(descriptor, F_GETFL) | O_NONBLOCK);
+		fcntl(descriptor, F_SETFD, FD_CLOEXEC);
+	}
+	
+	//Fills in the address of a doorbell, returning false if the path is too long
+	bool resolveAddress(const std::string& path, sockaddr_un& address)
+	{
+		std::memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(address.sun_path)) {
+			return false;
+		}
+		
+		std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+		return true;
+	}
+	
+	//Sends a timestamp to a doorbell, ignoring failures (a full doorbell has already been rung, and a missing
+	//one belongs to a consumer that has detached)
+	void sendTimestamp(int sender, const std::string& path, uint64_t timestamp)
+	{
+		sockaddr_un address;
+		if (resolveAddress(path, address) == true) {
+			sendto(sender, &timestamp, sizeof(timestamp), 0, (const sockaddr*)(&address), sizeof(address));
+		}
+	}
+}
+#endif
+
+Doorbell::Doorbell(Telemetry& telemetry, ConsumerCounters* counters) : counters(counters), socket(-1)
+{
+	#ifdef _WIN32
+		throw std::runtime_error("doorbells are not supported under Windows");
+	#else
+		
+		//Bind the socket, replacing any stale socket left behind by a process that had the same process ID
+		uint32_t id = nextDoorbell.fetch_add(1, std::memory_order_relaxed);
+		this->address = Doorbell::path((uint32_t)(getpid()), id);
+		sockaddr_un address;
+		if (resolveAddress(this->address, address) == false) {
+			throw std::runtime_error("the doorbell path \"" + this->address + "\" is too long");
+		}
+		
+		this->socket = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+		if (this->socket == -1) {
+			throw std::runtime_error("failed to create a doorbell socket: " + std::string(std::strerror(errno)));
+		}
+		
+		configureSocket(this->socket);
+		unlink(this->address.c_str());
+		if (bind(this->socket, (const sockaddr*)(&address), sizeof(address)) != 0)
+		{
+			std::string error = std::strerror(errno);
+			close(this->socket);
+			throw std::runtime_error("failed to bind the doorbell \"" + this->address + "\": " + error);
+		}
+		
+		telemetry.registerDoorbell(counters, id);
+		
+	#endif
+}
+
+Doorbell::~Doorbell()
+{
+	#ifndef _WIN32
+	if (this->socket != -1)
+	{
+		close(this->socket);
+		unlink(this->address.c_str());
+	}
+	#endif
+}
+
+int Doorbell::descriptor() const {
+	return this->socket;
+}
+
+uint64_t Doorbell::drain()
+{
+	uint64_t earliest = 0;
+	
+	#ifndef _WIN32
+	uint64_t timestamp = 0;
+	while (recv(this->socket, &timestamp, sizeof(timestamp), 0) >= 0)
+	{
+		if (timestamp != 0 && (earliest == 0 || timestamp < earliest)) {
+			earliest = timestamp;
+		}
+		
+		timestamp = 0;
+	}
+	#endif
+	
+	return earliest;
+}
+
+void Doorbell::arm()
+{
+	//This is paired with the sequentially-consistent exchange in ringArmed(), so that either the producer sees that we are
+	//armed or we see whatever it published before it checked
+	this->counters->doorbellArmed.store(1, std::memory_order_seq_cst);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void Doorbell::ring()
+{
+	#ifndef _WIN32
+	sendTimestamp(this->socket, this->address, 0);
+	#endif
+}
+
+int Doorbell::openSender()
+{
+	#ifdef _WIN32
+		return -1;
+	#else
+		int sender = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+		if (sender != -1) {
+			configureSocket(sender);
+		}
+		
+		return sender;
+	#endif
+}
+
+void Doorbell::closeSender(int sender)
+{
+	#ifndef _WIN32
+	if (sender != -1) {
+		close(sender);
+	}
+	#endif
+}
+
+void Doorbell::ringArmed(int sender, Telemetry& telemetry)
+{
+	#ifndef _WIN32
+	if (sender == -1 || telemetry.doorbells.load(std::memory_order_acquire) == 0) {
+		return;
+	}
+	
+	//Clearing the armed flag means each doorbell is rung at most once per wait, no matter how much we publish
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	for (ConsumerCounters& consumer : telemetry.consumers)
+	{
+		uint32_t id = consumer.doorbell.load(std::memory_order_acquire);
+		if (id != 0 && consumer.doorbellArmed.load(std::memory_order_relaxed) != 0 && consumer.doorbellArmed.exchange(0, std::memory_order_seq_cst) != 0) {
+			sendTimestamp(sender, Doorbell::path(consumer.processId.load(std::memory_order_acquire), id), telemetryTimestamp());
+		}
+	}
+	#endif
+}
+
+void Doorbell::removeStale(uint32_t processId, uint32_t id)
+{
+	#ifndef _WIN32
+	unlink(Doorbell::path(processId, id).c_str());
+	#endif
+}
+
+std::string Doorbell::path(uint32_t processId, uint32_t id)
+{
+	#ifdef __linux__
+		std::string directory = "/dev/shm/";
+	#else
+		std::string directory = "/tmp/";
+	#endif
+	
+	return directory + "MediaIPCDoorbell" + std::to_string(processId) + "_" + std::to_string(id);
+}
+
+} //End MediaIPC
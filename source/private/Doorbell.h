@@ -0,0 +1,68 @@
+#ifndef _MEDIA_IPC_DOORBELL
+#define _MEDIA_IPC_DOORBELL
+
+#include "Telemetry.h"
+#include <stdint.h>
+#include <string>
+
+namespace MediaIPC {
+
+//A file descriptor through which a producer wakes a consumer, so that consumers can wait on many streams at once with epoll,
+//poll() or an event loop rather than blocking a thread on each stream's futex
+//(Each doorbell is a Unix datagram socket bound to a path derived from the consumer's process ID and an ID that is unique
+//within the process, which the consumer records in its registry slot; whenever the producer publishes data it sends a
+//datagram holding the current timestamp to each doorbell that has been armed, so a busy consumer costs it no system calls)
+//(Doorbells live alongside the shared memory objects under Linux, so any process that can open a stream can reach them)
+class Doorbell
+{
+	public:
+		
+		//Creates a doorbell and registers it in the specified registry slot, throwing std::runtime_error if the socket cannot
+		//be created (which is always the case under Windows)
+		Doorbell(Telemetry& telemetry, ConsumerCounters* counters);
+		
+		//Closes the socket and removes its path (the registry slot must already have been released)
+		~Doorbell();
+		
+		Doorbell(const Doorbell& other) = delete;
+		Doorbell& operator=(const Doorbell& other) = delete;
+		
+		//Returns the descriptor, which becomes readable once the doorbell has been rung
+		int descriptor() const;
+		
+		//Discards every datagram that has been received, returning the earliest timestamp the producer sent (zero if none was received)
+		uint64_t drain();
+		
+		//Asks the producer to ring the doorbell the next time it publishes anything
+		//(The caller must check for new data after this returns and before it waits, since the producer may have published in between)
+		void arm();
+		
+		//Rings the doorbell ourselves, making the descriptor readable without waiting for the producer
+		//(The datagram holds no timestamp, so drain() does not mistake it for a ring from the producer)
+		void ring();
+		
+		//Creates the socket that a producer rings doorbells with (returns -1 on failure)
+		static int openSender();
+		
+		//Closes a socket created by openSender()
+		static void closeSender(int sender);
+		
+		//Rings the doorbell of every consumer in the registry that has armed its doorbell since it was last rung
+		static void ringArmed(int sender, Telemetry& telemetry);
+		
+		//Removes the path of a doorbell whose consumer exited without closing it
+		static void removeStale(uint32_t processId, uint32_t id);
+		
+	private:
+		
+		//Resolves the path of a doorbell
+		static std::string path(uint32_t processId, uint32_t id);
+		
+		ConsumerCounters* counters;
+		int socket;
+		std::string address;
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,299 @@
+#include "../public/FormatConverter.h"
+#include "CpuFeatures.h"
+#include "FormatKernels.h"
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+namespace MediaIPC {
+
+namespace
+{
+	//Retrieves the byte order of a packed RGB format, returning false for any other format
+	bool packedLayout(VideoFormat format, PackedLayout& layout)
+	{
+		const uint8_t n = PackedLayout::NoAlpha;
+		switch (format)
+		{
+			case VideoFormat::RGB:  layout = { 3, 0, 1, 2, n }; return true;
+			case VideoFormat::BGR:  layout = { 3, 2, 1, 0, n }; return true;
+			case VideoFormat::RGBA: layout = { 4, 0, 1, 2, 3 }; return true;
+			case VideoFormat::BGRA: layout = { 4, 2, 1, 0, 3 }; return true;
+			case VideoFormat::ARGB: layout = { 4, 1, 2, 3, 0 }; return true;
+			case VideoFormat::ABGR: layout = { 4, 3, 2, 1, 0 }; return true;
+			default: return false;
+		}
+	}
+	
+	//Selects the best kernels that are supported by both the build and the CPU
+	const FormatKernels* detectKernels()
+	{
+		if (avx2Kernels() != nullptr && cpuSupportsAVX2() == true) {
+			return avx2Kernels();
+		}
+		
+		//SSE2 is part of the baseline for every x86 target that the SSE2 kernels are built for
+		if (sse2Kernels() != nullptr) {
+			return sse2Kernels();
+		}
+		
+		return scalarKernels();
+	}
+	
+	//The kernels that are currently in use
+	std::atomic<const FormatKernels*> activeKernels(nullptr);
+	
+	const FormatKernels* kernels()
+	{
+		const FormatKernels* current = activeKernels.load(std::memory_order_acquire);
+		if (current == nullptr)
+		{
+			current = detectKernels();
+			activeKernels.store(current, std::memory_order_release);
+		}
+		
+		return current;
+	}
+	
+	//Converts a packed RGB frame to 4:2:0 YUV, writing the chroma samples at the specified step
+	bool toYUV420(const uint8_t* source, VideoFormat sourceFormat, uint64_t sourceStride, uint8_t* y, uint64_t yStride, uint8_t* u, uint8_t* v, uint64_t chromaStride, uint32_t chromaStep, uint32_t width, uint32_t height)
+	{
+		PackedLayout layout;
+		if (packedLayout(sourceFormat, layout) == false) {
+			return false;
+		}
+		
+		//Process the frame in pairs of rows (if the height is odd then the final row is paired with itself)
+		sourceStride = ((sourceStride != 0) ? sourceStride : (uint64_t)(width) * layout.bytes);
+		yStride = ((yStride != 0) ? yStride : width);
+		const FormatKernels* active = kernels();
+		for (uint32_t row = 0; row < height; row += 2)
+		{
+			uint32_t next = ((row + 1 < height) ? row + 1 : row);
+			uint64_t chromaOffset = (row / 2) * chromaStride;
+			active->yuvRows(
+				source + (row * sourceStride),
+				source + (next * sourceStride),
+				layout,
+				y + (row * yStride),
+				y + (next * yStride),
+				u + chromaOffset,
+				v + chromaOffset,
+				chromaStep,
+				width
+			);
+		}
+		
+		return true;
+	}
+}
+
+bool FormatConverter::canConvert(VideoFormat source, VideoFormat dest)
+{
+	if (source == dest && source != VideoFormat::None) {
+		return true;
+	}
+	
+	PackedLayout sourceLayout;
+	PackedLayout destLayout;
+	return (packedLayout(source, sourceLayout) == true && (packedLayout(dest, destLayout) == true || dest == VideoFormat::I420 || dest == VideoFormat::NV12 || dest == VideoFormat::YUY2));
+}
+
+bool FormatConverter::convert(const uint8_t* source, VideoFormat sourceFormat, uint64_t sourceStride, uint8_t* dest, VideoFormat destFormat, uint64_t destStride, uint32_t width, uint32_t height)
+{
+	if (FormatConverter::canConvert(sourceFormat, destFormat) == false) {
+		return false;
+	}
+	
+	//Identical formats are simply copied plane by plane and row by row
+	if (sourceFormat == destFormat)
+	{
+		for (uint8_t plane = 0; plane < FormatDetails::planeCount(sourceFormat); ++plane)
+		{
+			uint64_t rowSize = FormatDetails::planeLayout(sourceFormat, width, height, plane).stride;
+			PlaneLayout sourcePlane = FormatDetails::planeLayout(sourceFormat, width, height, plane, sourceStride);
+			PlaneLayout destPlane = FormatDetails::planeLayout(destFormat, width, height, plane, destStride);
+			for (uint32_t row = 0; row < sourcePlane.rows; ++row) {
+				std::memcpy(dest + destPlane.offset + (row * destPlane.stride), source + sourcePlane.offset + (row * sourcePlane.stride), rowSize);
+			}
+		}
+		
+		return true;
+	}
+	
+	//Packed YUV destinations have a single plane
+	if (destFormat == VideoFormat::YUY2) {
+		return FormatConverter::toYUY2(source, sourceFormat, sourceStride, dest, destStride, width, height);
+	}
+	
+	//Planar YUV destinations are written using the layout of each plane
+	PlaneLayout luma = FormatDetails::planeLayout(destFormat, width, height, 0, destStride);
+	PlaneLayout chroma = FormatDetails::planeLayout(destFormat, width, height, 1, destStride);
+	if (destFormat == VideoFormat::I420)
+	{
+		PlaneLayout chromaV = FormatDetails::planeLayout(destFormat, width, height, 2, destStride);
+		return FormatConverter::toI420(source, sourceFormat, sourceStride, dest + luma.offset, luma.stride, dest + chroma.offset, chroma.stride, dest + chromaV.offset, chromaV.stride, width, height);
+	}
+	else if (destFormat == VideoFormat::NV12) {
+		return FormatConverter::toNV12(source, sourceFormat, sourceStride, dest + luma.offset, luma.stride, dest + chroma.offset, chroma.stride, width, height);
+	}
+	
+	PackedLayout sourceLayout;
+	PackedLayout destLayout;
+	packedLayout(sourceFormat, sourceLayout);
+	packedLayout(destFormat, destLayout);
+	sourceStride = ((sourceStride != 0) ? sourceStride : (uint64_t)(width) * sourceLayout.bytes);
+	destStride = ((destStride != 0) ? destStride : (uint64_t)(width) * destLayout.bytes);
+	
+	const FormatKernels* active = kernels();
+	for (uint32_t row = 0; row < height; ++row) {
+		active->swizzleRow(source + (row * sourceStride), sourceLayout, dest + (row * destStride), destLayout, width);
+	}
+	
+	return true;
+}
+
+bool FormatConverter::toI420(const uint8_t* source, VideoFormat sourceFormat, uint64_t sourceStride, uint8_t* y, uint64_t yStride, uint8_t* u, uint64_t uStride, uint8_t* v, uint64_t vStride, uint32_t width, uint32_t height)
+{
+	//The U and V planes must share a stride, since each pair of rows is converted in a single call to the row kernel
+	uint32_t chromaWidth = (width + 1) / 2;
+	uStride = ((uStride != 0) ? uStride : chromaWidth);
+	vStride = ((vStride != 0) ? vStride : chromaWidth);
+	if (uStride != vStride)
+	{
+		//Convert the U and V planes via a pass per plane if their strides differ
+		//(This is rare enough that we simply convert into a temporary interleaved plane and split it)
+		uint32_t chromaHeight = (height + 1) / 2;
+		std::unique_ptr<uint8_t[]> uv(new uint8_t[(uint64_t)(chromaWidth) * 2 * chromaHeight]);
+		if (toYUV420(source, sourceFormat, sourceStride, y, yStride, uv.get(), uv.get() + 1, (uint64_t)(chromaWidth) * 2, 2, width, height) == false) {
+			return false;
+		}
+		
+		for (uint32_t row = 0; row < chromaHeight; ++row)
+		{
+			const uint8_t* interleaved = uv.get() + ((uint64_t)(row) * chromaWidth * 2);
+			for (uint32_t x = 0; x < chromaWidth; ++x)
+			{
+				u[(row * uStride) + x] = interleaved[x * 2];
+				v[(row * vStride) + x] = interleaved[(x * 2) + 1];
+			}
+		}
+		
+		return true;
+	}
+	
+	return toYUV420(source, sourceFormat, sourceStride, y, yStride, u, v, uStride, 1, width, height);
+}
+
+bool FormatConverter::toNV12(const uint8_t* source, VideoFormat sourceFormat, uint64_t sourceStride, uint8_t* y, uint64_t yStride, uint8_t* uv, uint64_t uvStride, uint32_t width, uint32_t height)
+{
+	uvStride = ((uvStride != 0) ? uvStride : (uint64_t)((width + 1) / 2) * 2);
+	return toYUV420(source, sourceFormat, sourceStride, y, yStride, uv, uv + 1, uvStride, 2, width, height);
+}
+
+bool FormatConverter::toYUY2(const uint8_t* source, VideoFormat sourceFormat, uint64_t sourceStride, uint8_t* dest, uint64_t destStride, uint32_t width, uint32_t height)
+{
+	PackedLayout layout;
+	if (packedLayout(sourceFormat, layout) == false) {
+		return false;
+	}
+	
+	sourceStride = ((sourceStride != 0) ? sourceStride : (uint64_t)(width) * layout.bytes);
+	destStride = ((destStride != 0) ? destStride : FormatDetails::alignedStride(VideoFormat::YUY2, width, 1));
+	
+	//Pairing each row with itself makes the YUV kernel average each chroma sample over a horizontal pair of pixels, so we
+	//convert each row into temporary planes and then interleave them (the luma row has room for the duplicated final pixel)
+	uint32_t chromaWidth = (width + 1) / 2;
+	std::unique_ptr<uint8_t[]> planes(new uint8_t[(uint64_t)(chromaWidth) * 4]);
+	uint8_t* luma = planes.get();
+	uint8_t* u = luma + ((uint64_t)(chromaWidth) * 2);
+	uint8_t* v = u + chromaWidth;
+	const FormatKernels* active = kernels();
+	for (uint32_t row = 0; row < height; ++row)
+	{
+		const uint8_t* sourceRow = source + (row * sourceStride);
+		active->yuvRows(sourceRow, sourceRow, layout, luma, luma, u, v, 1, width);
+		if (width % 2 != 0) {
+			luma[width] = luma[width - 1];
+		}
+		
+		uint8_t* destRow = dest + (row * destStride);
+		for (uint32_t x = 0; x < chromaWidth; ++x)
+		{
+			destRow[(x * 4) + 0] = luma[x * 2];
+			destRow[(x * 4) + 1] = u[x];
+			destRow[(x * 4) + 2] = luma[(x * 2) + 1];
+			destRow[(x * 4) + 3] = v[x];
+		}
+	}
+	
+	return true;
+}
+
+bool FormatConverter::canHalve(VideoFormat format)
+{
+	PackedLayout layout;
+	return (format == VideoFormat::GRAY8 || format == VideoFormat::I420 || format == VideoFormat::NV12 || packedLayout(format, layout) == true);
+}
+
+bool FormatConverter::halve(const uint8_t* source, VideoFormat format, uint64_t sourceStride, uint8_t* dest, uint64_t destStride, uint32_t width, uint32_t height)
+{
+	if (FormatConverter::canHalve(format) == false) {
+		return false;
+	}
+	
+	//Each plane is halved independently, since the subsampled chroma planes of the destination are exactly half the size of the source's
+	const FormatKernels* active = kernels();
+	uint32_t halfWidth = (width + 1) / 2;
+	uint32_t halfHeight = (height + 1) / 2;
+	for (uint8_t plane = 0; plane < FormatDetails::planeCount(format); ++plane)
+	{
+		PlaneLayout sourcePlane = FormatDetails::planeLayout(format, width, height, plane, sourceStride);
+		PlaneLayout destPlane = FormatDetails::planeLayout(format, halfWidth, halfHeight, plane, destStride);
+		
+		//The interleaved UV plane of NV12 holds two samples per chroma pixel
+		uint32_t samples = ((plane == 0) ? width : (width + FormatDetails::subsamplingX(format) - 1) / FormatDetails::subsamplingX(format));
+		uint8_t channels = ((plane == 0) ? FormatDetails::bytesPerPixel(format) : ((format == VideoFormat::NV12) ? 2 : 1));
+		for (uint32_t row = 0; row < destPlane.rows; ++row)
+		{
+			//If the height of the plane is odd then the final row is paired with itself
+			uint32_t top = row * 2;
+			uint32_t bottom = ((top + 1 < sourcePlane.rows) ? top + 1 : top);
+			active->halveRows(
+				source + sourcePlane.offset + (top * sourcePlane.stride),
+				source + sourcePlane.offset + (bottom * sourcePlane.stride),
+				dest + destPlane.offset + (row * destPlane.stride),
+				channels,
+				samples
+			);
+		}
+	}
+	
+	return true;
+}
+
+std::string FormatConverter::instructionSet() {
+	return kernels()->name;
+}
+
+bool FormatConverter::setInstructionSet(const std::string& name)
+{
+	const FormatKernels* candidates[] = {
+		((cpuSupportsAVX2() == true) ? avx2Kernels() : nullptr),
+		sse2Kernels(),
+		scalarKernels()
+	};
+	
+	for (const FormatKernels* candidate : candidates)
+	{
+		if (candidate != nullptr && name == candidate->name)
+		{
+			activeKernels.store(candidate, std::memory_order_release);
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+} //End MediaIPC
@@ -0,0 +1,95 @@
+#include "FormatKernels.h"
+
+namespace MediaIPC {
+
+namespace
+{
+	//Computes BT.601 limited-range luma and chroma values using the same 8-bit fixed-point coefficients as the SIMD kernels
+	inline uint8_t luma(int r, int g, int b) {
+		return (uint8_t)((((66 * r) + (129 * g) + (25 * b) + 128) >> 8) + 16);
+	}
+	
+	inline uint8_t chromaU(int r, int g, int b) {
+		return (uint8_t)((((-38 * r) - (74 * g) + (112 * b) + 128) >> 8) + 128);
+	}
+	
+	inline uint8_t chromaV(int r, int g, int b) {
+		return (uint8_t)((((112 * r) - (94 * g) - (18 * b) + 128) >> 8) + 128);
+	}
+	
+	void swizzleRowFull(const uint8_t* source, const PackedLayout& sourceLayout, uint8_t* dest, const PackedLayout& destLayout, uint32_t width) {
+		swizzleRowScalar(source, sourceLayout, dest, destLayout, 0, width);
+	}
+	
+	void yuvRowsFull(const uint8_t* source0, const uint8_t* source1, const PackedLayout& layout, uint8_t* luma0, uint8_t* luma1, uint8_t* u, uint8_t* v, uint32_t chromaStep, uint32_t width) {
+		yuvRowsScalar(source0, source1, layout, luma0, luma1, u, v, chromaStep, 0, width);
+	}
+	
+	void halveRowsFull(const uint8_t* top, const uint8_t* bottom, uint8_t* dest, uint8_t channels, uint32_t width) {
+		halveRowsScalar(top, bottom, dest, channels, 0, width);
+	}
+	
+	const FormatKernels kernels = { "Scalar", &swizzleRowFull, &yuvRowsFull, &halveRowsFull };
+}
+
+void swizzleRowScalar(const uint8_t* source, const PackedLayout& sourceLayout, uint8_t* dest, const PackedLayout& destLayout, uint32_t start, uint32_t width)
+{
+	for (uint32_t x = start; x < width; ++x)
+	{
+		const uint8_t* in = source + (x * sourceLayout.bytes);
+		uint8_t* out = dest + (x * destLayout.bytes);
+		out[destLayout.r] = in[sourceLayout.r];
+		out[destLayout.g] = in[sourceLayout.g];
+		out[destLayout.b] = in[sourceLayout.b];
+		if (destLayout.a != PackedLayout::NoAlpha) {
+			out[destLayout.a] = ((sourceLayout.a != PackedLayout::NoAlpha) ? in[sourceLayout.a] : 255);
+		}
+	}
+}
+
+void yuvRowsScalar(const uint8_t* source0, const uint8_t* source1, const PackedLayout& layout, uint8_t* luma0, uint8_t* luma1, uint8_t* u, uint8_t* v, uint32_t chromaStep, uint32_t start, uint32_t width)
+{
+	for (uint32_t x = start; x < width; x += 2)
+	{
+		//If the width is odd then the final pixel of each row is duplicated when computing the final chroma sample
+		uint32_t next = ((x + 1 < width) ? x + 1 : x);
+		const uint8_t* p00 = source0 + (x * layout.bytes);
+		const uint8_t* p01 = source0 + (next * layout.bytes);
+		const uint8_t* p10 = source1 + (x * layout.bytes);
+		const uint8_t* p11 = source1 + (next * layout.bytes);
+		
+		luma0[x] = luma(p00[layout.r], p00[layout.g], p00[layout.b]);
+		luma1[x] = luma(p10[layout.r], p10[layout.g], p10[layout.b]);
+		if (next != x)
+		{
+			luma0[next] = luma(p01[layout.r], p01[layout.g], p01[layout.b]);
+			luma1[next] = luma(p11[layout.r], p11[layout.g], p11[layout.b]);
+		}
+		
+		//Average the 2x2 block before computing the chroma values
+		int r = (p00[layout.r] + p01[layout.r] + p10[layout.r] + p11[layout.r] + 2) >> 2;
+		int g = (p00[layout.g] + p01[layout.g] + p10[layout.g] + p11[layout.g] + 2) >> 2;
+		int b = (p00[layout.b] + p01[layout.b] + p10[layout.b] + p11[layout.b] + 2) >> 2;
+		u[(x / 2) * chromaStep] = chromaU(r, g, b);
+		v[(x / 2) * chromaStep] = chromaV(r, g, b);
+	}
+}
+
+void halveRowsScalar(const uint8_t* top, const uint8_t* bottom, uint8_t* dest, uint8_t channels, uint32_t start, uint32_t width)
+{
+	for (uint32_t x = start; x < (width + 1) / 2; ++x)
+	{
+		//If the width is odd then the final pixel of each row is averaged with itself
+		uint32_t left = (x * 2) * channels;
+		uint32_t right = (((x * 2) + 1 < width) ? (x * 2) + 1 : x * 2) * channels;
+		for (uint32_t c = 0; c < channels; ++c) {
+			dest[(x * channels) + c] = (uint8_t)((top[left + c] + top[right + c] + bottom[left + c] + bottom[right + c] + 2) >> 2);
+		}
+	}
+}
+
+const FormatKernels* scalarKernels() {
+	return &kernels;
+}
+
+} //End MediaIPC
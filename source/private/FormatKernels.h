@@ -0,0 +1,56 @@
+#ifndef _MEDIA_IPC_FORMAT_KERNELS
+#define _MEDIA_IPC_FORMAT_KERNELS
+
+#include <stdint.h>
+
+namespace MediaIPC {
+
+//Describes the byte order of a packed RGB pixel format
+struct PackedLayout
+{
+	//The value of the alpha offset for formats without an alpha channel
+	static const uint8_t NoAlpha = 0xFF;
+	
+	//The number of bytes per pixel (either 3 or 4)
+	uint8_t bytes;
+	
+	//The byte offset of each component within a pixel
+	uint8_t r;
+	uint8_t g;
+	uint8_t b;
+	uint8_t a;
+};
+
+//Row-level pixel format conversion kernels for a particular instruction set
+//(Note that the SIMD kernels are compiled with instruction set flags, so this header must not pull in any inline library code)
+struct FormatKernels
+{
+	//The name of the instruction set
+	const char* name;
+	
+	//Converts a row of pixels between two packed layouts (an alpha channel missing from the source is filled with 255)
+	void (*swizzleRow)(const uint8_t* source, const PackedLayout& sourceLayout, uint8_t* dest, const PackedLayout& destLayout, uint32_t width);
+	
+	//Converts a pair of rows of packed pixels to two rows of BT.601 limited-range luma and one row of 2x2 subsampled chroma
+	//(The chroma step is either 1 for separate U and V planes, or 2 for an interleaved UV plane in which case v must equal u + 1)
+	void (*yuvRows)(const uint8_t* source0, const uint8_t* source1, const PackedLayout& layout, uint8_t* luma0, uint8_t* luma1, uint8_t* u, uint8_t* v, uint32_t chromaStep, uint32_t width);
+	
+	//Downscales a pair of rows of 8-bit samples to a single row of half the width, averaging each 2x2 block with rounding
+	//(The channels are the number of interleaved samples per pixel, and the width is that of the source rows in pixels)
+	void (*halveRows)(const uint8_t* top, const uint8_t* bottom, uint8_t* dest, uint8_t channels, uint32_t width);
+};
+
+//Scalar kernels that start at the specified column, which the SIMD kernels use to process the remainder of each row
+//(For the YUV kernel the starting column must be even, and for the halving kernel it is a column of the destination row)
+void swizzleRowScalar(const uint8_t* source, const PackedLayout& sourceLayout, uint8_t* dest, const PackedLayout& destLayout, uint32_t start, uint32_t width);
+void yuvRowsScalar(const uint8_t* source0, const uint8_t* source1, const PackedLayout& layout, uint8_t* luma0, uint8_t* luma1, uint8_t* u, uint8_t* v, uint32_t chromaStep, uint32_t start, uint32_t width);
+void halveRowsScalar(const uint8_t* top, const uint8_t* bottom, uint8_t* dest, uint8_t channels, uint32_t start, uint32_t width);
+
+//Retrieves the kernels for each instruction set (nullptr if the library was built without support for the instruction set)
+const FormatKernels* scalarKernels();
+const FormatKernels* sse2Kernels();
+const FormatKernels* avx2Kernels();
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,285 @@
+#include "FormatKernels.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#include <string.h>
+
+namespace MediaIPC {
+
+namespace
+{
+	//Packs a pair of signed 16-bit coefficients for use with _mm256_madd_epi16()
+	inline __m256i coefficients(int16_t low, int16_t high) {
+		return _mm256_set1_epi32((int)((uint32_t)(uint16_t)(low) | ((uint32_t)(uint16_t)(high) << 16)));
+	}
+	
+	//Builds a byte shuffle mask that gathers the specified byte of each of the four pixels in a 128-bit lane into 32-bit values
+	//(Each entry of the offsets array is the source byte offset for that byte of the output value, or -1 to zero it)
+	__m256i gatherMask(uint8_t bytesPerPixel, const int offsets[4])
+	{
+		int8_t mask[16];
+		for (int pixel = 0; pixel < 4; ++pixel)
+		{
+			for (int byte = 0; byte < 4; ++byte) {
+				mask[(pixel * 4) + byte] = (int8_t)((offsets[byte] >= 0) ? (pixel * bytesPerPixel) + offsets[byte] : -128);
+			}
+		}
+		
+		__m128i lane = _mm_loadu_si128((const __m128i*)(mask));
+		return _mm256_broadcastsi128_si256(lane);
+	}
+	
+	//Loads eight pixels so that each 128-bit lane holds four pixels in its low bytes
+	//(For 3-byte layouts this reads four bytes beyond the eighth pixel, so callers must ensure that memory is part of the row)
+	inline __m256i loadPixels(const uint8_t* source, uint8_t bytesPerPixel)
+	{
+		if (bytesPerPixel == 4) {
+			return _mm256_loadu_si256((const __m256i*)(source));
+		}
+		
+		__m128i low = _mm_loadu_si128((const __m128i*)(source));
+		__m128i high = _mm_loadu_si128((const __m128i*)(source + 12));
+		return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+	}
+	
+	//Computes the luma values for eight pixels whose components are arranged as [R, G] and [B, 1] pairs of 16-bit values
+	inline __m256i luma(__m256i rg, __m256i b1)
+	{
+		__m256i sum = _mm256_add_epi32(_mm256_madd_epi16(rg, coefficients(66, 129)), _mm256_madd_epi16(b1, coefficients(25, 128)));
+		return _mm256_add_epi32(_mm256_srai_epi32(sum, 8), _mm256_set1_epi32(16));
+	}
+	
+	//Computes the chroma values for eight averaged pixels whose components are arranged as [R, G] and [B, 1] pairs of 16-bit values
+	inline __m256i chroma(__m256i rg, __m256i b1, int16_t cr, int16_t cg, int16_t cb)
+	{
+		__m256i sum = _mm256_add_epi32(_mm256_madd_epi16(rg, coefficients(cr, cg)), _mm256_madd_epi16(b1, coefficients(cb, 128)));
+		return _mm256_add_epi32(_mm256_srai_epi32(sum, 8), _mm256_set1_epi32(128));
+	}
+	
+	//Sums the components of horizontally adjacent pixel pairs, returning the eight sums in order
+	//(Each input holds eight pixels whose 16-bit halves hold separate components, so the sums cannot overflow)
+	inline __m256i pairSums(__m256i first, __m256i second)
+	{
+		__m256i firstSums = _mm256_shuffle_epi32(_mm256_add_epi16(first, _mm256_srli_epi64(first, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+		__m256i secondSums = _mm256_shuffle_epi32(_mm256_add_epi16(second, _mm256_srli_epi64(second, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+		return _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(firstSums, secondSums), _MM_SHUFFLE(3, 1, 2, 0));
+	}
+	
+	void swizzleRow(const uint8_t* source, const PackedLayout& sourceLayout, uint8_t* dest, const PackedLayout& destLayout, uint32_t width)
+	{
+		//Build the shuffle mask that maps the source bytes of each lane to the destination bytes, along with the alpha fill
+		int8_t mask[16];
+		int8_t fill[16];
+		for (int i = 0; i < 16; ++i)
+		{
+			mask[i] = -128;
+			fill[i] = 0;
+		}
+		
+		for (int pixel = 0; pixel < 4; ++pixel)
+		{
+			int in = pixel * sourceLayout.bytes;
+			int out = pixel * destLayout.bytes;
+			mask[out + destLayout.r] = (int8_t)(in + sourceLayout.r);
+			mask[out + destLayout.g] = (int8_t)(in + sourceLayout.g);
+			mask[out + destLayout.b] = (int8_t)(in + sourceLayout.b);
+			if (destLayout.a != PackedLayout::NoAlpha)
+			{
+				if (sourceLayout.a != PackedLayout::NoAlpha) {
+					mask[out + destLayout.a] = (int8_t)(in + sourceLayout.a);
+				}
+				else {
+					fill[out + destLayout.a] = -1;
+				}
+			}
+		}
+		
+		__m256i shuffle = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(mask)));
+		__m256i alpha = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(fill)));
+		
+		//Process eight pixels per iteration (for 3-byte layouts, we stop early so that the over-reads and over-writes remain within the row)
+		uint32_t x = 0;
+		uint32_t margin = ((sourceLayout.bytes == 3 || destLayout.bytes == 3) ? 2 : 0);
+		for (; x + 8 + margin <= width; x += 8)
+		{
+			__m256i out = _mm256_or_si256(_mm256_shuffle_epi8(loadPixels(source + (x * sourceLayout.bytes), sourceLayout.bytes), shuffle), alpha);
+			uint8_t* destPixels = dest + (x * destLayout.bytes);
+			if (destLayout.bytes == 4) {
+				_mm256_storeu_si256((__m256i*)(destPixels), out);
+			}
+			else
+			{
+				//Each lane holds 12 valid bytes, so the second store overwrites the unused bytes of the first
+				_mm_storeu_si128((__m128i*)(destPixels), _mm256_castsi256_si128(out));
+				_mm_storeu_si128((__m128i*)(destPixels + 12), _mm256_extracti128_si256(out, 1));
+			}
+		}
+		
+		swizzleRowScalar(source, sourceLayout, dest, destLayout, x, width);
+	}
+	
+	void yuvRows(const uint8_t* source0, const uint8_t* source1, const PackedLayout& layout, uint8_t* luma0, uint8_t* luma1, uint8_t* u, uint8_t* v, uint32_t chromaStep, uint32_t width)
+	{
+		//Build the shuffle masks that arrange the components of each pixel as [R, G] and [B, 0] pairs of 16-bit values
+		const int rgOffsets[] = { layout.r, -1, layout.g, -1 };
+		const int bOffsets[] = { layout.b, -1, -1, -1 };
+		const __m256i rgMask = gatherMask(layout.bytes, rgOffsets);
+		const __m256i bMask = gatherMask(layout.bytes, bOffsets);
+		const __m256i one = _mm256_set1_epi32(0x10000);
+		const __m256i two = _mm256_set1_epi16(2);
+		
+		//Process sixteen pixels from each row per iteration (for 3-byte layouts, we stop early so that the over-reads remain within the row)
+		uint32_t x = 0;
+		uint32_t margin = ((layout.bytes == 3) ? 2 : 0);
+		for (; x + 16 + margin <= width; x += 16)
+		{
+			__m256i rg[4];
+			__m256i b[4];
+			const uint8_t* rows[] = {
+				source0 + (x * layout.bytes),
+				source0 + ((x + 8) * layout.bytes),
+				source1 + (x * layout.bytes),
+				source1 + ((x + 8) * layout.bytes)
+			};
+			
+			for (int i = 0; i < 4; ++i)
+			{
+				__m256i pixels = loadPixels(rows[i], layout.bytes);
+				rg[i] = _mm256_shuffle_epi8(pixels, rgMask);
+				b[i] = _mm256_shuffle_epi8(pixels, bMask);
+			}
+			
+			//Compute and store the luma values for both rows
+			//(Packing operates within each 128-bit lane, so we permute the 64-bit quarters back into pixel order after each step)
+			__m256i y0 = _mm256_packs_epi32(luma(rg[0], _mm256_or_si256(b[0], one)), luma(rg[1], _mm256_or_si256(b[1], one)));
+			__m256i y1 = _mm256_packs_epi32(luma(rg[2], _mm256_or_si256(b[2], one)), luma(rg[3], _mm256_or_si256(b[3], one)));
+			y0 = _mm256_permute4x64_epi64(y0, _MM_SHUFFLE(3, 1, 2, 0));
+			y1 = _mm256_permute4x64_epi64(y1, _MM_SHUFFLE(3, 1, 2, 0));
+			y0 = _mm256_permute4x64_epi64(_mm256_packus_epi16(y0, y0), _MM_SHUFFLE(3, 1, 2, 0));
+			y1 = _mm256_permute4x64_epi64(_mm256_packus_epi16(y1, y1), _MM_SHUFFLE(3, 1, 2, 0));
+			_mm_storeu_si128((__m128i*)(luma0 + x), _mm256_castsi256_si128(y0));
+			_mm_storeu_si128((__m128i*)(luma1 + x), _mm256_castsi256_si128(y1));
+			
+			//Average each 2x2 block of pixels
+			__m256i rgAverage = _mm256_srli_epi16(_mm256_add_epi16(pairSums(_mm256_add_epi16(rg[0], rg[2]), _mm256_add_epi16(rg[1], rg[3])), two), 2);
+			__m256i bAverage = _mm256_srli_epi16(_mm256_add_epi16(pairSums(_mm256_add_epi16(b[0], b[2]), _mm256_add_epi16(b[1], b[3])), two), 2);
+			bAverage = _mm256_or_si256(_mm256_and_si256(bAverage, _mm256_set1_epi32(0xFFFF)), one);
+			
+			//Compute the chroma values and pack them into bytes, gathering the eight U values followed by the eight V values
+			__m256i uv = _mm256_packs_epi32(chroma(rgAverage, bAverage, -38, -74, 112), chroma(rgAverage, bAverage, 112, -94, -18));
+			uv = _mm256_packus_epi16(uv, uv);
+			__m128i ordered = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(uv, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)));
+			
+			//Store the chroma values, either as separate planes or interleaved
+			uint8_t* uDest = u + ((x / 2) * chromaStep);
+			if (chromaStep == 1)
+			{
+				_mm_storel_epi64((__m128i*)(uDest), ordered);
+				_mm_storel_epi64((__m128i*)(v + (x / 2)), _mm_srli_si128(ordered, 8));
+			}
+			else {
+				_mm_storeu_si128((__m128i*)(uDest), _mm_unpacklo_epi8(ordered, _mm_srli_si128(ordered, 8)));
+			}
+		}
+		
+		yuvRowsScalar(source0, source1, layout, luma0, luma1, u, v, chromaStep, x, width);
+	}
+	
+	//Sums the samples of horizontally adjacent pixels within each 16 bytes of a row, returning sixteen 16-bit sums in order
+	//(Only pixels of one, two or four bytes are supported, and 3-byte pixels are widened to four bytes before calling this)
+	inline __m256i adjacentSums(__m256i row, uint8_t channels)
+	{
+		__m256i even = _mm256_and_si256(row, _mm256_set1_epi16(0x00FF));
+		__m256i odd = _mm256_srli_epi16(row, 8);
+		if (channels == 1) {
+			return _mm256_add_epi16(even, odd);
+		}
+		else if (channels == 2)
+		{
+			__m256i first = _mm256_add_epi16(even, _mm256_srli_epi32(even, 16));
+			__m256i second = _mm256_add_epi16(odd, _mm256_srli_epi32(odd, 16));
+			return _mm256_or_si256(_mm256_and_si256(first, _mm256_set1_epi32(0xFFFF)), _mm256_slli_epi32(second, 16));
+		}
+		
+		__m256i left = _mm256_unpacklo_epi8(row, _mm256_setzero_si256());
+		__m256i right = _mm256_unpackhi_epi8(row, _mm256_setzero_si256());
+		return _mm256_unpacklo_epi64(_mm256_add_epi16(left, _mm256_srli_si256(left, 8)), _mm256_add_epi16(right, _mm256_srli_si256(right, 8)));
+	}
+	
+	//Averages the 2x2 blocks of pixels within a pair of rows, returning sixteen 16-bit averages in order
+	inline __m256i blockAverages(__m256i top, __m256i bottom, uint8_t channels)
+	{
+		__m256i sums = _mm256_add_epi16(adjacentSums(top, channels), adjacentSums(bottom, channels));
+		return _mm256_srli_epi16(_mm256_add_epi16(sums, _mm256_set1_epi16(2)), 2);
+	}
+	
+	//Packs two sets of 16-bit averages into bytes, undoing the interleaving of the 128-bit lanes
+	inline __m256i packAverages(__m256i first, __m256i second) {
+		return _mm256_permute4x64_epi64(_mm256_packus_epi16(first, second), _MM_SHUFFLE(3, 1, 2, 0));
+	}
+	
+	void halveRows(const uint8_t* top, const uint8_t* bottom, uint8_t* dest, uint8_t channels, uint32_t width)
+	{
+		uint32_t x = 0;
+		if (channels == 1 || channels == 2 || channels == 4)
+		{
+			//Produce 32 bytes per iteration
+			uint32_t step = 32 / channels;
+			for (; (x + step) * 2 <= width; x += step)
+			{
+				const uint8_t* topPixels = top + (x * 2 * channels);
+				const uint8_t* bottomPixels = bottom + (x * 2 * channels);
+				__m256i first = blockAverages(_mm256_loadu_si256((const __m256i*)(topPixels)), _mm256_loadu_si256((const __m256i*)(bottomPixels)), channels);
+				__m256i second = blockAverages(_mm256_loadu_si256((const __m256i*)(topPixels + 32)), _mm256_loadu_si256((const __m256i*)(bottomPixels + 32)), channels);
+				_mm256_storeu_si256((__m256i*)(dest + (x * channels)), packAverages(first, second));
+			}
+		}
+		else if (channels == 3)
+		{
+			//Widen sixteen source pixels to four bytes each, average them as 4-byte pixels, and narrow the eight results again
+			//(We stop early so that the over-reads of loadPixels() and the overlapping stores remain within the rows)
+			const int widen[4] = { 0, 1, 2, -1 };
+			__m256i widenMask = gatherMask(3, widen);
+			int8_t narrow[16];
+			for (int i = 0; i < 16; ++i) {
+				narrow[i] = (int8_t)((i < 12) ? ((i / 3) * 4) + (i % 3) : -128);
+			}
+			
+			__m256i narrowMask = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(narrow)));
+			for (; (x + 8 + 2) * 2 <= width; x += 8)
+			{
+				const uint8_t* topPixels = top + (x * 6);
+				const uint8_t* bottomPixels = bottom + (x * 6);
+				__m256i first = blockAverages(_mm256_shuffle_epi8(loadPixels(topPixels, 3), widenMask), _mm256_shuffle_epi8(loadPixels(bottomPixels, 3), widenMask), 4);
+				__m256i second = blockAverages(_mm256_shuffle_epi8(loadPixels(topPixels + 24, 3), widenMask), _mm256_shuffle_epi8(loadPixels(bottomPixels + 24, 3), widenMask), 4);
+				__m256i out = _mm256_shuffle_epi8(packAverages(first, second), narrowMask);
+				
+				//Each lane holds 12 valid bytes, so the second store overwrites the unused bytes of the first
+				_mm_storeu_si128((__m128i*)(dest + (x * 3)), _mm256_castsi256_si128(out));
+				_mm_storeu_si128((__m128i*)(dest + (x * 3) + 12), _mm256_extracti128_si256(out, 1));
+			}
+		}
+		
+		halveRowsScalar(top, bottom, dest, channels, x, width);
+	}
+	
+	const FormatKernels kernels = { "AVX2", &swizzleRow, &yuvRows, &halveRows };
+}
+
+const FormatKernels* avx2Kernels() {
+	return &kernels;
+}
+
+} //End MediaIPC
+
+#else
+
+namespace MediaIPC {
+
+const FormatKernels* avx2Kernels() {
+	return nullptr;
+}
+
+} //End MediaIPC
+
+#endif
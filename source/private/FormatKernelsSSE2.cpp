@@ -0,0 +1,188 @@
+#include "FormatKernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#include <string.h>
+
+namespace MediaIPC {
+
+namespace
+{
+	//Packs a pair of signed 16-bit coefficients for use with _mm_madd_epi16()
+	inline __m128i coefficients(int16_t low, int16_t high) {
+		return _mm_set1_epi32((int)((uint32_t)(uint16_t)(low) | ((uint32_t)(uint16_t)(high) << 16)));
+	}
+	
+	//Extracts the byte at the specified offset of each 32-bit pixel
+	inline __m128i component(__m128i pixels, uint8_t offset) {
+		return _mm_and_si128(_mm_srl_epi32(pixels, _mm_cvtsi32_si128(offset * 8)), _mm_set1_epi32(0xFF));
+	}
+	
+	//Computes the luma values for four pixels whose components are arranged as [R, G] and [B, 1] pairs of 16-bit values
+	inline __m128i luma(__m128i rg, __m128i b1)
+	{
+		__m128i sum = _mm_add_epi32(_mm_madd_epi16(rg, coefficients(66, 129)), _mm_madd_epi16(b1, coefficients(25, 128)));
+		return _mm_add_epi32(_mm_srai_epi32(sum, 8), _mm_set1_epi32(16));
+	}
+	
+	//Computes the chroma values for four averaged pixels whose components are arranged as [R, G] and [B, 1] pairs of 16-bit values
+	inline __m128i chroma(__m128i rg, __m128i b1, int16_t cr, int16_t cg, int16_t cb)
+	{
+		__m128i sum = _mm_add_epi32(_mm_madd_epi16(rg, coefficients(cr, cg)), _mm_madd_epi16(b1, coefficients(cb, 128)));
+		return _mm_add_epi32(_mm_srai_epi32(sum, 8), _mm_set1_epi32(128));
+	}
+	
+	//Sums the components of horizontally adjacent pixel pairs, returning the four sums in order
+	//(Each input holds four pixels whose 16-bit halves hold separate components, so the sums cannot overflow)
+	inline __m128i pairSums(__m128i first, __m128i second)
+	{
+		__m128i firstSums = _mm_shuffle_epi32(_mm_add_epi16(first, _mm_srli_epi64(first, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+		__m128i secondSums = _mm_shuffle_epi32(_mm_add_epi16(second, _mm_srli_epi64(second, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+		return _mm_unpacklo_epi64(firstSums, secondSums);
+	}
+	
+	void swizzleRow(const uint8_t* source, const PackedLayout& sourceLayout, uint8_t* dest, const PackedLayout& destLayout, uint32_t width)
+	{
+		//SSE2 has no byte shuffle, so we only accelerate conversions between 4-byte layouts, using shifts and masks
+		uint32_t x = 0;
+		if (sourceLayout.bytes == 4 && destLayout.bytes == 4)
+		{
+			const uint8_t sourceOffsets[] = { sourceLayout.r, sourceLayout.g, sourceLayout.b, sourceLayout.a };
+			const uint8_t destOffsets[] = { destLayout.r, destLayout.g, destLayout.b, destLayout.a };
+			for (; x + 4 <= width; x += 4)
+			{
+				__m128i in = _mm_loadu_si128((const __m128i*)(source + (x * 4)));
+				__m128i out = _mm_setzero_si128();
+				for (int c = 0; c < 4; ++c) {
+					out = _mm_or_si128(out, _mm_sll_epi32(component(in, sourceOffsets[c]), _mm_cvtsi32_si128(destOffsets[c] * 8)));
+				}
+				
+				_mm_storeu_si128((__m128i*)(dest + (x * 4)), out);
+			}
+		}
+		
+		swizzleRowScalar(source, sourceLayout, dest, destLayout, x, width);
+	}
+	
+	void yuvRows(const uint8_t* source0, const uint8_t* source1, const PackedLayout& layout, uint8_t* luma0, uint8_t* luma1, uint8_t* u, uint8_t* v, uint32_t chromaStep, uint32_t width)
+	{
+		//We only accelerate 4-byte layouts, processing eight pixels from each row per iteration
+		uint32_t x = 0;
+		if (layout.bytes == 4)
+		{
+			const __m128i one = _mm_set1_epi32(0x10000);
+			const __m128i two = _mm_set1_epi16(2);
+			for (; x + 8 <= width; x += 8)
+			{
+				//Arrange the components of each pixel as [R, G] and [B, 0] pairs of 16-bit values
+				__m128i rg[4];
+				__m128i b[4];
+				const uint8_t* rows[] = { source0 + (x * 4), source0 + (x * 4) + 16, source1 + (x * 4), source1 + (x * 4) + 16 };
+				for (int i = 0; i < 4; ++i)
+				{
+					__m128i pixels = _mm_loadu_si128((const __m128i*)(rows[i]));
+					rg[i] = _mm_or_si128(component(pixels, layout.r), _mm_slli_epi32(component(pixels, layout.g), 16));
+					b[i] = component(pixels, layout.b);
+				}
+				
+				//Compute and store the luma values for both rows
+				__m128i y0 = _mm_packs_epi32(luma(rg[0], _mm_or_si128(b[0], one)), luma(rg[1], _mm_or_si128(b[1], one)));
+				__m128i y1 = _mm_packs_epi32(luma(rg[2], _mm_or_si128(b[2], one)), luma(rg[3], _mm_or_si128(b[3], one)));
+				_mm_storel_epi64((__m128i*)(luma0 + x), _mm_packus_epi16(y0, y0));
+				_mm_storel_epi64((__m128i*)(luma1 + x), _mm_packus_epi16(y1, y1));
+				
+				//Average each 2x2 block of pixels
+				__m128i rgAverage = _mm_srli_epi16(_mm_add_epi16(pairSums(_mm_add_epi16(rg[0], rg[2]), _mm_add_epi16(rg[1], rg[3])), two), 2);
+				__m128i bAverage = _mm_srli_epi16(_mm_add_epi16(pairSums(_mm_add_epi16(b[0], b[2]), _mm_add_epi16(b[1], b[3])), two), 2);
+				bAverage = _mm_or_si128(_mm_and_si128(bAverage, _mm_set1_epi32(0xFFFF)), one);
+				
+				//Compute the chroma values and pack them into bytes
+				__m128i uv = _mm_packs_epi32(chroma(rgAverage, bAverage, -38, -74, 112), chroma(rgAverage, bAverage, 112, -94, -18));
+				uv = _mm_packus_epi16(uv, uv);
+				
+				//Store the chroma values, either as separate planes or interleaved
+				uint8_t* uDest = u + ((x / 2) * chromaStep);
+				if (chromaStep == 1)
+				{
+					int32_t uValues = _mm_cvtsi128_si32(uv);
+					int32_t vValues = _mm_cvtsi128_si32(_mm_srli_si128(uv, 4));
+					memcpy(uDest, &uValues, sizeof(int32_t));
+					memcpy(v + (x / 2), &vValues, sizeof(int32_t));
+				}
+				else {
+					_mm_storel_epi64((__m128i*)(uDest), _mm_unpacklo_epi8(uv, _mm_srli_si128(uv, 4)));
+				}
+			}
+		}
+		
+		yuvRowsScalar(source0, source1, layout, luma0, luma1, u, v, chromaStep, x, width);
+	}
+	
+	//Sums the samples of horizontally adjacent pixels within 16 bytes of a row, returning eight 16-bit sums in order
+	//(Only pixels of one, two or four bytes are supported)
+	inline __m128i adjacentSums(__m128i row, uint8_t channels)
+	{
+		__m128i even = _mm_and_si128(row, _mm_set1_epi16(0x00FF));
+		__m128i odd = _mm_srli_epi16(row, 8);
+		if (channels == 1) {
+			return _mm_add_epi16(even, odd);
+		}
+		else if (channels == 2)
+		{
+			__m128i first = _mm_add_epi16(even, _mm_srli_epi32(even, 16));
+			__m128i second = _mm_add_epi16(odd, _mm_srli_epi32(odd, 16));
+			return _mm_or_si128(_mm_and_si128(first, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(second, 16));
+		}
+		
+		__m128i left = _mm_unpacklo_epi8(row, _mm_setzero_si128());
+		__m128i right = _mm_unpackhi_epi8(row, _mm_setzero_si128());
+		return _mm_unpacklo_epi64(_mm_add_epi16(left, _mm_srli_si128(left, 8)), _mm_add_epi16(right, _mm_srli_si128(right, 8)));
+	}
+	
+	//Averages the 2x2 blocks of pixels within 16 bytes of a pair of rows, returning eight 16-bit averages in order
+	inline __m128i blockAverages(const uint8_t* top, const uint8_t* bottom, uint8_t channels)
+	{
+		__m128i topSums = adjacentSums(_mm_loadu_si128((const __m128i*)(top)), channels);
+		__m128i bottomSums = adjacentSums(_mm_loadu_si128((const __m128i*)(bottom)), channels);
+		return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(topSums, bottomSums), _mm_set1_epi16(2)), 2);
+	}
+	
+	void halveRows(const uint8_t* top, const uint8_t* bottom, uint8_t* dest, uint8_t channels, uint32_t width)
+	{
+		//SSE2 has no byte shuffle, so we only accelerate pixels of one, two or four bytes, producing 16 bytes per iteration
+		uint32_t x = 0;
+		if (channels == 1 || channels == 2 || channels == 4)
+		{
+			uint32_t step = 16 / channels;
+			for (; (x + step) * 2 <= width; x += step)
+			{
+				uint32_t offset = x * 2 * channels;
+				__m128i first = blockAverages(top + offset, bottom + offset, channels);
+				__m128i second = blockAverages(top + offset + 16, bottom + offset + 16, channels);
+				_mm_storeu_si128((__m128i*)(dest + (x * channels)), _mm_packus_epi16(first, second));
+			}
+		}
+		
+		halveRowsScalar(top, bottom, dest, channels, x, width);
+	}
+	
+	const FormatKernels kernels = { "SSE2", &swizzleRow, &yuvRows, &halveRows };
+}
+
+const FormatKernels* sse2Kernels() {
+	return &kernels;
+}
+
+} //End MediaIPC
+
+#else
+
+namespace MediaIPC {
+
+const FormatKernels* sse2Kernels() {
+	return nullptr;
+}
+
+} //End MediaIPC
+
+#endif
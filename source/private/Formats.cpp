@@ -2,6 +2,45 @@
 
 namespace MediaIPC {
 
+namespace
+{
+	//Divides and rounds up to the nearest whole number
+	uint64_t divideRoundUp(uint64_t value, uint64_t divisor) {
+		return (value + divisor - 1) / divisor;
+	}
+	
+	//Determines the stride and number of rows of the specified plane, ignoring its offset
+	PlaneLayout planeDimensions(VideoFormat format, uint32_t width, uint32_t height, uint8_t plane, uint64_t stride)
+	{
+		uint8_t planes = FormatDetails::planeCount(format);
+		uint8_t bytes = FormatDetails::bytesPerPixel(format);
+		uint8_t subsampleX = FormatDetails::subsamplingX(format);
+		uint8_t subsampleY = FormatDetails::subsamplingY(format);
+		
+		PlaneLayout layout;
+		if (plane == 0)
+		{
+			//Packed formats with chroma subsampling (such as YUY2) store an even number of pixels in each row
+			uint64_t samples = ((planes == 1) ? divideRoundUp(width, subsampleX) * subsampleX : width);
+			layout.stride = ((stride != 0) ? stride : samples * bytes);
+			layout.rows = height;
+		}
+		else
+		{
+			//Semi-planar formats interleave both chroma components in a single plane
+			uint64_t interleave = ((planes == 2) ? 2 : 1);
+			uint64_t samples = ((stride != 0) ? divideRoundUp(stride, subsampleX * bytes) : divideRoundUp(width, subsampleX));
+			layout.stride = samples * bytes * interleave;
+			layout.rows = (uint32_t)(divideRoundUp(height, subsampleY));
+		}
+		
+		layout.size = layout.stride * layout.rows;
+		return layout;
+	}
+}
+
+PlaneLayout::PlaneLayout() : stride(0), rows(0), offset(0), size(0) {}
+
 uint8_t FormatDetails::bytesPerSample(AudioFormat format)
 {
 	switch (format)
@@ -19,7 +58,7 @@ uint8_t FormatDetails::bytesPerPixel(VideoFormat format)
 {
 	switch (format)
 	{
-		#define VIDEO_FORMAT(name, bytes, description) case VideoFormat::name: return bytes;
+		#define VIDEO_FORMAT(name, bytes, planes, subsampleX, subsampleY, description) case VideoFormat::name: return bytes;
 		#include "../public/VideoFormats.inc"
 		
 		case VideoFormat::None:
@@ -28,6 +67,93 @@ uint8_t FormatDetails::bytesPerPixel(VideoFormat format)
 	}
 }
 
+uint8_t FormatDetails::planeCount(VideoFormat format)
+{
+	switch (format)
+	{
+		#define VIDEO_FORMAT(name, bytes, planes, subsampleX, subsampleY, description) case VideoFormat::name: return planes;
+		#include "../public/VideoFormats.inc"
+		
+		case VideoFormat::None:
+		default:
+			return 0;
+	}
+}
+
+uint8_t FormatDetails::subsamplingX(VideoFormat format)
+{
+	switch (format)
+	{
+		#define VIDEO_FORMAT(name, bytes, planes, subsampleX, subsampleY, description) case VideoFormat::name: return subsampleX;
+		#include "../public/VideoFormats.inc"
+		
+		case VideoFormat::None:
+		default:
+			return 1;
+	}
+}
+
+uint8_t FormatDetails::subsamplingY(VideoFormat format)
+{
+	switch (format)
+	{
+		#define VIDEO_FORMAT(name, bytes, planes, subsampleX, subsampleY, description) case VideoFormat::name: return subsampleY;
+		#include "../public/VideoFormats.inc"
+		
+		case VideoFormat::None:
+		default:
+			return 1;
+	}
+}
+
+bool FormatDetails::isYUV(VideoFormat format)
+{
+	//Only YUV formats subsample their chroma or split a frame across multiple planes
+	switch (format)
+	{
+		#define VIDEO_FORMAT(name, bytes, planes, subsampleX, subsampleY, description) case VideoFormat::name: return (planes > 1 || subsampleX > 1 || subsampleY > 1);
+		#include "../public/VideoFormats.inc"
+		
+		case VideoFormat::None:
+		default:
+			return false;
+	}
+}
+
+PlaneLayout FormatDetails::planeLayout(VideoFormat format, uint32_t width, uint32_t height, uint8_t plane, uint64_t stride)
+{
+	if (plane >= FormatDetails::planeCount(format)) {
+		return PlaneLayout();
+	}
+	
+	//Each plane immediately follows the previous one
+	uint64_t offset = 0;
+	for (uint8_t previous = 0; previous < plane; ++previous) {
+		offset += planeDimensions(format, width, height, previous, stride).size;
+	}
+	
+	PlaneLayout layout = planeDimensions(format, width, height, plane, stride);
+	layout.offset = offset;
+	return layout;
+}
+
+uint64_t FormatDetails::alignedStride(VideoFormat format, uint32_t width, uint32_t alignment)
+{
+	uint64_t stride = planeDimensions(format, width, 1, 0, 0).stride;
+	return ((alignment > 1) ? divideRoundUp(stride, alignment) * alignment : stride);
+}
+
+uint64_t FormatDetails::frameSize(VideoFormat format, uint32_t width, uint32_t height, uint64_t stride)
+{
+	uint8_t planes = FormatDetails::planeCount(format);
+	if (planes == 0) {
+		return 0;
+	}
+	
+	PlaneLayout last = FormatDetails::planeLayout(format, width, height, planes - 1, stride);
+	return last.offset + last.size;
+}
+
 std::string FormatDetails::description(AudioFormat format)
 {
 	switch (format)
@@ -45,7 +171,7 @@ std::string FormatDetails::description(VideoFormat format)
 {
 	switch (format)
 	{
-		#define VIDEO_FORMAT(name, bytes, description) case VideoFormat::name: return description;
+		#define VIDEO_FORMAT(name, bytes, planes, subsampleX, subsampleY, description) case VideoFormat::name: return description;
 		#include "../public/VideoFormats.inc"
 		
 		case VideoFormat::None:
@@ -0,0 +1,13 @@
+#include "../public/FrameDamage.h"
+
+namespace MediaIPC {
+
+DamageRect::DamageRect() : x(0), y(0), width(0), height(0) {}
+
+DamageRect::DamageRect(uint32_t x, uint32_t y, uint32_t width, uint32_t height) :
+	x(x), y(y), width(width), height(height)
+{}
+
+FrameDamage::FrameDamage() : full(true) {}
+
+} //End MediaIPC
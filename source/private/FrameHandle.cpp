@@ -0,0 +1,92 @@
+#include "../public/FrameHandle.h"
+#include "FramePool.h"
+#include <utility>
+
+namespace MediaIPC {
+
+namespace
+{
+	//Returned for the damage of an empty handle
+	const FrameDamage noDamage;
+}
+
+FrameHandle::FrameHandle() : buffer(nullptr) {}
+
+FrameHandle::FrameHandle(FrameBuffer* buffer) : buffer(buffer) {}
+
+FrameHandle::~FrameHandle() {
+	this->release();
+}
+
+FrameHandle::FrameHandle(const FrameHandle& other) : buffer(other.buffer)
+{
+	if (this->buffer != nullptr) {
+		this->buffer->references.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+FrameHandle& FrameHandle::operator=(const FrameHandle& other)
+{
+	if (this->buffer != other.buffer)
+	{
+		this->release();
+		this->buffer = other.buffer;
+		if (this->buffer != nullptr) {
+			this->buffer->references.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	
+	return *this;
+}
+
+FrameHandle::FrameHandle(FrameHandle&& other) : buffer(other.buffer) {
+	other.buffer = nullptr;
+}
+
+FrameHandle& FrameHandle::operator=(FrameHandle&& other)
+{
+	if (this != &other)
+	{
+		this->release();
+		this->buffer = other.buffer;
+		other.buffer = nullptr;
+	}
+	
+	return *this;
+}
+
+bool FrameHandle::isValid() const {
+	return (this->buffer != nullptr);
+}
+
+const uint8_t* FrameHandle::data() const {
+	return ((this->buffer != nullptr) ? this->buffer->data.get() : nullptr);
+}
+
+uint64_t FrameHandle::length() const {
+	return ((this->buffer != nullptr) ? this->buffer->length : 0);
+}
+
+FrameInfo FrameHandle::info() const {
+	return ((this->buffer != nullptr) ? this->buffer->info : FrameInfo());
+}
+
+const FrameDamage& FrameHandle::damage() const {
+	return ((this->buffer != nullptr) ? this->buffer->damage : noDamage);
+}
+
+void FrameHandle::release()
+{
+	//The last handle to release the buffer returns it to its pool
+	//(The release ordering ensures that our reads of the data happen before the buffer can be reused)
+	if (this->buffer != nullptr)
+	{
+		if (this->buffer->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			this->buffer->pool->release(this->buffer);
+		}
+		
+		this->buffer = nullptr;
+	}
+}
+
+} //End MediaIPC
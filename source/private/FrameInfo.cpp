@@ -0,0 +1,14 @@
+#include "../public/FrameInfo.h"
+
+namespace MediaIPC {
+
+const int64_t FrameInfo::NoPts;
+
+FrameInfo::FrameInfo()
+{
+	this->sequence = 0;
+	this->timestamp = 0;
+	this->pts = FrameInfo::NoPts;
+}
+
+} //End MediaIPC
@@ -0,0 +1,49 @@
+#include "FramePool.h"
+
+namespace MediaIPC {
+
+FrameHandle FramePool::acquire(uint64_t length)
+{
+	FrameBuffer* buffer = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		if (this->available.empty() == true)
+		{
+			//Reserve room for every buffer in the list of available buffers, so that releasing a buffer never allocates
+			this->buffers.push_back(std::unique_ptr<FrameBuffer>(new FrameBuffer()));
+			this->buffers.back()->pool = this;
+			this->buffers.back()->capacity = 0;
+			this->available.reserve(this->buffers.size());
+			this->available.push_back(this->buffers.back().get());
+		}
+		
+		buffer = this->available.back();
+		this->available.pop_back();
+	}
+	
+	//Only grow the buffer if the data no longer fits (the data is only ever this large after a reconfiguration)
+	if (buffer->capacity < length)
+	{
+		buffer->data.reset(new uint8_t[length]);
+		buffer->capacity = length;
+	}
+	
+	buffer->references.store(1, std::memory_order_relaxed);
+	buffer->length = length;
+	buffer->info = FrameInfo();
+	buffer->damage.full = true;
+	buffer->damage.rects.clear();
+	return FrameHandle(buffer);
+}
+
+FrameBuffer& FramePool::buffer(FrameHandle& handle) {
+	return *handle.buffer;
+}
+
+void FramePool::release(FrameBuffer* buffer)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->available.push_back(buffer);
+}
+
+} //End MediaIPC
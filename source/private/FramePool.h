@@ -0,0 +1,51 @@
+#ifndef _MEDIA_IPC_FRAME_POOL
+#define _MEDIA_IPC_FRAME_POOL
+
+#include "../public/FrameHandle.h"
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace MediaIPC {
+
+//A buffer that holds a video frame or a block of audio samples, along with the number of handles that refer to it
+struct FrameBuffer
+{
+	std::atomic<uint32_t> references;
+	FramePool* pool;
+	std::unique_ptr<uint8_t[]> data;
+	uint64_t capacity;
+	uint64_t length;
+	FrameInfo info;
+	FrameDamage damage;
+};
+
+//Pool of reusable buffers for frame handles
+//(Buffers are only allocated while the pool grows to the number of handles held at once, and only grow when the data they
+//hold becomes larger, so once a stream has settled acquiring and releasing a buffer never allocates memory)
+class FramePool
+{
+	public:
+		
+		//Returns a handle to a buffer that can hold the specified number of bytes, allocating one if every buffer is in use
+		FrameHandle acquire(uint64_t length);
+		
+		//Returns the buffer that a handle refers to, so that it can be filled before the handle is passed to a delegate
+		static FrameBuffer& buffer(FrameHandle& handle);
+		
+		//Returns a buffer to the pool once the last handle referring to it has been released
+		void release(FrameBuffer* buffer);
+		
+	private:
+		std::mutex mutex;
+		
+		//Every buffer we have allocated, and those not currently referred to by any handle
+		std::vector< std::unique_ptr<FrameBuffer> > buffers;
+		std::vector<FrameBuffer*> available;
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,414 @@
+#include "FrameRing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+namespace MediaIPC {
+
+namespace
+{
+	//Rounds a size up to the nearest multiple of the specified alignment (which is never smaller than the cache line size)
+	uint64_t alignTo(uint64_t size, uint32_t alignment)
+	{
+		uint64_t boundary = std::max((uint64_t)(alignment), (uint64_t)(MEDIA_IPC_CACHE_LINE));
+		return ((size + boundary - 1) / boundary) * boundary;
+	}
+}
+
+uint64_t FrameRing::requiredSize(uint32_t slots, uint64_t frameSize, uint32_t alignment)
+{
+	//The ring header and the header of each slot are padded so that the frame data that follows them is aligned
+	uint64_t slotStride = alignTo(sizeof(FrameSlotHeader), alignment) + alignTo(frameSize, alignment);
+	return alignTo(sizeof(FrameRingHeader), alignment) + (slots * slotStride);
+}
+
+FrameRing::FrameRing(uint8_t* memory, uint32_t slots, uint64_t frameSize, uint32_t alignment)
+{
+	this->header = (FrameRingHeader*)(memory);
+	this->slotMemory = memory + alignTo(sizeof(FrameRingHeader), alignment);
+	this->slots = slots;
+	this->frameSize = frameSize;
+	this->dataOffset = alignTo(sizeof(FrameSlotHeader), alignment);
+	this->slotStride = this->dataOffset + alignTo(frameSize, alignment);
+	this->localPins.store(0, std::memory_order_relaxed);
+	this->acquired = 0;
+	this->acquiredSlot = 0;
+}
+
+void FrameRing::reset()
+{
+	new (this->header) FrameRingHeader();
+	this->header->sequence.store(0, std::memory_order_relaxed);
+	this->header->slot.store(0, std::memory_order_relaxed);
+	
+	for (uint32_t slot = 0; slot < this->slots; ++slot)
+	{
+		FrameSlotHeader* slotHeader = new (this->slotHeader(slot)) FrameSlotHeader();
+		slotHeader->generation.store(0, std::memory_order_relaxed);
+		slotHeader->pins.store(0, std::memory_order_relaxed);
+		for (std::atomic<uint32_t>& ownerPins : slotHeader->ownerPins) {
+			ownerPins.store(0, std::memory_order_relaxed);
+		}
+		
+		slotHeader->timestamp = 0;
+		slotHeader->pts = FrameInfo::NoPts;
+		slotHeader->damage.setFull();
+	}
+	
+	//Every slot starts out without a frame, so none of them can be brought up to date by copying only the changed regions
+	DamageList full;
+	full.setFull();
+	this->stale.assign(this->slots, full);
+	this->discarded.clear();
+	
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+uint64_t FrameRing::latestSequence() const {
+	return this->header->sequence.load(std::memory_order_acquire);
+}
+
+uint64_t FrameRing::write(const void* source, uint64_t length, int64_t pts)
+{
+	std::memcpy(this->acquire(), source, std::min(length, this->frameSize));
+	return this->commit(pts);
+}
+
+uint8_t* FrameRing::pending() const {
+	return ((this->acquired != 0) ? this->slotData(this->acquiredSlot) : nullptr);
+}
+
+uint8_t* FrameRing::acquire()
+{
+	//If we have already acquired a slot then simply return it again
+	if (this->acquired != 0) {
+		return this->slotData(this->acquiredSlot);
+	}
+	
+	//Determine the sequence number for the new frame
+	//(We are the only writer, so relaxed loads of our own header values are sufficient)
+	uint64_t sequence = this->header->sequence.load(std::memory_order_relaxed) + 1;
+	uint32_t latest = this->header->slot.load(std::memory_order_relaxed);
+	
+	//Search for a slot that is neither pinned by a consumer nor holding the most recently published frame
+	//(If every other slot is pinned then we overwrite the next one regardless, since the producer must never block)
+	uint32_t slot = (latest + 1) % this->slots;
+	for (uint32_t attempt = 0; attempt < this->slots; ++attempt)
+	{
+		uint32_t candidate = (latest + 1 + attempt) % this->slots;
+		if (candidate == latest) {
+			continue;
+		}
+		
+		//Mark the slot as being written before checking for pins, so that a consumer pinning it concurrently will either
+		//see the odd generation and back off, or will have incremented the pin count before we check it
+		FrameSlotHeader* slotHeader = this->slotHeader(candidate);
+		uint64_t previous = slotHeader->generation.load(std::memory_order_relaxed);
+		slotHeader->generation.store((sequence * 2) - 1, std::memory_order_seq_cst);
+		if (slotHeader->pins.load(std::memory_order_seq_cst) == 0)
+		{
+			slot = candidate;
+			break;
+		}
+		
+		//The slot is pinned, so restore its generation and move on
+		slotHeader->generation.store(previous, std::memory_order_seq_cst);
+	}
+	
+	//Mark the selected slot as being written, so that any consumer currently reading it will detect the tear
+	//(This is a no-op if the slot was successfully claimed by the search above)
+	this->slotHeader(slot)->generation.store((sequence * 2) - 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	
+	this->acquired = sequence;
+	this->acquiredSlot = slot;
+	return this->slotData(slot);
+}
+
+uint64_t FrameRing::write(const void* source, const DamageList& damage, const DamageCopier& copier, uint64_t& bytesCopied, int64_t pts)
+{
+	//The contents of a slot that was already acquired for filling in place are unknown
+	bool alreadyAcquired = (this->acquired != 0);
+	uint32_t latest = this->header->slot.load(std::memory_order_relaxed);
+	uint8_t* data = this->acquire();
+	if (alreadyAcquired == true) {
+		this->stale[this->acquiredSlot].setFull();
+	}
+	
+	//Include the changes from any frames that were discarded since the last frame we published
+	DamageList changed = this->discarded;
+	changed.merge(damage);
+	
+	//Bring the slot up to date with the previous frame, then copy the regions that changed since then
+	//(Prior to the first frame there is nothing to bring the slot up to date with, so it receives the whole of the new frame instead)
+	if (this->header->sequence.load(std::memory_order_relaxed) == 0) {
+		changed.setFull();
+	}
+	else if (this->acquiredSlot != latest && changed.full == 0) {
+		bytesCopied += copier.copy(data, this->slotData(latest), this->stale[this->acquiredSlot]);
+	}
+	
+	bytesCopied += copier.copy(data, (const uint8_t*)(source), changed);
+	return this->commit(changed, pts);
+}
+
+void FrameRing::discard(const DamageList& damage) {
+	this->discarded.merge(damage);
+}
+
+uint64_t FrameRing::commit(int64_t pts)
+{
+	DamageList full;
+	full.setFull();
+	return this->commit(full, pts);
+}
+
+uint64_t FrameRing::commit(const DamageList& damage, int64_t pts)
+{
+	uint64_t sequence = this->acquired;
+	if (sequence == 0) {
+		return 0;
+	}
+	
+	//Stamp the frame metadata while the slot is still marked as being written
+	FrameSlotHeader* slotHeader = this->slotHeader(this->acquiredSlot);
+	slotHeader->timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	slotHeader->pts = pts;
+	slotHeader->damage = damage;
+	
+	//Every other slot is now out of date in the regions that changed, while this slot is entirely up to date
+	for (uint32_t slot = 0; slot < this->slots; ++slot) {
+		this->stale[slot].merge(damage);
+	}
+	
+	this->stale[this->acquiredSlot].clear();
+	this->discarded.clear();
+	
+	//Mark the slot as complete and publish the new sequence number
+	slotHeader->generation.store(sequence * 2, std::memory_order_release);
+	this->header->slot.store(this->acquiredSlot, std::memory_order_release);
+	this->header->sequence.store(sequence, std::memory_order_release);
+	this->acquired = 0;
+	return sequence;
+}
+
+uint64_t FrameRing::read(void* destination, uint64_t length, FrameInfo* info) const
+{
+	while (true)
+	{
+		//Determine which frame is the most recent
+		uint64_t sequence = this->latestSequence();
+		if (sequence == 0) {
+			return 0;
+		}
+		
+		//Verify that the slot still holds the frame we want before we start copying it
+		//(A mismatch means the slot and sequence number were updated between our two loads, or the slot has since been reused)
+		uint32_t slot = this->header->slot.load(std::memory_order_acquire);
+		FrameSlotHeader* slotHeader = this->slotHeader(slot);
+		uint64_t generation = slotHeader->generation.load(std::memory_order_acquire);
+		if (generation != sequence * 2) {
+			continue;
+		}
+		
+		//Copy the frame data and metadata and then verify that the producer did not begin overwriting the slot while we were copying
+		std::memcpy(destination, this->slotData(slot), std::min(length, this->frameSize));
+		uint64_t timestamp = slotHeader->timestamp;
+		int64_t pts = slotHeader->pts;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slotHeader->generation.load(std::memory_order_relaxed) == generation)
+		{
+			if (info != nullptr)
+			{
+				info->sequence = sequence;
+				info->timestamp = timestamp;
+				info->pts = pts;
+			}
+			
+			return sequence;
+		}
+	}
+}
+
+uint64_t FrameRing::readDelta(void* destination, uint64_t lastSequence, const DamageCopier& copier, DamageList& damage, FrameInfo* info, uint64_t& bytesCopied) const
+{
+	while (true)
+	{
+		//If no frame has been published since the one the destination holds, there is nothing to copy
+		uint64_t sequence = this->latestSequence();
+		if (sequence == 0 || sequence == lastSequence)
+		{
+			damage.clear();
+			return sequence;
+		}
+		
+		//Determine what changed before we start copying, since the damage lists of the frames in between may be overwritten
+		this->damageSince(lastSequence, sequence, damage);
+		
+		//Verify that the slot still holds the frame we want before we start copying it
+		uint32_t slot = this->header->slot.load(std::memory_order_acquire);
+		FrameSlotHeader* slotHeader = this->slotHeader(slot);
+		uint64_t generation = slotHeader->generation.load(std::memory_order_acquire);
+		if (generation != sequence * 2) {
+			continue;
+		}
+		
+		//Copy the changed regions and the metadata and then verify that the producer did not begin overwriting the slot while we were copying
+		//(A torn copy is repaired by the next attempt, since it copies at least the same regions from the newer frame)
+		uint64_t copied = copier.copy((uint8_t*)(destination), this->slotData(slot), damage);
+		uint64_t timestamp = slotHeader->timestamp;
+		int64_t pts = slotHeader->pts;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		bytesCopied += copied;
+		if (slotHeader->generation.load(std::memory_order_relaxed) == generation)
+		{
+			if (info != nullptr)
+			{
+				info->sequence = sequence;
+				info->timestamp = timestamp;
+				info->pts = pts;
+			}
+			
+			return sequence;
+		}
+	}
+}
+
+void FrameRing::damageSince(uint64_t lastSequence, uint64_t sequence, DamageList& damage) const
+{
+	//Frames older than the ring itself can no longer have been retained
+	damage.clear();
+	if (lastSequence == 0 || lastSequence > sequence || sequence - lastSequence > this->slots)
+	{
+		damage.setFull();
+		return;
+	}
+	
+	DamageList frame;
+	for (uint64_t current = lastSequence + 1; current <= sequence && damage.full == 0; ++current)
+	{
+		if (this->frameDamage(current, frame) == false)
+		{
+			damage.setFull();
+			return;
+		}
+		
+		damage.merge(frame);
+	}
+}
+
+uint64_t FrameRing::pin(uint32_t& slot, uint32_t owner) const
+{
+	while (true)
+	{
+		//Determine which frame is the most recent
+		uint64_t sequence = this->latestSequence();
+		if (sequence == 0) {
+			return 0;
+		}
+		
+		//Pin the slot and then verify that it still holds the frame we want
+		//(The producer marks a slot as being written before checking its pin count, so one of us is guaranteed to see the other)
+		slot = this->header->slot.load(std::memory_order_acquire);
+		FrameSlotHeader* slotHeader = this->slotHeader(slot);
+		slotHeader->pins.fetch_add(1, std::memory_order_seq_cst);
+		if (slotHeader->generation.load(std::memory_order_seq_cst) == sequence * 2)
+		{
+			if (owner < MEDIA_IPC_MAX_PIN_OWNERS) {
+				slotHeader->ownerPins[owner].fetch_add(1, std::memory_order_relaxed);
+			}
+			
+			this->localPins.fetch_add(1, std::memory_order_relaxed);
+			return sequence;
+		}
+		
+		//The slot was reused before we could pin it, so try again
+		slotHeader->pins.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+void FrameRing::unpin(uint32_t slot, uint32_t owner) const
+{
+	//Attribution is removed before the pin itself, so a process that dies in between leaks the pin rather than
+	//having it released twice
+	FrameSlotHeader* slotHeader = this->slotHeader(slot);
+	if (owner < MEDIA_IPC_MAX_PIN_OWNERS) {
+		slotHeader->ownerPins[owner].fetch_sub(1, std::memory_order_relaxed);
+	}
+	
+	slotHeader->pins.fetch_sub(1, std::memory_order_release);
+	this->localPins.fetch_sub(1, std::memory_order_release);
+}
+
+void FrameRing::releasePins(uint32_t owner)
+{
+	if (owner >= MEDIA_IPC_MAX_PIN_OWNERS) {
+		return;
+	}
+	
+	for (uint32_t slot = 0; slot < this->slots; ++slot)
+	{
+		FrameSlotHeader* slotHeader = this->slotHeader(slot);
+		uint32_t held = slotHeader->ownerPins[owner].exchange(0, std::memory_order_acq_rel);
+		if (held != 0) {
+			slotHeader->pins.fetch_sub(held, std::memory_order_release);
+		}
+	}
+}
+
+bool FrameRing::pinnedLocally() const {
+	return (this->localPins.load(std::memory_order_acquire) != 0);
+}
+
+bool FrameRing::holds(uint32_t slot, uint64_t sequence) const {
+	return (this->slotHeader(slot)->generation.load(std::memory_order_acquire) == sequence * 2);
+}
+
+const uint8_t* FrameRing::frameData(uint32_t slot) const {
+	return this->slotData(slot);
+}
+
+FrameInfo FrameRing::frameInfo(uint32_t slot) const
+{
+	FrameSlotHeader* slotHeader = this->slotHeader(slot);
+	FrameInfo info;
+	info.sequence = slotHeader->generation.load(std::memory_order_acquire) / 2;
+	info.timestamp = slotHeader->timestamp;
+	info.pts = slotHeader->pts;
+	return info;
+}
+
+FrameSlotHeader* FrameRing::slotHeader(uint32_t slot) const {
+	return (FrameSlotHeader*)(this->slotMemory + (slot * this->slotStride));
+}
+
+uint8_t* FrameRing::slotData(uint32_t slot) const {
+	return this->slotMemory + (slot * this->slotStride) + this->dataOffset;
+}
+
+bool FrameRing::frameDamage(uint64_t sequence, DamageList& damage) const
+{
+	for (uint32_t slot = 0; slot < this->slots; ++slot)
+	{
+		//Copy the damage list under the slot's seqlock, in the same manner as the frame data
+		FrameSlotHeader* slotHeader = this->slotHeader(slot);
+		if (slotHeader->generation.load(std::memory_order_acquire) != sequence * 2) {
+			continue;
+		}
+		
+		std::memcpy(&damage, &slotHeader->damage, sizeof(DamageList));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slotHeader->generation.load(std::memory_order_relaxed) == sequence * 2)
+		{
+			//Guard against a corrupt count, since it determines how much of the list is read
+			damage.count = std::min(damage.count, (uint32_t)(MEDIA_IPC_MAX_DAMAGE_RECTS));
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+} //End MediaIPC
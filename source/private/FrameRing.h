@@ -0,0 +1,170 @@
+#ifndef _MEDIA_IPC_FRAME_RING
+#define _MEDIA_IPC_FRAME_RING
+
+#include "../public/FrameInfo.h"
+#include "DamageList.h"
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+namespace MediaIPC {
+
+//The size of a CPU cache line, used to keep the ring header and each frame slot on separate lines
+#define MEDIA_IPC_CACHE_LINE 64
+
+//The number of consumers whose pins are recorded individually, so that the pins of a consumer that dies can be released
+//(This matches the number of sets of consumer counters, and a consumer's owner index is the index of its counters)
+#define MEDIA_IPC_MAX_PIN_OWNERS 16
+
+//The owner index used by consumers that could not claim a set of counters (their pins are only counted, not attributed)
+#define MEDIA_IPC_NO_PIN_OWNER UINT32_MAX
+
+//Header stored at the start of the frame ring shared memory
+struct FrameRingHeader
+{
+	//The sequence number of the most recently published frame (zero if no frame has been published yet)
+	alignas(MEDIA_IPC_CACHE_LINE) std::atomic<uint64_t> sequence;
+	
+	//The slot holding the most recently published frame
+	std::atomic<uint32_t> slot;
+};
+
+//Header stored at the start of each frame slot
+struct FrameSlotHeader
+{
+	//Seqlock for the slot: twice the sequence number of the frame it holds, or an odd value while it is being written
+	//(The seqlock also protects the timestamps and damage list below)
+	alignas(MEDIA_IPC_CACHE_LINE) std::atomic<uint64_t> generation;
+	
+	//The producer's steady clock time when the frame was published, and the optional presentation timestamp
+	uint64_t timestamp;
+	int64_t pts;
+	
+	//The regions of the frame that differ from the frame published before it
+	DamageList damage;
+	
+	//The number of consumers currently holding a view of the frame in this slot
+	//(The producer skips pinned slots when choosing where to write the next frame)
+	std::atomic<uint32_t> pins;
+	
+	//The number of those pins held by each consumer with a set of counters, indexed by owner
+	std::atomic<uint32_t> ownerPins[MEDIA_IPC_MAX_PIN_OWNERS];
+};
+
+//Lock-free single-producer, multi-consumer ring of video frame slots stored in shared memory
+//(The producer never blocks on a consumer, and consumers detect torn reads and retry rather than locking)
+class FrameRing
+{
+	public:
+		
+		//Determines the number of bytes of shared memory required to hold a frame ring with the specified dimensions
+		//(The frame data in each slot starts at a multiple of the alignment, which must be a power of two)
+		static uint64_t requiredSize(uint32_t slots, uint64_t frameSize, uint32_t alignment = MEDIA_IPC_CACHE_LINE);
+		
+		//Wraps an existing region of shared memory (whose size must be at least requiredSize(slots, frameSize, alignment) bytes)
+		//(The memory itself must be aligned to at least the specified alignment, which holds for page-aligned mappings)
+		FrameRing(uint8_t* memory, uint32_t slots, uint64_t frameSize, uint32_t alignment = MEDIA_IPC_CACHE_LINE);
+		
+		//Initialises the ring header and slot headers (called by the producer prior to publishing any frames)
+		void reset();
+		
+		//Returns the sequence number of the most recently published frame (zero if no frame has been published yet)
+		uint64_t latestSequence() const;
+		
+		//Copies a frame into the next slot and publishes it, returning its sequence number
+		uint64_t write(const void* source, uint64_t length, int64_t pts = FrameInfo::NoPts);
+		
+		//Marks the next free slot as being written and returns a pointer to its frame data, so that it can be filled in place
+		//(Calling this again before the slot is committed returns the same slot)
+		uint8_t* acquire();
+		
+		//Returns the frame data of the slot that was returned by acquire() and has not yet been committed (nullptr if there is none)
+		uint8_t* pending() const;
+		
+		//Publishes the slot that was returned by acquire(), returning its sequence number (zero if no slot was acquired)
+		uint64_t commit(int64_t pts = FrameInfo::NoPts);
+		
+		//Publishes the slot that was returned by acquire(), recording only the specified regions as having changed
+		//(The caller must have brought every other region of the slot up to date with the previous frame)
+		uint64_t commit(const DamageList& damage, int64_t pts = FrameInfo::NoPts);
+		
+		//Publishes a frame that differs from the previous frame only in the specified regions, copying just those regions
+		//from the source and any regions that are out of date in the slot from the previous frame, returning its sequence number
+		//(The number of bytes copied into the slot is added to bytesCopied)
+		uint64_t write(const void* source, const DamageList& damage, const DamageCopier& copier, uint64_t& bytesCopied, int64_t pts = FrameInfo::NoPts);
+		
+		//Records the damage of a frame that was not published, so that it is included in the next frame that is
+		void discard(const DamageList& damage);
+		
+		//Copies the most recently published frame and its metadata, returning its sequence number (zero if no frame has been published yet)
+		uint64_t read(void* destination, uint64_t length, FrameInfo* info = nullptr) const;
+		
+		//Copies the regions of the most recently published frame that changed since the specified frame, which the destination
+		//must already hold, returning the sequence number of the frame and the regions that were copied
+		//(The whole frame is copied if the destination holds no frame or if the changes could not be determined)
+		uint64_t readDelta(void* destination, uint64_t lastSequence, const DamageCopier& copier, DamageList& damage, FrameInfo* info, uint64_t& bytesCopied) const;
+		
+		//Determines the regions that changed between two published frames, marking everything as damaged if the
+		//frames in between have already been overwritten
+		void damageSince(uint64_t lastSequence, uint64_t sequence, DamageList& damage) const;
+		
+		//Pins the slot holding the most recently published frame on behalf of the specified owner so that the producer will not
+		//overwrite it, returning its sequence number (zero if no frame has been published yet, in which case nothing is pinned)
+		uint64_t pin(uint32_t& slot, uint32_t owner) const;
+		
+		//Releases a slot that was pinned by pin() on behalf of the same owner
+		void unpin(uint32_t slot, uint32_t owner) const;
+		
+		//Releases every pin held by the specified owner (called by the producer once the owner's process has exited)
+		//(A process that dies between counting a pin and attributing it leaks that pin, which is preferable to releasing
+		//a pin that was never taken)
+		void releasePins(uint32_t owner);
+		
+		//Determines if any slot pinned through this interface has yet to be released
+		bool pinnedLocally() const;
+		
+		//Determines if the specified slot still holds the frame with the specified sequence number
+		//(This can only be false for a pinned slot if every other slot was pinned when the producer needed one)
+		bool holds(uint32_t slot, uint64_t sequence) const;
+		
+		//Retrieves the frame data for the specified slot
+		const uint8_t* frameData(uint32_t slot) const;
+		
+		//Retrieves the metadata for the frame held by the specified slot (which should be pinned)
+		FrameInfo frameInfo(uint32_t slot) const;
+		
+	private:
+		
+		//Retrieves the header and the frame data for the specified slot
+		FrameSlotHeader* slotHeader(uint32_t slot) const;
+		uint8_t* slotData(uint32_t slot) const;
+		
+		//Copies the damage list of the frame with the specified sequence number, returning false if it is no longer held by any slot
+		bool frameDamage(uint64_t sequence, DamageList& damage) const;
+		
+		FrameRingHeader* header;
+		uint8_t* slotMemory;
+		uint32_t slots;
+		uint64_t frameSize;
+		uint64_t slotStride;
+		
+		//The offset of the frame data from the start of each slot
+		uint64_t dataOffset;
+		
+		//The number of pins taken through this interface that have not been released
+		//(A consumer keeps a ring's memory mapped after the producer moves it until this reaches zero)
+		mutable std::atomic<uint32_t> localPins;
+		
+		//The sequence number and slot currently acquired by the producer (a sequence of zero means no slot is acquired)
+		uint64_t acquired;
+		uint32_t acquiredSlot;
+		
+		//The regions of each slot that are out of date with respect to the most recently published frame, and the damage of
+		//any frames that were discarded since then (both are only used by the producer)
+		std::vector<DamageList> stale;
+		DamageList discarded;
+};
+
+} //End MediaIPC
+
+#endif
@@ -1,37 +1,239 @@
 #include "IPCUtils.h"
+#include <algorithm>
 #include <cstring>
+#include <functional>
+#include <stdexcept>
 #include <thread>
 #include <utility>
+#include <vector>
+
+#ifdef __linux__
+	#include <fcntl.h>
+	#include <linux/mempolicy.h>
+	#include <poll.h>
+	#include <sys/inotify.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <sys/syscall.h>
+	#include <sys/vfs.h>
+	#include <unistd.h>
+	#include <fstream>
+	#include <sstream>
+#endif
 
 namespace MediaIPC {
 
-MemoryCleanup::MemoryCleanup(const string& name)
+namespace
 {
-	this->memoryName = name;
-	if (this->memoryName.empty() == false) {
-		ipc::shared_memory_object::remove(this->memoryName.c_str());
+	#ifdef __linux__
+	
+	//The filesystem magic number for hugetlbfs mounts
+	const long HUGETLBFS_MAGIC_NUMBER = 0x958458f6;
+	
+	//Locates a hugetlbfs mount that we can create files in, along with its huge page size
+	bool locateHugePageMount(string& mountPoint, uint64_t& pageSize)
+	{
+		std::ifstream mounts("/proc/mounts");
+		string line;
+		while (std::getline(mounts, line))
+		{
+			std::istringstream fields(line);
+			string device, path, type;
+			if (fields >> device >> path >> type && type == "hugetlbfs")
+			{
+				struct statfs info;
+				if (statfs(path.c_str(), &info) == 0 && info.f_type == HUGETLBFS_MAGIC_NUMBER && access(path.c_str(), W_OK) == 0)
+				{
+					mountPoint = path;
+					pageSize = (uint64_t)(info.f_bsize);
+					return true;
+				}
+			}
+		}
+		
+		return false;
 	}
-}
-
-MemoryCleanup::~MemoryCleanup()
-{
-	if (this->memoryName.empty() == false) {
-		ipc::shared_memory_object::remove(this->memoryName.c_str());
+	
+	//Resolves the path of the file on a hugetlbfs mount that backs the specified buffer
+	bool hugePageFile(const string& name, string& path, uint64_t& pageSize)
+	{
+		string mountPoint;
+		if (locateHugePageMount(mountPoint, pageSize) == false) {
+			return false;
+		}
+		
+		path = mountPoint + "/" + name;
+		return true;
+	}
+	
+	#endif
+	
+	//The longest we sleep between attempts to open an object that does not exist yet
+	//(Under Linux this is only a safety net, since we are woken by inotify as soon as anything in the directory changes)
+	const std::chrono::milliseconds MAX_RETRY_INTERVAL(50);
+	
+	//Converts a timeout into a deadline, treating the maximum duration as waiting indefinitely
+	std::chrono::steady_clock::time_point deadlineFor(std::chrono::milliseconds timeout)
+	{
+		if (timeout == std::chrono::milliseconds::max()) {
+			return std::chrono::steady_clock::time_point::max();
+		}
+		
+		return std::chrono::steady_clock::now() + timeout;
+	}
+	
+	#ifdef __linux__
+	
+	//An inotify instance that is kept open for the lifetime of the thread that created it
+	//(Closing an inotify instance waits for an RCU grace period, which takes several milliseconds, whereas adding and removing
+	//watches is cheap, so reusing the instance keeps that delay off the path between the producer appearing and us attaching)
+	class InotifyInstance
+	{
+		public:
+			InotifyInstance() : descriptor(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {}
+			~InotifyInstance()
+			{
+				if (this->descriptor != -1) {
+					close(this->descriptor);
+				}
+			}
+			
+			InotifyInstance(const InotifyInstance& other) = delete;
+			InotifyInstance& operator=(const InotifyInstance& other) = delete;
+			
+			//Discards any queued events
+			void drain()
+			{
+				char events[4096];
+				while (read(this->descriptor, events, sizeof(events)) > 0) {}
+			}
+			
+			int descriptor;
+	};
+	
+	InotifyInstance& threadInotifyInstance()
+	{
+		static thread_local InotifyInstance instance;
+		return instance;
+	}
+	
+	#endif
+	
+	//Repeatedly calls the supplied function until it succeeds in opening an object, returning false if the deadline passes first
+	//(Under Linux we sleep on inotify events for the directory containing the object, so we wake within moments of it being
+	//created or resized, and elsewhere we poll with an interval that starts at a millisecond and backs off)
+	bool waitForObject(const string& directory, const std::function<bool()>& attempt, std::chrono::steady_clock::time_point deadline)
+	{
+		#ifdef __linux__
+		//The watch must be in place before our first attempt, so that we cannot miss an event between the attempt and the wait
+		InotifyInstance& inotify = threadInotifyInstance();
+		int watch = -1;
+		if (inotify.descriptor != -1)
+		{
+			watch = inotify_add_watch(inotify.descriptor, directory.c_str(), IN_CREATE | IN_MOVED_TO | IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE);
+			inotify.drain();
+		}
+		#endif
+		
+		bool success = false;
+		std::chrono::milliseconds interval(1);
+		while (true)
+		{
+			if (attempt() == true)
+			{
+				success = true;
+				break;
+			}
+			
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (now >= deadline) {
+				break;
+			}
+			
+			std::chrono::milliseconds remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now) + std::chrono::milliseconds(1);
+			
+			#ifdef __linux__
+			if (watch != -1)
+			{
+				//Wait for a change to the directory and then discard the queued events, since we simply try again regardless of which object changed
+				struct pollfd descriptor;
+				descriptor.fd = inotify.descriptor;
+				descriptor.events = POLLIN;
+				descriptor.revents = 0;
+				poll(&descriptor, 1, (int)(std::min(remaining, MAX_RETRY_INTERVAL).count()));
+				inotify.drain();
+				continue;
+			}
+			#endif
+			
+			std::this_thread::sleep_for(std::min(remaining, interval));
+			interval = std::min(interval * 2, MAX_RETRY_INTERVAL);
+		}
+		
+		#ifdef __linux__
+		if (watch != -1) {
+			inotify_rm_watch(inotify.descriptor, watch);
+		}
+		#endif
+		
+		return success;
+	}
+	
+	//Attempts to open the specified shared memory object without waiting
+	//(The producer creates each object before setting its size, so an object that is still empty is treated as not existing yet)
+	bool tryOpenMemory(const string& name, ipc::mode_t mode, unique_ptr<ipc::shared_memory_object>& memory)
+	{
+		try
+		{
+			memory.reset(new ipc::shared_memory_object(ipc::open_only, name.c_str(), mode));
+			ipc::offset_t size = 0;
+			if (memory->get_size(size) == true && size > 0) {
+				return true;
+			}
+		}
+		catch (...) {}
+		
+		memory.reset();
+		return false;
+	}
+	
+	//The directory that holds shared memory objects, which we watch for new objects (this is only used under Linux)
+	const char* const SHARED_MEMORY_DIRECTORY = "/dev/shm";
+	
+	//Advises the kernel to back a mapped region with transparent huge pages (this is a no-op on platforms without them)
+	void adviseHugePages(ipc::mapped_region& region)
+	{
+		#if defined(__linux__) && defined(MADV_HUGEPAGE)
+		madvise(region.get_address(), region.get_size(), MADV_HUGEPAGE);
+		#endif
 	}
 }
 
-MutexCleanup::MutexCleanup(const string& name)
+MemoryCleanup::MemoryCleanup(const string& name, bool isFile)
 {
-	this->mutexName = name;
-	if (this->mutexName.empty() == false) {
-		ipc::named_mutex::remove(this->mutexName.c_str());
+	this->memoryName = name;
+	this->isFile = isFile;
+	if (this->memoryName.empty() == false)
+	{
+		if (this->isFile == true) {
+			ipc::file_mapping::remove(this->memoryName.c_str());
+		}
+		else {
+			ipc::shared_memory_object::remove(this->memoryName.c_str());
+		}
 	}
 }
 
-MutexCleanup::~MutexCleanup()
+MemoryCleanup::~MemoryCleanup()
 {
-	if (this->mutexName.empty() == false) {
-		ipc::named_mutex::remove(this->mutexName.c_str());
+	if (this->memoryName.empty() == false)
+	{
+		if (this->isFile == true) {
+			ipc::file_mapping::remove(this->memoryName.c_str());
+		}
+		else {
+			ipc::shared_memory_object::remove(this->memoryName.c_str());
+		}
 	}
 }
 
@@ -40,16 +242,17 @@ MemoryWrapper::~MemoryWrapper()
 	//Make sure we release our object references prior to any cleanup
 	this->mapped.reset();
 	this->memory.reset();
+	this->file.reset();
 }
 
-MutexWrapper::~MutexWrapper()
+void MemoryWrapper::map(ipc::mode_t mode)
 {
-	//Make sure we release our object reference prior to any cleanup
-	this->mutex.reset();
-}
-
-void MemoryWrapper::map(ipc::mode_t mode) {
-	this->mapped.reset(new ipc::mapped_region(*this->memory, mode));
+	if (this->file) {
+		this->mapped.reset(new ipc::mapped_region(*this->file, mode));
+	}
+	else {
+		this->mapped.reset(new ipc::mapped_region(*this->memory, mode));
+	}
 }
 
 MemoryWrapper IPCUtils::createSharedMemory(const string& name, uint64_t size, ipc::mode_t mode)
@@ -62,19 +265,12 @@ MemoryWrapper IPCUtils::createSharedMemory(const string& name, uint64_t size, ip
 	return wrapper;
 }
 
-MemoryWrapper IPCUtils::getMemoryOnceExists(const string& name, ipc::mode_t mode)
+MemoryWrapper IPCUtils::getMemoryOnceExists(const string& name, ipc::mode_t mode, std::chrono::milliseconds timeout)
 {
 	unique_ptr<ipc::shared_memory_object> memory;
-	while (memory.get() == nullptr)
-	{
-		try {
-			memory.reset(new ipc::shared_memory_object(ipc::open_only, name.c_str(), mode));
-		}
-		catch (...)
-		{
-			//Shared memory does not exist yet
-			std::this_thread::sleep_for(std::chrono::seconds(1));
-		}
+	std::function<bool()> attempt = [&name, mode, &memory]() { return tryOpenMemory(name, mode, memory); };
+	if (waitForObject(SHARED_MEMORY_DIRECTORY, attempt, deadlineFor(timeout)) == false) {
+		throw std::runtime_error("timed out waiting for the shared memory object \"" + name + "\" to be created");
 	}
 	
 	MemoryWrapper wrapper;
@@ -83,14 +279,149 @@ MemoryWrapper IPCUtils::getMemoryOnceExists(const string& name, ipc::mode_t mode
 	return wrapper;
 }
 
-MutexWrapper IPCUtils::getNamedMutex(const string& name, bool cleanup)
+MemoryWrapper IPCUtils::tryGetMemory(const string& name, ipc::mode_t mode)
+{
+	MemoryWrapper wrapper;
+	if (tryOpenMemory(name, mode, wrapper.memory) == true) {
+		wrapper.map(mode);
+	}
+	
+	return wrapper;
+}
+
+MemoryWrapper IPCUtils::createBufferMemory(const string& name, uint64_t size, bool hugePages, MemoryBacking& backing)
+{
+	#ifdef __linux__
+	if (hugePages == true)
+	{
+		//If a writable hugetlbfs mount is available then create the buffer as a file on it
+		//(The size of the file must be a multiple of the huge page size)
+		string path;
+		uint64_t pageSize = 0;
+		if (hugePageFile(name, path, pageSize) == true)
+		{
+			//Constructing the cleanup object removes any stale file left behind by a previous producer that crashed
+			MemoryWrapper wrapper;
+			wrapper.cleanup = MemoryCleanup(path, true);
+			int fd = open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+			if (fd != -1)
+			{
+				bool truncated = (ftruncate(fd, ((size + pageSize - 1) / pageSize) * pageSize) == 0);
+				close(fd);
+				
+				//Mapping the file fails if the pool of huge pages has been exhausted, in which case we fall back to regular shared memory
+				//(The file is removed by the cleanup object when the wrapper is destroyed)
+				if (truncated == true)
+				{
+					try
+					{
+						wrapper.file.reset( new ipc::file_mapping(path.c_str(), ipc::read_write) );
+						wrapper.map(ipc::read_write);
+						backing = MemoryBacking::HugeTLB;
+						return wrapper;
+					}
+					catch (...) {}
+				}
+			}
+		}
+	}
+	#endif
+	
+	//Create a regular shared memory object, advising the kernel to use transparent huge pages if requested
+	MemoryWrapper wrapper = IPCUtils::createSharedMemory(name, size, ipc::read_write);
+	backing = MemoryBacking::Standard;
+	if (hugePages == true)
+	{
+		adviseHugePages(*wrapper.mapped);
+		backing = MemoryBacking::TransparentHugePages;
+	}
+	
+	return wrapper;
+}
+
+MemoryWrapper IPCUtils::getBufferOnceExists(const string& name, ipc::mode_t mode, MemoryBacking backing, std::chrono::milliseconds timeout)
 {
-	MutexWrapper wrapper;
-	wrapper.cleanup = MutexCleanup( (cleanup == true ? name : "") );
-	wrapper.mutex.reset( new ipc::named_mutex(ipc::open_or_create, name.c_str()) );
+	#ifdef __linux__
+	if (backing == MemoryBacking::HugeTLB)
+	{
+		string path;
+		uint64_t pageSize = 0;
+		if (hugePageFile(name, path, pageSize) == false) {
+			throw std::runtime_error("the producer created its buffers on a hugetlbfs mount that is not accessible to this process");
+		}
+		
+		//Wait for the file to be created and sized (the producer sizes it immediately after creating it)
+		unique_ptr<ipc::file_mapping> file;
+		std::function<bool()> attempt = [&path, mode, &file]()
+		{
+			struct stat info;
+			if (stat(path.c_str(), &info) != 0 || info.st_size == 0) {
+				return false;
+			}
+			
+			try {
+				file.reset(new ipc::file_mapping(path.c_str(), mode));
+			}
+			catch (...) {
+				return false;
+			}
+			
+			return true;
+		};
+		
+		if (waitForObject(path.substr(0, path.find_last_of('/')), attempt, deadlineFor(timeout)) == false) {
+			throw std::runtime_error("timed out waiting for the hugetlbfs file \"" + path + "\" to be created");
+		}
+		
+		MemoryWrapper wrapper;
+		wrapper.file = std::move(file);
+		wrapper.map(mode);
+		return wrapper;
+	}
+	#endif
+	
+	MemoryWrapper wrapper = IPCUtils::getMemoryOnceExists(name, mode, timeout);
+	if (backing == MemoryBacking::TransparentHugePages) {
+		adviseHugePages(*wrapper.mapped);
+	}
+	
 	return wrapper;
 }
 
+bool IPCUtils::bindToNumaNode(ipc::mapped_region& region, int32_t node)
+{
+	#ifdef __linux__
+	if (node < 0) {
+		return false;
+	}
+	
+	//Build the node mask and bind the region, moving any pages that have already been touched
+	const uint64_t bitsPerWord = sizeof(unsigned long) * 8;
+	std::vector<unsigned long> nodeMask((node / bitsPerWord) + 1, 0);
+	nodeMask[node / bitsPerWord] |= (1UL << (node % bitsPerWord));
+	return (syscall(SYS_mbind, region.get_address(), region.get_size(), MPOL_BIND, nodeMask.data(), (nodeMask.size() * bitsPerWord) + 1, MPOL_MF_MOVE) == 0);
+	#else
+	return false;
+	#endif
+}
+
+void IPCUtils::prefaultMemory(ipc::mapped_region& region, bool writable)
+{
+	//Where available, ask the kernel to populate the page tables in a single system call
+	#if defined(__linux__) && defined(MADV_POPULATE_READ) && defined(MADV_POPULATE_WRITE)
+	if (madvise(region.get_address(), region.get_size(), (writable == true) ? MADV_POPULATE_WRITE : MADV_POPULATE_READ) == 0) {
+		return;
+	}
+	#endif
+	
+	//Fall back to touching each page individually (reading is sufficient to map the existing pages)
+	const volatile uint8_t* memory = (const volatile uint8_t*)(region.get_address());
+	const uint64_t pageSize = ipc::mapped_region::get_page_size();
+	for (uint64_t offset = 0; offset < region.get_size(); offset += pageSize) {
+		(void)(memory[offset]);
+	}
+}
+
 void IPCUtils::fillMemory(ipc::mapped_region& region, uint8_t value) {
 	std::memset(region.get_address(), value, region.get_size());
 }
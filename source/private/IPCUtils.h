@@ -2,13 +2,13 @@
 #define _MEDIA_IPC_IPC_UTILS
 
 #define BOOST_DATE_TIME_NO_LIB
+#include <boost/interprocess/file_mapping.hpp>
 #include <boost/interprocess/mapped_region.hpp>
 #include <boost/interprocess/shared_memory_object.hpp>
-#include <boost/interprocess/sync/named_mutex.hpp>
-#include <boost/interprocess/sync/scoped_lock.hpp>
 namespace ipc = boost::interprocess;
 
 #include <stdint.h>
+#include <chrono>
 #include <memory>
 #include <string>
 using std::string;
@@ -16,13 +16,25 @@ using std::unique_ptr;
 
 namespace MediaIPC {
 
-typedef ipc::scoped_lock<ipc::named_mutex> MutexLock;
+//Determines how the memory for a video or audio buffer is backed
+//(The producer records this in the control block so that consumers can open each buffer the same way)
+enum class MemoryBacking : uint8_t
+{
+	//Regular shared memory with the default page size
+	Standard = 0,
+	
+	//Regular shared memory, with the kernel advised to back it with transparent huge pages
+	TransparentHugePages = 1,
+	
+	//A file on a hugetlbfs mount, which is always backed by huge pages
+	HugeTLB = 2
+};
 
-//Performs automatic cleanup for a shared memory object
+//Performs automatic cleanup for a shared memory object (or a file, in the case of memory on a hugetlbfs mount)
 class MemoryCleanup
 {
 	public:
-		MemoryCleanup(const string& name = "");
+		MemoryCleanup(const string& name = "", bool isFile = false);
 		~MemoryCleanup();
 		
 		MemoryCleanup(const MemoryCleanup& other) = delete;
@@ -32,22 +44,7 @@ class MemoryCleanup
 		
 	private:
 		string memoryName;
-};
-
-//Performs automatic cleanup for a named mutex
-class MutexCleanup
-{
-	public:
-		MutexCleanup(const string& name = "");
-		~MutexCleanup();
-		
-		MutexCleanup(const MutexCleanup& other) = delete;
-		MutexCleanup& operator=(const MutexCleanup& other) = delete;
-		MutexCleanup(MutexCleanup&& other) = default;
-		MutexCleanup& operator=(MutexCleanup&& other) = default;
-		
-	private:
-		string mutexName;
+		bool isFile;
 };
 
 //Wrapper for a shared memory object with associated mapped region and optional cleanup
@@ -64,27 +61,13 @@ class MemoryWrapper
 		
 		void map(ipc::mode_t mode);
 		
+		//Only one of these is populated, depending on whether the memory is a shared memory object or a file
 		unique_ptr<ipc::shared_memory_object> memory;
+		unique_ptr<ipc::file_mapping> file;
 		unique_ptr<ipc::mapped_region> mapped;
 		MemoryCleanup cleanup;
 };
 
-//Wrapper for a named mutex with optional cleanup
-class MutexWrapper
-{
-	public:
-		MutexWrapper() : cleanup("") {}
-		~MutexWrapper();
-		
-		MutexWrapper(const MutexWrapper& other) = delete;
-		MutexWrapper& operator=(const MutexWrapper& other) = delete;
-		MutexWrapper(MutexWrapper&& other) = default;
-		MutexWrapper& operator=(MutexWrapper&& other) = default;
-		
-		unique_ptr<ipc::named_mutex> mutex;
-		MutexCleanup cleanup;
-};
-
 class IPCUtils
 {
 	public:
@@ -93,10 +76,27 @@ class IPCUtils
 		static MemoryWrapper createSharedMemory(const string& name, uint64_t size, ipc::mode_t mode);
 		
 		//Waits until the specified shared memory object exists and then retrieves it
-		static MemoryWrapper getMemoryOnceExists(const string& name, ipc::mode_t mode);
+		//(Throws std::runtime_error if the object is not created before the timeout elapses, and the maximum duration waits indefinitely)
+		static MemoryWrapper getMemoryOnceExists(const string& name, ipc::mode_t mode, std::chrono::milliseconds timeout = std::chrono::milliseconds::max());
+		
+		//Retrieves the specified shared memory object if it currently exists, without waiting
+		//(The returned wrapper has no mapped region if the object does not exist)
+		static MemoryWrapper tryGetMemory(const string& name, ipc::mode_t mode);
+		
+		//Creates the memory for a video or audio buffer, using huge pages if they are requested and available
+		//(The backing that was actually used is returned so that it can be recorded in the control block)
+		static MemoryWrapper createBufferMemory(const string& name, uint64_t size, bool hugePages, MemoryBacking& backing);
+		
+		//Waits until the specified video or audio buffer exists and then retrieves it
+		//(Throws std::runtime_error if the buffer is not created before the timeout elapses, and the maximum duration waits indefinitely)
+		static MemoryWrapper getBufferOnceExists(const string& name, ipc::mode_t mode, MemoryBacking backing, std::chrono::milliseconds timeout = std::chrono::milliseconds::max());
+		
+		//Binds the pages of a mapped region to the specified NUMA node, returning false if the binding is not supported
+		//(This only affects pages that have not yet been touched, so it must be called before the region is first written)
+		static bool bindToNumaNode(ipc::mapped_region& region, int32_t node);
 		
-		//Creates or opens the specified named mutex
-		static MutexWrapper getNamedMutex(const string& name, bool cleanup = false);
+		//Faults in every page of a mapped region, so that subsequent accesses do not pay page fault costs
+		static void prefaultMemory(ipc::mapped_region& region, bool writable);
 		
 		//Fills the contents of a shared memory region
 		static void fillMemory(ipc::mapped_region& region, uint8_t value);
@@ -1,9 +1,19 @@
 #include "../public/MediaConsumer.h"
+#include "../public/AudioConverter.h"
+#include "Doorbell.h"
+#include "FrameRing.h"
 #include "IPCUtils.h"
 #include "MemoryUtils.h"
 #include "ObjectNames.h"
 #include "RingBuffer.h"
+#include "SharedState.h"
+#include "Telemetry.h"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
 #include <thread>
 #include <utility>
 
@@ -11,162 +21,1322 @@ using std::chrono::high_resolution_clock;
 
 namespace MediaIPC {
 
+//The name, parameters and layout of a single track, copied from the track table
+struct TrackLayout
+{
+	std::string name;
+	ControlBlock controlBlock;
+	uint64_t generation;
+	uint64_t videoOffset;
+	uint64_t audioOffset;
+	uint64_t audioStartIndex;
+};
+
+//A copy of the control block and the track table, taken while holding the status mutex
+struct ConsumerLayout
+{
+	ControlBlock controlBlock;
+	uint64_t generation;
+	uint32_t videoBufferGeneration;
+	uint32_t audioBufferGeneration;
+	std::vector<TrackLayout> tracks;
+};
+
+//The state of a single track that a consumer is subscribed to
+struct ConsumerTrack
+{
+	//The index of the track, and the delegate that receives its data
+	uint32_t index;
+	std::unique_ptr<ConsumerDelegate> delegate;
+	
+	//The parameters most recently passed to our delegate, and the reconfiguration generation they belong to
+	//(Both sampling loops lock the mutex before passing new parameters, so neither delivers data that uses them before the delegate has seen them)
+	std::mutex reconfigureMutex;
+	ControlBlock controlBlock;
+	uint64_t generation;
+	
+	//The frame ring and ring buffer interfaces for the track
+	FrameRing* frameRing;
+	RingBuffer* ringBuffer;
+	
+	//The video sampling state: the generation and offset of the frame ring we are sampling, whether the track transmits video,
+	//whether our delegate receives views, the buffer holding the last sampled frame, the sampling interval and next sampling
+	//time point, and the last frame we sampled
+	uint64_t videoGeneration;
+	uint64_t videoOffset;
+	bool hasVideo;
+	bool receivesViews;
+	uint64_t videoBufsize;
+	std::unique_ptr<uint8_t[]> videoTempBuf;
+	std::chrono::microseconds videoInterval;
+	high_resolution_clock::time_point nextVideoSample;
+	uint64_t lastSequence;
+	
+	//The damage tracking state: the copier for the current video parameters, the frame that the damage we pass to our delegate
+	//is measured against (zero if there is no such frame) along with its metadata, and the damage of the frame most recently sampled
+	DamageCopier copier;
+	uint64_t damageBase;
+	FrameInfo damageBaseInfo;
+	DamageList damageList;
+	FrameDamage damage;
+	
+	//The audio sampling state: the generation and offset of the sample ring we are reading, whether the track transmits audio,
+	//the buffer holding the last sampled samples, the sampling interval and next sampling time point, and our read cursor
+	uint64_t audioGeneration;
+	uint64_t audioOffset;
+	bool hasAudio;
+	uint64_t audioBufsize;
+	std::unique_ptr<uint8_t[]> audioTempBuf;
+	std::chrono::microseconds audioInterval;
+	high_resolution_clock::time_point nextAudioSample;
+	uint64_t cursor;
+	
+	//The audio conversion state: the sample format our delegate requested (AudioFormat::None to receive samples as published)
+	//and whether it receives them as planes, along with the published parameters, whether the current parameters require a
+	//conversion, and the buffer and planes holding the converted samples
+	AudioFormat requestedAudioFormat;
+	bool receivesPlanarAudio;
+	AudioFormat publishedAudioFormat;
+	uint32_t audioChannels;
+	uint32_t audioFrames;
+	bool convertsAudio;
+	uint64_t convertedBufsize;
+	std::unique_ptr<uint8_t[]> audioConvertedBuf;
+	std::vector<uint8_t*> audioPlanes;
+};
+
+//The sampling threads of a consumer, and whether they have been asked to stop
+struct ConsumerThreads
+{
+	std::thread videoThread;
+	std::thread audioThread;
+	std::atomic<bool> stopping;
+};
+
 namespace
 {
-	MemoryWrapperPtr consumerMemory(const std::string& name) {
-		return MemoryUtils::toPointer(IPCUtils::getMemoryOnceExists(name, ipc::read_only));
+	MemoryWrapperPtr consumerMemory(const std::string& name, ipc::mode_t mode, std::chrono::milliseconds timeout) {
+		return MemoryUtils::toPointer(IPCUtils::getMemoryOnceExists(name, mode, timeout));
+	}
+	
+	//Opens the specified generation of a video or audio buffer, using whichever backing the producer selected for it
+	//(This should be called while holding the status mutex, since the producer removes the name when it recreates the buffer)
+	MemoryWrapperPtr consumerBuffer(const std::string& name, uint32_t generation, ipc::mode_t mode, uint8_t backing, std::chrono::milliseconds timeout = std::chrono::milliseconds::max()) {
+		return MemoryUtils::toPointer(IPCUtils::getBufferOnceExists(ObjectNames::generation(name, generation), mode, (MemoryBacking)(backing), timeout));
+	}
+	
+	//Returns the time point at which an attach timeout expires (the maximum time point if the timeout is the maximum duration)
+	std::chrono::steady_clock::time_point attachDeadline(std::chrono::milliseconds timeout)
+	{
+		if (timeout == std::chrono::milliseconds::max()) {
+			return std::chrono::steady_clock::time_point::max();
+		}
+		
+		return std::chrono::steady_clock::now() + timeout;
+	}
+	
+	//Returns the portion of an attach timeout that remains before its deadline (zero once the deadline has passed)
+	std::chrono::milliseconds attachTimeRemaining(std::chrono::steady_clock::time_point deadline)
+	{
+		if (deadline == std::chrono::steady_clock::time_point::max()) {
+			return std::chrono::milliseconds::max();
+		}
+		
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		return (now < deadline) ? std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now) : std::chrono::milliseconds(0);
+	}
+	
+	//The telemetry counters used by any consumers that could not claim a set of counters in shared memory
+	ConsumerCounters detachedCounters;
+	
+	//Determines the owner recorded with the pins a consumer takes on frame slots, which is the index of its counters
+	uint32_t pinOwner(const Telemetry& telemetry, const ConsumerCounters* counters)
+	{
+		if (counters == &detachedCounters) {
+			return MEDIA_IPC_NO_PIN_OWNER;
+		}
+		
+		return (uint32_t)(counters - telemetry.consumers);
+	}
+	
+	//The interval at which a sampling loop without any tracks to sample checks for reconfigurations and the end of the stream
+	const std::chrono::microseconds idleInterval(100000);
+	
+	//Copies the control block and the track table from shared memory (the caller must hold the status mutex)
+	void copyLayout(ConsumerLayout& layout, const ControlBlock* controlBlock, const SharedState* sharedState)
+	{
+		std::memcpy(&layout.controlBlock, controlBlock, sizeof(ControlBlock));
+		layout.generation = sharedState->generation.load(std::memory_order_acquire);
+		layout.videoBufferGeneration = sharedState->videoBufferGeneration;
+		layout.audioBufferGeneration = sharedState->audioBufferGeneration;
+		layout.tracks.clear();
+		
+		for (uint32_t index = 0; index < sharedState->trackCount; ++index)
+		{
+			const TrackState& track = sharedState->tracks[index];
+			TrackLayout trackLayout;
+			trackLayout.name = std::string(track.name, strnlen(track.name, MEDIA_IPC_MAX_TRACK_NAME));
+			std::memcpy(&trackLayout.controlBlock, &(track.controlBlock), sizeof(ControlBlock));
+			trackLayout.generation = track.generation;
+			trackLayout.videoOffset = track.videoOffset;
+			trackLayout.audioOffset = track.audioOffset;
+			trackLayout.audioStartIndex = track.audioStartIndex;
+			layout.tracks.push_back(trackLayout);
+		}
+	}
+	
+	//Wraps a frame ring interface around a track's region of the video buffer
+	std::unique_ptr<FrameRing> wrapFrameRing(MemoryWrapper& videoBuffer, const TrackLayout& track)
+	{
+		return std::unique_ptr<FrameRing>(new FrameRing(
+			(uint8_t*)(videoBuffer.mapped->get_address()) + track.videoOffset,
+			track.controlBlock.videoSlots,
+			track.controlBlock.calculateVideoBufsize(),
+			track.controlBlock.videoAlignment
+		));
+	}
+	
+	//Wraps a ring buffer interface around a track's region of the audio buffer
+	std::unique_ptr<RingBuffer> wrapRingBuffer(MemoryWrapper& audioBuffer, const TrackLayout& track, TrackState& state)
+	{
+		return std::unique_ptr<RingBuffer>(new RingBuffer(
+			(uint8_t*)(audioBuffer.mapped->get_address()) + track.audioOffset,
+			TrackState::audioRegionSize(track.controlBlock),
+			&(state.audioRing)
+		));
+	}
+	
+	//Passes a track's parameters to its delegate, reporting the sample format the delegate requested rather than the published one
+	//(Tracks that are pulled rather than sampled have no delegate, so nothing is passed)
+	void passControlBlock(ConsumerTrack& track)
+	{
+		if (track.delegate == nullptr) {
+			return;
+		}
+		
+		ControlBlock cb = track.controlBlock;
+		if (cb.audioFormat != AudioFormat::None && track.requestedAudioFormat != AudioFormat::None) {
+			cb.audioFormat = track.requestedAudioFormat;
+		}
+		
+		track.delegate->controlBlockReceived(cb);
+	}
+	
+	//Passes the parameters of a reconfigured track to its delegate, unless the other sampling loop has already done so
+	void deliverControlBlock(ConsumerTrack& track, const TrackLayout& layout)
+	{
+		std::lock_guard<std::mutex> lock(track.reconfigureMutex);
+		if (track.generation < layout.generation)
+		{
+			track.controlBlock = layout.controlBlock;
+			track.generation = layout.generation;
+			passControlBlock(track);
+		}
+	}
+	
+	//Prepares the video sampling state of a track for the specified parameters
+	void prepareVideo(ConsumerTrack& track, const ControlBlock& cb, high_resolution_clock::time_point start)
+	{
+		track.hasVideo = (cb.videoFormat != VideoFormat::None);
+		track.receivesViews = ((track.delegate != nullptr) ? track.delegate->receivesFrameViews() : true);
+		track.videoBufsize = cb.calculateVideoBufsize();
+		track.videoInterval = cb.calculateVideoInterval();
+		track.nextVideoSample = start;
+		track.copier = DamageCopier(cb);
+		track.damageBase = 0;
+		track.damageBaseInfo = FrameInfo();
+		
+		//Allocate memory to hold the last sampled video framebuffer, unless our delegate receives views
+		//(This is zeroed so that we pass blank frames to our delegate until the producer publishes its first frame)
+		track.videoTempBuf.reset((track.hasVideo == true && track.receivesViews == false) ? new uint8_t[track.videoBufsize]() : nullptr);
+	}
+	
+	//Prepares the audio sampling state of a track for the specified parameters
+	void prepareAudio(ConsumerTrack& track, const ControlBlock& cb, high_resolution_clock::time_point start)
+	{
+		track.hasAudio = (cb.audioFormat != AudioFormat::None);
+		track.audioBufsize = cb.calculateAudioBufsize();
+		track.audioInterval = cb.calculateAudioInterval();
+		track.nextAudioSample = start;
+		
+		//Allocate memory to hold the last sampled audio samples, unless the track is pulled (in which case samples are read straight
+		//into the caller's buffer)
+		track.audioTempBuf.reset((track.hasAudio == true && track.delegate != nullptr) ? new uint8_t[track.audioBufsize] : nullptr);
+		
+		//Determine if the samples need converting into the format our delegate requested, and allocate memory to hold the result
+		//(Samples are only split into planes when there is more than one channel, since a single plane is simply the interleaved samples)
+		bool planar = (track.receivesPlanarAudio == true && cb.channels > 1 && cb.channels <= AudioConverter::MaxChannels);
+		track.publishedAudioFormat = cb.audioFormat;
+		track.audioChannels = cb.channels;
+		track.audioFrames = cb.samplesPerBuffer;
+		track.convertsAudio = (track.hasAudio == true && track.requestedAudioFormat != AudioFormat::None && (track.requestedAudioFormat != cb.audioFormat || planar == true));
+		track.convertedBufsize = ((track.convertsAudio == true) ? (uint64_t)(cb.channels) * cb.samplesPerBuffer * FormatDetails::bytesPerSample(track.requestedAudioFormat) : 0);
+		track.audioConvertedBuf.reset((track.convertsAudio == true) ? new uint8_t[track.convertedBufsize] : nullptr);
+		track.audioPlanes.clear();
+		for (uint32_t channel = 0; planar == true && track.convertsAudio == true && channel < cb.channels; ++channel) {
+			track.audioPlanes.push_back(track.audioConvertedBuf.get() + ((track.convertedBufsize / cb.channels) * channel));
+		}
+	}
+	
+	//Converts the samples most recently read for a track into the format its delegate requested
+	void convertAudio(ConsumerTrack& track)
+	{
+		if (track.audioPlanes.empty() == false) {
+			AudioConverter::deinterleave(track.audioTempBuf.get(), track.publishedAudioFormat, track.audioPlanes.data(), track.requestedAudioFormat, track.audioChannels, track.audioFrames);
+		}
+		else {
+			AudioConverter::convert(track.audioTempBuf.get(), track.publishedAudioFormat, track.audioConvertedBuf.get(), track.requestedAudioFormat, (uint64_t)(track.audioChannels) * track.audioFrames);
+		}
+	}
+	
+	//Measures a number of bytes of published samples in the format that a track's delegate receives
+	uint64_t deliveredBytes(const ConsumerTrack& track, uint64_t bytes)
+	{
+		if (track.convertsAudio == false) {
+			return bytes;
+		}
+		
+		return (bytes / FormatDetails::bytesPerSample(track.publishedAudioFormat)) * FormatDetails::bytesPerSample(track.requestedAudioFormat);
+	}
+	
+	//Selects the tracks with a delegate that transmit video or audio, and determines the shortest sampling interval across them
+	//(When none of the tracks transmit the media type, the interval is the one at which an idle loop checks the stream)
+	std::vector<ConsumerTrack*> selectTracks(std::vector< std::unique_ptr<ConsumerTrack> >& tracks, bool video, std::chrono::microseconds& shortestInterval)
+	{
+		std::vector<ConsumerTrack*> selected;
+		for (auto& track : tracks)
+		{
+			if (track->delegate != nullptr && ((video == true) ? track->hasVideo : track->hasAudio))
+			{
+				auto interval = (video == true) ? track->videoInterval : track->audioInterval;
+				shortestInterval = (selected.empty() == true) ? interval : std::min(shortestInterval, interval);
+				selected.push_back(track.get());
+			}
+		}
+		
+		if (selected.empty() == true) {
+			shortestInterval = idleInterval;
+		}
+		
+		return selected;
+	}
+	
+	//Records the interval at which a sampling loop polls its tracks in our registry entry
+	void recordSamplingInterval(std::atomic<uint64_t>& counter, SamplingMode mode, const std::vector<ConsumerTrack*>& tracks, std::chrono::microseconds interval)
+	{
+		bool polling = (mode == SamplingMode::Polling && tracks.empty() == false);
+		counter.store((polling == true) ? std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count() : 0, std::memory_order_relaxed);
+	}
+	
+	//Finds the index of the track with the specified name, throwing std::runtime_error if the producer does not publish it
+	uint32_t trackIndex(const ConsumerLayout& layout, const std::string& name)
+	{
+		uint32_t index = 0;
+		while (index < layout.tracks.size() && layout.tracks[index].name != name) {
+			++index;
+		}
+		
+		if (index == layout.tracks.size()) {
+			throw std::runtime_error("the producer does not publish a track named \"" + name + "\"");
+		}
+		
+		return index;
+	}
+	
+	//Retrieves a track that can be pulled, throwing std::runtime_error if the consumer cannot be pulled from
+	//(Only consumers constructed without delegates can be pulled, and only while they are not sampling on their own threads)
+	ConsumerTrack& pullableTrack(const std::unique_ptr<ConsumerThreads>& threads, std::vector< std::unique_ptr<ConsumerTrack> >& tracks, uint32_t index)
+	{
+		if (threads == nullptr) {
+			throw std::runtime_error("only consumers constructed without delegates can be pulled from");
+		}
+		
+		if (threads->videoThread.joinable() == true) {
+			throw std::runtime_error("a consumer cannot be pulled from until stop() has been called");
+		}
+		
+		if (index >= tracks.size()) {
+			throw std::runtime_error("the producer does not publish a track with index " + std::to_string(index));
+		}
+		
+		return *tracks[index];
+	}
+}
+
+MediaConsumer::MediaConsumer(const std::string& prefix, std::unique_ptr<ConsumerDelegate>&& delegate, SamplingMode mode, const ConsumerOptions& options)
+{
+	this->mode = mode;
+	this->attach(prefix, options);
+	this->subscribe(0, std::move(delegate));
+	this->run();
+}
+
+MediaConsumer::MediaConsumer(const std::string& prefix, std::map< std::string, std::unique_ptr<ConsumerDelegate> >&& delegates, SamplingMode mode, const ConsumerOptions& options)
+{
+	this->mode = mode;
+	this->attach(prefix, options);
+	
+	//Subscribe each delegate to the track with the corresponding name
+	for (auto& pair : delegates) {
+		this->subscribe(trackIndex(*this->layout, pair.first), std::move(pair.second));
 	}
 	
-	MutexWrapperPtr consumerMutex(const std::string& name) {
-		return MemoryUtils::toPointer(IPCUtils::getNamedMutex(name, false));
+	this->run();
+}
+
+MediaConsumer::MediaConsumer(const std::string& prefix, const ConsumerOptions& options)
+{
+	this->mode = SamplingMode::Notification;
+	this->attach(prefix, options);
+	
+	//Subscribe to every track without a delegate, and prepare each one to be pulled from
+	high_resolution_clock::time_point now = high_resolution_clock::now();
+	for (uint32_t index = 0; index < this->layout->tracks.size(); ++index)
+	{
+		this->subscribe(index, nullptr);
+		ConsumerTrack& track = *this->tracks.back();
+		prepareVideo(track, track.controlBlock, now);
+		prepareAudio(track, track.controlBlock, now);
+		track.cursor = track.ringBuffer->writeIndex();
 	}
+	
+	//We remain registered with the producer until we are destroyed
+	this->threads.reset(new ConsumerThreads());
+	this->threads->stopping = false;
+	this->claimCounters();
 }
 
-MediaConsumer::MediaConsumer(const std::string& prefix, std::unique_ptr<ConsumerDelegate>&& delegate)
+MediaConsumer::~MediaConsumer()
 {
-	//Take ownership of the supplied delegate
-	this->delegate = std::move(delegate);
+	//Only consumers constructed without delegates are still attached by the time they are destroyed
+	if (this->threads != nullptr)
+	{
+		this->stop();
+		this->releaseCounters();
+		this->doorbell.reset();
+	}
+}
+
+bool MediaConsumer::producerPresent(const std::string& prefix)
+{
+	//The control block exists for the lifetime of the producer, and its status flag remains set until the producer stops streaming
+	//(A producer that crashed never clears the flag, so we also check that its process is still running)
+	ObjectNames names(prefix);
+	MemoryWrapper memory = IPCUtils::tryGetMemory(names.controlBlockMemory, ipc::read_only);
+	if (memory.mapped == nullptr || memory.mapped->get_size() < SharedState::controlBlockMemorySize()) {
+		return false;
+	}
 	
-	//Resolve the names of our shared memory objects and mutexes
+	bool active = false;
+	std::memcpy(&active, &(((const ControlBlock*)(memory.mapped->get_address()))->active), sizeof(bool));
+	return (active == true && SharedState::locate(memory.mapped->get_address())->producerRunning() == true);
+}
+
+std::vector<Track> MediaConsumer::publishedTracks(const std::string& prefix, const ConsumerOptions& options)
+{
+	//Attach to the control block in the same manner as attach(), but without opening the buffers
 	ObjectNames names(prefix);
+	std::chrono::steady_clock::time_point deadline = attachDeadline(options.attachTimeout);
+	MemoryWrapperPtr memory = consumerMemory(names.controlBlockMemory, ipc::read_write, options.attachTimeout);
+	ControlBlock* controlBlock = (ControlBlock*)(memory->mapped->get_address());
+	SharedState* sharedState = SharedState::locate(controlBlock);
+	if (sharedState->statusMutex.waitUntilReady(attachTimeRemaining(deadline)) == false) {
+		throw std::runtime_error("timed out waiting for the producer with prefix \"" + prefix + "\" to initialise its shared state");
+	}
 	
-	//Wait for all of the shared memory objects to exist before dealing with the mutexes
-	//(This gives the producer a chance to populate the initial values before the consumer can acquire any locks)
-	this->controlBlockMemory = consumerMemory(names.controlBlockMemory);
-	this->videoFrontBuffer = consumerMemory(names.videoFrontBuffer);
-	this->videoBackBuffer = consumerMemory(names.videoBackBuffer);
-	this->audioBuffer = consumerMemory(names.audioBuffer);
-	
-	//Retrieve the named mutexes
-	this->statusMutex = consumerMutex(names.statusMutex);
-	this->videoMutex = consumerMutex(names.videoMutex);
-	this->frontBufferMutex = consumerMutex(names.frontBufferMutex);
-	this->backBufferMutex = consumerMutex(names.backBufferMutex);
-	this->audioMutex = consumerMutex(names.audioMutex);
-	
-	//Point our control block pointer to the shared memory containing the data
+	ConsumerLayout layout;
+	{
+		MutexLock lock(sharedState->statusMutex);
+		copyLayout(layout, controlBlock, sharedState);
+	}
+	
+	std::vector<Track> tracks;
+	for (const TrackLayout& track : layout.tracks) {
+		tracks.push_back(Track(track.name, track.controlBlock));
+	}
+	
+	return tracks;
+}
+
+void MediaConsumer::attach(const std::string& prefix, const ConsumerOptions& options)
+{
+	//Resolve the names of our shared memory objects
+	ObjectNames names(prefix);
+	this->prefix = prefix;
+	
+	//Wait for the control block shared memory to exist, and for the producer to initialise the status mutex that follows it
+	//(The producer holds the status mutex from when it initialises it until all of its buffers are populated,
+	//so once the mutex is ready, acquiring it guarantees that the initial values are in place)
+	//(Note that the control block is mapped read-write, since waiting on events and locking the mutex modifies its state)
+	//(If the producer does not appear before our attach timeout elapses then this throws std::runtime_error)
+	std::chrono::steady_clock::time_point deadline = attachDeadline(options.attachTimeout);
+	this->controlBlockMemory = consumerMemory(names.controlBlockMemory, ipc::read_write, options.attachTimeout);
 	this->controlBlock = (ControlBlock*)(this->controlBlockMemory->mapped->get_address());
+	this->sharedState = SharedState::locate(this->controlBlock);
+	if (this->sharedState->statusMutex.waitUntilReady(attachTimeRemaining(deadline)) == false) {
+		throw std::runtime_error("timed out waiting for the producer with prefix \"" + prefix + "\" to initialise its shared state");
+	}
+	
+	//Retrieve a copy of the initial control block data and the names and parameters of each track, and open the video and
+	//audio buffers while the producer cannot recreate them
+	//(Note that the video memory is mapped read-write, since pinning frames modifies its state)
+	//(The buffers are waited for within whatever remains of our attach timeout, so a producer that dies before creating them cannot stall us)
+	this->layout.reset(new ConsumerLayout());
+	const ConsumerLayout& layout = *this->layout;
+	{
+		MutexLock lock(this->sharedState->statusMutex);
+		copyLayout(*this->layout, this->controlBlock, this->sharedState);
+		this->videoBuffer = consumerBuffer(names.videoBuffer, layout.videoBufferGeneration, ipc::read_write, layout.controlBlock.videoBacking, attachTimeRemaining(deadline));
+		this->audioBuffer = consumerBuffer(names.audioBuffer, layout.audioBufferGeneration, ipc::read_only, layout.controlBlock.audioBacking, attachTimeRemaining(deadline));
+	}
+	
+	this->videoGeneration = layout.generation;
+	this->audioGeneration = layout.generation;
+	this->videoBufferGeneration = layout.videoBufferGeneration;
+	this->audioBufferGeneration = layout.audioBufferGeneration;
 	
-	//Wrap our ring buffer interface around the audio buffer
-	this->ringBuffer.reset(new RingBuffer(
-		(uint8_t*)(this->audioBuffer->mapped->get_address()),
-		this->audioBuffer->mapped->get_size(),
-		&(this->controlBlock->ringHead
-	)));
+	//If the producer requested it, fault in every page of the buffers now so that the first frames do not pay page fault costs
+	if (layout.controlBlock.prefault == true)
+	{
+		IPCUtils::prefaultMemory(*this->videoBuffer->mapped, true);
+		IPCUtils::prefaultMemory(*this->audioBuffer->mapped, false);
+	}
 	
-	//Pass a copy of the initial control block data to our delegate
-	ControlBlock cbTemp;
+	//Wrap our frame ring and ring buffer interfaces around the video and audio buffers of each track
+	for (uint32_t index = 0; index < layout.tracks.size(); ++index)
 	{
-		MutexLock lock(*this->statusMutex->mutex);
-		std::memcpy(&cbTemp, this->controlBlock, sizeof(ControlBlock));
+		this->frameRings.push_back(wrapFrameRing(*this->videoBuffer, layout.tracks[index]));
+		this->ringBuffers.push_back(wrapRingBuffer(*this->audioBuffer, layout.tracks[index], this->sharedState->tracks[index]));
+	}
+}
+
+void MediaConsumer::subscribe(uint32_t index, std::unique_ptr<ConsumerDelegate>&& delegate)
+{
+	const TrackLayout& layout = this->layout->tracks.at(index);
+	std::unique_ptr<ConsumerTrack> track(new ConsumerTrack());
+	track->index = index;
+	track->delegate = std::move(delegate);
+	track->controlBlock = layout.controlBlock;
+	track->generation = layout.generation;
+	track->frameRing = this->frameRings[index].get();
+	track->ringBuffer = this->ringBuffers[index].get();
+	track->videoGeneration = layout.generation;
+	track->videoOffset = layout.videoOffset;
+	track->hasVideo = false;
+	track->lastSequence = 0;
+	track->damageBase = 0;
+	track->audioGeneration = layout.generation;
+	track->audioOffset = layout.audioOffset;
+	track->hasAudio = false;
+	track->cursor = 0;
+	track->requestedAudioFormat = ((track->delegate != nullptr) ? track->delegate->requestedAudioFormat() : AudioFormat::None);
+	track->receivesPlanarAudio = ((track->delegate != nullptr) ? track->delegate->receivesPlanarAudio() : false);
+	track->convertsAudio = false;
+	this->tracks.push_back(std::move(track));
+}
+
+void MediaConsumer::run()
+{
+	//Run our sampling loops until the stream ends, remaining registered with the producer while they run
+	this->threads.reset(new ConsumerThreads());
+	this->claimCounters();
+	this->startThreads(this->mode);
+	this->threads->audioThread.join();
+	this->threads->videoThread.join();
+	this->releaseCounters();
+	
+	//Our consumer cannot be started or pulled from once the constructor returns
+	this->threads.reset();
+}
+
+void MediaConsumer::claimCounters()
+{
+	//Fall back to a private set if every set in shared memory is already claimed (in which case we only record our process
+	//ID, so the producer still knows we are attached and can tell if we exit without detaching)
+	Telemetry& telemetry = this->sharedState->telemetry;
+	this->counters = telemetry.claimConsumer();
+	this->unregisteredEntry = UINT32_MAX;
+	if (this->counters == nullptr)
+	{
+		this->counters = &detachedCounters;
+		this->unregisteredEntry = telemetry.addUnregisteredConsumer();
+	}
+}
+
+void MediaConsumer::releaseCounters()
+{
+	Telemetry& telemetry = this->sharedState->telemetry;
+	if (this->counters != &detachedCounters) {
+		telemetry.releaseConsumer(this->counters);
+	}
+	else
+	{
+		telemetry.removeUnregisteredConsumer(this->unregisteredEntry);
+		this->unregisteredEntry = UINT32_MAX;
+	}
+	
+	//Any further updates go to the private set, since the producer may hand our counters to another consumer
+	this->counters = &detachedCounters;
+}
+
+void MediaConsumer::startThreads(SamplingMode mode)
+{
+	//Pass the current parameters of each track to its delegate
+	this->mode = mode;
+	this->threads->stopping = false;
+	for (auto& track : this->tracks) {
+		passControlBlock(*track);
 	}
-	this->delegate->controlBlockReceived(cbTemp);
 	
 	//Start our sampling loops
-	std::thread audioThread(std::bind(&MediaConsumer::audioLoop, this));
-	std::thread videoThread(std::bind(&MediaConsumer::videoLoop, this));
-	audioThread.join();
-	videoThread.join();
+	this->threads->audioThread = std::thread(std::bind(&MediaConsumer::audioLoop, this));
+	this->threads->videoThread = std::thread(std::bind(&MediaConsumer::videoLoop, this));
+}
+
+void MediaConsumer::start(std::unique_ptr<ConsumerDelegate>&& delegate, SamplingMode mode)
+{
+	std::map< std::string, std::unique_ptr<ConsumerDelegate> > delegates;
+	delegates[this->layout->tracks.front().name] = std::move(delegate);
+	this->start(std::move(delegates), mode);
+}
+
+void MediaConsumer::start(std::map< std::string, std::unique_ptr<ConsumerDelegate> >&& delegates, SamplingMode mode)
+{
+	if (this->threads == nullptr) {
+		throw std::runtime_error("only consumers constructed without delegates can be started");
+	}
+	
+	if (this->threads->videoThread.joinable() == true) {
+		throw std::runtime_error("the consumer has already been started");
+	}
+	
+	this->bindDelegates(std::move(delegates));
+	this->startThreads(mode);
+}
+
+void MediaConsumer::bindDelegates(std::map< std::string, std::unique_ptr<ConsumerDelegate> >&& delegates)
+{
+	//Resolve every track name before we modify anything
+	std::vector<uint32_t> indices;
+	for (auto& pair : delegates) {
+		indices.push_back(trackIndex(*this->layout, pair.first));
+	}
+	
+	//Apply any reconfigurations that have not been pulled yet, so that our delegates receive the current parameters
+	uint64_t generation = this->sharedState->generation.load(std::memory_order_acquire);
+	if (generation != this->videoGeneration) {
+		this->refreshVideo();
+	}
+	
+	if (generation != this->audioGeneration) {
+		this->refreshAudio();
+	}
+	
+	//Hand each delegate its track
+	auto index = indices.begin();
+	for (auto& pair : delegates)
+	{
+		ConsumerTrack& track = *this->tracks[*index++];
+		track.delegate = std::move(pair.second);
+		track.requestedAudioFormat = track.delegate->requestedAudioFormat();
+		track.receivesPlanarAudio = track.delegate->receivesPlanarAudio();
+	}
 }
 
-//Needed so that client code doesn't require definitions for our forward-declared types
-MediaConsumer::~MediaConsumer() {}
+void MediaConsumer::beginDispatch()
+{
+	//Prepare every track to be sampled with the parameters its delegate receives, starting with the samples published from now on
+	this->mode = SamplingMode::Notification;
+	high_resolution_clock::time_point now = high_resolution_clock::now();
+	for (auto& track : this->tracks)
+	{
+		passControlBlock(*track);
+		prepareVideo(*track, track->controlBlock, now);
+		prepareAudio(*track, track->controlBlock, now);
+		track->cursor = std::max(track->cursor, track->ringBuffer->writeIndex());
+	}
+}
 
-bool MediaConsumer::streamIsActive()
+bool MediaConsumer::dispatch()
+{
+	//Move to the new rings of any reconfigured tracks, passing the new parameters to our delegates
+	this->counters->beat();
+	uint64_t generation = this->sharedState->generation.load(std::memory_order_acquire);
+	if (generation != this->videoGeneration) {
+		this->refreshVideo();
+	}
+	
+	if (generation != this->audioGeneration) {
+		this->refreshAudio();
+	}
+	
+	this->releaseRetiredRings();
+	
+	//Pass each new frame and every available buffer of samples to the delegates
+	//(Each call delivers at most one frame and one ring's worth of samples per track, which bounds the time it takes)
+	for (auto& track : this->tracks)
+	{
+		if (track->delegate == nullptr) {
+			continue;
+		}
+		
+		if (track->hasVideo == true && track->frameRing->latestSequence() != track->lastSequence) {
+			this->sampleVideo(*track);
+		}
+		
+		if (track->hasAudio == true) {
+			this->sampleAudio(*track);
+		}
+	}
+	
+	return this->streamActive();
+}
+
+void MediaConsumer::stop()
+{
+	if (this->threads == nullptr || this->threads->videoThread.joinable() == false) {
+		return;
+	}
+	
+	//Our sampling loops check the flag on each iteration, so they finish within one sampling interval
+	this->threads->stopping = true;
+	this->threads->audioThread.join();
+	this->threads->videoThread.join();
+	
+	//Release the delegates and prepare every track to be pulled from again, starting with the samples published from now on
+	high_resolution_clock::time_point now = high_resolution_clock::now();
+	for (auto& track : this->tracks)
+	{
+		track->delegate.reset();
+		track->requestedAudioFormat = AudioFormat::None;
+		track->receivesPlanarAudio = false;
+		prepareVideo(*track, track->controlBlock, now);
+		prepareAudio(*track, track->controlBlock, now);
+		track->cursor = std::max(track->cursor, track->ringBuffer->writeIndex());
+	}
+}
+
+int MediaConsumer::descriptor()
+{
+	//Only consumers that hold a registry slot can register a doorbell with the producer
+	if (this->doorbell == nullptr && this->threads != nullptr && this->counters != &detachedCounters)
+	{
+		try
+		{
+			this->lastVideoEvent = this->sharedState->videoEvent.current();
+			this->lastAudioEvent = this->sharedState->audioEvent.current();
+			this->doorbell.reset(new Doorbell(this->sharedState->telemetry, this->counters));
+		}
+		catch (std::runtime_error&) {
+			return -1;
+		}
+	}
+	
+	return ((this->doorbell != nullptr) ? this->doorbell->descriptor() : -1);
+}
+
+bool MediaConsumer::prepareWait()
+{
+	if (this->descriptor() == -1) {
+		return false;
+	}
+	
+	//Arm the doorbell before checking for publications, so that anything published after the check rings it
+	this->doorbell->drain();
+	this->doorbell->arm();
+	uint32_t videoEvent = this->sharedState->videoEvent.current();
+	uint32_t audioEvent = this->sharedState->audioEvent.current();
+	bool idle = (videoEvent == this->lastVideoEvent && audioEvent == this->lastAudioEvent);
+	this->lastVideoEvent = videoEvent;
+	this->lastAudioEvent = audioEvent;
+	return idle;
+}
+
+bool MediaConsumer::streamActive()
 {
 	bool active = false;
 	{
-		MutexLock lock(*this->statusMutex->mutex);
+		InstrumentedMutexLock lock(this->sharedState->statusMutex, this->counters->statusLockContentions, this->counters->statusLockWaitNanoseconds);
 		std::memcpy(&active, &(this->controlBlock->active), sizeof(bool));
 	}
-	return active;
+	
+	//A producer that crashed never clears its status flag, so the stream also ends once its process has exited
+	return (active == true && this->sharedState->producerRunning() == true);
 }
 
-void MediaConsumer::videoLoop()
+bool MediaConsumer::streamIsActive() {
+	return (this->threads->stopping == false && this->streamActive() == true);
+}
+
+std::vector<Track> MediaConsumer::trackParameters() const
 {
-	//Don't bother sampling anything if no video data is being transmitted
-	if (this->controlBlock->videoFormat == VideoFormat::None) {
-		return;
+	std::vector<Track> parameters;
+	for (auto& track : this->tracks)
+	{
+		std::lock_guard<std::mutex> lock(track->reconfigureMutex);
+		parameters.push_back(Track(this->layout->tracks[track->index].name, track->controlBlock));
+	}
+	
+	return parameters;
+}
+
+ConsumerTrack& MediaConsumer::pullVideo(uint32_t track)
+{
+	//Let the producer know we are still running, and move to the new frame rings if the producer has reconfigured any tracks
+	ConsumerTrack& pulled = pullableTrack(this->threads, this->tracks, track);
+	this->counters->beat();
+	if (this->sharedState->generation.load(std::memory_order_acquire) != this->videoGeneration) {
+		this->refreshVideo();
+	}
+	
+	this->releaseRetiredRings();
+	return pulled;
+}
+
+ConsumerTrack& MediaConsumer::pullAudio(uint32_t track)
+{
+	ConsumerTrack& pulled = pullableTrack(this->threads, this->tracks, track);
+	this->counters->beat();
+	if (this->sharedState->generation.load(std::memory_order_acquire) != this->audioGeneration) {
+		this->refreshAudio();
 	}
 	
-	//Allocate memory to hold the last sampled video framebuffer
-	uint32_t videoBufsize = this->videoFrontBuffer->mapped->get_size();
-	std::unique_ptr<uint8_t[]> videoTempBuf(new uint8_t[videoBufsize]);
+	return pulled;
+}
+
+bool MediaConsumer::tryGetLatestVideoFrame(VideoFrameView& view, uint32_t track)
+{
+	//Return immediately if the track has not published a frame since the previous call
+	ConsumerTrack& pulled = this->pullVideo(track);
+	if (pulled.hasVideo == false || pulled.frameRing->latestSequence() == pulled.lastSequence) {
+		return false;
+	}
 	
-	//Determine our sampling frequency
-	auto samplingFrequency = this->controlBlock->calculateVideoInterval();
+	uint32_t slot = 0;
+	uint32_t owner = pinOwner(this->sharedState->telemetry, this->counters);
+	uint64_t sequence = pulled.frameRing->pin(slot, owner);
+	if (sequence == 0) {
+		return false;
+	}
 	
-	//Determine our starting time
-	high_resolution_clock::time_point lastSample = high_resolution_clock::now();
-	high_resolution_clock::time_point nextSample = lastSample;
+	//Determine what changed since the previous frame we returned
+	pulled.frameRing->damageSince(pulled.damageBase, sequence, pulled.damageList);
+	pulled.damageList.toFrameDamage(pulled.damage);
+	pulled.damageBase = sequence;
 	
-	//Loop until the producer stops streaming data
+	view = VideoFrameView(pulled.frameRing, slot, owner, sequence, pulled.videoBufsize, pulled.damage);
+	this->countVideoFrame(pulled, sequence);
+	return true;
+}
+
+bool MediaConsumer::tryGetLatestVideoFrame(uint8_t* buffer, uint64_t length, FrameInfo& info, uint32_t track)
+{
+	ConsumerTrack& pulled = this->pullVideo(track);
+	if (pulled.hasVideo == false || pulled.frameRing->latestSequence() == pulled.lastSequence) {
+		return false;
+	}
+	
+	if (length < pulled.videoBufsize) {
+		throw std::runtime_error("the buffer is smaller than a video frame of the track");
+	}
+	
+	//The caller's buffer may not hold the previous frame, so the whole frame is copied
+	uint64_t sequence = pulled.frameRing->read(buffer, pulled.videoBufsize, &info);
+	if (sequence == 0) {
+		return false;
+	}
+	
+	countEvent(this->counters->videoBytesCopied, pulled.videoBufsize);
+	pulled.damageBase = sequence;
+	this->countVideoFrame(pulled, sequence);
+	return true;
+}
+
+uint64_t MediaConsumer::readAudio(uint8_t* buffer, uint64_t length, std::chrono::microseconds timeout, uint32_t track)
+{
+	FrameInfo info;
+	return this->readAudio(buffer, length, timeout, info, track);
+}
+
+uint64_t MediaConsumer::readAudio(uint8_t* buffer, uint64_t length, std::chrono::microseconds timeout, FrameInfo& info, uint32_t track)
+{
+	high_resolution_clock::time_point began = high_resolution_clock::now();
+	while (true)
+	{
+		//We only ever read whole frames, and never more than the ring can hold
+		ConsumerTrack& pulled = this->pullAudio(track);
+		uint64_t frameSize = (uint64_t)(pulled.audioChannels) * FormatDetails::bytesPerSample(pulled.publishedAudioFormat);
+		if (pulled.hasAudio == false || frameSize == 0) {
+			return 0;
+		}
+		
+		uint64_t capacity = pulled.ringBuffer->capacity();
+		uint64_t requested = (std::min(length, capacity) / frameSize) * frameSize;
+		
+		//Check the notification counter before the write index, so that we cannot miss a publication between the two
+		uint32_t lastEvent = this->sharedState->audioEvent.current();
+		uint64_t available = std::min(pulled.ringBuffer->available(pulled.cursor), capacity);
+		
+		//Wait for more samples unless we have enough, the timeout has elapsed or the stream has ended
+		//(We wake periodically to check that the stream is still active)
+		auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(high_resolution_clock::now() - began);
+		if (available < requested && elapsed < timeout && this->streamActive() == true)
+		{
+			this->sharedState->audioEvent.wait(lastEvent, std::min(timeout - elapsed, idleInterval));
+			continue;
+		}
+		
+		uint64_t bytes = std::min(requested, (available / frameSize) * frameSize);
+		if (bytes == 0) {
+			return 0;
+		}
+		
+		//Read the samples, skipping any that were overwritten before we could read them
+		uint64_t previous = pulled.cursor;
+		uint64_t bytesLost = 0;
+		bool success = pulled.ringBuffer->read(pulled.cursor, buffer, bytes, bytesLost);
+		
+		//If the producer has moved the ring since we last checked then the samples may belong to its replacement, so move to the
+		//new ring and try again
+		//(Any samples that were skipped are skipped again by the retry, so they are only reported as lost once it succeeds)
+		if (this->sharedState->generation.load(std::memory_order_acquire) != this->audioGeneration)
+		{
+			pulled.cursor = previous;
+			continue;
+		}
+		
+		//If the producer overwrote the samples while we were copying them then our cursor has already skipped past them, so try
+		//again with whatever samples remain (waiting for more if our timeout has not yet elapsed)
+		countEvent(this->counters->audioBytesLost, bytesLost);
+		if (success == false) {
+			continue;
+		}
+		
+		//Retrieve the metadata for the block containing the first sample we read
+		//(The block's record may already have been replaced if the producer has since written many smaller blocks)
+		if (pulled.ringBuffer->blockInfo(pulled.cursor - bytes, info) == false) {
+			info = FrameInfo();
+		}
+		
+		if (info.sequence != 0) {
+			this->counters->lastAudioSequence.store(info.sequence, std::memory_order_relaxed);
+		}
+		
+		countEvent(this->counters->audioBuffersConsumed);
+		countEvent(this->counters->audioBytesCopied, bytes);
+		return bytes;
+	}
+}
+
+void MediaConsumer::videoLoop()
+{
+	//Prepare each track for sampling using the parameters its delegate last received
+	//(Our starting time is the first sampling time point for every track)
+	high_resolution_clock::time_point start = high_resolution_clock::now();
+	for (auto& track : this->tracks) {
+		prepareVideo(*track, track->controlBlock, start);
+	}
+	
+	//Don't bother sampling anything for tracks that do not transmit video, and determine the shortest sampling interval across the rest
+	std::chrono::microseconds shortestInterval = idleInterval;
+	std::vector<ConsumerTrack*> tracks = selectTracks(this->tracks, true, shortestInterval);
+	recordSamplingInterval(this->counters->videoSamplingInterval, this->mode, tracks, shortestInterval);
+	
+	//Keep track of the last notification we received
+	uint32_t lastEvent = this->sharedState->videoEvent.current();
+	
+	//Loop until the producer stops streaming data, letting the producer know we are still running on each iteration
 	while (this->streamIsActive() == true)
 	{
-		//Determine the time point for the next sampling iteration
-		lastSample = nextSample;
-		nextSample = lastSample + samplingFrequency;
+		this->counters->beat();
+		
+		//If the producer has reconfigured any tracks then move to their new frame rings and pass the new parameters to our delegates
+		if (this->sharedState->generation.load(std::memory_order_acquire) != this->videoGeneration)
+		{
+			this->refreshVideo();
+			tracks = selectTracks(this->tracks, true, shortestInterval);
+			recordSamplingInterval(this->counters->videoSamplingInterval, this->mode, tracks, shortestInterval);
+		}
 		
-		//Determine which video framebuffer to use
-		VideoBuffer bufToUse = VideoBuffer::FrontBuffer;
+		this->releaseRetiredRings();
+		
+		//If none of our tracks transmit video then just wait for the producer to reconfigure them or stop streaming
+		if (tracks.empty() == true)
 		{
-			MutexLock lock(*this->videoMutex->mutex);
-			bufToUse = this->controlBlock->lastBuffer;
+			this->sharedState->videoEvent.wait(lastEvent, shortestInterval);
+			lastEvent = this->sharedState->videoEvent.current();
+			continue;
 		}
 		
-		//Sample the video framebuffer
+		if (this->mode == SamplingMode::Notification)
+		{
+			//Wait until the producer publishes a new frame on any track (waking periodically to check that the stream is still active)
+			if (this->sharedState->videoEvent.wait(lastEvent, shortestInterval) == false) {
+				continue;
+			}
+			
+			//Sample each track that has published a frame we have not yet sampled
+			lastEvent = this->sharedState->videoEvent.current();
+			for (ConsumerTrack* track : tracks)
+			{
+				if (track->frameRing->latestSequence() != track->lastSequence) {
+					this->sampleVideo(*track);
+				}
+			}
+		}
+		else
 		{
-			auto& mutex = (bufToUse == VideoBuffer::FrontBuffer) ? this->frontBufferMutex : this->backBufferMutex;
-			auto& source = (bufToUse == VideoBuffer::FrontBuffer) ? this->videoFrontBuffer : this->videoBackBuffer;
+			//Sample each track whose sampling time point has arrived, and determine the time point for its next iteration
+			high_resolution_clock::time_point now = high_resolution_clock::now();
+			high_resolution_clock::time_point nextSample = high_resolution_clock::time_point::max();
+			for (ConsumerTrack* track : tracks)
+			{
+				if (track->nextVideoSample <= now)
+				{
+					track->nextVideoSample += track->videoInterval;
+					this->sampleVideo(*track);
+				}
+				
+				nextSample = std::min(nextSample, track->nextVideoSample);
+			}
 			
-			MutexLock lock(*mutex->mutex);
-			std::memcpy(videoTempBuf.get(), source->mapped->get_address(), videoBufsize);
+			//Sleep until the next track is due to be sampled
+			std::this_thread::sleep_until(nextSample);
 		}
+	}
+}
+
+void MediaConsumer::refreshVideo()
+{
+	//Copy the track table, opening the new video buffer if the producer has recreated it
+	ConsumerLayout layout;
+	MemoryWrapperPtr buffer;
+	{
+		InstrumentedMutexLock lock(this->sharedState->statusMutex, this->counters->statusLockContentions, this->counters->statusLockWaitNanoseconds);
+		copyLayout(layout, this->controlBlock, this->sharedState);
+		if (layout.videoBufferGeneration != this->videoBufferGeneration) {
+			buffer = consumerBuffer(ObjectNames(this->prefix).videoBuffer, layout.videoBufferGeneration, ipc::read_write, layout.controlBlock.videoBacking);
+		}
+	}
+	
+	//Replace our frame ring interfaces, retiring the old rings and buffer rather than releasing them
+	//(Our delegates may still hold views of frames in the old rings, which the producer never modifies once they have moved)
+	bool remapped = (buffer != nullptr);
+	if (remapped == true)
+	{
+		if (layout.controlBlock.prefault == true) {
+			IPCUtils::prefaultMemory(*buffer->mapped, true);
+		}
+		
+		this->retiredBuffers.push_back(std::move(this->videoBuffer));
+		this->videoBuffer = std::move(buffer);
+		this->videoBufferGeneration = layout.videoBufferGeneration;
+	}
+	
+	for (uint32_t index = 0; index < this->frameRings.size(); ++index)
+	{
+		this->retiredRings.push_back(std::move(this->frameRings[index]));
+		this->frameRings[index] = wrapFrameRing(*this->videoBuffer, layout.tracks[index]);
+	}
+	
+	//Pass the parameters of each reconfigured track to its delegate before we sample any frames that use them
+	high_resolution_clock::time_point now = high_resolution_clock::now();
+	for (auto& track : this->tracks)
+	{
+		const TrackLayout& trackLayout = layout.tracks[track->index];
+		track->frameRing = this->frameRings[track->index].get();
+		if (trackLayout.generation != track->videoGeneration)
+		{
+			deliverControlBlock(*track, trackLayout);
+			prepareVideo(*track, trackLayout.controlBlock, now);
+			track->videoGeneration = trackLayout.generation;
+		}
+		
+		//A ring that has moved starts again from the first sequence number
+		if (remapped == true || trackLayout.videoOffset != track->videoOffset)
+		{
+			track->videoOffset = trackLayout.videoOffset;
+			track->lastSequence = 0;
+			track->damageBase = 0;
+		}
+	}
+	
+	this->videoGeneration = layout.generation;
+}
+
+void MediaConsumer::releaseRetiredRings()
+{
+	for (auto& ring : this->retiredRings)
+	{
+		if (ring->pinnedLocally() == true) {
+			return;
+		}
+	}
+	
+	this->retiredRings.clear();
+	this->retiredBuffers.clear();
+}
+
+void MediaConsumer::sampleVideo(ConsumerTrack& track)
+{
+	uint64_t sequence = 0;
+	if (track.receivesViews == true)
+	{
+		//Pin the most recently published video frame and pass a view of it to our delegate
+		//(Nothing is passed to our delegate until the producer publishes its first frame)
+		uint32_t slot = 0;
+		uint32_t owner = pinOwner(this->sharedState->telemetry, this->counters);
+		sequence = track.frameRing->pin(slot, owner);
+		if (sequence != 0)
+		{
+			//Determine what changed since the previous view we passed to our delegate
+			track.frameRing->damageSince(track.damageBase, sequence, track.damageList);
+			track.damageList.toFrameDamage(track.damage);
+			track.damageBase = sequence;
+			
+			VideoFrameView view(track.frameRing, slot, owner, sequence, track.videoBufsize, track.damage);
+			track.delegate->videoFrameViewReceived(view);
+		}
+	}
+	else
+	{
+		//Copy only the regions of the most recently published video frame that changed since the frame our buffer holds
+		//(Nothing is copied when the frame has not changed, and the whole frame is copied if the changes are unknown)
+		FrameInfo info;
+		uint64_t copied = 0;
+		sequence = track.frameRing->readDelta(track.videoTempBuf.get(), track.damageBase, track.copier, track.damageList, &info, copied);
+		if (sequence == track.damageBase) {
+			info = track.damageBaseInfo;
+		}
+		
+		countEvent(this->counters->videoBytesCopied, copied);
+		track.damageList.toFrameDamage(track.damage);
+		track.damageBase = sequence;
+		track.damageBaseInfo = info;
 		
 		//Pass the sampled data to our delegate
-		this->delegate->videoFrameReceived((const uint8_t*)(videoTempBuf.get()), videoBufsize);
+		track.delegate->videoFrameDamageReceived((const uint8_t*)(track.videoTempBuf.get()), track.videoBufsize, info, track.damage);
+	}
+	
+	this->countVideoFrame(track, sequence);
+}
+
+void MediaConsumer::countVideoFrame(ConsumerTrack& track, uint64_t sequence)
+{
+	if (sequence != 0)
+	{
+		if (sequence == track.lastSequence) {
+			countEvent(this->counters->videoDuplicates);
+		}
+		else
+		{
+			countEvent(this->counters->videoFramesConsumed);
+			if (track.lastSequence != 0 && sequence > track.lastSequence + 1) {
+				countEvent(this->counters->videoFramesSkipped, sequence - (track.lastSequence + 1));
+			}
+		}
 		
-		//Sleep until our next iteration
-		std::this_thread::sleep_until(nextSample);
+		track.lastSequence = sequence;
+		this->counters->lastVideoSequence.store(sequence, std::memory_order_relaxed);
 	}
 }
 
 void MediaConsumer::audioLoop()
 {
-	//Don't bother sampling anything if no audio data is being transmitted
-	if (this->controlBlock->audioFormat == AudioFormat::None) {
-		return;
+	//Prepare each track for sampling using the parameters its delegate last received
+	high_resolution_clock::time_point start = high_resolution_clock::now();
+	for (auto& track : this->tracks)
+	{
+		prepareAudio(*track, track->controlBlock, start);
+		
+		//Start our read cursor at the current write index, so that we only receive samples published after we attached
+		track->cursor = track->ringBuffer->writeIndex();
 	}
 	
-	//Allocate memory to hold the last sampled audio samples
-	uint32_t audioBufsize = this->audioBuffer->mapped->get_size();
-	std::unique_ptr<uint8_t[]> audioTempBuf(new uint8_t[audioBufsize]);
-	
-	//Determine our sampling frequency
-	auto samplingFrequency = this->controlBlock->calculateAudioInterval();
+	//Don't bother sampling anything for tracks that do not transmit audio, and determine the shortest sampling interval across the rest
+	std::chrono::microseconds shortestInterval = idleInterval;
+	std::vector<ConsumerTrack*> tracks = selectTracks(this->tracks, false, shortestInterval);
+	recordSamplingInterval(this->counters->audioSamplingInterval, this->mode, tracks, shortestInterval);
 	
-	//Determine our starting time
-	high_resolution_clock::time_point lastSample = high_resolution_clock::now();
-	high_resolution_clock::time_point nextSample = lastSample;
+	//Keep track of the last notification we received
+	uint32_t lastEvent = this->sharedState->audioEvent.current();
 	
-	//Loop until the producer stops streaming data
+	//Loop until the producer stops streaming data, letting the producer know we are still running on each iteration
 	while (this->streamIsActive() == true)
 	{
-		//Determine the time point for the next sampling iteration
-		lastSample = nextSample;
-		nextSample = lastSample + samplingFrequency;
+		this->counters->beat();
 		
-		//Sample the audio buffer
+		//If the producer has reconfigured any tracks then move to their new sample rings and pass the new parameters to our delegates
+		if (this->sharedState->generation.load(std::memory_order_acquire) != this->audioGeneration)
 		{
-			MutexLock lock(*this->audioMutex->mutex);
-			this->ringBuffer->read(audioTempBuf.get(), audioBufsize);
+			this->refreshAudio();
+			tracks = selectTracks(this->tracks, false, shortestInterval);
+			recordSamplingInterval(this->counters->audioSamplingInterval, this->mode, tracks, shortestInterval);
 		}
 		
-		//Pass the sampled data to our delegate
-		this->delegate->audioSamplesReceived((const uint8_t*)(audioTempBuf.get()), audioBufsize);
+		//If none of our tracks transmit audio then just wait for the producer to reconfigure them or stop streaming
+		if (tracks.empty() == true)
+		{
+			this->sharedState->audioEvent.wait(lastEvent, shortestInterval);
+			lastEvent = this->sharedState->audioEvent.current();
+			continue;
+		}
+		
+		if (this->mode == SamplingMode::Notification)
+		{
+			//Wait until the producer publishes new samples on any track (waking periodically to check that the stream is still active)
+			if (this->sharedState->audioEvent.wait(lastEvent, shortestInterval) == false) {
+				continue;
+			}
+			
+			lastEvent = this->sharedState->audioEvent.current();
+			for (ConsumerTrack* track : tracks) {
+				this->sampleAudio(*track);
+			}
+		}
+		else
+		{
+			//Sample each track whose sampling time point has arrived, and determine the time point for its next iteration
+			high_resolution_clock::time_point now = high_resolution_clock::now();
+			high_resolution_clock::time_point nextSample = high_resolution_clock::time_point::max();
+			for (ConsumerTrack* track : tracks)
+			{
+				if (track->nextAudioSample <= now)
+				{
+					track->nextAudioSample += track->audioInterval;
+					this->sampleAudio(*track);
+				}
+				
+				nextSample = std::min(nextSample, track->nextAudioSample);
+			}
+			
+			//Sleep until the next track is due to be sampled
+			std::this_thread::sleep_until(nextSample);
+		}
+	}
+}
+
+void MediaConsumer::refreshAudio()
+{
+	//Copy the track table, opening the new audio buffer if the producer has recreated it
+	ConsumerLayout layout;
+	MemoryWrapperPtr buffer;
+	{
+		InstrumentedMutexLock lock(this->sharedState->statusMutex, this->counters->statusLockContentions, this->counters->statusLockWaitNanoseconds);
+		copyLayout(layout, this->controlBlock, this->sharedState);
+		if (layout.audioBufferGeneration != this->audioBufferGeneration) {
+			buffer = consumerBuffer(ObjectNames(this->prefix).audioBuffer, layout.audioBufferGeneration, ipc::read_only, layout.controlBlock.audioBacking);
+		}
+	}
+	
+	//Finish reading the complete buffers of samples that each moved ring received before it moved, using the old parameters
+	//(If we missed more than one reconfiguration then some of those samples were written to rings we never saw, so we skip them)
+	bool remapped = (buffer != nullptr);
+	for (auto& track : this->tracks)
+	{
+		const TrackLayout& trackLayout = layout.tracks[track->index];
+		bool moved = (remapped == true || trackLayout.audioOffset != track->audioOffset);
+		if (moved == true && track->hasAudio == true && track->delegate != nullptr && layout.generation == this->audioGeneration + 1) {
+			this->sampleAudio(*track, trackLayout.audioStartIndex);
+		}
+	}
+	
+	//Replace our ring buffer interfaces (nothing refers to the old audio buffer once we have finished reading it)
+	if (remapped == true)
+	{
+		if (layout.controlBlock.prefault == true) {
+			IPCUtils::prefaultMemory(*buffer->mapped, false);
+		}
+		
+		this->audioBuffer = std::move(buffer);
+		this->audioBufferGeneration = layout.audioBufferGeneration;
+	}
+	
+	for (uint32_t index = 0; index < this->ringBuffers.size(); ++index) {
+		this->ringBuffers[index] = wrapRingBuffer(*this->audioBuffer, layout.tracks[index], this->sharedState->tracks[index]);
+	}
+	
+	//Pass the parameters of each reconfigured track to its delegate before we sample any samples that use them
+	high_resolution_clock::time_point now = high_resolution_clock::now();
+	for (auto& track : this->tracks)
+	{
+		const TrackLayout& trackLayout = layout.tracks[track->index];
+		track->ringBuffer = this->ringBuffers[track->index].get();
+		if (trackLayout.generation != track->audioGeneration)
+		{
+			deliverControlBlock(*track, trackLayout);
+			prepareAudio(*track, trackLayout.controlBlock, now);
+			track->audioGeneration = trackLayout.generation;
+		}
 		
-		//Sleep until our next iteration
-		std::this_thread::sleep_until(nextSample);
+		//A ring that has moved starts at the write index the producer recorded when it moved it
+		if (remapped == true || trackLayout.audioOffset != track->audioOffset)
+		{
+			track->audioOffset = trackLayout.audioOffset;
+			track->cursor = std::max(track->cursor, trackLayout.audioStartIndex);
+		}
+	}
+	
+	this->audioGeneration = layout.generation;
+}
+
+void MediaConsumer::sampleAudio(ConsumerTrack& track, uint64_t limit)
+{
+	//Pass every complete buffer of samples that is available to our delegate, reporting any samples lost to overruns
+	bool received = false;
+	uint64_t bytesLost = 0;
+	while (track.cursor + track.audioBufsize <= limit)
+	{
+		uint64_t previous = track.cursor;
+		bool success = track.ringBuffer->read(track.cursor, track.audioTempBuf.get(), track.audioBufsize, bytesLost);
+		if (bytesLost > 0)
+		{
+			countEvent(this->counters->audioBytesLost, bytesLost);
+			track.delegate->audioOverrun(deliveredBytes(track, bytesLost));
+		}
+		
+		if (success == false) {
+			break;
+		}
+		
+		//If the producer has moved the ring since we last checked then the samples may belong to its replacement, so leave them
+		//to be read once we have moved to the new ring (or, when finishing the old ring, discard anything past its final sample)
+		bool moved = (limit == UINT64_MAX) ? (this->sharedState->generation.load(std::memory_order_acquire) != this->audioGeneration) : (track.cursor > limit);
+		if (moved == true)
+		{
+			track.cursor = (limit == UINT64_MAX) ? previous : limit;
+			return;
+		}
+		
+		//Retrieve the metadata for the block containing the first sample we read
+		//(The metadata is left empty if the producer has since recorded so many blocks that its record was overwritten)
+		FrameInfo info;
+		track.ringBuffer->blockInfo(track.cursor - track.audioBufsize, info);
+		
+		//Pass the samples to our delegate, converting them first if it requested a different format
+		if (track.convertsAudio == true)
+		{
+			convertAudio(track);
+			track.delegate->audioSamplesInfoReceived((const uint8_t*)(track.audioConvertedBuf.get()), track.convertedBufsize, info);
+		}
+		else {
+			track.delegate->audioSamplesInfoReceived((const uint8_t*)(track.audioTempBuf.get()), track.audioBufsize, info);
+		}
+		
+		if (info.sequence != 0) {
+			this->counters->lastAudioSequence.store(info.sequence, std::memory_order_relaxed);
+		}
+		
+		countEvent(this->counters->audioBuffersConsumed);
+		countEvent(this->counters->audioBytesCopied, track.audioBufsize);
+		received = true;
+	}
+	
+	//When polling, report an underrun if a complete buffer of samples was not available when one was due
+	if (this->mode == SamplingMode::Polling && received == false && limit == UINT64_MAX)
+	{
+		countEvent(this->counters->audioUnderruns);
+		track.delegate->audioUnderrun(deliveredBytes(track, track.audioBufsize - track.ringBuffer->available(track.cursor)));
 	}
 }
 
@@ -1,120 +1,827 @@
 #include "../public/MediaProducer.h"
+#include "../public/FormatConverter.h"
+#include "Doorbell.h"
+#include "FrameRing.h"
 #include "IPCUtils.h"
 #include "MemoryUtils.h"
 #include "ObjectNames.h"
 #include "RingBuffer.h"
+#include "SharedState.h"
+#include "Telemetry.h"
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <cstring>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
 #include <utility>
 
 namespace MediaIPC {
 
+//The producer's view of the registry of attached consumers
+struct ConsumerRegistry
+{
+	//Serialises scans of the registry and changes to the callback
+	std::mutex mutex;
+	MediaProducer::ConsumerCountCallback callback;
+	
+	//The registry version and the number of attached consumers as of our last scan, and the time at which we next scan for crashed consumers
+	std::atomic<uint32_t> version;
+	std::atomic<uint32_t> count;
+	std::atomic<uint64_t> nextScan;
+	
+	//The number of attached consumers most recently passed to the callback
+	uint32_t reported;
+	
+	//The socket we use to ring the doorbells of consumers that wait on file descriptors (-1 if it could not be created)
+	int doorbellSender;
+	
+	ConsumerRegistry() : doorbellSender(Doorbell::openSender()) {}
+	~ConsumerRegistry() {
+		Doorbell::closeSender(this->doorbellSender);
+	}
+};
+
+//The renditions of a track, which are generated by halving each of its frames repeatedly
+struct RenditionLadder
+{
+	//The index of the track that publishes each step, where the first step halves the frame once, the second halves it twice,
+	//and so on up to the smallest rendition (steps that are not published as renditions hold MEDIA_IPC_MAX_TRACKS)
+	std::vector<uint32_t> steps;
+	
+	//The buffers that hold the steps that are not published (null for steps that are)
+	std::vector< std::unique_ptr<uint8_t[]> > scratch;
+};
+
 namespace
 {
+	//Returns a damage list covering the whole of a frame
+	DamageList fullDamage()
+	{
+		DamageList damage;
+		damage.setFull();
+		return damage;
+	}
+	
 	MemoryWrapperPtr producerMemory(const std::string& name, uint64_t size) {
 		return MemoryUtils::toPointer(IPCUtils::createSharedMemory(name, size, ipc::read_write));
 	}
 	
-	MutexWrapperPtr producerMutex(const std::string& name) {
-		return MemoryUtils::toPointer(IPCUtils::getNamedMutex(name, true));
+	//Creates the memory for a video or audio buffer with the requested page size and NUMA placement, and zeroes it
+	//(The NUMA binding must be applied before the memory is zeroed, since the first touch of each page determines its placement)
+	MemoryWrapperPtr producerBuffer(const std::string& name, uint64_t size, const ProducerOptions& options, uint8_t& backing)
+	{
+		MemoryBacking actualBacking = MemoryBacking::Standard;
+		MemoryWrapperPtr buffer = MemoryUtils::toPointer(IPCUtils::createBufferMemory(name, size, options.hugePages, actualBacking));
+		backing = (uint8_t)(actualBacking);
+		
+		if (options.numaNode >= 0) {
+			IPCUtils::bindToNumaNode(*buffer->mapped, options.numaNode);
+		}
+		
+		IPCUtils::fillMemory(*buffer->mapped, 0);
+		return buffer;
+	}
+	
+	//Rounds an offset up to the nearest multiple of the specified alignment (which is never smaller than the cache line size)
+	uint64_t alignOffset(uint64_t offset, uint32_t alignment)
+	{
+		uint64_t boundary = std::max((uint64_t)(alignment), (uint64_t)(MEDIA_IPC_CACHE_LINE));
+		return ((offset + boundary - 1) / boundary) * boundary;
+	}
+	
+	//Rounds a frame alignment up to the nearest power of two that is at least the cache line size
+	uint32_t alignmentPowerOfTwo(uint32_t alignment)
+	{
+		uint32_t result = MEDIA_IPC_CACHE_LINE;
+		while (result < alignment && result < (1u << 31)) {
+			result <<= 1;
+		}
+		
+		return result;
+	}
+	
+	//Applies the minimum ring sizes, row stride and frame alignment to the parameters of a track
+	void normaliseTrack(ControlBlock& cb)
+	{
+		cb.audioRingBuffers = std::max((uint32_t)1, cb.audioRingBuffers);
+		
+		//The video ring needs at least two slots so that the producer never overwrites the frame it has just published
+		cb.videoSlots = std::max((uint32_t)2, cb.videoSlots);
+		
+		//Ensure the row stride can hold a full row, and that the frame alignment is a power of two no smaller than a cache line
+		if (cb.videoStride != 0) {
+			cb.videoStride = std::max(cb.videoStride, FormatDetails::alignedStride(cb.videoFormat, cb.width, 1));
+		}
+		cb.videoAlignment = alignmentPowerOfTwo(cb.videoAlignment);
+	}
+	
+	//Determines the number of times that a rendition halves the frames of its track, returning zero if the divisor is not
+	//a power of two no smaller than 2
+	uint32_t halvings(uint32_t divisor)
+	{
+		uint32_t count = 0;
+		while (divisor > 1 && (divisor & 1) == 0)
+		{
+			divisor >>= 1;
+			count += 1;
+		}
+		
+		return ((divisor == 1) ? count : 0);
+	}
+	
+	//Determines the parameters of a rendition from the normalised parameters of its track
+	//(Renditions keep the track's video format, frame rate and ring parameters, but have tightly packed rows and no audio)
+	ControlBlock renditionControlBlock(const ControlBlock& source, uint32_t steps)
+	{
+		ControlBlock rendition;
+		std::memcpy(&rendition, &source, sizeof(ControlBlock));
+		for (uint32_t step = 0; step < steps; ++step)
+		{
+			rendition.width = (rendition.width + 1) / 2;
+			rendition.height = (rendition.height + 1) / 2;
+		}
+		
+		rendition.videoStride = 0;
+		rendition.audioFormat = AudioFormat::None;
+		normaliseTrack(rendition);
+		return rendition;
 	}
 }
 
-MediaProducer::MediaProducer(const std::string& prefix, const ControlBlock& cb)
+MediaProducer::MediaProducer(const std::string& prefix, const ControlBlock& cb, const ProducerOptions& options) :
+	MediaProducer(prefix, std::vector<Track>(1, Track("", cb)), options)
+{}
+
+MediaProducer::MediaProducer(const std::string& prefix, const std::vector<Track>& tracks, const ProducerOptions& options)
 {
-	//Resolve the names of our shared memory objects and mutexes
+	//Append the renditions of each track as tracks of their own, after all of the tracks that were passed to us
+	std::vector<Track> published(tracks);
+	this->ladders.resize(tracks.size());
+	for (uint32_t index = 0; index < tracks.size(); ++index)
+	{
+		const Track& track = tracks[index];
+		if (track.renditions.empty() == true) {
+			continue;
+		}
+		
+		if (FormatConverter::canHalve(track.controlBlock.videoFormat) == false) {
+			throw std::runtime_error("the video format of the track \"" + track.name + "\" does not support renditions");
+		}
+		
+		ControlBlock source;
+		std::memcpy(&source, &(track.controlBlock), sizeof(ControlBlock));
+		normaliseTrack(source);
+		
+		this->ladders[index].reset(new RenditionLadder());
+		RenditionLadder& ladder = *this->ladders[index];
+		for (const Rendition& rendition : track.renditions)
+		{
+			uint32_t steps = halvings(rendition.divisor);
+			if (steps == 0) {
+				throw std::runtime_error("the divisor of the rendition \"" + rendition.name + "\" must be a power of two no smaller than 2");
+			}
+			
+			if (ladder.steps.size() < steps) {
+				ladder.steps.resize(steps, MEDIA_IPC_MAX_TRACKS);
+			}
+			else if (ladder.steps[steps - 1] != MEDIA_IPC_MAX_TRACKS) {
+				throw std::runtime_error("the track \"" + track.name + "\" has more than one rendition with a divisor of " + std::to_string(rendition.divisor));
+			}
+			
+			ladder.steps[steps - 1] = (uint32_t)(published.size());
+			published.push_back(Track(rendition.name, renditionControlBlock(source, steps)));
+		}
+	}
+	
+	//Verify that the number of tracks and their names are supported
+	if (published.empty() == true || published.size() > MEDIA_IPC_MAX_TRACKS) {
+		throw std::runtime_error("a producer must publish between 1 and " + std::to_string(MEDIA_IPC_MAX_TRACKS) + " tracks, including renditions");
+	}
+	for (const Track& track : published)
+	{
+		if (track.name.size() >= MEDIA_IPC_MAX_TRACK_NAME) {
+			throw std::runtime_error("the track name \"" + track.name + "\" is too long");
+		}
+	}
+	
+	//Resolve the names of our shared memory objects
 	ObjectNames names(prefix);
+	this->prefix = prefix;
+	this->options = options;
 	
-	//Create our named mutexes
-	this->statusMutex = producerMutex(names.statusMutex);
-	this->videoMutex = producerMutex(names.videoMutex);
-	this->frontBufferMutex = producerMutex(names.frontBufferMutex);
-	this->backBufferMutex = producerMutex(names.backBufferMutex);
-	this->audioMutex = producerMutex(names.audioMutex);
+	//Create the shared memory for the control block and bind our pointer to it
+	this->controlBlockMemory = producerMemory(names.controlBlockMemory, SharedState::controlBlockMemorySize());
+	this->controlBlock = (ControlBlock*)(this->controlBlockMemory->mapped->get_address());
 	
-	//Lock the status mutex while we create our shared memory objects
-	//(This ensures the consumer can't acquire any locks before we've populated our initial values)
+	//Initialise the lock-free shared state that follows the control block, which leaves the status mutex locked while we
+	//populate the control block and create our remaining shared memory objects
+	//(This ensures the consumer can't acquire the mutex before we've populated our initial values)
+	this->sharedState = new (SharedState::locate(this->controlBlock)) SharedState();
+	this->sharedState->reset();
 	{
-		MutexLock lock(*this->statusMutex->mutex);
+		MutexLock lock(this->sharedState->statusMutex, std::adopt_lock);
 		
-		//Create the shared memory for the control block and bind our pointer to it
-		this->controlBlockMemory = producerMemory(names.controlBlockMemory, sizeof(ControlBlock));
-		this->controlBlock = (ControlBlock*)(this->controlBlockMemory->mapped->get_address());
+		//Populate the track table
+		this->sharedState->trackCount = (uint32_t)(published.size());
+		for (uint32_t index = 0; index < published.size(); ++index)
+		{
+			TrackState& track = this->sharedState->tracks[index];
+			std::strncpy(track.name, published[index].name.c_str(), MEDIA_IPC_MAX_TRACK_NAME - 1);
+			std::memcpy(&track.controlBlock, &(published[index].controlBlock), sizeof(ControlBlock));
+			normaliseTrack(track.controlBlock);
+			track.generation = 0;
+			track.audioStartIndex = 0;
+		}
 		
-		//Populate the initial control block data
-		std::memcpy(this->controlBlock, &cb, sizeof(ControlBlock));
+		//Populate the initial control block data, which describes the first track
+		std::memcpy(this->controlBlock, &(this->sharedState->tracks[0].controlBlock), sizeof(ControlBlock));
 		this->controlBlock->active = true;
-		this->controlBlock->lastBuffer = VideoBuffer::FrontBuffer;
-		this->controlBlock->ringHead = 0;
-		
-		//Create the shared memory for the video data (ensuring the size is non-zero)
-		uint64_t videoBufsize = std::max((uint64_t)1, this->controlBlock->calculateVideoBufsize());
-		this->videoFrontBuffer = producerMemory(names.videoFrontBuffer, videoBufsize);
-		this->videoBackBuffer = producerMemory(names.videoBackBuffer, videoBufsize);
+		this->controlBlock->prefault = options.prefault;
 		
-		//Zero-out the video buffers
-		IPCUtils::fillMemory(*this->videoFrontBuffer->mapped, 0);
-		IPCUtils::fillMemory(*this->videoBackBuffer->mapped, 0);
+		//Create the shared memory for the video frame rings and the audio sample rings, laying out the tracks one after another
+		this->createVideoBuffer(false);
+		this->createAudioBuffer(false);
 		
-		//Create the shared memory for the audio data (ensuring the size is non-zero)
-		uint64_t audioBufsize = std::max((uint64_t)1, this->controlBlock->calculateAudioBufsize());
-		this->audioBuffer = producerMemory(names.audioBuffer, audioBufsize);
+		//Initialise the write indices of each track's sample ring, which persist across reconfigurations for the lifetime of the stream
+		for (auto& ringBuffer : this->ringBuffers) {
+			ringBuffer->reset();
+		}
 		
-		//Zero-out the audio buffer
-		IPCUtils::fillMemory(*this->audioBuffer->mapped, 0);
-		
-		//Wrap our ring buffer interface around the audio buffer
-		this->ringBuffer.reset(new RingBuffer(
-			(uint8_t*)(this->audioBuffer->mapped->get_address()),
-			this->audioBuffer->mapped->get_size(),
-			&(this->controlBlock->ringHead
-		)));
+		for (uint32_t index = 0; index < this->ladders.size(); ++index) {
+			this->prepareRenditions(index);
+		}
 	}
+	
+	//Start with an empty view of the consumer registry, which is first scanned when data is next submitted or committed
+	this->registry.reset(new ConsumerRegistry());
+	this->registry->version.store(0, std::memory_order_relaxed);
+	this->registry->count.store(0, std::memory_order_relaxed);
+	this->registry->nextScan.store(telemetryTimestamp(), std::memory_order_relaxed);
+	this->registry->reported = 0;
 }
 
 MediaProducer::~MediaProducer() {
 	this->stop();
 }
 
-void MediaProducer::submitVideoFrame(void* buffer, uint64_t length)
+void MediaProducer::submitVideoFrame(void* buffer, uint64_t length, int64_t pts) {
+	this->submitVideoFrame(0, buffer, length, pts);
+}
+
+void MediaProducer::submitAudioSamples(void* buffer, uint64_t length, int64_t pts) {
+	this->submitAudioSamples(0, buffer, length, pts);
+}
+
+bool MediaProducer::submitVideoFrame(const void* buffer, VideoFormat sourceFormat, uint64_t sourceStride, int64_t pts) {
+	return this->submitVideoFrame(0, buffer, sourceFormat, sourceStride, pts);
+}
+
+void MediaProducer::submitVideoFrame(const void* buffer, const std::vector<DamageRect>& damage, int64_t pts) {
+	this->submitVideoFrame(0, buffer, damage, pts);
+}
+
+uint8_t* MediaProducer::acquireVideoFrame() {
+	return this->acquireVideoFrame(0);
+}
+
+void MediaProducer::commitVideoFrame(int64_t pts) {
+	this->commitVideoFrame(0, pts);
+}
+
+uint8_t* MediaProducer::acquireAudioSamples(uint64_t& length) {
+	return this->acquireAudioSamples(0, length);
+}
+
+void MediaProducer::commitAudioSamples(uint64_t length, int64_t pts) {
+	this->commitAudioSamples(0, length, pts);
+}
+
+uint32_t MediaProducer::trackCount() const {
+	return (uint32_t)(this->frameRings.size());
+}
+
+void MediaProducer::submitVideoFrame(uint32_t track, void* buffer, uint64_t length, int64_t pts)
+{
+	//Don't bother copying the frame if nobody is attached to see it
+	FrameRing* frameRing = this->frameRings.at(track).get();
+	if (this->updateConsumers() == false && this->options.skipUnobserved == true)
+	{
+		frameRing->discard(fullDamage());
+		countEvent(this->sharedState->telemetry.producer.videoFramesUnobserved);
+		return;
+	}
+	
+	//Publish the frame in the next slot of the track's video ring
+	//(This never blocks, since consumers detect and retry torn reads rather than locking the slot)
+	//(A partial frame cannot be scaled, so the renditions are only updated when the buffer holds a whole frame)
+	uint64_t frameSize = this->sharedState->tracks[track].controlBlock.calculateVideoBufsize();
+	frameRing->write(buffer, length, pts);
+	if (length >= frameSize) {
+		this->publishRenditions(track, (const uint8_t*)(buffer), pts);
+	}
+	this->notifyConsumers(true, false);
+	
+	ProducerCounters& counters = this->sharedState->telemetry.producer;
+	countEvent(counters.videoFramesSubmitted);
+	countEvent(counters.videoBytesCopied, std::min(length, frameSize));
+}
+
+void MediaProducer::submitAudioSamples(uint32_t track, void* buffer, uint64_t length, int64_t pts)
+{
+	//Don't bother copying the samples if nobody is attached to read them
+	RingBuffer* ringBuffer = this->ringBuffers.at(track).get();
+	if (this->updateConsumers() == false && this->options.skipUnobserved == true)
+	{
+		countEvent(this->sharedState->telemetry.producer.audioBlocksUnobserved);
+		return;
+	}
+	
+	ringBuffer->recordBlock(pts);
+	ringBuffer->write(buffer, length);
+	this->notifyConsumers(false, true);
+	
+	ProducerCounters& counters = this->sharedState->telemetry.producer;
+	countEvent(counters.audioBlocksSubmitted);
+	countEvent(counters.audioBytesSubmitted, length);
+	countEvent(counters.audioBytesCopied, length);
+}
+
+bool MediaProducer::submitVideoFrame(uint32_t track, const void* buffer, VideoFormat sourceFormat, uint64_t sourceStride, int64_t pts)
+{
+	//Convert the frame straight into the next slot of the track's video ring, avoiding an intermediate copy
+	//(If the conversion is unsupported then the slot remains acquired and will be reused by the next frame)
+	FrameRing* frameRing = this->frameRings.at(track).get();
+	const ControlBlock& cb = this->sharedState->tracks[track].controlBlock;
+	if (this->updateConsumers() == false && this->options.skipUnobserved == true)
+	{
+		frameRing->discard(fullDamage());
+		countEvent(this->sharedState->telemetry.producer.videoFramesUnobserved);
+		return true;
+	}
+	
+	uint8_t* slot = frameRing->acquire();
+	if (FormatConverter::convert((const uint8_t*)(buffer), sourceFormat, sourceStride, slot, cb.videoFormat, cb.videoStride, cb.width, cb.height) == false) {
+		return false;
+	}
+	
+	frameRing->commit(pts);
+	this->publishRenditions(track, slot, pts);
+	this->notifyConsumers(true, false);
+	
+	ProducerCounters& counters = this->sharedState->telemetry.producer;
+	countEvent(counters.videoFramesSubmitted);
+	countEvent(counters.videoBytesCopied, cb.calculateVideoBufsize());
+	return true;
+}
+
+void MediaProducer::submitVideoFrame(uint32_t track, const void* buffer, const std::vector<DamageRect>& damage, int64_t pts)
+{
+	//Clip the damaged rectangles to the frame, discarding any that lie outside of it
+	FrameRing* frameRing = this->frameRings.at(track).get();
+	DamageCopier copier(this->sharedState->tracks[track].controlBlock);
+	DamageList changed;
+	changed.clear();
+	for (DamageRect rect : damage)
+	{
+		if (copier.clamp(rect) == true) {
+			changed.add(rect);
+		}
+	}
+	
+	//Even when nobody is attached, we need to remember what changed so that it is included in the next frame we publish
+	if (this->updateConsumers() == false && this->options.skipUnobserved == true)
+	{
+		frameRing->discard(changed);
+		countEvent(this->sharedState->telemetry.producer.videoFramesUnobserved);
+		return;
+	}
+	
+	//Publish the frame, copying only the regions that changed along with any regions the slot is missing from earlier frames
+	//(The renditions are always scaled from the whole frame, which the buffer holds in full)
+	uint64_t copied = 0;
+	frameRing->write(buffer, changed, copier, copied, pts);
+	this->publishRenditions(track, (const uint8_t*)(buffer), pts);
+	this->notifyConsumers(true, false);
+	
+	ProducerCounters& counters = this->sharedState->telemetry.producer;
+	countEvent(counters.videoFramesSubmitted);
+	countEvent(counters.videoBytesCopied, copied);
+}
+
+uint8_t* MediaProducer::acquireVideoFrame(uint32_t track) {
+	return this->frameRings.at(track)->acquire();
+}
+
+void MediaProducer::commitVideoFrame(uint32_t track, int64_t pts)
 {
-	//Determine which buffer to use
-	VideoBuffer bufToUse = VideoBuffer::FrontBuffer;
+	//Frames rendered in place are always published, but we still keep track of the consumers
+	//(The renditions are scaled from the slot itself once it has been published, since nothing else writes to it)
+	this->updateConsumers();
+	FrameRing* frameRing = this->frameRings.at(track).get();
+	const uint8_t* frame = frameRing->pending();
+	if (frameRing->commit(pts) != 0)
 	{
-		MutexLock lock(*this->videoMutex->mutex);
-		bufToUse = (this->controlBlock->lastBuffer == VideoBuffer::FrontBuffer) ? VideoBuffer::BackBuffer : VideoBuffer::FrontBuffer;
+		this->publishRenditions(track, frame, pts);
+		this->notifyConsumers(true, false);
+		countEvent(this->sharedState->telemetry.producer.videoFramesSubmitted);
+	}
+}
+
+uint8_t* MediaProducer::acquireAudioSamples(uint32_t track, uint64_t& length) {
+	return this->ringBuffers.at(track)->acquire(length);
+}
+
+void MediaProducer::commitAudioSamples(uint32_t track, uint64_t length, int64_t pts)
+{
+	this->updateConsumers();
+	RingBuffer* ringBuffer = this->ringBuffers.at(track).get();
+	ringBuffer->recordBlock(pts);
+	ringBuffer->commit(length);
+	this->notifyConsumers(false, true);
+	
+	ProducerCounters& counters = this->sharedState->telemetry.producer;
+	countEvent(counters.audioBlocksSubmitted);
+	countEvent(counters.audioBytesSubmitted, length);
+}
+
+void MediaProducer::reconfigure(const ControlBlock& cb) {
+	this->reconfigure(0, cb);
+}
+
+void MediaProducer::reconfigure(uint32_t track, const ControlBlock& cb)
+{
+	if (track >= this->frameRings.size()) {
+		throw std::out_of_range("the producer does not publish a track with index " + std::to_string(track));
+	}
+	if (track >= this->ladders.size()) {
+		throw std::runtime_error("the track with index " + std::to_string(track) + " is a rendition, which can only be reconfigured along with its track");
 	}
 	
-	//Write to the selected buffer
+	//Determine the new parameters of the track and of each of its renditions
+	std::vector< std::pair<uint32_t, ControlBlock> > updates(1);
+	updates[0].first = track;
+	std::memcpy(&(updates[0].second), &cb, sizeof(ControlBlock));
+	normaliseTrack(updates[0].second);
+	if (this->ladders[track])
 	{
-		auto& mutex = (bufToUse == VideoBuffer::FrontBuffer) ? this->frontBufferMutex : this->backBufferMutex;
-		auto& dest = (bufToUse == VideoBuffer::FrontBuffer) ? this->videoFrontBuffer : this->videoBackBuffer;
+		if (FormatConverter::canHalve(updates[0].second.videoFormat) == false) {
+			throw std::runtime_error("the video format of a track with renditions must be supported by FormatConverter::halve()");
+		}
 		
-		MutexLock lock(*mutex->mutex);
-		std::memcpy(dest->mapped->get_address(), buffer, std::min(length, (uint64_t)(dest->mapped->get_size())));
+		const std::vector<uint32_t>& steps = this->ladders[track]->steps;
+		for (uint32_t step = 0; step < steps.size(); ++step)
+		{
+			if (steps[step] != MEDIA_IPC_MAX_TRACKS) {
+				updates.push_back(std::make_pair(steps[step], renditionControlBlock(updates[0].second, step + 1)));
+			}
+		}
 	}
 	
-	//Update the "last buffer" flag
 	{
-		MutexLock lock(*this->videoMutex->mutex);
-		this->controlBlock->lastBuffer = bufToUse;
+		//Give up if a consumer holds the status mutex for longer than our timeout, rather than stalling the caller indefinitely
+		ProducerCounters& counters = this->sharedState->telemetry.producer;
+		InstrumentedMutexLock lock(this->sharedState->statusMutex, counters.statusLockContentions, counters.statusLockWaitNanoseconds, this->options.lockTimeout);
+		if (lock.owns() == false) {
+			throw std::runtime_error("timed out waiting for consumers to release the status mutex");
+		}
+		
+		//Update the parameters of every affected track before placing any rings, since recreating a buffer lays out all of the tracks
+		for (const auto& update : updates) {
+			std::memcpy(&(this->sharedState->tracks[update.first].controlBlock), &(update.second), sizeof(ControlBlock));
+		}
+		
+		bool videoRecreated = false;
+		bool audioRecreated = false;
+		for (const auto& update : updates)
+		{
+			TrackState& state = this->sharedState->tracks[update.first];
+			const ControlBlock& updated = state.controlBlock;
+			
+			//Place the track's new frame ring in the spare space at the end of the video buffer if it fits, leaving the old ring untouched
+			//(Consumers keep reading from the old ring, and may hold views of its frames, until they notice the new generation)
+			//(If the ring does not fit then the buffer is recreated under a new name, with as much space again to spare, which also
+			//lays out the rings of any tracks that we have yet to place)
+			uint64_t videoOffset = alignOffset(this->videoUsed, updated.videoAlignment);
+			uint64_t videoSize = TrackState::videoRegionSize(updated);
+			if (videoRecreated == false && videoOffset + videoSize <= this->videoBuffer->mapped->get_size())
+			{
+				state.videoOffset = videoOffset;
+				this->videoUsed = videoOffset + videoSize;
+				this->wrapVideoRing(update.first);
+			}
+			else if (videoRecreated == false)
+			{
+				this->createVideoBuffer(true);
+				videoRecreated = true;
+			}
+			
+			//Do the same for the track's sample ring, recording the write index at which each moved ring begins
+			//(The write indices carry on from where the old ring left off, so consumers can finish reading the old ring first)
+			uint64_t audioOffset = alignOffset(this->audioUsed, MEDIA_IPC_CACHE_LINE);
+			uint64_t audioSize = TrackState::audioRegionSize(updated);
+			if (audioRecreated == false && audioOffset + audioSize <= this->audioBuffer->mapped->get_size())
+			{
+				state.audioOffset = audioOffset;
+				state.audioStartIndex = this->ringBuffers[update.first]->writeIndex();
+				this->audioUsed = audioOffset + audioSize;
+				this->wrapAudioRing(update.first);
+			}
+			else if (audioRecreated == false)
+			{
+				this->createAudioBuffer(true);
+				audioRecreated = true;
+			}
+			
+			state.generation += 1;
+		}
+		
+		//If we reconfigured the first track then update the control block that describes it, preserving our own fields
+		if (track == 0)
+		{
+			ControlBlock primary;
+			std::memcpy(&primary, &(this->sharedState->tracks[0].controlBlock), sizeof(ControlBlock));
+			primary.active = this->controlBlock->active;
+			primary.videoBacking = this->controlBlock->videoBacking;
+			primary.audioBacking = this->controlBlock->audioBacking;
+			primary.prefault = this->controlBlock->prefault;
+			std::memcpy(this->controlBlock, &primary, sizeof(ControlBlock));
+		}
+		
+		//Publish the new generation, which consumers will see once they can acquire the status mutex
+		//(The track and its renditions share a single generation, so consumers pick up all of their changes together)
+		this->prepareRenditions(track);
+		this->sharedState->generation.fetch_add(1, std::memory_order_release);
 	}
+	
+	//Wake any consumers that are waiting for new data so they can pick up the new parameters
+	this->notifyConsumers(true, true);
+}
+
+uint32_t MediaProducer::consumerCount()
+{
+	this->scanConsumers(telemetryTimestamp(), true);
+	return this->registry->count.load(std::memory_order_relaxed);
+}
+
+StreamStats MediaProducer::stats() const {
+	return sampleTelemetry(*this->sharedState);
 }
 
-void MediaProducer::submitAudioSamples(void* buffer, uint64_t length)
+void MediaProducer::setConsumerCountCallback(const ConsumerCountCallback& callback)
 {
-	MutexLock lock(*this->audioMutex->mutex);
-	this->ringBuffer->write(buffer, length);
+	//The callback only receives changes that occur after it is set
+	std::lock_guard<std::mutex> lock(this->registry->mutex);
+	this->registry->callback = callback;
+	this->registry->reported = this->registry->count.load(std::memory_order_relaxed);
+}
+
+bool MediaProducer::updateConsumers()
+{
+	//This is a pair of atomic loads and a clock read unless something has changed, so it is cheap enough to perform for every frame
+	ConsumerRegistry& registry = *this->registry;
+	uint64_t now = telemetryTimestamp();
+	uint32_t version = this->sharedState->telemetry.registryVersion.load(std::memory_order_acquire);
+	if (version != registry.version.load(std::memory_order_relaxed) || now >= registry.nextScan.load(std::memory_order_relaxed)) {
+		this->scanConsumers(now, false);
+	}
+	
+	return registry.count.load(std::memory_order_relaxed) > 0;
+}
+
+void MediaProducer::notifyConsumers(bool video, bool audio)
+{
+	if (video == true) {
+		this->sharedState->videoEvent.notify();
+	}
+	
+	if (audio == true) {
+		this->sharedState->audioEvent.notify();
+	}
+	
+	Doorbell::ringArmed(this->registry->doorbellSender, this->sharedState->telemetry);
+}
+
+void MediaProducer::scanConsumers(uint64_t now, bool wait)
+{
+	//If another thread is already scanning the registry then we can use its result rather than waiting for it
+	ConsumerRegistry& registry = *this->registry;
+	std::unique_lock<std::mutex> lock(registry.mutex, std::defer_lock);
+	if (wait == true) {
+		lock.lock();
+	}
+	else if (lock.try_lock() == false) {
+		return;
+	}
+	
+	//Read the version before counting, so that any consumer attaching or detaching during the scan triggers another one
+	//(Reclaiming the counters of a crashed consumer also changes the version, which simply results in one extra scan)
+	Telemetry& telemetry = this->sharedState->telemetry;
+	uint64_t timeout = std::chrono::duration_cast<std::chrono::nanoseconds>(this->options.consumerTimeout).count();
+	uint32_t version = telemetry.registryVersion.load(std::memory_order_acquire);
+	uint32_t count = telemetry.reclaimConsumers(now, timeout, std::bind(&MediaProducer::reclaimConsumer, this, std::placeholders::_1));
+	registry.count.store(count, std::memory_order_relaxed);
+	registry.version.store(version, std::memory_order_relaxed);
+	registry.nextScan.store(now + timeout / 2, std::memory_order_relaxed);
+	
+	//Invoke the callback without holding the lock, so that it can safely query the producer
+	if (count != registry.reported && registry.callback)
+	{
+		registry.reported = count;
+		ConsumerCountCallback callback = registry.callback;
+		lock.unlock();
+		callback(count);
+	}
+}
+
+bool MediaProducer::reclaimConsumer(uint32_t owner)
+{
+	//Our frame rings are only replaced while the status mutex is held, so holding it keeps them alive while we scan them
+	//(Rings that have already been replaced are never written to again, so any pins left on their slots are harmless)
+	Telemetry& telemetry = this->sharedState->telemetry;
+	ProducerCounters& counters = telemetry.producer;
+	InstrumentedMutexLock lock(this->sharedState->statusMutex, counters.statusLockContentions, counters.statusLockWaitNanoseconds, this->options.lockTimeout);
+	if (lock.owns() == false) {
+		return false;
+	}
+	
+	for (auto& frameRing : this->frameRings) {
+		frameRing->releasePins(owner);
+	}
+	
+	//A consumer that crashed never removed its doorbell, so we remove it before its registry slot is released
+	ConsumerCounters& consumer = telemetry.consumers[owner];
+	uint32_t doorbell = consumer.doorbell.load(std::memory_order_acquire);
+	if (doorbell != 0) {
+		Doorbell::removeStale(consumer.processId.load(std::memory_order_acquire), doorbell);
+	}
+	
+	return true;
+}
+
+void MediaProducer::createVideoBuffer(bool headroom)
+{
+	//Lay out the frame rings of the tracks one after another, each starting on its track's frame alignment
+	uint64_t videoSize = 0;
+	for (uint32_t index = 0; index < this->sharedState->trackCount; ++index)
+	{
+		TrackState& track = this->sharedState->tracks[index];
+		track.videoOffset = alignOffset(videoSize, track.controlBlock.videoAlignment);
+		videoSize = track.videoOffset + TrackState::videoRegionSize(track.controlBlock);
+	}
+	
+	//Create the shared memory under the name for the next generation (the initial buffer is generation zero) and zero it out
+	//(Replacing our old buffer removes its name, but consumers keep their own mappings of it until they have moved to the new one)
+	uint32_t generation = (this->videoBuffer) ? this->sharedState->videoBufferGeneration + 1 : 0;
+	std::string name = ObjectNames::generation(ObjectNames(this->prefix).videoBuffer, generation);
+	this->videoBuffer = producerBuffer(name, (headroom == true) ? videoSize * 2 : videoSize, this->options, this->controlBlock->videoBacking);
+	this->sharedState->videoBufferGeneration = generation;
+	this->videoUsed = videoSize;
+	
+	//Wrap our frame ring interfaces around the new buffer
+	for (uint32_t index = 0; index < this->sharedState->trackCount; ++index) {
+		this->wrapVideoRing(index);
+	}
+}
+
+void MediaProducer::createAudioBuffer(bool headroom)
+{
+	//Lay out the sample rings of the tracks one after another, each starting on a cache line
+	uint64_t audioSize = 0;
+	for (uint32_t index = 0; index < this->sharedState->trackCount; ++index)
+	{
+		TrackState& track = this->sharedState->tracks[index];
+		track.audioOffset = alignOffset(audioSize, MEDIA_IPC_CACHE_LINE);
+		audioSize = track.audioOffset + TrackState::audioRegionSize(track.controlBlock);
+		if (this->audioBuffer) {
+			track.audioStartIndex = this->ringBuffers[index]->writeIndex();
+		}
+	}
+	
+	//Create the shared memory under the name for the next generation and zero it out
+	uint32_t generation = (this->audioBuffer) ? this->sharedState->audioBufferGeneration + 1 : 0;
+	std::string name = ObjectNames::generation(ObjectNames(this->prefix).audioBuffer, generation);
+	this->audioBuffer = producerBuffer(name, (headroom == true) ? audioSize * 2 : audioSize, this->options, this->controlBlock->audioBacking);
+	this->sharedState->audioBufferGeneration = generation;
+	this->audioUsed = audioSize;
+	
+	//Wrap our ring buffer interfaces around the new buffer
+	for (uint32_t index = 0; index < this->sharedState->trackCount; ++index) {
+		this->wrapAudioRing(index);
+	}
+}
+
+void MediaProducer::wrapVideoRing(uint32_t track)
+{
+	//Wrap a frame ring interface around the track's region and initialise it
+	//(The region is always unused space, so no consumer can be holding a pin on any of its slots)
+	TrackState& state = this->sharedState->tracks[track];
+	std::unique_ptr<FrameRing> frameRing(new FrameRing(
+		(uint8_t*)(this->videoBuffer->mapped->get_address()) + state.videoOffset,
+		state.controlBlock.videoSlots,
+		state.controlBlock.calculateVideoBufsize(),
+		state.controlBlock.videoAlignment
+	));
+	frameRing->reset();
+	
+	if (track < this->frameRings.size()) {
+		this->frameRings[track] = std::move(frameRing);
+	}
+	else {
+		this->frameRings.push_back(std::move(frameRing));
+	}
+}
+
+void MediaProducer::wrapAudioRing(uint32_t track)
+{
+	//Wrap a ring buffer interface around the track's region
+	//(The write indices and block records live in the track table rather than the region, so they are not reset here)
+	TrackState& state = this->sharedState->tracks[track];
+	std::unique_ptr<RingBuffer> ringBuffer(new RingBuffer(
+		(uint8_t*)(this->audioBuffer->mapped->get_address()) + state.audioOffset,
+		TrackState::audioRegionSize(state.controlBlock),
+		&(state.audioRing)
+	));
+	
+	if (track < this->ringBuffers.size()) {
+		this->ringBuffers[track] = std::move(ringBuffer);
+	}
+	else {
+		this->ringBuffers.push_back(std::move(ringBuffer));
+	}
+}
+
+void MediaProducer::prepareRenditions(uint32_t track)
+{
+	if (track >= this->ladders.size() || !this->ladders[track]) {
+		return;
+	}
+	
+	RenditionLadder& ladder = *this->ladders[track];
+	const ControlBlock& cb = this->sharedState->tracks[track].controlBlock;
+	ladder.scratch.clear();
+	ladder.scratch.resize(ladder.steps.size());
+	for (uint32_t step = 0; step < ladder.steps.size(); ++step)
+	{
+		if (ladder.steps[step] == MEDIA_IPC_MAX_TRACKS)
+		{
+			ControlBlock scaled = renditionControlBlock(cb, step + 1);
+			ladder.scratch[step].reset(new uint8_t[scaled.calculateVideoBufsize()]);
+		}
+	}
+}
+
+void MediaProducer::publishRenditions(uint32_t track, const uint8_t* frame, int64_t pts)
+{
+	if (track >= this->ladders.size() || !this->ladders[track]) {
+		return;
+	}
+	
+	//Each step halves the one before it, so every rendition is scaled from the smallest frame available rather than the original
+	//(Published steps are read back from their slots after they are committed, which is safe since only we ever write to them)
+	RenditionLadder& ladder = *this->ladders[track];
+	const ControlBlock& cb = this->sharedState->tracks[track].controlBlock;
+	const uint8_t* source = frame;
+	uint64_t sourceStride = cb.videoStride;
+	uint32_t width = cb.width;
+	uint32_t height = cb.height;
+	uint64_t copied = 0;
+	for (uint32_t step = 0; step < ladder.steps.size(); ++step)
+	{
+		uint32_t target = ladder.steps[step];
+		FrameRing* frameRing = ((target != MEDIA_IPC_MAX_TRACKS) ? this->frameRings[target].get() : nullptr);
+		uint8_t* dest = ((frameRing != nullptr) ? frameRing->acquire() : ladder.scratch[step].get());
+		FormatConverter::halve(source, cb.videoFormat, sourceStride, dest, 0, width, height);
+		if (frameRing != nullptr)
+		{
+			frameRing->commit(pts);
+			copied += this->sharedState->tracks[target].controlBlock.calculateVideoBufsize();
+		}
+		
+		source = dest;
+		sourceStride = 0;
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+	}
+	
+	countEvent(this->sharedState->telemetry.producer.videoBytesCopied, copied);
 }
 
 void MediaProducer::stop()
 {
 	//Set our status flag to inactive
+	//(If a consumer holds the status mutex for longer than our timeout, for example because it has been suspended, then we set the
+	//flag regardless, since it is a single byte that consumers only ever read and they will see it the next time they check)
 	{
-		MutexLock lock(*this->statusMutex->mutex);
+		ProducerCounters& counters = this->sharedState->telemetry.producer;
+		InstrumentedMutexLock lock(this->sharedState->statusMutex, counters.statusLockContentions, counters.statusLockWaitNanoseconds, this->options.lockTimeout);
 		this->controlBlock->active = false;
 	}
+	
+	//Wake any consumers that are waiting for new data so they can detect that the stream has ended
+	this->notifyConsumers(true, true);
 }
 
 } //End MediaIPC
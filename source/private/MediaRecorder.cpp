@@ -0,0 +1,324 @@
+#include "../public/MediaRecorder.h"
+#include "../public/MediaConsumer.h"
+#include "RecordingFormat.h"
+#include "Telemetry.h"
+#include "TrackRecordQueue.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace MediaIPC {
+
+//The state shared between the sampling threads of our consumer and our writer thread
+struct MediaRecorderState
+{
+	RecordingCounters counters;
+	TrackRecordQueue records;
+	
+	//The writer thread's private state: the file, whether it bypasses the page cache, the offset at which the staging buffer will
+	//be written, the staging buffer (aligned for direct writes) and the number of bytes in it, and the index of the records
+	int file;
+	bool direct;
+	uint64_t fileOffset;
+	std::unique_ptr<uint8_t[]> stagingMemory;
+	uint8_t* staging;
+	uint64_t stagingSize;
+	uint64_t staged;
+	std::vector<RecordingIndexEntry> index;
+	
+	MediaRecorderState() : records(counters.videoFramesTorn), file(-1), direct(false), fileOffset(0), staging(nullptr), stagingSize(0), staged(0) {}
+	
+	~MediaRecorderState()
+	{
+		if (this->file != -1) {
+			close(this->file);
+		}
+	}
+};
+
+namespace
+{
+	//Rounds a size up to a whole number of blocks
+	uint64_t roundToBlock(uint64_t size) {
+		return ((size + MEDIA_IPC_RECORDING_BLOCK - 1) / MEDIA_IPC_RECORDING_BLOCK) * MEDIA_IPC_RECORDING_BLOCK;
+	}
+	
+	//Allocates a buffer aligned to the block size, returning the aligned pointer
+	uint8_t* allocateAligned(std::unique_ptr<uint8_t[]>& memory, uint64_t size)
+	{
+		memory.reset(new uint8_t[size + MEDIA_IPC_RECORDING_BLOCK]);
+		uintptr_t address = (uintptr_t)(memory.get());
+		return memory.get() + (roundToBlock(address) - address);
+	}
+	
+	//Creates the file for a recording, bypassing the page cache if requested and supported
+	int createFile(const std::string& path, bool directIO, bool& direct)
+	{
+		int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+		int file = -1;
+		direct = false;
+		
+		//File systems such as tmpfs reject O_DIRECT when the file is opened, in which case we fall back to regular writes
+		#ifdef O_DIRECT
+		if (directIO == true)
+		{
+			file = open(path.c_str(), flags | O_DIRECT, 0644);
+			direct = (file != -1);
+		}
+		#endif
+		
+		if (file == -1) {
+			file = open(path.c_str(), flags, 0644);
+		}
+		
+		if (file == -1) {
+			throw std::runtime_error("failed to create the recording \"" + path + "\": " + std::strerror(errno));
+		}
+		
+		#ifdef F_NOCACHE
+		if (directIO == true) {
+			direct = (fcntl(file, F_NOCACHE, 1) == 0);
+		}
+		#endif
+		
+		return file;
+	}
+	
+	//Writes an entire buffer at the specified offset, returning the number of system calls used
+	uint64_t writeAt(int file, bool& direct, const uint8_t* data, uint64_t length, uint64_t offset)
+	{
+		uint64_t calls = 0;
+		while (length > 0)
+		{
+			ssize_t written = pwrite(file, data, (size_t)(length), (off_t)(offset));
+			calls += 1;
+			if (written < 0)
+			{
+				if (errno == EINTR) {
+					continue;
+				}
+				
+				//Some file systems accept O_DIRECT when the file is opened but reject the writes, so we stop bypassing the page cache
+				#ifdef O_DIRECT
+				if (errno == EINVAL && direct == true)
+				{
+					fcntl(file, F_SETFL, fcntl(file, F_GETFL) & ~O_DIRECT);
+					direct = false;
+					continue;
+				}
+				#endif
+				
+				throw std::runtime_error(std::string("failed to write the recording: ") + std::strerror(errno));
+			}
+			
+			data += written;
+			length -= (uint64_t)(written);
+			offset += (uint64_t)(written);
+		}
+		
+		return calls;
+	}
+}
+
+MediaRecorder::MediaRecorder(const std::string& prefix, const std::string& path, const RecordingOptions& options) :
+	prefix(prefix), options(options), state(new MediaRecorderState())
+{
+	//Determine which tracks the producer publishes, and then create the file
+	this->tracks = MediaConsumer::publishedTracks(prefix, options.consumerOptions);
+	MediaRecorderState& state = *this->state;
+	state.file = createFile(path, options.directIO, state.direct);
+	
+	for (const Track& track : this->tracks) {
+		state.records.addTrack(track.controlBlock);
+	}
+	
+	//Write the header block without an index, so that the records can still be recovered if we are interrupted
+	state.stagingSize = roundToBlock(std::max(options.writeSize, (uint64_t)(MEDIA_IPC_RECORDING_BLOCK)));
+	state.staging = allocateAligned(state.stagingMemory, state.stagingSize);
+	encodeRecordingHeader(this->tracks, 0, 0, state.staging);
+	countEvent(state.counters.writes, writeAt(state.file, state.direct, state.staging, MEDIA_IPC_RECORDING_BLOCK, 0));
+	countEvent(state.counters.bytes, MEDIA_IPC_RECORDING_BLOCK);
+	state.fileOffset = MEDIA_IPC_RECORDING_BLOCK;
+}
+
+MediaRecorder::~MediaRecorder() {
+	this->finish();
+}
+
+void MediaRecorder::run()
+{
+	//Record every track until the stream ends, and wait for everything we queued to be written and the file to be completed
+	this->state->records.run(
+		this->prefix,
+		this->tracks,
+		this->options.samplingMode,
+		this->options.consumerOptions,
+		std::bind(&MediaRecorder::writeLoop, this),
+		std::bind(&MediaRecorder::enqueueVideoFrame, this, std::placeholders::_1, std::placeholders::_2)
+	);
+}
+
+RecordingStats MediaRecorder::stats() const
+{
+	RecordingStats stats = this->state->counters.snapshot();
+	stats.queuedBytes = this->state->records.queuedBytes.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void MediaRecorder::enqueueVideoFrame(uint32_t track, VideoFrameView& view)
+{
+	MediaRecorderState& state = *this->state;
+	TrackRecordQueue& records = state.records;
+	std::unique_ptr<QueuedRecord> record(new QueuedRecord());
+	record->header = makeHeader(BridgeMessageType::VideoFrame, track, view.length(), view.info());
+	{
+		std::lock_guard<std::mutex> lock(records.mutex);
+		if (records.failed == true) {
+			return;
+		}
+		
+		//Hold the frame in shared memory if we can do so without the producer having to overwrite one of our frames
+		if (records.pinned[track] < records.pinLimit[track])
+		{
+			records.pinned[track] += 1;
+			record->view = std::move(view);
+		}
+		
+		//Otherwise the disk is not keeping up, so we copy the frame unless we are already holding too many copies
+		else if (records.queuedBytes.load(std::memory_order_relaxed) + view.length() <= this->options.maxQueuedBytes) {
+			countEvent(records.queuedBytes, view.length());
+		}
+		else
+		{
+			countEvent(state.counters.videoFramesDropped);
+			return;
+		}
+	}
+	
+	//Copy the frame without holding the lock, so that the writer thread is not held up
+	if (record->view.isValid() == false)
+	{
+		record->payload.assign(view.data(), view.data() + view.length());
+		if (view.isIntact() == false) {
+			countEvent(state.counters.videoFramesTorn);
+		}
+	}
+	
+	records.enqueue(std::move(record));
+}
+
+void MediaRecorder::writeLoop()
+{
+	MediaRecorderState& state = *this->state;
+	try
+	{
+		bool done = false;
+		while (done == false)
+		{
+			//Write whatever has been queued, releasing each record's frame as soon as it has been copied into the staging buffer
+			RecordList records;
+			done = state.records.take(records, SIZE_MAX, UINT64_MAX, 0);
+			for (auto& record : records) {
+				this->write(*record);
+			}
+		}
+		
+		this->complete();
+	}
+	catch (std::runtime_error& e) {
+		state.records.fail(e.what());
+	}
+}
+
+void MediaRecorder::write(QueuedRecord& record)
+{
+	//Index the record by its position in the file, which is wherever the staging buffer has reached
+	MediaRecorderState& state = *this->state;
+	RecordingIndexEntry entry;
+	entry.offset = state.fileOffset + state.staged;
+	entry.timestamp = record.header.timestamp;
+	entry.track = record.header.track;
+	entry.type = record.header.type;
+	state.index.push_back(entry);
+	
+	this->append(&record.header, sizeof(BridgeMessageHeader));
+	if (record.view.isValid() == true) {
+		this->append(record.view.data(), record.view.length());
+	}
+	else {
+		this->append(record.payload.data(), record.payload.size());
+	}
+	
+	state.records.release(record);
+	state.counters.countRecord(record.header.type);
+}
+
+void MediaRecorder::append(const void* data, uint64_t length)
+{
+	MediaRecorderState& state = *this->state;
+	const uint8_t* source = (const uint8_t*)(data);
+	while (length > 0)
+	{
+		uint64_t count = std::min(length, state.stagingSize - state.staged);
+		std::memcpy(state.staging + state.staged, source, (size_t)(count));
+		state.staged += count;
+		source += count;
+		length -= count;
+		
+		if (state.staged == state.stagingSize) {
+			this->flush();
+		}
+	}
+}
+
+void MediaRecorder::flush()
+{
+	//Direct writes must cover whole blocks, so a partially filled buffer is padded with zeroes (which complete() truncates again)
+	MediaRecorderState& state = *this->state;
+	uint64_t length = roundToBlock(state.staged);
+	std::memset(state.staging + state.staged, 0, (size_t)(length - state.staged));
+	countEvent(state.counters.writes, writeAt(state.file, state.direct, state.staging, length, state.fileOffset));
+	countEvent(state.counters.bytes, length);
+	state.fileOffset += length;
+	state.staged = 0;
+}
+
+void MediaRecorder::complete()
+{
+	//Append the index after the last record, and write out whatever remains in the staging buffer
+	MediaRecorderState& state = *this->state;
+	uint64_t indexOffset = state.fileOffset + state.staged;
+	this->append(state.index.data(), state.index.size() * sizeof(RecordingIndexEntry));
+	uint64_t end = state.fileOffset + state.staged;
+	if (state.staged > 0) {
+		this->flush();
+	}
+	
+	if (ftruncate(state.file, (off_t)(end)) != 0) {
+		throw std::runtime_error(std::string("failed to truncate the recording: ") + std::strerror(errno));
+	}
+	
+	//Only refer to the index once everything else has reached the disk, so that a crash can never leave a header pointing at garbage
+	if (fsync(state.file) != 0) {
+		throw std::runtime_error(std::string("failed to flush the recording to disk: ") + std::strerror(errno));
+	}
+	
+	encodeRecordingHeader(this->tracks, indexOffset, state.index.size(), state.staging);
+	countEvent(state.counters.writes, writeAt(state.file, state.direct, state.staging, MEDIA_IPC_RECORDING_BLOCK, 0));
+	if (fsync(state.file) != 0) {
+		throw std::runtime_error(std::string("failed to flush the recording to disk: ") + std::strerror(errno));
+	}
+}
+
+void MediaRecorder::finish() {
+	this->state->records.finish();
+}
+
+} //End MediaIPC
@@ -0,0 +1,198 @@
+#include "../public/MediaReplayer.h"
+#include "../public/MediaProducer.h"
+#include "IPCUtils.h"
+#include "RecordingFormat.h"
+#include "Telemetry.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace MediaIPC {
+
+//The mapping of a recording, along with its tracks, its index and the counters for the replayer
+struct MediaReplayerState
+{
+	std::unique_ptr<ipc::file_mapping> file;
+	std::unique_ptr<ipc::mapped_region> region;
+	const uint8_t* data;
+	uint64_t size;
+	
+	std::vector<Track> tracks;
+	std::vector<RecordingIndexEntry> index;
+	RecordingCounters counters;
+};
+
+namespace
+{
+	//Determines the earliest and latest timestamps in a recording (both zero if it has no records)
+	//(Records are written in the order they were sampled, and the first frame of each track may have been published before
+	//the recorder attached, so the timestamps are not strictly increasing)
+	void timestampRange(const std::vector<RecordingIndexEntry>& index, uint64_t& first, uint64_t& last)
+	{
+		first = ((index.empty() == false) ? UINT64_MAX : 0);
+		last = 0;
+		for (const RecordingIndexEntry& entry : index)
+		{
+			first = std::min(first, entry.timestamp);
+			last = std::max(last, entry.timestamp);
+		}
+	}
+}
+
+MediaReplayer::MediaReplayer(const std::string& path, const std::string& prefix, const RecordingOptions& options) :
+	prefix(prefix), options(options), state(new MediaReplayerState())
+{
+	//Map the whole file, advising the kernel that we will read it from start to finish
+	MediaReplayerState& state = *this->state;
+	try
+	{
+		state.file.reset(new ipc::file_mapping(path.c_str(), ipc::read_only));
+		state.region.reset(new ipc::mapped_region(*state.file, ipc::read_only));
+		state.region->advise(ipc::mapped_region::advice_sequential);
+	}
+	catch (ipc::interprocess_exception& e) {
+		throw std::runtime_error("failed to open the recording \"" + path + "\": " + e.what());
+	}
+	
+	state.data = (const uint8_t*)(state.region->get_address());
+	state.size = state.region->get_size();
+	
+	RecordingHeader header;
+	state.tracks = decodeRecordingHeader(state.data, state.size, header);
+	state.index = readRecordingIndex(state.data, state.size, header);
+}
+
+//Needed so that client code doesn't require definitions for our forward-declared types
+MediaReplayer::~MediaReplayer() {}
+
+std::vector<Track> MediaReplayer::tracks() const {
+	return this->state->tracks;
+}
+
+std::chrono::nanoseconds MediaReplayer::duration() const
+{
+	uint64_t first = 0;
+	uint64_t last = 0;
+	timestampRange(this->state->index, first, last);
+	return std::chrono::nanoseconds(last - first);
+}
+
+RecordingStats MediaReplayer::stats() const {
+	return this->state->counters.snapshot();
+}
+
+void MediaReplayer::run()
+{
+	//Determine the timestamp at which to begin, measured from the earliest record
+	MediaReplayerState& state = *this->state;
+	const std::vector<RecordingIndexEntry>& index = state.index;
+	uint64_t first = 0;
+	uint64_t last = 0;
+	timestampRange(index, first, last);
+	uint64_t start = first + std::chrono::duration_cast<std::chrono::nanoseconds>(this->options.startOffset).count();
+	
+	//Skip to the first frame or block at or after the starting point, applying the parameters of any tracks that were
+	//reconfigured before it, so that the producer begins with the parameters the tracks had at that point
+	std::vector<Track> tracks = state.tracks;
+	size_t position = 0;
+	while (position < index.size() && (index[position].type == (uint32_t)(BridgeMessageType::ControlBlock) || index[position].timestamp < start))
+	{
+		const RecordingIndexEntry& entry = index[position];
+		BridgeMessageHeader header;
+		std::memcpy(&header, state.data + entry.offset, sizeof(header));
+		if (entry.type == (uint32_t)(BridgeMessageType::ControlBlock) && header.length == sizeof(BridgeWireControlBlock))
+		{
+			BridgeWireControlBlock wire;
+			std::memcpy(&wire, state.data + entry.offset + sizeof(header), sizeof(wire));
+			tracks[entry.track].controlBlock = fromWire(wire);
+		}
+		
+		position += 1;
+	}
+	
+	//Republish the stream with the same tracks, stopping the producer however the replay ends
+	std::vector<ControlBlock> controlBlocks;
+	for (const Track& track : tracks) {
+		controlBlocks.push_back(track.controlBlock);
+	}
+	
+	MediaProducer producer(this->prefix, tracks, this->options.producerOptions);
+	try
+	{
+		//When replaying in real time, each record is published at the same interval after the starting point as it was recorded
+		//(Records that were sampled slightly out of order are published as soon as we reach them)
+		auto began = std::chrono::steady_clock::now();
+		for (; position < index.size(); ++position)
+		{
+			const RecordingIndexEntry& entry = index[position];
+			if (this->options.realTime == true && entry.timestamp > start) {
+				std::this_thread::sleep_until(began + std::chrono::nanoseconds(entry.timestamp - start));
+			}
+			
+			if (this->publish(producer, controlBlocks, entry) == false) {
+				break;
+			}
+		}
+	}
+	catch (std::runtime_error&)
+	{
+		producer.stop();
+		throw;
+	}
+	
+	producer.stop();
+}
+
+bool MediaReplayer::publish(MediaProducer& producer, std::vector<ControlBlock>& controlBlocks, const RecordingIndexEntry& entry)
+{
+	//The index has already been validated against the records it refers to
+	RecordingCounters& counters = this->state->counters;
+	BridgeMessageHeader header;
+	std::memcpy(&header, this->state->data + entry.offset, sizeof(header));
+	const uint8_t* body = this->state->data + entry.offset + sizeof(header);
+	if (header.type == (uint32_t)(BridgeMessageType::End)) {
+		return false;
+	}
+	
+	ControlBlock& cb = controlBlocks[header.track];
+	if (header.type == (uint32_t)(BridgeMessageType::ControlBlock))
+	{
+		if (header.length != sizeof(BridgeWireControlBlock)) {
+			throw std::runtime_error("the recording contains an invalid control block");
+		}
+		
+		//The recorder records the parameters of each track when it starts, so only reconfigure if they have actually changed
+		BridgeWireControlBlock wire;
+		std::memcpy(&wire, body, sizeof(wire));
+		BridgeWireControlBlock previous = toWire(cb);
+		if (std::memcmp(&wire, &previous, sizeof(wire)) != 0)
+		{
+			cb = fromWire(wire);
+			producer.reconfigure(header.track, cb);
+		}
+	}
+	else if (header.type == (uint32_t)(BridgeMessageType::VideoFrame))
+	{
+		if (header.length != cb.calculateVideoBufsize()) {
+			throw std::runtime_error("the recording contains a video frame whose size does not match the track's parameters");
+		}
+		
+		//Frames are copied straight from the mapping into the track's video ring
+		producer.submitVideoFrame(header.track, (void*)(body), header.length, header.pts);
+	}
+	else if (header.type == (uint32_t)(BridgeMessageType::AudioBlock))
+	{
+		if (header.length > cb.calculateAudioRingSize()) {
+			throw std::runtime_error("the recording contains a block of audio samples larger than the track's ring");
+		}
+		
+		producer.submitAudioSamples(header.track, (void*)(body), header.length, header.pts);
+	}
+	
+	counters.countRecord(header.type);
+	countEvent(counters.bytes, sizeof(header) + header.length);
+	return true;
+}
+
+} //End MediaIPC
@@ -5,16 +5,14 @@ namespace MediaIPC {
 ObjectNames::ObjectNames(const string& prefix)
 {
 	this->statusMemory = prefix + "ProducerStatusSharedMemory";
-	this->statusMutex = prefix + "ProducerStatusNamedMutex";
 	this->controlBlockMemory = prefix + "ControlBlockSharedMemory";
 	this->controlBlockMutex = prefix + "ControlBlockNamedMutex";
-	this->videoFrontBuffer = prefix + "VideoFrontBufferSharedMemory";
-	this->videoBackBuffer = prefix + "VideoBackBufferSharedMemory";
-	this->videoMutex = prefix + "VideoNamedMutex";
-	this->frontBufferMutex = prefix + "VideoFrontBufferNamedMutex";
-	this->backBufferMutex = prefix + "VideoBackBufferNamedMutex";
+	this->videoBuffer = prefix + "VideoBufferSharedMemory";
 	this->audioBuffer = prefix + "AudioBufferSharedMemory";
-	this->audioMutex = prefix + "AudioNamedMutex";
+}
+
+string ObjectNames::generation(const string& name, uint32_t generation) {
+	return ((generation == 0) ? name : name + "Generation" + std::to_string(generation));
 }
 
 } //End MediaIPC
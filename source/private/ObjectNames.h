@@ -1,6 +1,7 @@
 #ifndef _MEDIA_IPC_OBJECT_NAMES
 #define _MEDIA_IPC_OBJECT_NAMES
 
+#include <stdint.h>
 #include <string>
 using std::string;
 
@@ -13,25 +14,22 @@ class ObjectNames
 		//Resolves the fully-qualified object names for the supplied prefix
 		ObjectNames(const string& prefix);
 		
-		//Producer status shared memory and named mutex
+		//Producer status shared memory
 		string statusMemory;
-		string statusMutex;
 		
 		//Control block shared memory and named mutex
 		string controlBlockMemory;
 		string controlBlockMutex;
 		
-		//Video shared memory and named mutexes
-		string videoFrontBuffer;
-		string videoBackBuffer;
-		string videoMutex;
-		string frontBufferMutex;
-		string backBufferMutex;
+		//Video shared memory
+		string videoBuffer;
 		
-		//Audio shared memory and named mutex
+		//Audio shared memory
 		string audioBuffer;
-		string audioMutex;
-		//Something here to coordinate ring buffer?
+		
+		//Resolves the name of a video or audio buffer that has been recreated the specified number of times
+		//(The original buffer keeps its unsuffixed name, so that generation zero matches the names above)
+		static string generation(const string& name, uint32_t generation);
 };
 
 } //End MediaIPC
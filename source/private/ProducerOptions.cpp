@@ -0,0 +1,15 @@
+#include "../public/ProducerOptions.h"
+
+namespace MediaIPC {
+
+ProducerOptions::ProducerOptions()
+{
+	this->hugePages = false;
+	this->numaNode = -1;
+	this->prefault = false;
+	this->skipUnobserved = false;
+	this->consumerTimeout = std::chrono::milliseconds(2000);
+	this->lockTimeout = std::chrono::milliseconds(1000);
+}
+
+} //End MediaIPC
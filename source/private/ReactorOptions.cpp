@@ -0,0 +1,12 @@
+#include "../public/ReactorOptions.h"
+
+namespace MediaIPC {
+
+ReactorOptions::ReactorOptions()
+{
+	this->threads = 2;
+	this->batchSize = 16;
+	this->checkInterval = std::chrono::milliseconds(1000);
+}
+
+} //End MediaIPC
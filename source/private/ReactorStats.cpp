@@ -0,0 +1,21 @@
+#include "../public/ReactorStats.h"
+
+namespace MediaIPC {
+
+ReactorStats::ReactorStats()
+{
+	this->stream = 0;
+	this->turns = 0;
+	this->wakeups = 0;
+	this->wakeLatencyNanoseconds = 0;
+	this->wakeLatencyMaxNanoseconds = 0;
+	this->wakeLatencySamples = 0;
+	this->turnNanoseconds = 0;
+	this->turnMaxNanoseconds = 0;
+	this->videoFramesConsumed = 0;
+	this->videoFramesSkipped = 0;
+	this->audioBuffersConsumed = 0;
+	this->audioBytesLost = 0;
+}
+
+} //End MediaIPC
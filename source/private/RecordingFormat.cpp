@@ -0,0 +1,165 @@
+#include "RecordingFormat.h"
+#include "Telemetry.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace MediaIPC {
+
+namespace
+{
+	//Determines if a record header is valid for a recording with the specified number of tracks and size, starting at the specified offset
+	bool validRecord(const BridgeMessageHeader& header, uint64_t offset, uint32_t trackCount, uint64_t size)
+	{
+		bool validType = (
+			header.type == (uint32_t)(BridgeMessageType::ControlBlock) ||
+			header.type == (uint32_t)(BridgeMessageType::VideoFrame) ||
+			header.type == (uint32_t)(BridgeMessageType::AudioBlock) ||
+			header.type == (uint32_t)(BridgeMessageType::End)
+		);
+		
+		return (validType == true && header.track < trackCount && header.length <= size - offset - sizeof(BridgeMessageHeader));
+	}
+}
+
+void encodeRecordingHeader(const std::vector<Track>& tracks, uint64_t indexOffset, uint64_t indexCount, uint8_t* block)
+{
+	RecordingHeader header;
+	header.magic = MEDIA_IPC_RECORDING_MAGIC;
+	header.version = MEDIA_IPC_RECORDING_VERSION;
+	header.trackCount = (uint32_t)(tracks.size());
+	header.reserved = 0;
+	header.indexOffset = indexOffset;
+	header.indexCount = indexCount;
+	
+	//The track table is the same as the body of a bridge greeting, without the greeting itself
+	std::vector<uint8_t> hello = encodeHello(tracks);
+	std::memset(block, 0, MEDIA_IPC_RECORDING_BLOCK);
+	std::memcpy(block, &header, sizeof(RecordingHeader));
+	std::memcpy(block + sizeof(RecordingHeader), hello.data() + sizeof(BridgeHello), hello.size() - sizeof(BridgeHello));
+}
+
+std::vector<Track> decodeRecordingHeader(const uint8_t* data, uint64_t size, RecordingHeader& header)
+{
+	if (size < MEDIA_IPC_RECORDING_BLOCK) {
+		throw std::runtime_error("the file is too small to be a MediaIPC recording");
+	}
+	
+	std::memcpy(&header, data, sizeof(RecordingHeader));
+	if (header.magic != MEDIA_IPC_RECORDING_MAGIC) {
+		throw std::runtime_error("the file is not a MediaIPC recording, or was recorded on a host with a different byte order");
+	}
+	
+	if (header.version != MEDIA_IPC_RECORDING_VERSION) {
+		throw std::runtime_error("the recording uses container version " + std::to_string(header.version) + ", but we only support version " + std::to_string(MEDIA_IPC_RECORDING_VERSION));
+	}
+	
+	if (header.trackCount == 0 || header.trackCount > MEDIA_IPC_MAX_TRACKS) {
+		throw std::runtime_error("the recording has an invalid track table");
+	}
+	
+	//Decode the track table as the body of a bridge greeting
+	BridgeHello hello;
+	hello.magic = MEDIA_IPC_BRIDGE_MAGIC;
+	hello.version = MEDIA_IPC_BRIDGE_VERSION;
+	hello.trackCount = header.trackCount;
+	hello.reserved = 0;
+	
+	std::vector<uint8_t> body(sizeof(BridgeHello) + (header.trackCount * sizeof(BridgeWireTrack)));
+	std::memcpy(body.data(), &hello, sizeof(BridgeHello));
+	std::memcpy(body.data() + sizeof(BridgeHello), data + sizeof(RecordingHeader), body.size() - sizeof(BridgeHello));
+	return decodeHello(body);
+}
+
+std::vector<RecordingIndexEntry> readRecordingIndex(const uint8_t* data, uint64_t size, const RecordingHeader& header)
+{
+	std::vector<RecordingIndexEntry> index;
+	if (header.indexOffset != 0)
+	{
+		if (header.indexOffset < MEDIA_IPC_RECORDING_BLOCK || header.indexOffset > size || header.indexCount > (size - header.indexOffset) / sizeof(RecordingIndexEntry)) {
+			throw std::runtime_error("the recording's index lies outside the file");
+		}
+		
+		index.resize((size_t)(header.indexCount));
+		std::memcpy(index.data(), data + header.indexOffset, index.size() * sizeof(RecordingIndexEntry));
+		for (const RecordingIndexEntry& entry : index)
+		{
+			BridgeMessageHeader record;
+			if (entry.offset < MEDIA_IPC_RECORDING_BLOCK || entry.offset > header.indexOffset - sizeof(BridgeMessageHeader)) {
+				throw std::runtime_error("the recording's index refers to a record outside the file");
+			}
+			
+			std::memcpy(&record, data + entry.offset, sizeof(BridgeMessageHeader));
+			if (validRecord(record, entry.offset, header.trackCount, header.indexOffset) == false || record.type != entry.type || record.track != entry.track) {
+				throw std::runtime_error("the recording's index refers to an invalid record");
+			}
+		}
+		
+		return index;
+	}
+	
+	//Walk the records from the end of the header block until we reach the end of the stream or of the data that was written
+	uint64_t offset = MEDIA_IPC_RECORDING_BLOCK;
+	while (size - offset >= sizeof(BridgeMessageHeader))
+	{
+		BridgeMessageHeader record;
+		std::memcpy(&record, data + offset, sizeof(BridgeMessageHeader));
+		if (validRecord(record, offset, header.trackCount, size) == false) {
+			break;
+		}
+		
+		RecordingIndexEntry entry;
+		entry.offset = offset;
+		entry.timestamp = record.timestamp;
+		entry.track = record.track;
+		entry.type = record.type;
+		index.push_back(entry);
+		
+		offset += sizeof(BridgeMessageHeader) + record.length;
+		if (record.type == (uint32_t)(BridgeMessageType::End)) {
+			break;
+		}
+	}
+	
+	return index;
+}
+
+RecordingCounters::RecordingCounters()
+{
+	this->videoFrames.store(0, std::memory_order_relaxed);
+	this->audioBlocks.store(0, std::memory_order_relaxed);
+	this->controlBlocks.store(0, std::memory_order_relaxed);
+	this->bytes.store(0, std::memory_order_relaxed);
+	this->writes.store(0, std::memory_order_relaxed);
+	this->videoFramesDropped.store(0, std::memory_order_relaxed);
+	this->videoFramesTorn.store(0, std::memory_order_relaxed);
+}
+
+void RecordingCounters::countRecord(uint32_t type)
+{
+	if (type == (uint32_t)(BridgeMessageType::VideoFrame)) {
+		countEvent(this->videoFrames);
+	}
+	else if (type == (uint32_t)(BridgeMessageType::AudioBlock)) {
+		countEvent(this->audioBlocks);
+	}
+	else if (type == (uint32_t)(BridgeMessageType::ControlBlock)) {
+		countEvent(this->controlBlocks);
+	}
+}
+
+RecordingStats RecordingCounters::snapshot() const
+{
+	RecordingStats stats;
+	stats.videoFrames = this->videoFrames.load(std::memory_order_relaxed);
+	stats.audioBlocks = this->audioBlocks.load(std::memory_order_relaxed);
+	stats.controlBlocks = this->controlBlocks.load(std::memory_order_relaxed);
+	stats.bytes = this->bytes.load(std::memory_order_relaxed);
+	stats.writes = this->writes.load(std::memory_order_relaxed);
+	stats.videoFramesDropped = this->videoFramesDropped.load(std::memory_order_relaxed);
+	stats.videoFramesTorn = this->videoFramesTorn.load(std::memory_order_relaxed);
+	return stats;
+}
+
+} //End MediaIPC
@@ -0,0 +1,82 @@
+#ifndef _MEDIA_IPC_RECORDING_FORMAT
+#define _MEDIA_IPC_RECORDING_FORMAT
+
+#include "../public/RecordingStats.h"
+#include "BridgeProtocol.h"
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+namespace MediaIPC {
+
+//Identifies a recording ("MIPR" in little-endian byte order) and the version of the container format
+//(All values are stored in the recorder's native byte order, so recordings can only be replayed on hosts with the same byte order)
+#define MEDIA_IPC_RECORDING_MAGIC 0x5250494d
+#define MEDIA_IPC_RECORDING_VERSION 1
+
+//The size of the header block at the start of a recording, which is also the alignment of the recorder's direct writes
+#define MEDIA_IPC_RECORDING_BLOCK 4096
+
+//A recording consists of:
+//  - The header block, holding a RecordingHeader followed by a BridgeWireTrack for each track
+//  - The records, each of which is a BridgeMessageHeader followed by its data, exactly as they would be sent over a bridge
+//    (only ControlBlock, VideoFrame, AudioBlock and End messages are recorded, and the timestamps are those of the producer)
+//  - The index, an array of RecordingIndexEntry describing each record in the order they were written
+struct RecordingHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t trackCount;
+	uint32_t reserved;
+	
+	//The offset and number of entries of the index (both zero until the recorder has completed the file)
+	uint64_t indexOffset;
+	uint64_t indexCount;
+};
+
+struct RecordingIndexEntry
+{
+	//The offset of the record's header from the start of the file
+	uint64_t offset;
+	
+	//The time at which the producer published the record's frame or samples (or at which the recorder received its control block)
+	uint64_t timestamp;
+	
+	uint32_t track;
+	uint32_t type;
+};
+
+//Encodes the header block of a recording for the specified tracks
+void encodeRecordingHeader(const std::vector<Track>& tracks, uint64_t indexOffset, uint64_t indexCount, uint8_t* block);
+
+//Decodes and validates the header block of a recording, throwing std::runtime_error if it is invalid
+std::vector<Track> decodeRecordingHeader(const uint8_t* data, uint64_t size, RecordingHeader& header);
+
+//Reads and validates the index of a recording, or rebuilds it by walking the records if the recording was not completed
+//(Walking stops at the first record that is truncated or invalid, which is where an interrupted recorder stopped writing)
+std::vector<RecordingIndexEntry> readRecordingIndex(const uint8_t* data, uint64_t size, const RecordingHeader& header);
+
+//The counters for a recorder or replayer, which are updated by its threads while another thread takes snapshots
+struct RecordingCounters
+{
+	std::atomic<uint64_t> videoFrames;
+	std::atomic<uint64_t> audioBlocks;
+	std::atomic<uint64_t> controlBlocks;
+	std::atomic<uint64_t> bytes;
+	std::atomic<uint64_t> writes;
+	std::atomic<uint64_t> videoFramesDropped;
+	std::atomic<uint64_t> videoFramesTorn;
+	
+	//Zeroes all of the counters
+	RecordingCounters();
+	
+	//Counts a record of the specified type
+	void countRecord(uint32_t type);
+	
+	//Reads the current values of the counters
+	RecordingStats snapshot() const;
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,15 @@
+#include "../public/RecordingOptions.h"
+
+namespace MediaIPC {
+
+RecordingOptions::RecordingOptions()
+{
+	this->samplingMode = SamplingMode::Notification;
+	this->writeSize = 8 * 1024 * 1024;
+	this->directIO = true;
+	this->maxQueuedBytes = 256 * 1024 * 1024;
+	this->realTime = true;
+	this->startOffset = std::chrono::milliseconds(0);
+}
+
+} //End MediaIPC
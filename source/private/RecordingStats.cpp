@@ -0,0 +1,17 @@
+#include "../public/RecordingStats.h"
+
+namespace MediaIPC {
+
+RecordingStats::RecordingStats()
+{
+	this->videoFrames = 0;
+	this->audioBlocks = 0;
+	this->controlBlocks = 0;
+	this->bytes = 0;
+	this->writes = 0;
+	this->videoFramesDropped = 0;
+	this->videoFramesTorn = 0;
+	this->queuedBytes = 0;
+}
+
+} //End MediaIPC
@@ -1,44 +1,177 @@
 #include "RingBuffer.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cstring>
+#include <new>
 
 namespace MediaIPC {
 
-RingBuffer::RingBuffer(uint8_t* buffer, uint32_t size, uint32_t* head)
+RingBuffer::RingBuffer(uint8_t* buffer, uint64_t capacity, RingBufferHeader* header)
 {
 	this->buffer = buffer;
-	this->size = size;
-	this->head = head;
+	this->size = capacity;
+	this->header = header;
 }
 
-void RingBuffer::read(void* destination, uint32_t bytesToRead)
+void RingBuffer::reset()
 {
-	uint32_t currOffset = *this->head;
-	uint8_t* dest = (uint8_t*)destination;
-	while (bytesToRead > 0)
+	new (this->header) RingBufferHeader();
+	this->header->written.store(0, std::memory_order_relaxed);
+	this->header->reserved.store(0, std::memory_order_relaxed);
+	this->header->blocks.store(0, std::memory_order_relaxed);
+	for (uint32_t index = 0; index < MEDIA_IPC_RING_BLOCKS; ++index) {
+		this->header->records[index].generation.store(0, std::memory_order_relaxed);
+	}
+	
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+uint64_t RingBuffer::capacity() const {
+	return this->size;
+}
+
+uint64_t RingBuffer::writeIndex() const {
+	return this->header->written.load(std::memory_order_acquire);
+}
+
+uint64_t RingBuffer::available(uint64_t cursor) const {
+	return this->writeIndex() - cursor;
+}
+
+bool RingBuffer::read(uint64_t& cursor, void* destination, uint64_t bytesToRead, uint64_t& bytesLost) const
+{
+	bytesLost = 0;
+	if (bytesToRead > this->size) {
+		return false;
+	}
+	
+	while (true)
 	{
-		uint32_t readCount = std::min(bytesToRead, this->size - currOffset);
-		std::memcpy(dest, this->buffer + currOffset, readCount);
+		//If the producer has lapped us then skip forward to the oldest data that is still intact
+		uint64_t written = this->writeIndex();
+		if (written - cursor > this->size)
+		{
+			bytesLost += (written - this->size) - cursor;
+			cursor = written - this->size;
+		}
+		
+		//Don't read anything unless the full amount is available
+		if (written - cursor < bytesToRead) {
+			return false;
+		}
 		
-		currOffset = (currOffset + readCount) % this->size;
-		bytesToRead -= readCount;
-		dest += readCount;
+		//Copy the data, wrapping around the end of the buffer as needed
+		uint64_t offset = cursor % this->size;
+		uint64_t remaining = bytesToRead;
+		uint8_t* dest = (uint8_t*)destination;
+		while (remaining > 0)
+		{
+			uint64_t readCount = std::min(remaining, this->size - offset);
+			std::memcpy(dest, this->buffer + offset, readCount);
+			
+			offset = (offset + readCount) % this->size;
+			remaining -= readCount;
+			dest += readCount;
+		}
+		
+		//Verify that the producer did not begin overwriting the data while we were copying it
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t reserved = this->header->reserved.load(std::memory_order_relaxed);
+		if (reserved <= cursor + this->size)
+		{
+			cursor += bytesToRead;
+			return true;
+		}
+		
+		//The data was overwritten, so skip past it and try again
+		bytesLost += (reserved - this->size) - cursor;
+		cursor = reserved - this->size;
 	}
 }
 
-void RingBuffer::write(void* source, uint32_t bytesToWrite)
+bool RingBuffer::blockInfo(uint64_t position, FrameInfo& info) const
 {
-	uint8_t* src = (uint8_t*)source;
-	while (bytesToWrite > 0)
+	//Search backwards from the most recent block for the block containing the specified position
+	uint64_t latest = this->header->blocks.load(std::memory_order_acquire);
+	for (uint64_t sequence = latest; sequence > 0 && latest - sequence < MEDIA_IPC_RING_BLOCKS; --sequence)
 	{
-		uint32_t writeCount = std::min(bytesToWrite, this->size - *this->head);
-		std::memcpy(this->buffer + *this->head, src, writeCount);
+		//Copy the record and verify that it was not overwritten while we were copying it
+		const RingBufferBlock& record = this->header->records[sequence % MEDIA_IPC_RING_BLOCKS];
+		uint64_t generation = record.generation.load(std::memory_order_acquire);
+		uint64_t start = record.start;
+		uint64_t timestamp = record.timestamp;
+		int64_t pts = record.pts;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (generation != sequence * 2 || record.generation.load(std::memory_order_relaxed) != generation) {
+			return false;
+		}
+		
+		if (start <= position)
+		{
+			info.sequence = sequence;
+			info.timestamp = timestamp;
+			info.pts = pts;
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+uint64_t RingBuffer::recordBlock(int64_t pts)
+{
+	//We are the only writer, so relaxed loads of our own indices are sufficient
+	uint64_t sequence = this->header->blocks.load(std::memory_order_relaxed) + 1;
+	RingBufferBlock& record = this->header->records[sequence % MEDIA_IPC_RING_BLOCKS];
+	
+	//Populate the record under its seqlock and then publish the new sequence number
+	record.generation.store((sequence * 2) - 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	record.start = this->header->written.load(std::memory_order_relaxed);
+	record.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	record.pts = pts;
+	record.generation.store(sequence * 2, std::memory_order_release);
+	this->header->blocks.store(sequence, std::memory_order_release);
+	return sequence;
+}
+
+void RingBuffer::write(const void* source, uint64_t bytesToWrite)
+{
+	const uint8_t* src = (const uint8_t*)source;
+	while (bytesToWrite > 0 && this->size > 0)
+	{
+		uint64_t writeCount = bytesToWrite;
+		std::memcpy(this->acquire(writeCount), src, writeCount);
+		this->commit(writeCount);
 		
-		*this->head = (*this->head + writeCount) % this->size;
 		bytesToWrite -= writeCount;
 		src += writeCount;
 	}
 }
 
+uint8_t* RingBuffer::acquire(uint64_t& length)
+{
+	//We are the only writer, so a relaxed load of our own write index is sufficient
+	uint64_t written = this->header->written.load(std::memory_order_relaxed);
+	uint64_t offset = written % this->size;
+	length = std::min(length, this->size - offset);
+	
+	//Reserve the region before we modify it, so that consumers reading it will detect the tear
+	this->header->reserved.store(written + length, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	return this->buffer + offset;
+}
+
+void RingBuffer::commit(uint64_t bytesWritten)
+{
+	uint64_t written = this->header->written.load(std::memory_order_relaxed);
+	uint64_t reserved = this->header->reserved.load(std::memory_order_relaxed);
+	uint64_t committed = written + std::min(bytesWritten, reserved - written);
+	
+	//Publish the new data and release any portion of the reservation that was not used
+	this->header->written.store(committed, std::memory_order_release);
+	this->header->reserved.store(committed, std::memory_order_release);
+}
+
 } //End MediaIPC
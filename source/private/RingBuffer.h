@@ -1,22 +1,89 @@
 #ifndef _MEDIA_IPC_RING_BUFFER
 #define _MEDIA_IPC_RING_BUFFER
 
+#include "../public/FrameInfo.h"
 #include <stdint.h>
+#include <atomic>
 
 namespace MediaIPC {
 
+//The number of block records retained by a RingBuffer
+#define MEDIA_IPC_RING_BLOCKS 256
+
+//Metadata for a block of data written to a RingBuffer in a single operation
+struct RingBufferBlock
+{
+	//Seqlock for the record: twice the block's sequence number, or an odd value while the record is being written
+	std::atomic<uint64_t> generation;
+	
+	//The write index of the first byte of the block
+	uint64_t start;
+	
+	//The producer's steady clock time when the block was published, and the optional presentation timestamp
+	uint64_t timestamp;
+	int64_t pts;
+};
+
+//Monotonic write indices and block records for a RingBuffer, stored in shared memory
+struct RingBufferHeader
+{
+	//The total number of bytes that have been published to the ring since it was created
+	std::atomic<uint64_t> written;
+	
+	//The total number of bytes that the producer has started writing
+	//(This runs ahead of the written index while a write is in progress, which allows consumers to detect torn reads)
+	std::atomic<uint64_t> reserved;
+	
+	//The sequence number of the most recently recorded block, and the records for the most recent blocks
+	std::atomic<uint64_t> blocks;
+	RingBufferBlock records[MEDIA_IPC_RING_BLOCKS];
+};
+
+//Lock-free single-producer, multi-consumer byte ring stored in shared memory
+//(Each consumer maintains its own private read cursor, expressed in terms of the monotonic write index)
 class RingBuffer
 {
 	public:
-		RingBuffer(uint8_t* buffer, uint32_t size, uint32_t* head);
+		RingBuffer(uint8_t* buffer, uint64_t capacity, RingBufferHeader* header);
+		
+		//Initialises the write indices and block records (called by the producer prior to writing any data)
+		void reset();
+		
+		//Returns the capacity of the ring in bytes
+		uint64_t capacity() const;
+		
+		//Returns the total number of bytes that have been published to the ring
+		uint64_t writeIndex() const;
+		
+		//Returns the number of bytes available to a consumer with the specified read cursor
+		//(If this exceeds the capacity of the ring then the consumer has been overrun and the oldest data has been lost)
+		uint64_t available(uint64_t cursor) const;
+		
+		//Reads exactly the requested number of bytes starting at the specified read cursor and advances the cursor
+		//(Returns false without reading anything if fewer bytes are available, and reports any bytes skipped due to overruns)
+		bool read(uint64_t& cursor, void* destination, uint64_t bytesToRead, uint64_t& bytesLost) const;
+		
+		//Retrieves the metadata for the block containing the byte at the specified write index
+		//(Returns false if the block is too old for its record to have been retained)
+		bool blockInfo(uint64_t position, FrameInfo& info) const;
+		
+		//Records the start of a new block at the current write index, returning its sequence number
+		//(This should be called prior to writing or committing the data for the block)
+		uint64_t recordBlock(int64_t pts = FrameInfo::NoPts);
+		
+		//Copies data into the ring and publishes it
+		void write(const void* source, uint64_t bytesToWrite);
+		
+		//Returns a pointer to the contiguous region starting at the write index, clamping the length to the space before the end of the buffer
+		uint8_t* acquire(uint64_t& length);
 		
-		void read(void* destination, uint32_t bytesToRead);
-		void write(void* source, uint32_t bytesToWrite);
+		//Publishes bytes that were written in place via acquire()
+		void commit(uint64_t bytesWritten);
 		
 	private:
 		uint8_t* buffer;
-		uint32_t size;
-		uint32_t* head;
+		uint64_t size;
+		RingBufferHeader* header;
 };
 
 } //End MediaIPC
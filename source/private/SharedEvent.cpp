@@ -0,0 +1,86 @@
+#include "SharedEvent.h"
+#include <thread>
+
+#ifdef __linux__
+	#include <climits>
+	#include <ctime>
+	#include <linux/futex.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
+
+namespace MediaIPC {
+
+#ifdef __linux__
+namespace
+{
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "std::atomic<uint32_t> must be usable as a futex word");
+	
+	//Note that we deliberately avoid FUTEX_PRIVATE_FLAG, since the futex word is shared between processes
+	long futex(std::atomic<uint32_t>* word, int op, uint32_t value, const struct timespec* timeout) {
+		return syscall(SYS_futex, (uint32_t*)(word), op, value, timeout, nullptr, 0);
+	}
+}
+#endif
+
+void SharedEvent::reset()
+{
+	this->counter.store(0, std::memory_order_relaxed);
+	this->waiting.store(0, std::memory_order_relaxed);
+}
+
+uint32_t SharedEvent::current() const {
+	return this->counter.load(std::memory_order_acquire);
+}
+
+void SharedEvent::notify()
+{
+	this->counter.fetch_add(1, std::memory_order_seq_cst);
+	
+	#ifdef __linux__
+	if (this->waiting.exchange(0, std::memory_order_seq_cst) != 0) {
+		futex(&this->counter, FUTEX_WAKE, INT_MAX, nullptr);
+	}
+	#endif
+}
+
+bool SharedEvent::wait(uint32_t lastSeen, std::chrono::microseconds timeout)
+{
+	//Determine the point in time at which we give up waiting
+	auto deadline = std::chrono::steady_clock::now() + timeout;
+	
+	#ifdef __linux__
+	
+	//Mark the event as having a waiter before each check of the counter, so the producer cannot miss us between the check and the wait
+	//(The producer clears the flag each time it wakes waiters, so we set it again whenever we go back to sleep)
+	while (true)
+	{
+		this->waiting.store(1, std::memory_order_seq_cst);
+		if (this->counter.load(std::memory_order_seq_cst) != lastSeen) {
+			break;
+		}
+		
+		auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now());
+		if (remaining.count() <= 0) {
+			break;
+		}
+		
+		struct timespec relative;
+		relative.tv_sec = (time_t)(remaining.count() / 1000000000);
+		relative.tv_nsec = (long)(remaining.count() % 1000000000);
+		futex(&this->counter, FUTEX_WAIT, lastSeen, &relative);
+	}
+	
+	#else
+	
+	//Poll the counter until it changes or the timeout expires
+	while (this->counter.load(std::memory_order_acquire) == lastSeen && std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	
+	#endif
+	
+	return (this->counter.load(std::memory_order_acquire) != lastSeen);
+}
+
+} //End MediaIPC
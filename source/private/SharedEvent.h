@@ -0,0 +1,42 @@
+#ifndef _MEDIA_IPC_SHARED_EVENT
+#define _MEDIA_IPC_SHARED_EVENT
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+namespace MediaIPC {
+
+//Cross-process event stored in shared memory, which consumers can block on until the producer signals it
+//(Under Linux waiting is implemented with a futex, and under other platforms we fall back to polling the counter)
+class SharedEvent
+{
+	public:
+		
+		//Initialises the event (called by the producer when it creates the shared memory)
+		void reset();
+		
+		//Returns the number of times the event has been signalled so far
+		uint32_t current() const;
+		
+		//Signals the event, waking any consumers that are currently waiting on it
+		void notify();
+		
+		//Waits until the event has been signalled since the specified count was observed, or until the timeout expires
+		//(Returns true if the event was signalled, or false if the timeout expired)
+		bool wait(uint32_t lastSeen, std::chrono::microseconds timeout);
+		
+	private:
+		
+		//The number of times the event has been signalled (this is the futex word under Linux)
+		std::atomic<uint32_t> counter;
+		
+		//Set by each consumer before it blocks on the event, and cleared by the producer when it wakes them
+		//(This allows the producer to skip the wake system call when nobody is waiting, and unlike a count of waiters it cannot be
+		//left set indefinitely by a consumer that dies while waiting, since the next signal clears it)
+		std::atomic<uint32_t> waiting;
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,144 @@
+#include "SharedMutex.h"
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+	#include <ctime>
+#else
+	#include <boost/date_time/posix_time/posix_time_types.hpp>
+#endif
+
+namespace MediaIPC {
+
+#ifdef __linux__
+namespace
+{
+	//Marks the mutex as consistent again if its previous owner died while holding it, and reports any other error
+	//(Returns true if the mutex was acquired, or false if the timeout expired or the mutex was already locked)
+	bool acquired(pthread_mutex_t* mutex, int result, std::atomic<uint64_t>& recovered)
+	{
+		if (result == EOWNERDEAD)
+		{
+			//The state protected by the mutex is only ever modified by the producer, and a producer that died
+			//part-way through an update has ended the stream anyway, so the mutex can simply be marked as consistent
+			pthread_mutex_consistent(mutex);
+			recovered.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+		
+		if (result == EBUSY || result == ETIMEDOUT) {
+			return false;
+		}
+		
+		if (result != 0) {
+			throw std::runtime_error("failed to lock the shared mutex: " + std::string(std::strerror(result)));
+		}
+		
+		return true;
+	}
+}
+#endif
+
+void SharedMutex::reset()
+{
+	#ifdef __linux__
+	
+	//Request priority inheritance, falling back to a robust mutex without it if the kernel does not support PI futexes
+	pthread_mutexattr_t attributes;
+	pthread_mutexattr_init(&attributes);
+	pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+	pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+	pthread_mutexattr_setprotocol(&attributes, PTHREAD_PRIO_INHERIT);
+	int result = pthread_mutex_init(&this->mutex, &attributes);
+	if (result == ENOTSUP)
+	{
+		pthread_mutexattr_setprotocol(&attributes, PTHREAD_PRIO_NONE);
+		result = pthread_mutex_init(&this->mutex, &attributes);
+	}
+	
+	pthread_mutexattr_destroy(&attributes);
+	if (result != 0) {
+		throw std::runtime_error("failed to initialise the shared mutex: " + std::string(std::strerror(result)));
+	}
+	
+	#else
+	new (&this->mutex) boost::interprocess::interprocess_mutex();
+	#endif
+	
+	this->recovered.store(0, std::memory_order_relaxed);
+	this->lock();
+	this->ready.store(1, std::memory_order_release);
+}
+
+bool SharedMutex::waitUntilReady(std::chrono::milliseconds timeout) const
+{
+	//The producer initialises the mutex immediately after creating the shared memory, so we only ever wait briefly
+	auto deadline = (timeout == std::chrono::milliseconds::max()) ? std::chrono::steady_clock::time_point::max() : std::chrono::steady_clock::now() + timeout;
+	while (this->ready.load(std::memory_order_acquire) == 0)
+	{
+		if (std::chrono::steady_clock::now() >= deadline) {
+			return false;
+		}
+		
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	
+	return true;
+}
+
+void SharedMutex::lock()
+{
+	#ifdef __linux__
+	acquired(&this->mutex, pthread_mutex_lock(&this->mutex), this->recovered);
+	#else
+	this->mutex.lock();
+	#endif
+}
+
+bool SharedMutex::try_lock()
+{
+	#ifdef __linux__
+	return acquired(&this->mutex, pthread_mutex_trylock(&this->mutex), this->recovered);
+	#else
+	return this->mutex.try_lock();
+	#endif
+}
+
+bool SharedMutex::tryLockFor(std::chrono::nanoseconds timeout)
+{
+	#ifdef __linux__
+	
+	//pthread_mutex_timedlock() expects an absolute time measured against the realtime clock
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	int64_t nanoseconds = (int64_t)(deadline.tv_nsec) + (timeout.count() % 1000000000);
+	deadline.tv_sec += (time_t)(timeout.count() / 1000000000 + nanoseconds / 1000000000);
+	deadline.tv_nsec = (long)(nanoseconds % 1000000000);
+	return acquired(&this->mutex, pthread_mutex_timedlock(&this->mutex, &deadline), this->recovered);
+	
+	#else
+	
+	auto deadline = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::microseconds(timeout.count() / 1000);
+	return this->mutex.timed_lock(deadline);
+	
+	#endif
+}
+
+void SharedMutex::unlock()
+{
+	#ifdef __linux__
+	pthread_mutex_unlock(&this->mutex);
+	#else
+	this->mutex.unlock();
+	#endif
+}
+
+uint64_t SharedMutex::recoveries() const {
+	return this->recovered.load(std::memory_order_relaxed);
+}
+
+} //End MediaIPC
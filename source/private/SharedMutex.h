@@ -0,0 +1,70 @@
+#ifndef _MEDIA_IPC_SHARED_MUTEX
+#define _MEDIA_IPC_SHARED_MUTEX
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#ifdef __linux__
+	#include <pthread.h>
+#else
+	#define BOOST_DATE_TIME_NO_LIB
+	#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#endif
+
+namespace MediaIPC {
+
+//Cross-process mutex stored in shared memory, which the producer and its consumers lock to access the control block and track table
+//(Under Linux this is a robust, priority-inheriting process-shared pthread mutex, so a process that dies while holding it cannot
+//stall the stream and a low-priority consumer holding it is boosted while a higher-priority thread waits; under other platforms
+//we fall back to a regular interprocess mutex)
+class SharedMutex
+{
+	public:
+		
+		//Initialises the mutex and returns with it locked by the calling thread, then marks it as ready for other processes to use
+		//(Called by the producer when it creates the shared memory, so that consumers block until the shared state is populated)
+		void reset();
+		
+		//Waits until the producer has initialised the mutex, returning false if the timeout expires first
+		//(The maximum duration waits indefinitely)
+		bool waitUntilReady(std::chrono::milliseconds timeout) const;
+		
+		//Locks the mutex, recovering it if the process that held it died while doing so
+		//(The recovering thread holds the mutex as normal, and the recovery is recorded so that it appears in the telemetry)
+		void lock();
+		
+		//Attempts to lock the mutex without blocking, returning true if the mutex was acquired
+		bool try_lock();
+		
+		//Attempts to lock the mutex, waiting until the timeout expires, and returns true if the mutex was acquired
+		bool tryLockFor(std::chrono::nanoseconds timeout);
+		
+		//Unlocks the mutex
+		void unlock();
+		
+		//Returns the number of times the mutex has been recovered from a process that died while holding it
+		uint64_t recoveries() const;
+		
+	private:
+		
+		#ifdef __linux__
+		pthread_mutex_t mutex;
+		#else
+		boost::interprocess::interprocess_mutex mutex;
+		#endif
+		
+		//Non-zero once the producer has initialised the mutex
+		std::atomic<uint32_t> ready;
+		
+		//The number of times the mutex has been recovered from a dead owner
+		std::atomic<uint64_t> recovered;
+};
+
+//Scoped lock for the shared mutex
+typedef std::lock_guard<SharedMutex> MutexLock;
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef _MEDIA_IPC_SHARED_STATE
+#define _MEDIA_IPC_SHARED_STATE
+
+#include "../public/ControlBlock.h"
+#include "../public/Track.h"
+#include "FrameRing.h"
+#include "RingBuffer.h"
+#include "SharedEvent.h"
+#include "SharedMutex.h"
+#include "Telemetry.h"
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+
+namespace MediaIPC {
+
+//The description and lock-free state of a single track
+struct TrackState
+{
+	//The name of the track (null-terminated)
+	char name[MEDIA_IPC_MAX_TRACK_NAME];
+	
+	//The video and audio parameters of the track
+	ControlBlock controlBlock;
+	
+	//The number of times the producer has reconfigured the track
+	uint64_t generation;
+	
+	//The offsets of the track's frame ring within the video buffer and its sample ring within the audio buffer
+	uint64_t videoOffset;
+	uint64_t audioOffset;
+	
+	//The audio write index at which the track's current sample ring begins
+	//(Samples before this index were written to the ring the track used prior to its most recent move)
+	uint64_t audioStartIndex;
+	
+	//The write indices and block records for the track's audio ring
+	alignas(MEDIA_IPC_CACHE_LINE) RingBufferHeader audioRing;
+	
+	//Returns the number of bytes of the video buffer occupied by the frame ring of a track with the specified parameters
+	static uint64_t videoRegionSize(const ControlBlock& cb) {
+		return FrameRing::requiredSize(cb.videoSlots, cb.calculateVideoBufsize(), cb.videoAlignment);
+	}
+	
+	//Returns the number of bytes of the audio buffer occupied by the sample ring of a track with the specified parameters
+	//(This is never zero, so that the audio buffer can always be created)
+	static uint64_t audioRegionSize(const ControlBlock& cb) {
+		return std::max((uint64_t)1, cb.calculateAudioRingSize());
+	}
+};
+
+//Lock-free state shared between the producer and its consumers
+//(This is stored in the control block shared memory, immediately following the ControlBlock itself)
+struct SharedState
+{
+	//Locked by the producer while it updates the control block and the track table, and by consumers while they read them
+	alignas(MEDIA_IPC_CACHE_LINE) SharedMutex statusMutex;
+	
+	//Signalled by the producer each time it publishes a video frame on any track
+	alignas(MEDIA_IPC_CACHE_LINE) SharedEvent videoEvent;
+	
+	//Signalled by the producer each time it publishes a buffer of audio samples on any track
+	alignas(MEDIA_IPC_CACHE_LINE) SharedEvent audioEvent;
+	
+	//Telemetry counters for the producer and each of its consumers (these cover every track)
+	Telemetry telemetry;
+	
+	//Incremented by the producer each time it reconfigures a track, so that consumers can detect changes without locking
+	//(Consumers re-read the track table while holding the status mutex once they see a new value)
+	std::atomic<uint64_t> generation;
+	
+	//The process ID of the producer, so that consumers can distinguish a producer that is still streaming from one that crashed
+	//(A producer that exits without stopping leaves the status flag in the control block set)
+	std::atomic<uint32_t> producerProcessId;
+	
+	//The number of times the video and audio buffers have been recreated because a reconfigured track did not fit
+	//(Each recreated buffer has a new name, see ObjectNames::generation())
+	uint32_t videoBufferGeneration;
+	uint32_t audioBufferGeneration;
+	
+	//The number of tracks published by the producer, and the state of each track
+	//(The first track is also described by the ControlBlock itself, for consumers that are not aware of tracks)
+	uint32_t trackCount;
+	TrackState tracks[MEDIA_IPC_MAX_TRACKS];
+	
+	//Initialises the shared state (called by the producer when it creates the control block shared memory)
+	//(This returns with the status mutex locked by the calling thread, so that consumers cannot read the control block until it is populated)
+	void reset()
+	{
+		this->videoEvent.reset();
+		this->audioEvent.reset();
+		this->telemetry.reset();
+		this->generation.store(0, std::memory_order_relaxed);
+		this->producerProcessId.store(currentProcessId(), std::memory_order_relaxed);
+		this->videoBufferGeneration = 0;
+		this->audioBufferGeneration = 0;
+		this->trackCount = 0;
+		this->statusMutex.reset();
+	}
+	
+	//Determines if the producer that initialised the shared state is still running
+	bool producerRunning() const {
+		return processExists(this->producerProcessId.load(std::memory_order_relaxed));
+	}
+	
+	//Returns the offset of the shared state from the start of the control block shared memory
+	static uint64_t offset() {
+		return ((sizeof(ControlBlock) + MEDIA_IPC_CACHE_LINE - 1) / MEDIA_IPC_CACHE_LINE) * MEDIA_IPC_CACHE_LINE;
+	}
+	
+	//Returns the total size of the control block shared memory
+	static uint64_t controlBlockMemorySize() {
+		return SharedState::offset() + sizeof(SharedState);
+	}
+	
+	//Locates the shared state within the control block shared memory
+	static SharedState* locate(void* controlBlockMemory) {
+		return (SharedState*)((uint8_t*)(controlBlockMemory) + SharedState::offset());
+	}
+};
+
+} //End MediaIPC
+
+#endif
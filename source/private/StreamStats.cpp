@@ -0,0 +1,119 @@
+#include "../public/StreamStats.h"
+#include "IPCUtils.h"
+#include "MemoryUtils.h"
+#include "ObjectNames.h"
+#include "SharedState.h"
+
+namespace MediaIPC {
+
+ProducerStats::ProducerStats()
+{
+	this->videoFramesSubmitted = 0;
+	this->videoBytesCopied = 0;
+	this->audioBlocksSubmitted = 0;
+	this->audioBytesSubmitted = 0;
+	this->audioBytesCopied = 0;
+	this->videoFramesUnobserved = 0;
+	this->audioBlocksUnobserved = 0;
+	this->statusLockContentions = 0;
+	this->statusLockWaitNanoseconds = 0;
+}
+
+ConsumerStats::ConsumerStats()
+{
+	this->processId = 0;
+	this->index = 0;
+	this->heartbeat = 0;
+	this->lastVideoSequence = 0;
+	this->lastAudioSequence = 0;
+	this->videoSamplingInterval = 0;
+	this->audioSamplingInterval = 0;
+	this->videoFramesConsumed = 0;
+	this->videoDuplicates = 0;
+	this->videoFramesSkipped = 0;
+	this->videoBytesCopied = 0;
+	this->audioBuffersConsumed = 0;
+	this->audioBytesCopied = 0;
+	this->audioBytesLost = 0;
+	this->audioUnderruns = 0;
+	this->statusLockContentions = 0;
+	this->statusLockWaitNanoseconds = 0;
+}
+
+StreamStats::StreamStats()
+{
+	this->unregisteredConsumers = 0;
+	this->statusLockRecoveries = 0;
+}
+
+StatsReader::StatsReader(const std::string& prefix)
+{
+	ObjectNames names(prefix);
+	this->controlBlockMemory = MemoryUtils::toPointer(IPCUtils::getMemoryOnceExists(names.controlBlockMemory, ipc::read_only));
+	this->sharedState = SharedState::locate(this->controlBlockMemory->mapped->get_address());
+}
+
+//Needed so that client code doesn't require definitions for our forward-declared types
+StatsReader::~StatsReader() {}
+
+StreamStats StatsReader::sample() const {
+	return sampleTelemetry(*this->sharedState);
+}
+
+StreamStats sampleTelemetry(const SharedState& state)
+{
+	StreamStats stats;
+	const Telemetry& telemetry = state.telemetry;
+	
+	const ProducerCounters& producer = telemetry.producer;
+	stats.producer.videoFramesSubmitted = producer.videoFramesSubmitted.load(std::memory_order_relaxed);
+	stats.producer.videoBytesCopied = producer.videoBytesCopied.load(std::memory_order_relaxed);
+	stats.producer.audioBlocksSubmitted = producer.audioBlocksSubmitted.load(std::memory_order_relaxed);
+	stats.producer.audioBytesSubmitted = producer.audioBytesSubmitted.load(std::memory_order_relaxed);
+	stats.producer.audioBytesCopied = producer.audioBytesCopied.load(std::memory_order_relaxed);
+	stats.producer.videoFramesUnobserved = producer.videoFramesUnobserved.load(std::memory_order_relaxed);
+	stats.producer.audioBlocksUnobserved = producer.audioBlocksUnobserved.load(std::memory_order_relaxed);
+	stats.producer.statusLockContentions = producer.statusLockContentions.load(std::memory_order_relaxed);
+	stats.producer.statusLockWaitNanoseconds = producer.statusLockWaitNanoseconds.load(std::memory_order_relaxed);
+	
+	for (uint32_t index = 0; index < MEDIA_IPC_MAX_CONSUMER_STATS; ++index)
+	{
+		//Skip any counters that are not currently claimed by a consumer
+		const ConsumerCounters& consumer = telemetry.consumers[index];
+		if (consumer.claimed.load(std::memory_order_acquire) == 0) {
+			continue;
+		}
+		
+		ConsumerStats consumerStats;
+		consumerStats.processId = consumer.processId.load(std::memory_order_acquire);
+		consumerStats.index = index;
+		consumerStats.heartbeat = consumer.heartbeat.load(std::memory_order_relaxed);
+		consumerStats.lastVideoSequence = consumer.lastVideoSequence.load(std::memory_order_relaxed);
+		consumerStats.lastAudioSequence = consumer.lastAudioSequence.load(std::memory_order_relaxed);
+		consumerStats.videoSamplingInterval = consumer.videoSamplingInterval.load(std::memory_order_relaxed);
+		consumerStats.audioSamplingInterval = consumer.audioSamplingInterval.load(std::memory_order_relaxed);
+		consumerStats.videoFramesConsumed = consumer.videoFramesConsumed.load(std::memory_order_relaxed);
+		consumerStats.videoDuplicates = consumer.videoDuplicates.load(std::memory_order_relaxed);
+		consumerStats.videoFramesSkipped = consumer.videoFramesSkipped.load(std::memory_order_relaxed);
+		consumerStats.videoBytesCopied = consumer.videoBytesCopied.load(std::memory_order_relaxed);
+		consumerStats.audioBuffersConsumed = consumer.audioBuffersConsumed.load(std::memory_order_relaxed);
+		consumerStats.audioBytesCopied = consumer.audioBytesCopied.load(std::memory_order_relaxed);
+		consumerStats.audioBytesLost = consumer.audioBytesLost.load(std::memory_order_relaxed);
+		consumerStats.audioUnderruns = consumer.audioUnderruns.load(std::memory_order_relaxed);
+		consumerStats.statusLockContentions = consumer.statusLockContentions.load(std::memory_order_relaxed);
+		consumerStats.statusLockWaitNanoseconds = consumer.statusLockWaitNanoseconds.load(std::memory_order_relaxed);
+		stats.consumers.push_back(consumerStats);
+	}
+	
+	for (const std::atomic<uint32_t>& entry : telemetry.unregisteredConsumers)
+	{
+		if (entry.load(std::memory_order_relaxed) != 0) {
+			stats.unregisteredConsumers += 1;
+		}
+	}
+	
+	stats.statusLockRecoveries = state.statusMutex.recoveries();
+	return stats;
+}
+
+} //End MediaIPC
@@ -0,0 +1,237 @@
+#include "Telemetry.h"
+#include <chrono>
+#include <new>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <errno.h>
+	#include <signal.h>
+	#include <unistd.h>
+#endif
+
+namespace MediaIPC {
+
+uint32_t currentProcessId()
+{
+	#ifdef _WIN32
+		return (uint32_t)(GetCurrentProcessId());
+	#else
+		return (uint32_t)(getpid());
+	#endif
+}
+
+bool processExists(uint32_t processId)
+{
+	#ifdef _WIN32
+		HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)(processId));
+		if (process == nullptr) {
+			return GetLastError() != ERROR_INVALID_PARAMETER;
+		}
+		
+		bool running = (WaitForSingleObject(process, 0) == WAIT_TIMEOUT);
+		CloseHandle(process);
+		return running;
+	#else
+		return kill((pid_t)(processId), 0) == 0 || errno != ESRCH;
+	#endif
+}
+
+void ConsumerCounters::reset()
+{
+	this->videoFramesConsumed.store(0, std::memory_order_relaxed);
+	this->videoDuplicates.store(0, std::memory_order_relaxed);
+	this->videoFramesSkipped.store(0, std::memory_order_relaxed);
+	this->videoBytesCopied.store(0, std::memory_order_relaxed);
+	this->audioBuffersConsumed.store(0, std::memory_order_relaxed);
+	this->audioBytesCopied.store(0, std::memory_order_relaxed);
+	this->audioBytesLost.store(0, std::memory_order_relaxed);
+	this->audioUnderruns.store(0, std::memory_order_relaxed);
+	this->heartbeat.store(0, std::memory_order_relaxed);
+	this->lastVideoSequence.store(0, std::memory_order_relaxed);
+	this->lastAudioSequence.store(0, std::memory_order_relaxed);
+	this->videoSamplingInterval.store(0, std::memory_order_relaxed);
+	this->audioSamplingInterval.store(0, std::memory_order_relaxed);
+	this->statusLockContentions.store(0, std::memory_order_relaxed);
+	this->statusLockWaitNanoseconds.store(0, std::memory_order_relaxed);
+	this->doorbell.store(0, std::memory_order_relaxed);
+	this->doorbellArmed.store(0, std::memory_order_relaxed);
+}
+
+void ConsumerCounters::beat() {
+	this->heartbeat.store(telemetryTimestamp(), std::memory_order_relaxed);
+}
+
+void Telemetry::reset()
+{
+	new (this) Telemetry();
+	this->producer.videoFramesSubmitted.store(0, std::memory_order_relaxed);
+	this->producer.videoBytesCopied.store(0, std::memory_order_relaxed);
+	this->producer.audioBlocksSubmitted.store(0, std::memory_order_relaxed);
+	this->producer.audioBytesSubmitted.store(0, std::memory_order_relaxed);
+	this->producer.audioBytesCopied.store(0, std::memory_order_relaxed);
+	this->producer.videoFramesUnobserved.store(0, std::memory_order_relaxed);
+	this->producer.audioBlocksUnobserved.store(0, std::memory_order_relaxed);
+	this->producer.statusLockContentions.store(0, std::memory_order_relaxed);
+	this->producer.statusLockWaitNanoseconds.store(0, std::memory_order_relaxed);
+	
+	for (ConsumerCounters& consumer : this->consumers)
+	{
+		consumer.claimed.store(0, std::memory_order_relaxed);
+		consumer.processId.store(0, std::memory_order_relaxed);
+		consumer.reset();
+	}
+	
+	for (std::atomic<uint32_t>& entry : this->unregisteredConsumers) {
+		entry.store(0, std::memory_order_relaxed);
+	}
+	
+	this->registryVersion.store(0, std::memory_order_relaxed);
+	this->doorbells.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+ConsumerCounters* Telemetry::claimConsumer()
+{
+	for (ConsumerCounters& consumer : this->consumers)
+	{
+		//Claim the counters with our process ID, so that they can be reclaimed even if we die before publishing anything else
+		uint32_t expected = 0;
+		if (consumer.claimed.compare_exchange_strong(expected, currentProcessId(), std::memory_order_acq_rel))
+		{
+			//Start the heartbeat before publishing our process ID, so the producer never sees a stale heartbeat for a live process
+			consumer.reset();
+			consumer.beat();
+			consumer.processId.store(currentProcessId(), std::memory_order_release);
+			this->registryVersion.fetch_add(1, std::memory_order_release);
+			return &consumer;
+		}
+	}
+	
+	return nullptr;
+}
+
+void Telemetry::releaseConsumer(ConsumerCounters* counters)
+{
+	if (counters->doorbell.exchange(0, std::memory_order_acq_rel) != 0) {
+		this->doorbells.fetch_sub(1, std::memory_order_relaxed);
+	}
+	
+	counters->processId.store(0, std::memory_order_relaxed);
+	counters->claimed.store(0, std::memory_order_release);
+	this->registryVersion.fetch_add(1, std::memory_order_release);
+}
+
+void Telemetry::registerDoorbell(ConsumerCounters* counters, uint32_t id)
+{
+	counters->doorbellArmed.store(0, std::memory_order_relaxed);
+	counters->doorbell.store(id, std::memory_order_release);
+	this->doorbells.fetch_add(1, std::memory_order_release);
+}
+
+uint32_t Telemetry::addUnregisteredConsumer()
+{
+	uint32_t processId = currentProcessId();
+	for (uint32_t index = 0; index < MEDIA_IPC_MAX_UNREGISTERED_CONSUMERS; ++index)
+	{
+		uint32_t expected = 0;
+		if (this->unregisteredConsumers[index].compare_exchange_strong(expected, processId, std::memory_order_acq_rel))
+		{
+			this->registryVersion.fetch_add(1, std::memory_order_release);
+			return index;
+		}
+	}
+	
+	return UINT32_MAX;
+}
+
+void Telemetry::removeUnregisteredConsumer(uint32_t entry)
+{
+	if (entry < MEDIA_IPC_MAX_UNREGISTERED_CONSUMERS)
+	{
+		this->unregisteredConsumers[entry].store(0, std::memory_order_release);
+		this->registryVersion.fetch_add(1, std::memory_order_release);
+	}
+}
+
+uint32_t Telemetry::reclaimConsumers(uint64_t now, uint64_t timeout, const std::function<bool(uint32_t)>& reclaim)
+{
+	//Consumers without counters have no heartbeat, so their entries are released as soon as their process no longer exists
+	uint32_t attached = 0;
+	for (std::atomic<uint32_t>& entry : this->unregisteredConsumers)
+	{
+		uint32_t processId = entry.load(std::memory_order_acquire);
+		if (processId == 0) {
+			continue;
+		}
+		
+		if (processExists(processId) == false)
+		{
+			if (entry.compare_exchange_strong(processId, 0, std::memory_order_acq_rel)) {
+				this->registryVersion.fetch_add(1, std::memory_order_release);
+			}
+			
+			continue;
+		}
+		
+		attached += 1;
+	}
+	
+	for (uint32_t index = 0; index < MEDIA_IPC_MAX_CONSUMER_STATS; ++index)
+	{
+		ConsumerCounters& consumer = this->consumers[index];
+		uint32_t processId = consumer.claimed.load(std::memory_order_acquire);
+		if (processId == 0) {
+			continue;
+		}
+		
+		//The claim itself records the consumer's process ID, so a consumer that died part-way through claiming its counters is
+		//reclaimed like any other (its heartbeat is either zero or that of the previous owner)
+		//(A consumer that has stopped beating but whose process still exists may simply be stalled, so it is not reclaimed)
+		uint64_t heartbeat = consumer.heartbeat.load(std::memory_order_relaxed);
+		if (heartbeat + timeout < now && processExists(processId) == false && reclaim(index) == true)
+		{
+			this->releaseConsumer(&consumer);
+			continue;
+		}
+		
+		attached += 1;
+	}
+	
+	return attached;
+}
+
+InstrumentedMutexLock::InstrumentedMutexLock(SharedMutex& mutex, std::atomic<uint64_t>& contentions, std::atomic<uint64_t>& waitNanoseconds, std::chrono::milliseconds timeout) :
+	mutex(mutex)
+{
+	this->locked = this->mutex.try_lock();
+	if (this->locked == false)
+	{
+		auto start = std::chrono::steady_clock::now();
+		if (timeout == std::chrono::milliseconds::max())
+		{
+			this->mutex.lock();
+			this->locked = true;
+		}
+		else {
+			this->locked = this->mutex.tryLockFor(timeout);
+		}
+		
+		auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+		countEvent(contentions);
+		countEvent(waitNanoseconds, waited.count());
+	}
+}
+
+InstrumentedMutexLock::~InstrumentedMutexLock()
+{
+	if (this->locked == true) {
+		this->mutex.unlock();
+	}
+}
+
+bool InstrumentedMutexLock::owns() const {
+	return this->locked;
+}
+
+} //End MediaIPC
@@ -0,0 +1,176 @@
+#ifndef _MEDIA_IPC_TELEMETRY
+#define _MEDIA_IPC_TELEMETRY
+
+#include "FrameRing.h"
+#include "IPCUtils.h"
+#include "SharedMutex.h"
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+namespace MediaIPC {
+
+class StreamStats;
+struct SharedState;
+
+//The maximum number of consumers whose counters can be recorded at once
+//(The index of a consumer's counters also identifies the pins it holds on frame slots, see FrameRing.h)
+#define MEDIA_IPC_MAX_CONSUMER_STATS MEDIA_IPC_MAX_PIN_OWNERS
+
+//The maximum number of consumers without counters that can be tracked by process ID once every set of counters is claimed
+#define MEDIA_IPC_MAX_UNREGISTERED_CONSUMERS 64
+
+//Counters updated by the producer
+//(All counters are monotonic and updated with relaxed atomic increments, so they are cheap enough to leave enabled)
+struct ProducerCounters
+{
+	alignas(MEDIA_IPC_CACHE_LINE) std::atomic<uint64_t> videoFramesSubmitted;
+	std::atomic<uint64_t> videoBytesCopied;
+	std::atomic<uint64_t> audioBlocksSubmitted;
+	std::atomic<uint64_t> audioBytesSubmitted;
+	std::atomic<uint64_t> audioBytesCopied;
+	
+	//Video frames and audio blocks that were submitted while no consumers were attached, and so were never copied
+	std::atomic<uint64_t> videoFramesUnobserved;
+	std::atomic<uint64_t> audioBlocksUnobserved;
+	
+	//The number of times the status mutex was contended, and the total time spent waiting for it
+	std::atomic<uint64_t> statusLockContentions;
+	std::atomic<uint64_t> statusLockWaitNanoseconds;
+};
+
+//Counters updated by a single consumer
+//(Each set of counters also serves as the consumer's slot in the registry of attached consumers)
+struct ConsumerCounters
+{
+	//The process ID of the consumer that has claimed the counters (zero while they are unclaimed), and the same process ID once
+	//the consumer has finished initialising the counters
+	alignas(MEDIA_IPC_CACHE_LINE) std::atomic<uint32_t> claimed;
+	std::atomic<uint32_t> processId;
+	
+	//The steady clock time at which one of the consumer's sampling loops last ran, in nanoseconds since the clock's epoch
+	std::atomic<uint64_t> heartbeat;
+	
+	//The sequence numbers of the video frame and audio block that the consumer most recently passed to a delegate
+	std::atomic<uint64_t> lastVideoSequence;
+	std::atomic<uint64_t> lastAudioSequence;
+	
+	//The shortest interval at which the consumer polls for video and audio, in nanoseconds
+	//(This is zero when the consumer samples on notification, or has no tracks that transmit the media type)
+	std::atomic<uint64_t> videoSamplingInterval;
+	std::atomic<uint64_t> audioSamplingInterval;
+	
+	//Distinct video frames delivered, frames sampled again because nothing new had been published,
+	//and frames the producer published that were never sampled
+	std::atomic<uint64_t> videoFramesConsumed;
+	std::atomic<uint64_t> videoDuplicates;
+	std::atomic<uint64_t> videoFramesSkipped;
+	std::atomic<uint64_t> videoBytesCopied;
+	
+	std::atomic<uint64_t> audioBuffersConsumed;
+	std::atomic<uint64_t> audioBytesCopied;
+	std::atomic<uint64_t> audioBytesLost;
+	std::atomic<uint64_t> audioUnderruns;
+	
+	//The number of times the status mutex was contended, and the total time spent waiting for it
+	std::atomic<uint64_t> statusLockContentions;
+	std::atomic<uint64_t> statusLockWaitNanoseconds;
+	
+	//The ID of the doorbell that the consumer waits on (zero if it does not have one), and whether it is waiting on it
+	//(The consumer sets doorbellArmed before it waits, and the producer clears it when it rings the doorbell, see Doorbell.h)
+	std::atomic<uint32_t> doorbell;
+	std::atomic<uint32_t> doorbellArmed;
+	
+	//Zeroes every counter
+	void reset();
+	
+	//Records that one of the consumer's sampling loops is still running
+	void beat();
+};
+
+//Telemetry counters shared between the producer and its consumers
+struct Telemetry
+{
+	ProducerCounters producer;
+	ConsumerCounters consumers[MEDIA_IPC_MAX_CONSUMER_STATS];
+	
+	//Incremented each time a consumer attaches or detaches, so the producer can detect changes without scanning the registry
+	std::atomic<uint32_t> registryVersion;
+	
+	//The process IDs of attached consumers that could not claim a set of counters because every set was already claimed
+	//(Each entry is zero when unused, and the entries of consumers whose process has exited are released like their counters
+	//would have been; consumers that find every entry in use as well are not counted as attached)
+	std::atomic<uint32_t> unregisteredConsumers[MEDIA_IPC_MAX_UNREGISTERED_CONSUMERS];
+	
+	//The number of consumers that have registered a doorbell, so the producer can skip the registry when there are none
+	std::atomic<uint32_t> doorbells;
+	
+	//Initialises every counter (called by the producer when it creates the shared memory)
+	void reset();
+	
+	//Claims a set of consumer counters for the calling process (returns nullptr if every set is already claimed)
+	ConsumerCounters* claimConsumer();
+	
+	//Releases a set of consumer counters claimed by claimConsumer()
+	void releaseConsumer(ConsumerCounters* counters);
+	
+	//Registers the doorbell of a consumer that has claimed a set of counters (it is removed when the counters are released)
+	void registerDoorbell(ConsumerCounters* counters, uint32_t id);
+	
+	//Records the attachment or detachment of a consumer that could not claim a set of counters
+	//(The attachment returns the index of the entry recording the consumer's process ID, or UINT32_MAX if every entry is in use)
+	uint32_t addUnregisteredConsumer();
+	void removeUnregisteredConsumer(uint32_t entry);
+	
+	//Releases the counters of any consumer whose heartbeat is older than the timeout and whose process no longer exists,
+	//along with the entries of consumers without counters whose process no longer exists, and returns the number of
+	//consumers that remain attached (including those without counters)
+	//(The callback receives the index of each dead consumer's counters before they are released, so that anything else the
+	//consumer held can be released first; if it returns false then the counters are kept until a later call)
+	uint32_t reclaimConsumers(uint64_t now, uint64_t timeout, const std::function<bool(uint32_t)>& reclaim);
+};
+
+//Takes a snapshot of the telemetry counters for the producer and each consumer that has claimed a set of counters
+StreamStats sampleTelemetry(const SharedState& state);
+
+//Returns the ID of the calling process
+uint32_t currentProcessId();
+
+//Determines if a process with the specified ID is still running
+//(A process we lack permission to signal or open still exists, so only a definitive absence is reported as false)
+bool processExists(uint32_t processId);
+
+//Returns the current steady clock time in nanoseconds since the clock's epoch (the clock used for heartbeats and frame timestamps)
+inline uint64_t telemetryTimestamp() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//Increments a telemetry counter
+inline void countEvent(std::atomic<uint64_t>& counter, uint64_t amount = 1) {
+	counter.fetch_add(amount, std::memory_order_relaxed);
+}
+
+//Locks the status mutex, recording the time spent waiting for it if it is contended
+//(The uncontended case is a single try_lock(), so no clock reads are performed unless we actually have to wait)
+//(If a timeout is specified then we give up waiting once it expires, and the caller must check owns() before proceeding)
+class InstrumentedMutexLock
+{
+	public:
+		InstrumentedMutexLock(SharedMutex& mutex, std::atomic<uint64_t>& contentions, std::atomic<uint64_t>& waitNanoseconds, std::chrono::milliseconds timeout = std::chrono::milliseconds::max());
+		~InstrumentedMutexLock();
+		
+		InstrumentedMutexLock(const InstrumentedMutexLock& other) = delete;
+		InstrumentedMutexLock& operator=(const InstrumentedMutexLock& other) = delete;
+		
+		//Returns true if the mutex was acquired before the timeout expired
+		bool owns() const;
+		
+	private:
+		SharedMutex& mutex;
+		bool locked;
+};
+
+} //End MediaIPC
+
+#endif
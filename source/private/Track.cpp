@@ -0,0 +1,23 @@
+#include "../public/Track.h"
+
+namespace MediaIPC {
+
+Rendition::Rendition() {
+	this->divisor = 2;
+}
+
+Rendition::Rendition(const std::string& name, uint32_t divisor)
+{
+	this->name = name;
+	this->divisor = divisor;
+}
+
+Track::Track() {}
+
+Track::Track(const std::string& name, const ControlBlock& controlBlock)
+{
+	this->name = name;
+	this->controlBlock = controlBlock;
+}
+
+} //End MediaIPC
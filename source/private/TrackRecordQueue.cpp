@@ -0,0 +1,239 @@
+#include "TrackRecordQueue.h"
+#include "Telemetry.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+namespace MediaIPC {
+
+//Delegate that passes the data for a single track to the queue
+class TrackRecordDelegate : public ConsumerDelegate
+{
+	public:
+		TrackRecordDelegate(TrackRecordQueue* queue, uint32_t track, TrackRecordQueue::VideoFrameCallback videoCallback) :
+			queue(queue), track(track), videoCallback(videoCallback)
+		{
+			this->lastSequence.store(0, std::memory_order_relaxed);
+		}
+		
+		void controlBlockReceived(const ControlBlock& cb)
+		{
+			//Frames from a reconfigured track are numbered from the start again
+			this->lastSequence.store(0, std::memory_order_relaxed);
+			this->queue->enqueueControlBlock(this->track, cb);
+		}
+		
+		void videoFrameReceived(const uint8_t* buffer, uint64_t length) {}
+		void audioSamplesReceived(const uint8_t* buffer, uint64_t length) {}
+		
+		void audioSamplesInfoReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info) {
+			this->queue->enqueueAudioBlock(this->track, buffer, length, info);
+		}
+		
+		bool receivesFrameViews() const {
+			return true;
+		}
+		
+		void videoFrameViewReceived(VideoFrameView& view)
+		{
+			//Don't queue the same frame twice when the consumer samples faster than the producer publishes
+			if (view.sequence() != this->lastSequence.load(std::memory_order_relaxed))
+			{
+				this->lastSequence.store(view.sequence(), std::memory_order_relaxed);
+				this->videoCallback(this->track, view);
+			}
+		}
+		
+	private:
+		TrackRecordQueue* queue;
+		uint32_t track;
+		TrackRecordQueue::VideoFrameCallback videoCallback;
+		std::atomic<uint64_t> lastSequence;
+};
+
+namespace
+{
+	//Determines how many views of a track's frames we can hold at once, leaving the producer a slot besides the latest frame
+	uint32_t pinLimitFor(const ControlBlock& cb) {
+		return std::max(cb.videoSlots, (uint32_t)(3)) - 2;
+	}
+}
+
+TrackRecordQueue::TrackRecordQueue(std::atomic<uint64_t>& videoFramesTorn) : finished(false), failed(false), videoFramesTorn(videoFramesTorn) {
+	this->queuedBytes.store(0, std::memory_order_relaxed);
+}
+
+void TrackRecordQueue::addTrack(const ControlBlock& cb)
+{
+	this->pinned.push_back(0);
+	this->pinLimit.push_back(pinLimitFor(cb));
+}
+
+void TrackRecordQueue::run(const std::string& prefix, const std::vector<Track>& tracks, SamplingMode mode, const ConsumerOptions& options, std::function<void()> writeLoop, VideoFrameCallback videoCallback)
+{
+	this->writer = std::thread(writeLoop);
+	
+	//Subscribe to every track and queue the stream until it ends
+	std::map< std::string, std::unique_ptr<ConsumerDelegate> > delegates;
+	for (uint32_t index = 0; index < tracks.size(); ++index) {
+		delegates[tracks[index].name].reset(new TrackRecordDelegate(this, index, videoCallback));
+	}
+	
+	try {
+		MediaConsumer consumer(prefix, std::move(delegates), mode, options);
+	}
+	catch (std::runtime_error&)
+	{
+		this->finish();
+		throw;
+	}
+	
+	//Mark the end of the stream, and wait for everything we queued to be written
+	std::unique_ptr<QueuedRecord> end(new QueuedRecord());
+	FrameInfo info;
+	info.timestamp = telemetryTimestamp();
+	end->header = makeHeader(BridgeMessageType::End, 0, 0, info);
+	this->enqueue(std::move(end));
+	
+	this->finish();
+	if (this->failed == true) {
+		throw std::runtime_error(this->failure);
+	}
+}
+
+void TrackRecordQueue::enqueueControlBlock(uint32_t track, const ControlBlock& cb)
+{
+	//Control blocks have no timestamp of their own, so we record when we received them
+	BridgeWireControlBlock wire = toWire(cb);
+	FrameInfo info;
+	info.timestamp = telemetryTimestamp();
+	std::unique_ptr<QueuedRecord> record(new QueuedRecord());
+	record->header = makeHeader(BridgeMessageType::ControlBlock, track, sizeof(wire), info);
+	record->payload.assign((const uint8_t*)(&wire), (const uint8_t*)(&wire) + sizeof(wire));
+	countEvent(this->queuedBytes, sizeof(wire));
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->pinLimit[track] = pinLimitFor(cb);
+	}
+	
+	this->enqueue(std::move(record));
+}
+
+void TrackRecordQueue::enqueueAudioBlock(uint32_t track, const uint8_t* buffer, uint64_t length, const FrameInfo& info)
+{
+	std::unique_ptr<QueuedRecord> record(new QueuedRecord());
+	record->header = makeHeader(BridgeMessageType::AudioBlock, track, length, info);
+	record->payload.assign(buffer, buffer + length);
+	countEvent(this->queuedBytes, length);
+	this->enqueue(std::move(record));
+}
+
+void TrackRecordQueue::enqueue(std::unique_ptr<QueuedRecord> record)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		if (this->failed == true)
+		{
+			this->queuedBytes.fetch_sub(record->payload.size(), std::memory_order_relaxed);
+			return;
+		}
+		
+		this->records.push_back(std::move(record));
+	}
+	
+	this->wake.notify_one();
+}
+
+bool TrackRecordQueue::take(RecordList& records, size_t maxRecords, uint64_t maxBytes, uint32_t timeoutMilliseconds)
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+	if (timeoutMilliseconds > 0)
+	{
+		if (this->records.empty() == true && this->finished == false) {
+			this->wake.wait_for(lock, std::chrono::milliseconds(timeoutMilliseconds));
+		}
+	}
+	else
+	{
+		while (this->records.empty() == true && this->finished == false) {
+			this->wake.wait(lock);
+		}
+	}
+	
+	//Take as many of the queued records as fit, always taking at least one so that no record is too large to ever be taken
+	uint64_t bytes = 0;
+	while (this->records.empty() == false && records.size() < maxRecords)
+	{
+		uint64_t length = sizeof(BridgeMessageHeader) + this->records.front()->header.length;
+		if (records.empty() == false && bytes + length > maxBytes) {
+			break;
+		}
+		
+		bytes += length;
+		records.push_back(std::move(this->records.front()));
+		this->records.pop_front();
+	}
+	
+	return (this->finished == true && this->records.empty() == true);
+}
+
+void TrackRecordQueue::release(QueuedRecord& record)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->releaseLocked(record);
+}
+
+void TrackRecordQueue::release(RecordList& records)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		for (auto& record : records) {
+			this->releaseLocked(*record);
+		}
+	}
+	
+	records.clear();
+}
+
+void TrackRecordQueue::fail(const std::string& failure)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->failed = true;
+	this->failure = failure;
+	this->records.clear();
+	this->queuedBytes.store(0, std::memory_order_relaxed);
+}
+
+void TrackRecordQueue::finish()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->finished = true;
+	}
+	
+	this->wake.notify_one();
+	if (this->writer.joinable() == true) {
+		this->writer.join();
+	}
+}
+
+void TrackRecordQueue::releaseLocked(QueuedRecord& record)
+{
+	if (record.view.isValid() == true)
+	{
+		//Frames that the producer began overwriting while they were being written may have been written torn
+		if (record.view.isIntact() == false) {
+			countEvent(this->videoFramesTorn);
+		}
+		
+		this->pinned[record.header.track] -= 1;
+		record.view.release();
+	}
+	else if (this->failed == false) {
+		this->queuedBytes.fetch_sub(record.payload.size(), std::memory_order_relaxed);
+	}
+}
+
+} //End MediaIPC
@@ -0,0 +1,100 @@
+#ifndef _MEDIA_IPC_TRACK_RECORD_QUEUE
+#define _MEDIA_IPC_TRACK_RECORD_QUEUE
+
+#include "../public/ConsumerOptions.h"
+#include "../public/MediaConsumer.h"
+#include "../public/Track.h"
+#include "../public/VideoFrameView.h"
+#include "BridgeProtocol.h"
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace MediaIPC {
+
+//A record waiting to be written by a writer thread, in the same form as a bridge message
+struct QueuedRecord
+{
+	BridgeMessageHeader header;
+	
+	//The data that follows the header: either a copy owned by the record, or a view of a video frame pinned in shared memory
+	std::vector<uint8_t> payload;
+	VideoFrameView view;
+};
+
+typedef std::vector< std::unique_ptr<QueuedRecord> > RecordList;
+
+//Consumes every track of a stream into a queue of records for a writer thread, holding video frames pinned in shared memory
+//(This is shared by BridgeSender and MediaRecorder, which only differ in how they queue video frames when their writer falls behind)
+class TrackRecordQueue
+{
+	public:
+		typedef std::function<void(uint32_t, VideoFrameView&)> VideoFrameCallback;
+		
+		//Frames found to be torn when they are released are counted in the specified counter
+		TrackRecordQueue(std::atomic<uint64_t>& videoFramesTorn);
+		
+		//Adds a track, which may pin frames according to its initial parameters
+		void addTrack(const ControlBlock& cb);
+		
+		//Starts the writer thread and consumes every track of the stream until it ends, passing video frames to the callback
+		//(Once the stream ends, an End record is queued and we wait for the writer thread to exit, throwing std::runtime_error if it failed)
+		void run(const std::string& prefix, const std::vector<Track>& tracks, SamplingMode mode, const ConsumerOptions& options, std::function<void()> writeLoop, VideoFrameCallback videoCallback);
+		
+		//Queues a record for the writer thread, taking a copy of the data (control blocks are stamped with the time we received them)
+		void enqueueControlBlock(uint32_t track, const ControlBlock& cb);
+		void enqueueAudioBlock(uint32_t track, const uint8_t* buffer, uint64_t length, const FrameInfo& info);
+		
+		//Queues a record and wakes the writer thread, discarding the record if the writer thread has failed
+		void enqueue(std::unique_ptr<QueuedRecord> record);
+		
+		//Waits for records to be queued (for at most the specified time, if it is non-zero), and takes as many as fit within the limits
+		//(Returns true once the stream has ended and every record has been taken)
+		bool take(RecordList& records, size_t maxRecords, uint64_t maxBytes, uint32_t timeoutMilliseconds);
+		
+		//Releases the frames or copies held by records that have been written
+		void release(QueuedRecord& record);
+		void release(RecordList& records);
+		
+		//Records the failure of the writer thread, discarding everything queued so that the producer can reuse the slots we had pinned
+		void fail(const std::string& failure);
+		
+		//Marks the stream as ended and waits for the writer thread to exit
+		void finish();
+		
+		//Guards the queue, the flags and the pin counts below, which are read and updated by our owner when it queues video frames
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::deque< std::unique_ptr<QueuedRecord> > records;
+		
+		//Set once the stream has ended and nothing more will be queued, and once writing has failed
+		bool finished;
+		bool failed;
+		std::string failure;
+		
+		//The number of views each track has pinned in our queue or in flight, and the number it may pin without starving the producer
+		std::vector<uint32_t> pinned;
+		std::vector<uint32_t> pinLimit;
+		
+		//The number of bytes of copied data held by queued records
+		std::atomic<uint64_t> queuedBytes;
+		
+	private:
+		
+		//Releases a record while the mutex is held
+		void releaseLocked(QueuedRecord& record);
+		
+		std::atomic<uint64_t>& videoFramesTorn;
+		std::thread writer;
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,83 @@
+#include "../public/VideoFrameView.h"
+#include "FrameRing.h"
+#include <utility>
+
+namespace MediaIPC {
+
+VideoFrameView::VideoFrameView() : ring(nullptr), slot(0), owner(MEDIA_IPC_NO_PIN_OWNER), frameSequence(0), frameLength(0) {}
+
+VideoFrameView::VideoFrameView(const FrameRing* ring, uint32_t slot, uint32_t owner, uint64_t sequence, uint64_t length, const FrameDamage& damage) :
+	ring(ring), slot(slot), owner(owner), frameSequence(sequence), frameLength(length), frameDamage(damage)
+{}
+
+VideoFrameView::~VideoFrameView() {
+	this->release();
+}
+
+VideoFrameView::VideoFrameView(VideoFrameView&& other) : ring(nullptr) {
+	this->moveFrom(std::move(other));
+}
+
+VideoFrameView& VideoFrameView::operator=(VideoFrameView&& other)
+{
+	if (this != &other)
+	{
+		this->release();
+		this->moveFrom(std::move(other));
+	}
+	
+	return *this;
+}
+
+bool VideoFrameView::isValid() const {
+	return (this->ring != nullptr);
+}
+
+bool VideoFrameView::isIntact() const {
+	return (this->ring != nullptr && this->ring->holds(this->slot, this->frameSequence));
+}
+
+const uint8_t* VideoFrameView::data() const {
+	return ((this->ring != nullptr) ? this->ring->frameData(this->slot) : nullptr);
+}
+
+uint64_t VideoFrameView::length() const {
+	return this->frameLength;
+}
+
+uint64_t VideoFrameView::sequence() const {
+	return this->frameSequence;
+}
+
+FrameInfo VideoFrameView::info() const
+{
+	FrameInfo info = ((this->ring != nullptr) ? this->ring->frameInfo(this->slot) : FrameInfo());
+	info.sequence = this->frameSequence;
+	return info;
+}
+
+const FrameDamage& VideoFrameView::damage() const {
+	return this->frameDamage;
+}
+
+void VideoFrameView::release()
+{
+	if (this->ring != nullptr)
+	{
+		this->ring->unpin(this->slot, this->owner);
+		this->ring = nullptr;
+	}
+}
+
+void VideoFrameView::moveFrom(VideoFrameView&& other)
+{
+	this->ring = other.ring;
+	this->slot = other.slot;
+	this->owner = other.owner;
+	this->frameSequence = other.frameSequence;
+	this->frameLength = other.frameLength;
+	this->frameDamage = std::move(other.frameDamage);
+	other.ring = nullptr;
+}
+
+} //End MediaIPC
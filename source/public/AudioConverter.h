@@ -0,0 +1,48 @@
+#ifndef _MEDIA_IPC_AUDIO_CONVERTER
+#define _MEDIA_IPC_AUDIO_CONVERTER
+
+#include "Formats.h"
+#include <stdint.h>
+#include <string>
+
+namespace MediaIPC {
+
+//Converts audio samples between sample formats and between interleaved and planar layouts, using SSE2 or AVX2 kernels when
+//the CPU supports them
+//(Integer samples are scaled so that full-scale integers map to floating-point samples in the range [-1.0, 1.0), and
+//floating-point samples outside that range are clamped when they are converted to integers)
+//(Narrowing integer conversions discard the low bits of each sample unless dither is requested, in which case triangular
+//dither is added before rounding to the destination bit depth; dither is never applied to floating-point destinations)
+class AudioConverter
+{
+	public:
+		
+		//The maximum number of channels that deinterleave() and interleave() accept
+		static const uint32_t MaxChannels = 1024;
+		
+		//Determines if samples can be converted between the specified formats (this is true for any pair other than AudioFormat::None)
+		static bool canConvert(AudioFormat source, AudioFormat dest);
+		
+		//Converts the specified number of samples, returning false if this is unsupported
+		//(The source and destination buffers must not overlap, and since samples are converted individually the layout of the
+		//channels is preserved, so this works for both interleaved buffers and individual planes)
+		static bool convert(const uint8_t* source, AudioFormat sourceFormat, uint8_t* dest, AudioFormat destFormat, uint64_t samples, bool dither = false);
+		
+		//Converts interleaved samples into a separate plane for each channel, returning false if this is unsupported
+		//(Each plane receives the specified number of frames)
+		static bool deinterleave(const uint8_t* source, AudioFormat sourceFormat, uint8_t* const* planes, AudioFormat destFormat, uint32_t channels, uint64_t frames, bool dither = false);
+		
+		//Converts a separate plane for each channel into interleaved samples, returning false if this is unsupported
+		static bool interleave(const uint8_t* const* planes, AudioFormat sourceFormat, uint8_t* dest, AudioFormat destFormat, uint32_t channels, uint64_t frames, bool dither = false);
+		
+		//Returns the name of the instruction set that the conversion kernels are currently using ("AVX2", "SSE2" or "Scalar")
+		static std::string instructionSet();
+		
+		//Overrides the instruction set detected at runtime, returning false if the CPU or the build does not support it
+		//(This is intended for testing and benchmarking the individual kernels)
+		static bool setInstructionSet(const std::string& name);
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef _MEDIA_IPC_BRIDGE_OPTIONS
+#define _MEDIA_IPC_BRIDGE_OPTIONS
+
+#include "ConsumerOptions.h"
+#include "MediaConsumer.h"
+#include "ProducerOptions.h"
+#include <stdint.h>
+#include <chrono>
+
+namespace MediaIPC {
+
+//Options controlling how a bridge relays a stream over a socket
+class BridgeOptions
+{
+	public:
+		
+		//Creates a set of options that sample on notification and batch up to 64 messages per write, without zero-copy transmission
+		BridgeOptions();
+		
+		//How the sender samples the stream it relays
+		//(Sampling on notification relays every frame and block the producer publishes, bandwidth permitting)
+		SamplingMode samplingMode;
+		
+		//The options the sender uses to attach to the stream it relays, and the options the receiver uses to republish it
+		ConsumerOptions consumerOptions;
+		ProducerOptions producerOptions;
+		
+		//The maximum time the sender spends retrying its connection while the receiver is not yet listening
+		std::chrono::milliseconds connectTimeout;
+		
+		//The maximum number of messages and the maximum number of bytes that the sender combines into a single write
+		uint32_t maxBatchMessages;
+		uint64_t maxBatchBytes;
+		
+		//Transmit video frames straight from shared memory using MSG_ZEROCOPY, for writes of at least the specified number of bytes
+		//(This is only supported for TCP under Linux, and is silently disabled elsewhere; frames remain pinned until the kernel
+		//reports that it has finished with them)
+		bool zeroCopy;
+		uint64_t zeroCopyThreshold;
+		
+		//The size of the kernel's send and receive buffers for the socket, or zero to use the system defaults
+		uint32_t socketBufferSize;
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef _MEDIA_IPC_BRIDGE_RECEIVER
+#define _MEDIA_IPC_BRIDGE_RECEIVER
+
+#include "BridgeOptions.h"
+#include "BridgeStats.h"
+#include "ControlBlock.h"
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace MediaIPC {
+
+struct BridgeReceiverState;
+class BridgeSocket;
+class MediaProducer;
+
+//Accepts a connection from a BridgeSender and republishes the stream it relays through a local producer under a new prefix
+//(The republished stream has the same tracks and parameters as the original, and follows its reconfigurations)
+class BridgeReceiver
+{
+	public:
+		
+		//Starts listening on the specified endpoint (binding TCP port zero selects a free port, which port() then reports)
+		BridgeReceiver(const std::string& endpoint, const std::string& prefix, const BridgeOptions& options = BridgeOptions());
+		~BridgeReceiver();
+		
+		//BridgeReceiver objects cannot be copied or moved
+		BridgeReceiver(const BridgeReceiver& other) = delete;
+		BridgeReceiver& operator=(const BridgeReceiver& other) = delete;
+		
+		//Returns the TCP port we are listening on (zero for Unix domain sockets)
+		uint16_t port() const;
+		
+		//Waits for a sender to connect, and republishes its stream until the stream ends, at which point the producer is stopped
+		//(Throws std::runtime_error if the connection fails or the sender violates the protocol, after stopping the producer)
+		void run();
+		
+		//Returns the current values of our counters (this can be called from any thread while run() is in progress)
+		BridgeStats stats() const;
+		
+	private:
+		
+		//Republishes messages from the sender until it tells us that the stream has ended
+		void relay(BridgeSocket& socket, MediaProducer& producer, std::vector<ControlBlock>& controlBlocks);
+		
+		std::string prefix;
+		BridgeOptions options;
+		
+		//The listening socket and the counters, whose types are private to the library
+		std::unique_ptr<BridgeReceiverState> state;
+};
+
+} //End MediaIPC
+
+#endif
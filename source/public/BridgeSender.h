@@ -0,0 +1,71 @@
+#ifndef _MEDIA_IPC_BRIDGE_SENDER
+#define _MEDIA_IPC_BRIDGE_SENDER
+
+#include "BridgeOptions.h"
+#include "BridgeStats.h"
+#include "Track.h"
+#include "VideoFrameView.h"
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace MediaIPC {
+
+struct BridgeSenderState;
+
+//Consumes a stream and relays its control block updates, video frames and audio samples over a socket to a BridgeReceiver
+//(Endpoints are specified as "unix:PATH" for a Unix domain socket, or as "tcp:HOST:PORT" or simply "HOST:PORT" for TCP)
+//(The bridge relies on POSIX sockets, so it is only available under Linux and macOS)
+class BridgeSender
+{
+	public:
+		
+		//Waits for the producer with the specified prefix to appear and connects to the receiver listening on the specified endpoint
+		//(Connection attempts are retried until the connect timeout expires, so the receiver may be started after the sender)
+		BridgeSender(const std::string& prefix, const std::string& endpoint, const BridgeOptions& options = BridgeOptions());
+		~BridgeSender();
+		
+		//BridgeSender objects cannot be copied or moved, since the threads relaying the stream refer to them
+		BridgeSender(const BridgeSender& other) = delete;
+		BridgeSender& operator=(const BridgeSender& other) = delete;
+		
+		//Relays every track of the stream until the stream ends, and then tells the receiver that the stream has ended
+		//(Throws std::runtime_error if the connection fails, although only once the stream ends, since consumers sample until then)
+		void run();
+		
+		//Returns the current values of our counters (this can be called from any thread while run() is in progress)
+		BridgeStats stats() const;
+		
+	private:
+		//Queues a video frame for the writer thread, replacing an earlier frame from the same track that has yet to be written
+		//(Video frames are sent straight from shared memory, so the queue holds their views until they have been written)
+		void enqueueVideoFrame(uint32_t track, VideoFrameView& view);
+		
+		//The writer thread, which combines queued messages into batches and writes them to the socket
+		void writeLoop();
+		
+		//Writes a batch of queued messages to the socket with a single scatter-gather write
+		void writeBatch();
+		
+		//Processes the acknowledgements sent back by the receiver, and the kernel's notifications that zero-copy writes have completed
+		//(The receiver closing the connection is only an error if the stream has not yet ended, and waiting for completions gives up after a second)
+		void processAcknowledgements(bool ending);
+		void processCompletions(bool wait);
+		
+		//Marks the writer thread as finished and waits for it to exit
+		void finish();
+		
+		std::string prefix;
+		BridgeOptions options;
+		
+		//The names and initial parameters of the tracks we relay
+		std::vector<Track> tracks;
+		
+		//The socket, the message queue and the counters, whose types are private to the library
+		std::unique_ptr<BridgeSenderState> state;
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef _MEDIA_IPC_BRIDGE_STATS
+#define _MEDIA_IPC_BRIDGE_STATS
+
+#include <stdint.h>
+
+namespace MediaIPC {
+
+//Snapshot of the counters for one side of a bridge
+//(The sender counts what it wrote to the socket, and the receiver counts what it read from the socket and republished)
+class BridgeStats
+{
+	public:
+		BridgeStats();
+		
+		//The number of video frames, blocks of audio samples and control block updates relayed
+		uint64_t videoFrames;
+		uint64_t audioBlocks;
+		uint64_t controlBlocks;
+		
+		//The number of bytes written to or read from the socket, and the number of system calls used to do so
+		uint64_t bytes;
+		uint64_t batches;
+		
+		//The number of video frames the sender dropped because the socket could not keep up, and the number it sent
+		//after the producer had begun overwriting them (which only happens when every slot in the ring is pinned)
+		uint64_t videoFramesDropped;
+		uint64_t videoFramesTorn;
+		
+		//The number of writes the sender made using MSG_ZEROCOPY, and the number the kernel completed by copying anyway
+		//(The kernel always copies for loopback and Unix sockets, and for devices that do not support scatter-gather)
+		uint64_t zeroCopyWrites;
+		uint64_t zeroCopyCopied;
+		
+		//The time each video frame spent within this side of the bridge: for the sender, from when the producer published
+		//the frame until it was written to the socket, and for the receiver, from when the frame began arriving until it
+		//was republished (the total, the maximum and the number of frames measured)
+		uint64_t localLatencyNanoseconds;
+		uint64_t localLatencyMaxNanoseconds;
+		uint64_t localLatencySamples;
+		
+		//The time from when the producer published each video frame until the sender received the receiver's acknowledgement
+		//that it had republished it, which bounds the end-to-end latency of the bridge (only measured by the sender)
+		uint64_t roundTripNanoseconds;
+		uint64_t roundTripMaxNanoseconds;
+		uint64_t roundTripSamples;
+};
+
+} //End MediaIPC
+
+#endif
@@ -2,6 +2,10 @@
 #define _MEDIA_IPC_CONSUMER_DELEGATE
 
 #include "ControlBlock.h"
+#include "FrameDamage.h"
+#include "FrameHandle.h"
+#include "FrameInfo.h"
+#include "VideoFrameView.h"
 #include <functional>
 
 namespace MediaIPC {
@@ -12,7 +16,8 @@ class ConsumerDelegate
 	public:
 		virtual ~ConsumerDelegate();
 		
-		//Called when the control block is received from the producer
+		//Called when the control block is received from the producer, and again whenever the producer reconfigures the track
+		//(After a reconfiguration, this is called before any video frame or audio samples that use the new parameters)
 		virtual void controlBlockReceived(const ControlBlock& cb) = 0;
 		
 		//Called on the video thread when a new video frame has been sampled
@@ -20,6 +25,51 @@ class ConsumerDelegate
 		
 		//Called on the audio thread when a new buffer of audio samples have been sampled
 		virtual void audioSamplesReceived(const uint8_t* buffer, uint64_t length) = 0;
+		
+		//Called instead of the methods above, with the sequence number and timestamps of the frame or block of samples
+		//(For audio, the metadata is that of the block the producer published containing the first sample of the buffer)
+		//(The default implementations simply discard the metadata and call videoFrameReceived() and audioSamplesReceived())
+		virtual void videoFrameInfoReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info);
+		virtual void audioSamplesInfoReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info);
+		
+		//Called instead of the video methods above, with the regions of the buffer that changed since the previous call
+		//(Only the changed regions are copied into the buffer, which is otherwise unchanged from the previous call)
+		//(The default implementation simply discards the damage and calls videoFrameInfoReceived())
+		virtual void videoFrameDamageReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info, const FrameDamage& damage);
+		
+		//Called on the audio thread when the producer has overwritten samples before they could be read
+		//(The default implementation does nothing)
+		virtual void audioOverrun(uint64_t bytesLost);
+		
+		//Called on the audio thread when a buffer of audio samples was due but the producer had not yet published it
+		//(The default implementation does nothing)
+		virtual void audioUnderrun(uint64_t bytesMissing);
+		
+		//Determines if video frames should be delivered as views pinned in shared memory rather than as copies
+		//(The default implementation returns false, so that frames are passed to videoFrameDamageReceived())
+		virtual bool receivesFrameViews() const;
+		
+		//Called on the video thread instead of videoFrameDamageReceived() when receivesFrameViews() returns true
+		//(The view is released when this returns, unless it has been moved into a view that outlives the call)
+		//(The default implementation simply passes the view's data, metadata and damage to videoFrameDamageReceived())
+		virtual void videoFrameViewReceived(VideoFrameView& view);
+		
+		//Called on a DelegateDispatcher worker thread instead of the methods above when the delegate is run by a dispatcher
+		//(The data is held in a pooled buffer, and copying the handle keeps the buffer for as long as the copy exists)
+		//(The default implementations simply pass the data, metadata and damage to videoFrameDamageReceived() and audioSamplesInfoReceived())
+		virtual void videoFrameHandleReceived(FrameHandle& frame);
+		virtual void audioSamplesHandleReceived(FrameHandle& samples);
+		
+		//Determines the sample format that audio samples should be converted to before they are passed to the delegate
+		//(The default implementation returns AudioFormat::None, so that samples are passed in the format the producer publishes)
+		//(The control blocks passed to controlBlockReceived() report the requested format, and the lengths of samples, overruns
+		//and underruns are all measured in it, so the delegate never needs to know the published format)
+		virtual AudioFormat requestedAudioFormat() const;
+		
+		//Determines if converted audio samples should be passed as consecutive planes, one per channel, rather than interleaved
+		//(This only applies when requestedAudioFormat() returns a format, and is ignored beyond AudioConverter::MaxChannels channels)
+		//(The default implementation returns false)
+		virtual bool receivesPlanarAudio() const;
 };
 
 //Consumer delegate implementation for wrapping std::function instances
@@ -28,6 +78,11 @@ class FunctionConsumerDelegate : public ConsumerDelegate
 	public:
 		typedef std::function<void(const ControlBlock&)> ControlBlockCallback;
 		typedef std::function<void(const uint8_t*, uint64_t)> DataCallback;
+		typedef std::function<void(const uint8_t*, uint64_t, const FrameInfo&)> InfoDataCallback;
+		typedef std::function<void(const uint8_t*, uint64_t, const FrameInfo&, const FrameDamage&)> DamageDataCallback;
+		typedef std::function<void(VideoFrameView&)> ViewCallback;
+		typedef std::function<void(FrameHandle&)> HandleCallback;
+		typedef std::function<void(uint64_t)> CountCallback;
 		
 		FunctionConsumerDelegate();
 		
@@ -35,14 +90,55 @@ class FunctionConsumerDelegate : public ConsumerDelegate
 		void setVideoHandler(DataCallback videoHandler);
 		void setAudioHandler(DataCallback audioHandler);
 		
+		//Setting an info handler causes it to be called instead of the corresponding plain data handler
+		void setVideoInfoHandler(InfoDataCallback videoInfoHandler);
+		void setAudioInfoHandler(InfoDataCallback audioInfoHandler);
+		
+		//Setting a video damage handler causes it to be called instead of either of the video handlers above
+		void setVideoDamageHandler(DamageDataCallback videoDamageHandler);
+		
+		void setAudioOverrunHandler(CountCallback overrunHandler);
+		void setAudioUnderrunHandler(CountCallback underrunHandler);
+		
+		//Setting a video view handler causes frames to be delivered as views instead of being passed to the video handler
+		void setVideoViewHandler(ViewCallback videoViewHandler);
+		
+		//Setting a handle handler causes it to be called instead of the corresponding data handlers when run by a DelegateDispatcher
+		void setVideoHandleHandler(HandleCallback videoHandleHandler);
+		void setAudioHandleHandler(HandleCallback audioHandleHandler);
+		
+		//Requests that audio samples be converted to the specified format (and optionally split into planes) before they are passed to the handlers
+		void setRequestedAudioFormat(AudioFormat format, bool planar = false);
+		
 		void controlBlockReceived(const ControlBlock& cb);
 		void videoFrameReceived(const uint8_t* buffer, uint64_t length);
 		void audioSamplesReceived(const uint8_t* buffer, uint64_t length);
-	
+		void videoFrameInfoReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info);
+		void audioSamplesInfoReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info);
+		void videoFrameDamageReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info, const FrameDamage& damage);
+		void audioOverrun(uint64_t bytesLost);
+		void audioUnderrun(uint64_t bytesMissing);
+		bool receivesFrameViews() const;
+		void videoFrameViewReceived(VideoFrameView& view);
+		void videoFrameHandleReceived(FrameHandle& frame);
+		void audioSamplesHandleReceived(FrameHandle& samples);
+		AudioFormat requestedAudioFormat() const;
+		bool receivesPlanarAudio() const;
+		
 	private:
 		ControlBlockCallback cbHandler;
 		DataCallback videoHandler;
 		DataCallback audioHandler;
+		InfoDataCallback videoInfoHandler;
+		InfoDataCallback audioInfoHandler;
+		DamageDataCallback videoDamageHandler;
+		CountCallback overrunHandler;
+		CountCallback underrunHandler;
+		ViewCallback videoViewHandler;
+		HandleCallback videoHandleHandler;
+		HandleCallback audioHandleHandler;
+		AudioFormat audioFormat;
+		bool planarAudio;
 };
 
 } //End MediaIPC
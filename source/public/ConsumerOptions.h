@@ -0,0 +1,24 @@
+#ifndef _MEDIA_IPC_CONSUMER_OPTIONS
+#define _MEDIA_IPC_CONSUMER_OPTIONS
+
+#include <chrono>
+
+namespace MediaIPC {
+
+//Options controlling how a consumer attaches to its producer
+class ConsumerOptions
+{
+	public:
+		
+		//Creates a set of options that wait indefinitely for the producer to appear
+		ConsumerOptions();
+		
+		//The maximum time to wait for the producer to create its shared memory (including its video and audio buffers), or the
+		//maximum duration to wait indefinitely
+		//(If the producer does not appear in time then the MediaConsumer constructor throws std::runtime_error)
+		std::chrono::milliseconds attachTimeout;
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef _MEDIA_IPC_CONSUMER_REACTOR
+#define _MEDIA_IPC_CONSUMER_REACTOR
+
+#include "ConsumerDelegate.h"
+#include "ReactorOptions.h"
+#include "ReactorStats.h"
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace MediaIPC {
+
+class MediaConsumer;
+struct ReactorState;
+struct ReactorStream;
+
+//Consumes many streams on a small, fixed pool of worker threads, rather than a video thread and an audio thread per stream
+//(Each stream is consumed through a descriptor that its producer signals whenever it publishes data, see MediaConsumer::descriptor(),
+//and the workers wait on the descriptors of every stream at once with epoll)
+//(Each ready stream takes a turn, passing its newest video frame and its available audio samples to its delegates, after which it
+//goes to the back of the queue if it is still busy, so a busy stream cannot starve the others)
+//(A stream's delegates receive their callbacks one at a time, in order, although successive turns may run on different workers)
+class ConsumerReactor
+{
+	public:
+		
+		//Starts the worker threads
+		ConsumerReactor(const ReactorOptions& options = ReactorOptions());
+		
+		//Stops the worker threads and detaches from every stream
+		~ConsumerReactor();
+		
+		ConsumerReactor(const ConsumerReactor& other) = delete;
+		ConsumerReactor& operator=(const ConsumerReactor& other) = delete;
+		
+		//Attaches to the producer with the specified prefix and passes the data of its first track or its named tracks to the
+		//delegates, returning an ID for the stream
+		//(This waits for the producer to appear as the consumer options specify, and the delegates receive the parameters of
+		//their tracks before it returns; std::runtime_error is thrown for an unknown track name, or if the producer's
+		//registry of consumers is full)
+		uint64_t add(const std::string& prefix, std::unique_ptr<ConsumerDelegate>&& delegate);
+		uint64_t add(const std::string& prefix, std::map< std::string, std::unique_ptr<ConsumerDelegate> >&& delegates);
+		
+		//Detaches from a stream, waiting for any turn in progress to finish (this does nothing if the stream has already ended)
+		void remove(uint64_t stream);
+		
+		//Returns the number of streams still being consumed (streams are removed automatically once their producer stops, or once
+		//sampling them throws an exception, so that one failing stream never interrupts the others)
+		size_t streamCount() const;
+		
+		//Returns a snapshot of the counters for each stream still being consumed, followed by the final counters of each stream
+		//that failed since the previous call, along with the error that detached it
+		std::vector<ReactorStats> stats() const;
+		
+	private:
+		
+		//Registers a stream whose consumer has attached
+		uint64_t attach(std::unique_ptr<MediaConsumer>&& consumer, std::map< std::string, std::unique_ptr<ConsumerDelegate> >&& delegates);
+		
+		//The loop run by each worker thread
+		void workerLoop();
+		
+		//Passes the new data of a ready stream to its delegates, and then waits for the stream to become ready again
+		void turn(uint64_t stream);
+		
+		//Takes a snapshot of the counters for a stream whose consumer is still attached
+		static ReactorStats snapshot(const ReactorStream& stream);
+		
+		//Gives a turn to each stream that has not had one for longer than the check interval
+		void checkIdleStreams();
+		
+		ReactorOptions options;
+		std::unique_ptr<ReactorState> state;
+};
+
+} //End MediaIPC
+
+#endif
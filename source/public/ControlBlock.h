@@ -7,12 +7,6 @@
 
 namespace MediaIPC {
 
-enum class VideoBuffer : uint8_t
-{
-	FrontBuffer = 0,
-	BackBuffer = 1
-};
-
 class ControlBlock
 {
 	public:
@@ -22,11 +16,18 @@ class ControlBlock
 		ControlBlock();
 		
 		//Determines the number of bytes required to hold the video framebuffer, based on our video parameters
+		//(For planar formats this includes every plane, stored one after another, and any padding at the end of each row)
 		uint64_t calculateVideoBufsize() const;
 		
+		//Determines the layout of the specified plane within the video framebuffer, based on our video parameters
+		PlaneLayout calculateVideoPlaneLayout(uint8_t plane) const;
+		
 		//Determines the number of bytes required to hold the audio sample buffer, based on our audio parameters
 		uint64_t calculateAudioBufsize() const;
 		
+		//Determines the number of bytes required to hold the shared memory audio ring, based on our audio parameters
+		uint64_t calculateAudioRingSize() const;
+		
 		//Determines the interval in microseconds for sampling the video framebuffer, based on our video parameters
 		std::chrono::microseconds calculateVideoInterval() const;
 		
@@ -48,6 +49,18 @@ class ControlBlock
 		//The pixel format of the video
 		VideoFormat videoFormat;
 		
+		//The number of frame slots in the shared memory video ring
+		//(More slots give consumers more time to copy a frame before the producer overwrites it)
+		uint32_t videoSlots;
+		
+		//The number of bytes between the start of consecutive rows in the first plane of each frame (zero for tightly packed rows)
+		//(The strides of any chroma planes are derived from this, and FormatDetails::alignedStride() calculates padded strides)
+		uint64_t videoStride;
+		
+		//The alignment in bytes of the start of each frame in the shared memory video ring, such as 64 or 4096
+		//(This must be a power of two, and values smaller than a cache line are rounded up to the cache line size)
+		uint32_t videoAlignment;
+		
 		
 		//---- AUDIO PARAMETERS ----
 		
@@ -64,6 +77,10 @@ class ControlBlock
 		//The format of the audio samples
 		AudioFormat audioFormat;
 		
+		//The number of sample buffers (each holding samplesPerBuffer samples) in the shared memory audio ring
+		//(A larger ring gives consumers more leeway to fall behind the producer before samples are lost)
+		uint32_t audioRingBuffers;
+		
 		
 	private:
 		
@@ -77,13 +94,12 @@ class ControlBlock
 		//(The "status" mutex also controls the initial access to the entire control block)
 		bool active;
 		
-		//Was the front framebuffer or the back framebuffer most recently updated?
-		//(Access to this flag is protected by the "video" mutex)
-		VideoBuffer lastBuffer;
+		//How the video and audio buffers are backed (these hold MemoryBacking values, which are private to the library)
+		uint8_t videoBacking;
+		uint8_t audioBacking;
 		
-		//The current head position of the audio ring buffer
-		//(Access to this flag is protected by the "audio" mutex)
-		uint32_t ringHead;
+		//Should consumers fault in every page of the buffers when they attach?
+		bool prefault;
 };
 
 } //End MediaIPC
@@ -0,0 +1,58 @@
+#ifndef _MEDIA_IPC_DELEGATE_DISPATCHER
+#define _MEDIA_IPC_DELEGATE_DISPATCHER
+
+#include "ConsumerDelegate.h"
+#include "DispatchOptions.h"
+#include "DispatchStats.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace MediaIPC {
+
+struct DispatcherState;
+
+//Runs consumer delegates on a pool of worker threads, so that a slow delegate does not delay the consumer's sampling threads
+//(Each video frame is copied once from shared memory into a pooled buffer and queued for its delegate as a reference-counted
+//FrameHandle, and each block of audio samples is queued in the same manner, so no memory is allocated per frame once the
+//stream has settled; a full queue is handled according to the dispatch policy)
+//(Each delegate receives its video callbacks from at most one worker at a time and its audio callbacks from at most one worker
+//at a time, in the order they were sampled, so delegates see the same guarantees as when they run on the sampling threads)
+//(The dispatcher must outlive any MediaConsumer that uses its delegates)
+class DelegateDispatcher
+{
+	public:
+		
+		//Starts the worker threads (throws std::runtime_error if there are no workers or a queue depth is zero)
+		DelegateDispatcher(const DispatchOptions& options = DispatchOptions());
+		
+		//Waits for everything queued to be passed to its delegate, and then stops the worker threads
+		~DelegateDispatcher();
+		
+		//DelegateDispatcher objects cannot be copied or moved, since the worker threads refer to them
+		DelegateDispatcher(const DelegateDispatcher& other) = delete;
+		DelegateDispatcher& operator=(const DelegateDispatcher& other) = delete;
+		
+		//Wraps a delegate so that its callbacks run on our worker threads, and returns the wrapper to pass to a MediaConsumer
+		//(Video frames are passed to the delegate as handles rather than views, whatever its receivesFrameViews() returns)
+		//(The name identifies the delegate in our stats, and destroying the wrapper waits for its queues to empty)
+		std::unique_ptr<ConsumerDelegate> wrap(std::unique_ptr<ConsumerDelegate>&& delegate, const std::string& name = "");
+		
+		//Waits until everything queued has been passed to its delegate
+		//(Call this once the MediaConsumer constructor returns to ensure that delegates have finished with the stream)
+		void drain();
+		
+		//Returns the current values of the counters for each delegate we are running, in the order they were wrapped
+		//(This can be called from any thread)
+		std::vector<DispatchStats> stats() const;
+		
+	private:
+		
+		//The worker threads, queues and counters, whose types are private to the library
+		//(This is shared with our wrappers, which only refer to it until they are destroyed)
+		std::shared_ptr<DispatcherState> state;
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef _MEDIA_IPC_DISPATCH_OPTIONS
+#define _MEDIA_IPC_DISPATCH_OPTIONS
+
+#include <stdint.h>
+
+namespace MediaIPC {
+
+//Determines what happens when a sampling thread has data for a delegate whose queue is already full
+enum class DispatchPolicy : uint8_t
+{
+	//Discard the oldest queued frame or block of samples to make room, so the delegate always receives the most recent data
+	DropOldest = 0,
+	
+	//Discard the new frame or block of samples, so the delegate receives an uninterrupted run of older data
+	DropNewest = 1,
+	
+	//Wait until the delegate has made room, so nothing is discarded (a slow delegate then delays sampling, as it would without dispatch)
+	Block = 2
+};
+
+//Options controlling how a DelegateDispatcher queues data for the delegates it runs
+class DispatchOptions
+{
+	public:
+		
+		//Creates a set of options with a single worker thread that queues up to three video frames and
+		//thirty-two blocks of audio samples per delegate, discarding the oldest when a queue is full
+		DispatchOptions();
+		
+		//The number of worker threads that run delegates
+		//(Each delegate receives its video and its audio on at most one worker at a time, so more workers than twice the
+		//number of delegates is never useful)
+		uint32_t workers;
+		
+		//The maximum number of video frames and blocks of audio samples queued for each delegate
+		//(Control blocks and audio overrun and underrun notifications are never discarded, and do not count towards these limits)
+		uint32_t videoQueueDepth;
+		uint32_t audioQueueDepth;
+		
+		//What to do when a delegate's queue is full
+		DispatchPolicy policy;
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef _MEDIA_IPC_DISPATCH_STATS
+#define _MEDIA_IPC_DISPATCH_STATS
+
+#include <stdint.h>
+#include <string>
+
+namespace MediaIPC {
+
+//Snapshot of the counters for a single delegate run by a DelegateDispatcher
+class DispatchStats
+{
+	public:
+		DispatchStats();
+		
+		//The name the delegate was given when it was wrapped
+		std::string name;
+		
+		//The number of video frames and blocks of audio samples passed to the delegate, and the number discarded from its queues
+		uint64_t videoFramesDelivered;
+		uint64_t videoFramesDropped;
+		uint64_t audioBlocksDelivered;
+		uint64_t audioBlocksDropped;
+		
+		//The number of video frames and blocks of audio samples currently queued for the delegate
+		uint64_t videoFramesQueued;
+		uint64_t audioBlocksQueued;
+		
+		//The total time that sampling threads spent waiting for room in the delegate's queues (only under DispatchPolicy::Block)
+		uint64_t blockedNanoseconds;
+		
+		//The time each video frame and block of audio samples spent queued, from when it was sampled until it was passed to
+		//the delegate (the total and the maximum, with the number measured given by the delivered counts above)
+		uint64_t videoQueueNanoseconds;
+		uint64_t videoQueueMaxNanoseconds;
+		uint64_t audioQueueNanoseconds;
+		uint64_t audioQueueMaxNanoseconds;
+		
+		//The time the delegate spent processing video frames and blocks of audio samples (the total and the maximum)
+		uint64_t videoHandlerNanoseconds;
+		uint64_t videoHandlerMaxNanoseconds;
+		uint64_t audioHandlerNanoseconds;
+		uint64_t audioHandlerMaxNanoseconds;
+};
+
+} //End MediaIPC
+
+#endif
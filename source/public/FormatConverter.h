@@ -0,0 +1,57 @@
+#ifndef _MEDIA_IPC_FORMAT_CONVERTER
+#define _MEDIA_IPC_FORMAT_CONVERTER
+
+#include "Formats.h"
+#include <stdint.h>
+#include <string>
+
+namespace MediaIPC {
+
+//Converts video frames between pixel formats, using SSE2 or AVX2 kernels when the CPU supports them
+//(Strides are specified in bytes, and a stride of zero indicates that the rows of a plane are tightly packed)
+class FormatConverter
+{
+	public:
+		
+		//Determines if frames can be converted between the specified formats using convert()
+		//(Any of the packed RGB formats can be converted to any other or to I420, NV12 and YUY2, and any format can be copied to itself)
+		//(No other conversions are supported, so YUV and grayscale frames can only be copied)
+		static bool canConvert(VideoFormat source, VideoFormat dest);
+		
+		//Converts a frame from a packed RGB format (RGB, BGR, RGBA, BGRA, ARGB and ABGR) to another packed RGB format or to I420, NV12
+		//or YUY2, returning false if this is unsupported
+		//(When the source format has no alpha channel, the alpha channel of the destination is set to fully opaque)
+		//(For planar destinations the planes are laid out as described by FormatDetails::planeLayout(), using the destination stride)
+		static bool convert(const uint8_t* source, VideoFormat sourceFormat, uint64_t sourceStride, uint8_t* dest, VideoFormat destFormat, uint64_t destStride, uint32_t width, uint32_t height);
+		
+		//Converts a packed RGB frame to BT.601 limited-range 4:2:0 YUV with separate U and V planes, returning false if this is unsupported
+		//(Each chroma sample is the average of a 2x2 block of pixels, and the chroma planes are rounded up to cover odd dimensions)
+		static bool toI420(const uint8_t* source, VideoFormat sourceFormat, uint64_t sourceStride, uint8_t* y, uint64_t yStride, uint8_t* u, uint64_t uStride, uint8_t* v, uint64_t vStride, uint32_t width, uint32_t height);
+		
+		//Converts a packed RGB frame to BT.601 limited-range 4:2:0 YUV with an interleaved UV plane, returning false if this is unsupported
+		static bool toNV12(const uint8_t* source, VideoFormat sourceFormat, uint64_t sourceStride, uint8_t* y, uint64_t yStride, uint8_t* uv, uint64_t uvStride, uint32_t width, uint32_t height);
+		
+		//Converts a packed RGB frame to BT.601 limited-range packed 4:2:2 YUV (Y0 U Y1 V), returning false if this is unsupported
+		//(Each chroma sample is the average of a horizontal pair of pixels, and if the width is odd the final pixel is duplicated)
+		static bool toYUY2(const uint8_t* source, VideoFormat sourceFormat, uint64_t sourceStride, uint8_t* dest, uint64_t destStride, uint32_t width, uint32_t height);
+		
+		//Determines if frames of the specified format can be downscaled using halve()
+		//(This is true for 8-bit grayscale, the packed RGB formats, I420 and NV12)
+		static bool canHalve(VideoFormat format);
+		
+		//Downscales a frame to half of its width and height, averaging each 2x2 block of samples in each plane, returning false if this is unsupported
+		//(Odd dimensions are rounded up, with the final column or row of the source averaged with itself, and the strides are interpreted
+		//as described by FormatDetails::planeLayout() using the dimensions of the source and destination frames respectively)
+		static bool halve(const uint8_t* source, VideoFormat format, uint64_t sourceStride, uint8_t* dest, uint64_t destStride, uint32_t width, uint32_t height);
+		
+		//Returns the name of the instruction set that the conversion kernels are currently using ("AVX2", "SSE2" or "Scalar")
+		static std::string instructionSet();
+		
+		//Overrides the instruction set detected at runtime, returning false if the CPU or the build does not support it
+		//(This is intended for testing and benchmarking the individual kernels)
+		static bool setInstructionSet(const std::string& name);
+};
+
+} //End MediaIPC
+
+#endif
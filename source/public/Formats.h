@@ -16,18 +16,61 @@ enum class AudioFormat : uint8_t
 
 enum class VideoFormat : uint8_t
 {
-	#define VIDEO_FORMAT(name, bytes, description) name,
+	#define VIDEO_FORMAT(name, bytes, planes, subsampleX, subsampleY, description) name,
 	#include "VideoFormats.inc"
 	
 	None = 255
 };
 
+//Describes the location of a single plane within a video frame
+class PlaneLayout
+{
+	public:
+		PlaneLayout();
+		
+		//The number of bytes between the start of consecutive rows of the plane
+		uint64_t stride;
+		
+		//The number of rows in the plane
+		uint32_t rows;
+		
+		//The offset of the plane from the start of the frame in bytes
+		uint64_t offset;
+		
+		//The size of the plane in bytes (the stride multiplied by the number of rows)
+		uint64_t size;
+};
+
 class FormatDetails
 {
 	public:
 		static uint8_t bytesPerSample(AudioFormat format);
+		
+		//Returns the number of bytes per sample in the first plane of a video format
+		//(For packed RGB and grayscale formats this is the number of bytes per pixel)
 		static uint8_t bytesPerPixel(VideoFormat format);
 		
+		//Returns the number of planes in a video format (zero for VideoFormat::None)
+		static uint8_t planeCount(VideoFormat format);
+		
+		//Returns the horizontal and vertical chroma subsampling factors of a video format (one for formats without subsampling)
+		static uint8_t subsamplingX(VideoFormat format);
+		static uint8_t subsamplingY(VideoFormat format);
+		
+		//Determines if a video format stores luma and chroma samples rather than RGB or grayscale pixels
+		static bool isYUV(VideoFormat format);
+		
+		//Determines the layout of the specified plane of a frame with the specified dimensions
+		//(The stride is that of the first plane, and a stride of zero indicates tightly packed rows;
+		//the strides of any chroma planes are scaled from the first plane's stride by the subsampling factors)
+		static PlaneLayout planeLayout(VideoFormat format, uint32_t width, uint32_t height, uint8_t plane, uint64_t stride = 0);
+		
+		//Determines the stride of the first plane of a frame when its rows are padded to a multiple of the specified alignment
+		static uint64_t alignedStride(VideoFormat format, uint32_t width, uint32_t alignment);
+		
+		//Determines the total size in bytes of a frame with the specified dimensions, including all of its planes
+		static uint64_t frameSize(VideoFormat format, uint32_t width, uint32_t height, uint64_t stride = 0);
+		
 		static std::string description(AudioFormat format);
 		static std::string description(VideoFormat format);
 };
@@ -0,0 +1,45 @@
+#ifndef _MEDIA_IPC_FRAME_DAMAGE
+#define _MEDIA_IPC_FRAME_DAMAGE
+
+#include <stdint.h>
+#include <vector>
+
+namespace MediaIPC {
+
+//The maximum number of damaged rectangles recorded for a single video frame
+//(Frames with more rectangles than this are recorded as the bounding box of all of them)
+#define MEDIA_IPC_MAX_DAMAGE_RECTS 16
+
+//A rectangular region of a video frame, in pixels
+class DamageRect
+{
+	public:
+		DamageRect();
+		DamageRect(uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+		
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+		uint32_t height;
+};
+
+//The regions of a video frame that differ from the frame previously delivered to a delegate
+class FrameDamage
+{
+	public:
+		
+		//Creates a damage list covering the whole frame
+		FrameDamage();
+		
+		//Whether the whole frame should be treated as changed (in which case the list of rectangles is empty)
+		//(This is the case for the first frame, for frames the producer published in full, and whenever the frames in between
+		//have been overwritten before the consumer could determine what changed in them)
+		bool full;
+		
+		//The changed regions, which may overlap (an empty list with full set to false means that nothing changed)
+		std::vector<DamageRect> rects;
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef _MEDIA_IPC_FRAME_HANDLE
+#define _MEDIA_IPC_FRAME_HANDLE
+
+#include "FrameDamage.h"
+#include "FrameInfo.h"
+#include <stdint.h>
+
+namespace MediaIPC {
+
+struct FrameBuffer;
+class FramePool;
+
+//Reference-counted handle to a video frame or a block of audio samples held in a buffer owned by a DelegateDispatcher
+//(Copying a handle shares the buffer rather than copying the data, and the buffer is returned to its pool for reuse once
+//every handle referring to it has been released, so delegates can keep data beyond the call that delivered it)
+//(Handles must not outlive the MediaConsumer whose delegate received them)
+class FrameHandle
+{
+	public:
+		
+		//Creates an empty handle
+		FrameHandle();
+		~FrameHandle();
+		
+		FrameHandle(const FrameHandle& other);
+		FrameHandle& operator=(const FrameHandle& other);
+		FrameHandle(FrameHandle&& other);
+		FrameHandle& operator=(FrameHandle&& other);
+		
+		//Determines if the handle refers to a buffer
+		bool isValid() const;
+		
+		//Returns a pointer to the data
+		const uint8_t* data() const;
+		
+		//Returns the length of the data in bytes
+		uint64_t length() const;
+		
+		//Returns the metadata for the frame or block of samples
+		FrameInfo info() const;
+		
+		//Returns the regions of a video frame that changed since the previous frame passed to the delegate
+		//(This covers the whole frame if any frames were discarded in between)
+		const FrameDamage& damage() const;
+		
+		//Releases our reference to the buffer, after which the handle is empty
+		void release();
+		
+	private:
+		friend class FramePool;
+		
+		//Creates a handle that takes ownership of a reference that has already been counted
+		FrameHandle(FrameBuffer* buffer);
+		
+		FrameBuffer* buffer;
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef _MEDIA_IPC_FRAME_INFO
+#define _MEDIA_IPC_FRAME_INFO
+
+#include <stdint.h>
+
+namespace MediaIPC {
+
+//Metadata carried through shared memory alongside each video frame and each block of audio samples
+class FrameInfo
+{
+	public:
+		
+		//The value of the pts field when the producer did not supply a presentation timestamp
+		static const int64_t NoPts = INT64_MIN;
+		
+		//Creates an empty frame info object
+		FrameInfo();
+		
+		//The monotonic sequence number assigned by the producer, starting at 1
+		//(Video frames and audio blocks are numbered independently, and gaps indicate dropped frames or blocks)
+		uint64_t sequence;
+		
+		//The producer's std::chrono::steady_clock time when the data was published, in nanoseconds since the clock's epoch
+		uint64_t timestamp;
+		
+		//The presentation timestamp supplied by the producer, in whatever units the producer chooses (NoPts if none was supplied)
+		int64_t pts;
+};
+
+} //End MediaIPC
+
+#endif
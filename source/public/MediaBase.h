@@ -2,42 +2,41 @@
 #define _MEDIA_IPC_MEDIA_BASE
 
 #include <memory>
+#include <vector>
 
 namespace MediaIPC {
 
 class ControlBlock;
+class FrameRing;
 class MemoryWrapper;
-class MutexWrapper;
 class RingBuffer;
+struct SharedState;
 typedef std::unique_ptr<MemoryWrapper> MemoryWrapperPtr;
-typedef std::unique_ptr<MutexWrapper> MutexWrapperPtr;
 
 class MediaBase
 {
 	protected:
 		
-		//Producer status named mutex
-		MutexWrapperPtr statusMutex;
-		
 		//Control block shared memory
 		MemoryWrapperPtr controlBlockMemory;
 		
-		//Video shared memory and named mutexes
-		MemoryWrapperPtr videoFrontBuffer;
-		MemoryWrapperPtr videoBackBuffer;
-		MutexWrapperPtr videoMutex;
-		MutexWrapperPtr frontBufferMutex;
-		MutexWrapperPtr backBufferMutex;
+		//Video shared memory (holding the frame ring for every track)
+		MemoryWrapperPtr videoBuffer;
 		
-		//Audio shared memory and named mutex
+		//Audio shared memory (holding the sample ring for every track)
 		MemoryWrapperPtr audioBuffer;
-		MutexWrapperPtr audioMutex;
 		
-		//Ring buffer interface for the audio shared memory
-		std::unique_ptr<RingBuffer> ringBuffer;
+		//Frame ring interfaces for the video shared memory of each track
+		std::vector< std::unique_ptr<FrameRing> > frameRings;
+		
+		//Ring buffer interfaces for the audio shared memory of each track
+		std::vector< std::unique_ptr<RingBuffer> > ringBuffers;
 		
 		//Control block pointer (points to the control block shared memory)
 		ControlBlock* controlBlock;
+		
+		//Shared state pointer (points to the lock-free state that follows the control block in shared memory)
+		SharedState* sharedState;
 };
 
 } //End MediaIPC
@@ -2,27 +2,155 @@
 #define _MEDIA_IPC_MEDIA_CONSUMER
 
 #include "ConsumerDelegate.h"
+#include "ConsumerOptions.h"
 #include "ControlBlock.h"
+#include "FrameInfo.h"
 #include "MediaBase.h"
+#include "Track.h"
+#include "VideoFrameView.h"
+#include <stdint.h>
+#include <chrono>
+#include <map>
 #include <string>
+#include <vector>
 
 namespace MediaIPC {
 
+class Doorbell;
+struct ConsumerCounters;
+struct ConsumerLayout;
+struct ConsumerThreads;
+struct ConsumerTrack;
+
+//Determines how a consumer decides when to sample the shared memory buffers
+enum class SamplingMode : uint8_t
+{
+	//Sample the buffers at fixed intervals, based on the frame rate and sample rate in the control block
+	Polling = 0,
+	
+	//Wait for the producer to signal that it has published new data, and then sample whatever has become available
+	//(Each wake delivers the latest video frame of each track, skipping any published while the consumer was busy, and every complete
+	//buffer of audio samples, so audio publications are split or merged into buffers of the control block's samplesPerBuffer)
+	Notification = 1
+};
+
 class MediaConsumer : public MediaBase
 {
 	public:
-		MediaConsumer(const std::string& prefix, std::unique_ptr<ConsumerDelegate>&& delegate);
+		//Consumes the first track published by the producer
+		//(The constructor waits for the producer to appear, and is woken within moments of it creating its shared memory)
+		MediaConsumer(const std::string& prefix, std::unique_ptr<ConsumerDelegate>&& delegate, SamplingMode mode = SamplingMode::Polling, const ConsumerOptions& options = ConsumerOptions());
+		
+		//Consumes the named tracks published by the producer, passing the data for each track to its own delegate
+		//(A single video thread and a single audio thread sample every subscribed track, and an unknown track name throws std::runtime_error)
+		MediaConsumer(const std::string& prefix, std::map< std::string, std::unique_ptr<ConsumerDelegate> >&& delegates, SamplingMode mode = SamplingMode::Polling, const ConsumerOptions& options = ConsumerOptions());
+		
+		//Attaches to the producer and subscribes to every track, returning as soon as we have attached rather than when the stream ends
+		//(Nothing is sampled until data is pulled with tryGetLatestVideoFrame() and readAudio(), or until start() is called)
+		//(The video and audio pull methods can be called from different threads, but each must only be called from one thread at a time)
+		MediaConsumer(const std::string& prefix, const ConsumerOptions& options = ConsumerOptions());
+		
+		//Stops any sampling threads started by start() and detaches from the producer
 		~MediaConsumer();
 		
-		//MediaConsumer objects cannot be copied, only moved
+		//Determines if a producer is currently streaming with the specified prefix, without waiting for one to appear
+		//(This does not lock the producer's status mutex, so the result is only a snapshot, and a producer whose process has exited is never present)
+		static bool producerPresent(const std::string& prefix);
+		
+		//Waits for the producer with the specified prefix to appear, and returns the names and current parameters of its tracks
+		//(This does not register as a consumer; the tracks never change, although the producer may reconfigure their parameters)
+		static std::vector<Track> publishedTracks(const std::string& prefix, const ConsumerOptions& options = ConsumerOptions());
+		
+		//Starts sampling the first track or the named tracks on a video thread and an audio thread of our own, passing the data to
+		//the delegates, and returns immediately (the threads finish when the stream ends or when stop() is called)
+		//(This is only supported by consumers created with the constructor that does not take delegates, and an unknown track name
+		//or a consumer that has already been started throws std::runtime_error)
+		void start(std::unique_ptr<ConsumerDelegate>&& delegate, SamplingMode mode = SamplingMode::Polling);
+		void start(std::map< std::string, std::unique_ptr<ConsumerDelegate> >&& delegates, SamplingMode mode = SamplingMode::Polling);
+		
+		//Stops the threads started by start(), waiting at most one sampling interval for them to finish, and releases the delegates
+		//(Tracks can be pulled again once this returns, and it does nothing if the consumer has not been started)
+		void stop();
+		
+		//Determines if the producer is still streaming data
+		//(Once this returns false no more data will be published, although data that has already been published can still be pulled)
+		//(This also returns false once the producer's process has exited, even if it crashed without stopping the stream)
+		bool streamActive();
+		
+		//Returns the names and parameters of every track, as of the last reconfiguration that a pull method or sampling thread applied
+		//(Pull methods apply reconfigurations without reporting them, so pull consumers should check this periodically, and
+		//whenever the length of the data they receive changes)
+		std::vector<Track> trackParameters() const;
+		
+		//Pins the most recently published video frame of a track and moves it into the view, returning false without waiting if
+		//the track has not published a frame since the previous call (in which case the view is left untouched)
+		//(The view's damage is measured against the previous frame returned for the track, and the frame stays pinned until the
+		//view is released, so views should be released promptly to avoid blocking the producer)
+		bool tryGetLatestVideoFrame(VideoFrameView& view, uint32_t track = 0);
+		
+		//Copies the most recently published video frame of a track, returning false without waiting if the track has not published
+		//a frame since the previous call (a buffer that is smaller than a frame throws std::runtime_error)
+		bool tryGetLatestVideoFrame(uint8_t* buffer, uint64_t length, FrameInfo& info, uint32_t track = 0);
+		
+		//Reads up to the specified number of bytes of audio samples from a track, waiting at most the specified timeout for that many
+		//to be published, and returns the number of bytes read (always a whole number of frames, and zero if none are available)
+		//(Samples that were overwritten before they could be read are skipped and counted as overruns in the telemetry, as are any
+		//samples published before a reconfiguration that had not been read when it occurred; the metadata is that of the block
+		//containing the first sample that was read)
+		uint64_t readAudio(uint8_t* buffer, uint64_t length, std::chrono::microseconds timeout, uint32_t track = 0);
+		uint64_t readAudio(uint8_t* buffer, uint64_t length, std::chrono::microseconds timeout, FrameInfo& info, uint32_t track = 0);
+		
+		//Returns a file descriptor that becomes readable when the producer publishes data, reconfigures a track or stops, so that
+		//pull consumers can wait on many streams at once with poll(), epoll or an event loop such as boost::asio
+		//(The producer only signals the descriptor once prepareWait() has armed it, and the descriptor is -1 if the
+		//producer's registry of consumers is full or the platform does not support it, in which case consumers must poll)
+		//(The descriptor belongs to the consumer, and must not be read from or closed by the caller)
+		int descriptor();
+		
+		//Clears the descriptor and asks the producer to signal it, returning false if anything has been published since the
+		//previous call, in which case the caller should pull again rather than wait
+		//(The descriptor is armed either way, so a caller that pulls again may still find it readable when it next waits)
+		bool prepareWait();
+		
+		//MediaConsumer objects cannot be copied, only moved (and must not be moved while started)
 		MediaConsumer(const MediaConsumer& other) = delete;
 		MediaConsumer& operator=(const MediaConsumer& other) = delete;
 		MediaConsumer(MediaConsumer&& other) = default;
 		MediaConsumer& operator=(MediaConsumer&& other) = default;
 		
 	private:
+		friend class ConsumerReactor;
 		
-		//Determines if the producer is still streaming data
+		//Opens the shared memory and mutexes for the specified prefix and retrieves the parameters of each track
+		void attach(const std::string& prefix, const ConsumerOptions& options);
+		
+		//Subscribes the specified delegate to the track with the specified index
+		void subscribe(uint32_t index, std::unique_ptr<ConsumerDelegate>&& delegate);
+		
+		//Runs the sampling loops for our subscribed tracks until the stream ends
+		void run();
+		
+		//Claims a set of telemetry counters, which registers us with the producer, and releases them once we have finished
+		void claimCounters();
+		void releaseCounters();
+		
+		//Hands the named tracks to their delegates, applying any reconfigurations that have not been pulled yet
+		void bindDelegates(std::map< std::string, std::unique_ptr<ConsumerDelegate> >&& delegates);
+		
+		//Passes the current parameters to the delegates and starts the sampling threads
+		void startThreads(SamplingMode mode);
+		
+		//Passes the current parameters to the delegates and prepares to sample on notification from the caller's thread, after
+		//which dispatch() passes any data published since it was last called to the delegates without waiting, returning false
+		//once the stream has ended (this is how a ConsumerReactor samples its streams)
+		void beginDispatch();
+		bool dispatch();
+		
+		//Retrieves a track that can be pulled, applying any reconfigurations of its video or audio parameters first
+		ConsumerTrack& pullVideo(uint32_t track);
+		ConsumerTrack& pullAudio(uint32_t track);
+		
+		//Determines if the sampling loops should keep running
 		bool streamIsActive();
 		
 		//The video sampling loop
@@ -31,7 +159,56 @@ class MediaConsumer : public MediaBase
 		//The audio sampling loop
 		void audioLoop();
 		
-		std::unique_ptr<ConsumerDelegate> delegate;
+		//Samples the most recent video frame or the available audio samples of a single track
+		//(Audio samples are only read up to the specified write index, which is used to finish reading a ring that has moved)
+		void sampleVideo(ConsumerTrack& track);
+		void sampleAudio(ConsumerTrack& track, uint64_t limit = UINT64_MAX);
+		
+		//Records whether a sampled video frame was new, a repeat of the previous frame, or whether we missed any frames in between
+		void countVideoFrame(ConsumerTrack& track, uint64_t sequence);
+		
+		//Applies any reconfigurations that the producer has published since the video or audio sampling loop last checked
+		//(Each loop moves its own rings, and whichever loop notices a reconfiguration first passes the new parameters to the delegate)
+		void refreshVideo();
+		void refreshAudio();
+		
+		//Releases the frame rings and video buffers replaced by reconfigurations once we no longer hold views of their frames
+		void releaseRetiredRings();
+		
+		SamplingMode mode;
+		
+		//The prefix of the producer's shared memory objects (needed to open the buffers when the producer recreates them)
+		std::string prefix;
+		
+		//The names, parameters and layout of every track published by the producer at the time we attached
+		std::unique_ptr<ConsumerLayout> layout;
+		
+		//The reconfiguration generation most recently applied by the video and audio sampling loops, and the generations of the buffers they have mapped
+		uint64_t videoGeneration;
+		uint64_t audioGeneration;
+		uint32_t videoBufferGeneration;
+		uint32_t audioBufferGeneration;
+		
+		//Frame rings and video buffers replaced by reconfigurations, which are kept until we have released every view of their frames
+		std::vector< std::unique_ptr<FrameRing> > retiredRings;
+		std::vector<MemoryWrapperPtr> retiredBuffers;
+		
+		//The tracks we are subscribed to
+		std::vector< std::unique_ptr<ConsumerTrack> > tracks;
+		
+		//Our telemetry counters (these are private to our process if every set of counters in shared memory is already claimed)
+		ConsumerCounters* counters;
+		
+		//The registry entry holding our process ID if we could not claim a set of counters (UINT32_MAX if we have no entry)
+		uint32_t unregisteredEntry;
+		
+		//The sampling threads of a consumer that was constructed without delegates (null for the other constructors)
+		std::unique_ptr<ConsumerThreads> threads;
+		
+		//The doorbell returned by descriptor() (null until it is first called), and the notifications observed by prepareWait()
+		std::unique_ptr<Doorbell> doorbell;
+		uint32_t lastVideoEvent;
+		uint32_t lastAudioEvent;
 };
 
 } //End MediaIPC
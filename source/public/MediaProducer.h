@@ -2,15 +2,34 @@
 #define _MEDIA_IPC_MEDIA_PRODUCER
 
 #include "ControlBlock.h"
+#include "Formats.h"
+#include "FrameDamage.h"
+#include "FrameInfo.h"
 #include "MediaBase.h"
+#include "ProducerOptions.h"
+#include "StreamStats.h"
+#include "Track.h"
+#include <functional>
 #include <string>
+#include <vector>
 
 namespace MediaIPC {
 
+struct ConsumerRegistry;
+struct RenditionLadder;
+
 class MediaProducer : public MediaBase
 {
 	public:
-		MediaProducer(const std::string& prefix, const ControlBlock& cb);
+		//Receives the number of consumers attached to the stream each time it changes
+		typedef std::function<void(uint32_t)> ConsumerCountCallback;
+		
+		//Creates a producer that publishes a single unnamed track
+		MediaProducer(const std::string& prefix, const ControlBlock& cb, const ProducerOptions& options = ProducerOptions());
+		
+		//Creates a producer that publishes multiple named tracks with independent parameters under a single prefix
+		//(All of the tracks share a single control block, status mutex, video buffer and audio buffer in shared memory)
+		MediaProducer(const std::string& prefix, const std::vector<Track>& tracks, const ProducerOptions& options = ProducerOptions());
 		~MediaProducer();
 		
 		//MediaProducer objects cannot be copied, only moved
@@ -19,9 +38,115 @@ class MediaProducer : public MediaBase
 		MediaProducer(MediaProducer&& other) = default;
 		MediaProducer& operator=(MediaProducer&& other) = default;
 		
-		void submitVideoFrame(void* buffer, uint64_t length);
-		void submitAudioSamples(void* buffer, uint64_t length);
+		//Publishes a video frame or a block of audio samples, with an optional presentation timestamp
+		//(Each frame and block is also stamped with a sequence number and the time at which it was published)
+		void submitVideoFrame(void* buffer, uint64_t length, int64_t pts = FrameInfo::NoPts);
+		void submitAudioSamples(void* buffer, uint64_t length, int64_t pts = FrameInfo::NoPts);
+		
+		//Converts a video frame from the specified pixel format directly into shared memory and publishes it
+		//(The source stride is in bytes, and zero indicates tightly packed rows; returns false if the conversion is unsupported)
+		//(When the source is already in the stream's format, this copies a frame with its own row pitch into the stream's row stride)
+		bool submitVideoFrame(const void* buffer, VideoFormat sourceFormat, uint64_t sourceStride = 0, int64_t pts = FrameInfo::NoPts);
+		
+		//Publishes a video frame that differs from the previous frame only within the specified rectangles (measured in pixels),
+		//so that only those regions are copied into shared memory and consumers can copy only those regions out again
+		//(The buffer holds a whole frame in the stream's format, rectangles are clipped to the frame, and an empty list publishes an unchanged frame)
+		void submitVideoFrame(const void* buffer, const std::vector<DamageRect>& damage, int64_t pts = FrameInfo::NoPts);
 		void stop();
+		
+		//Returns a writable pointer to the next video frame slot in shared memory, so the frame can be rendered in place
+		//(The frame is not visible to consumers until commitVideoFrame() is called)
+		uint8_t* acquireVideoFrame();
+		
+		//Publishes the video frame slot that was returned by acquireVideoFrame(), with an optional presentation timestamp
+		void commitVideoFrame(int64_t pts = FrameInfo::NoPts);
+		
+		//Returns a writable pointer into the audio ring in shared memory, so samples can be written in place
+		//(The requested length is clamped to the contiguous space before the end of the ring)
+		uint8_t* acquireAudioSamples(uint64_t& length);
+		
+		//Publishes the specified number of bytes written to the pointer returned by acquireAudioSamples() as a single block,
+		//with an optional presentation timestamp
+		void commitAudioSamples(uint64_t length, int64_t pts = FrameInfo::NoPts);
+		
+		//Returns the number of tracks that the producer publishes, including any renditions
+		uint32_t trackCount() const;
+		
+		//Equivalents of the methods above for a specific track, identified by its index in the list passed to the constructor
+		//(The methods above operate on the first track, and an out-of-range index throws std::out_of_range)
+		//(Renditions are generated and published along with each video frame of their track, so they are never submitted to directly)
+		//(The presentation timestamp is required when committing to a specific track, so that the calls are never ambiguous)
+		void submitVideoFrame(uint32_t track, void* buffer, uint64_t length, int64_t pts = FrameInfo::NoPts);
+		void submitAudioSamples(uint32_t track, void* buffer, uint64_t length, int64_t pts = FrameInfo::NoPts);
+		bool submitVideoFrame(uint32_t track, const void* buffer, VideoFormat sourceFormat, uint64_t sourceStride = 0, int64_t pts = FrameInfo::NoPts);
+		void submitVideoFrame(uint32_t track, const void* buffer, const std::vector<DamageRect>& damage, int64_t pts = FrameInfo::NoPts);
+		uint8_t* acquireVideoFrame(uint32_t track);
+		void commitVideoFrame(uint32_t track, int64_t pts);
+		uint8_t* acquireAudioSamples(uint32_t track, uint64_t& length);
+		void commitAudioSamples(uint32_t track, uint64_t length, int64_t pts);
+		
+		//Changes the video and audio parameters of the first track or of a specific track without tearing down the stream
+		//(The track's new rings are placed in spare space in the existing buffers when they fit, otherwise the buffers are
+		//recreated with room to spare, and consumers pass the new parameters to their delegates before any data that uses them)
+		//(Any video frame or audio samples acquired but not yet committed for the track are discarded)
+		//(The track's renditions are reconfigured along with it, and attempting to reconfigure a rendition directly throws std::runtime_error)
+		void reconfigure(const ControlBlock& cb);
+		void reconfigure(uint32_t track, const ControlBlock& cb);
+		
+		//Returns the number of consumers currently attached to the stream, first removing any that have crashed from the registry
+		uint32_t consumerCount();
+		
+		//Returns a snapshot of the telemetry counters for the stream, including the heartbeat and progress of each registered consumer
+		StreamStats stats() const;
+		
+		//Sets the callback that receives the number of attached consumers each time consumers attach, detach or are found to have crashed
+		//(Changes are detected by whichever thread next submits or commits data or calls consumerCount(), and the callback runs on that thread)
+		void setConsumerCountCallback(const ConsumerCountCallback& callback);
+		
+	private:
+		
+		//Checks the consumer registry if consumers have attached or detached since we last looked or if it is time to look for
+		//crashed consumers, invoking the consumer count callback if the count has changed, and returns true if any are attached
+		bool updateConsumers();
+		
+		//Counts the attached consumers, waiting for any other thread that is already doing so if requested
+		void scanConsumers(uint64_t now, bool wait);
+		
+		//Releases the pins held on our frame slots by a consumer whose process has exited and removes its doorbell, returning
+		//false if the status mutex could not be acquired (in which case the consumer is reclaimed by a later scan)
+		bool reclaimConsumer(uint32_t owner);
+		
+		//Wakes the consumers that are waiting for new video frames or audio samples, including those that wait on a doorbell
+		void notifyConsumers(bool video, bool audio);
+		
+		//Creates a new video or audio buffer and lays out the rings of every track from its start, optionally doubling
+		//its size so that the rings of tracks that are later reconfigured can be placed in the spare space
+		void createVideoBuffer(bool headroom);
+		void createAudioBuffer(bool headroom);
+		
+		//Wraps the frame ring or sample ring interface for a track around its current region of the video or audio buffer
+		void wrapVideoRing(uint32_t track);
+		void wrapAudioRing(uint32_t track);
+		
+		//Allocates the buffers that hold the intermediate steps of a track's renditions that are not themselves published
+		void prepareRenditions(uint32_t track);
+		
+		//Generates and publishes the renditions of a track from a video frame that has just been published
+		void publishRenditions(uint32_t track, const uint8_t* frame, int64_t pts);
+		
+		//The prefix and options that the producer was created with (needed when the buffers are recreated)
+		std::string prefix;
+		ProducerOptions options;
+		
+		//The number of bytes at the start of the video and audio buffers that are occupied by track rings
+		uint64_t videoUsed;
+		uint64_t audioUsed;
+		
+		//Our view of the consumer registry, and the consumer count callback
+		std::unique_ptr<ConsumerRegistry> registry;
+		
+		//The renditions of each track passed to the constructor (null for tracks without renditions)
+		std::vector< std::unique_ptr<RenditionLadder> > ladders;
 };
 
 } //End MediaIPC
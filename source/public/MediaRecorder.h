@@ -0,0 +1,74 @@
+#ifndef _MEDIA_IPC_MEDIA_RECORDER
+#define _MEDIA_IPC_MEDIA_RECORDER
+
+#include "RecordingOptions.h"
+#include "RecordingStats.h"
+#include "Track.h"
+#include "VideoFrameView.h"
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace MediaIPC {
+
+struct MediaRecorderState;
+struct QueuedRecord;
+
+//Consumes a stream and records every track's control block updates, video frames and audio samples to a file, along with
+//their timestamps and an index, so that MediaReplayer can republish the stream later
+//(The recorder relies on POSIX file I/O, so it is only available under Linux and macOS)
+class MediaRecorder
+{
+	public:
+		
+		//Waits for the producer with the specified prefix to appear and creates the recording, replacing any existing file
+		MediaRecorder(const std::string& prefix, const std::string& path, const RecordingOptions& options = RecordingOptions());
+		~MediaRecorder();
+		
+		//MediaRecorder objects cannot be copied or moved, since the threads recording the stream refer to them
+		MediaRecorder(const MediaRecorder& other) = delete;
+		MediaRecorder& operator=(const MediaRecorder& other) = delete;
+		
+		//Records every track of the stream until the stream ends, and then writes the index and completes the file
+		//(Throws std::runtime_error if writing fails, although only once the stream ends, since consumers sample until then)
+		void run();
+		
+		//Returns the current values of our counters (this can be called from any thread while run() is in progress)
+		RecordingStats stats() const;
+		
+	private:
+		//Queues a video frame for the writer thread, holding it pinned in shared memory where possible and otherwise copying it
+		void enqueueVideoFrame(uint32_t track, VideoFrameView& view);
+		
+		//The writer thread, which copies queued records into the staging buffer and writes it out whenever it fills
+		void writeLoop();
+		
+		//Appends a record to the staging buffer and the index, releasing the frame it holds
+		void write(QueuedRecord& record);
+		
+		//Appends data to the staging buffer, writing the buffer to the file each time it fills
+		void append(const void* data, uint64_t length);
+		
+		//Writes the staging buffer to the file, padding it to a whole number of blocks if it is only partially filled
+		void flush();
+		
+		//Writes the index and the final contents of the staging buffer, and then updates the header to refer to the index
+		void complete();
+		
+		//Marks the writer thread as finished and waits for it to exit
+		void finish();
+		
+		std::string prefix;
+		RecordingOptions options;
+		
+		//The names and initial parameters of the tracks we record
+		std::vector<Track> tracks;
+		
+		//The file, the queue, the staging buffer and the counters, whose types are private to the library
+		std::unique_ptr<MediaRecorderState> state;
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef _MEDIA_IPC_MEDIA_REPLAYER
+#define _MEDIA_IPC_MEDIA_REPLAYER
+
+#include "RecordingOptions.h"
+#include "RecordingStats.h"
+#include "Track.h"
+#include <stdint.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace MediaIPC {
+
+struct MediaReplayerState;
+struct RecordingIndexEntry;
+class MediaProducer;
+
+//Memory-maps a recording made by MediaRecorder and republishes it through a producer under a new prefix
+//(The republished stream has the same tracks and parameters as the recorded one, and follows its reconfigurations)
+class MediaReplayer
+{
+	public:
+		
+		//Opens the recording and reads its header and index, throwing std::runtime_error if it is invalid
+		//(If the recorder did not complete the file, for example because it crashed, the index is rebuilt from the records)
+		MediaReplayer(const std::string& path, const std::string& prefix, const RecordingOptions& options = RecordingOptions());
+		~MediaReplayer();
+		
+		//MediaReplayer objects cannot be copied or moved
+		MediaReplayer(const MediaReplayer& other) = delete;
+		MediaReplayer& operator=(const MediaReplayer& other) = delete;
+		
+		//Returns the names and initial parameters of the recorded tracks
+		std::vector<Track> tracks() const;
+		
+		//Returns the time between the first and last records of the recording
+		std::chrono::nanoseconds duration() const;
+		
+		//Republishes the recording from the starting offset until its end, at which point the producer is stopped
+		//(Throws std::runtime_error if a record is inconsistent with its track's parameters, after stopping the producer)
+		void run();
+		
+		//Returns the current values of our counters (this can be called from any thread while run() is in progress)
+		RecordingStats stats() const;
+		
+	private:
+		
+		//Republishes a single record, returning false if it marks the end of the stream
+		bool publish(MediaProducer& producer, std::vector<ControlBlock>& controlBlocks, const RecordingIndexEntry& entry);
+		
+		std::string prefix;
+		RecordingOptions options;
+		
+		//The mapping of the file, the tracks, the index and the counters, whose types are private to the library
+		std::unique_ptr<MediaReplayerState> state;
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef _MEDIA_IPC_PRODUCER_OPTIONS
+#define _MEDIA_IPC_PRODUCER_OPTIONS
+
+#include <stdint.h>
+#include <chrono>
+
+namespace MediaIPC {
+
+//Options controlling how a producer allocates its video and audio buffers
+class ProducerOptions
+{
+	public:
+		
+		//Creates a set of options that use regular shared memory with no NUMA binding or pre-faulting, and always copy submitted data
+		ProducerOptions();
+		
+		//Back the buffers with huge pages where available, to reduce the number of TLB entries touched per frame
+		//(Under Linux a writable hugetlbfs mount is used if one exists, otherwise the kernel is advised to use transparent huge pages)
+		bool hugePages;
+		
+		//The NUMA node to bind the buffers to, or -1 to place pages on whichever node first touches them
+		//(This is only supported under Linux, and is ignored elsewhere)
+		int32_t numaNode;
+		
+		//Fault in every page of the buffers in each consumer when it attaches, so the first frames do not pay page fault costs
+		//(The producer always touches every page when it zeroes the buffers, so this only affects consumers)
+		bool prefault;
+		
+		//Discard frames and audio samples passed to the submit methods while no consumers are attached, rather than copying them
+		//(Consumers that attach later will not see the most recent frame until the next one is submitted)
+		bool skipUnobserved;
+		
+		//The time after which a consumer that has stopped updating its heartbeat and whose process has exited is removed from the registry
+		//(This should be longer than the slowest polling interval of any consumer, since consumers update their heartbeat once per interval)
+		std::chrono::milliseconds consumerTimeout;
+		
+		//The maximum time that reconfigure() and stop() wait for consumers to release the status mutex
+		//(A consumer that dies while holding the mutex never stalls the producer, since the mutex is recovered immediately under Linux,
+		//so this only guards against consumers that are alive but suspended; reconfigure() throws std::runtime_error if it expires)
+		std::chrono::milliseconds lockTimeout;
+};
+
+} //End MediaIPC
+
+#endif
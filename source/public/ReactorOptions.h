@@ -0,0 +1,36 @@
+#ifndef _MEDIA_IPC_REACTOR_OPTIONS
+#define _MEDIA_IPC_REACTOR_OPTIONS
+
+#include "ConsumerOptions.h"
+#include <stdint.h>
+#include <chrono>
+
+namespace MediaIPC {
+
+//Options controlling how a ConsumerReactor samples its streams
+class ReactorOptions
+{
+	public:
+		
+		//Creates a set of options that use two worker threads, each taking up to 16 ready streams at a time, and check idle streams every second
+		ReactorOptions();
+		
+		//The number of worker threads that sample the streams
+		uint32_t threads;
+		
+		//The maximum number of ready streams that a worker takes at a time
+		//(Smaller values spread bursts of activity across the workers more evenly, while larger values make fewer system calls)
+		uint32_t batchSize;
+		
+		//The interval at which streams that have not been woken by their producer are checked anyway, which bounds the time it
+		//takes to notice that a stream has ended if its producer could not wake us
+		std::chrono::milliseconds checkInterval;
+		
+		//The options used to attach to each stream
+		//(ConsumerReactor::add() waits for the producer to appear, so an attach timeout keeps a missing producer from stalling it)
+		ConsumerOptions consumerOptions;
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef _MEDIA_IPC_REACTOR_STATS
+#define _MEDIA_IPC_REACTOR_STATS
+
+#include <stdint.h>
+#include <string>
+
+namespace MediaIPC {
+
+//Snapshot of the counters for a single stream sampled by a ConsumerReactor
+class ReactorStats
+{
+	public:
+		ReactorStats();
+		
+		//The ID returned by ConsumerReactor::add() and the prefix of the stream
+		uint64_t stream;
+		std::string prefix;
+		
+		//The number of turns the stream has taken, and the number that began because its producer woke us
+		//(The remainder are turns that continued a busy stream after other streams had a turn, or periodic checks of idle streams)
+		uint64_t turns;
+		uint64_t wakeups;
+		
+		//The time from when the producer woke us until a worker began the turn, which grows when the workers cannot keep up
+		//(the total, the maximum and the number of wakeups measured)
+		uint64_t wakeLatencyNanoseconds;
+		uint64_t wakeLatencyMaxNanoseconds;
+		uint64_t wakeLatencySamples;
+		
+		//The total time spent in turns (which is mostly spent in the delegates) and the longest turn
+		uint64_t turnNanoseconds;
+		uint64_t turnMaxNanoseconds;
+		
+		//The number of video frames passed to the delegates and the number published that were never passed to them, along
+		//with the number of buffers of audio samples passed to the delegates and the number of bytes of samples that were
+		//overwritten before they could be read
+		uint64_t videoFramesConsumed;
+		uint64_t videoFramesSkipped;
+		uint64_t audioBuffersConsumed;
+		uint64_t audioBytesLost;
+		
+		//The error that detached the stream, if a delegate threw or the stream could not be sampled (empty otherwise)
+		std::string error;
+};
+
+} //End MediaIPC
+
+#endif
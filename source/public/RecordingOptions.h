@@ -0,0 +1,49 @@
+#ifndef _MEDIA_IPC_RECORDING_OPTIONS
+#define _MEDIA_IPC_RECORDING_OPTIONS
+
+#include "ConsumerOptions.h"
+#include "MediaConsumer.h"
+#include "ProducerOptions.h"
+#include <stdint.h>
+#include <chrono>
+
+namespace MediaIPC {
+
+//Options controlling how a stream is recorded to a file and replayed from it
+class RecordingOptions
+{
+	public:
+		
+		//Creates a set of options that record every frame using direct writes of 8MiB, and replay in real time from the start
+		RecordingOptions();
+		
+		//How the recorder samples the stream it records
+		//(Sampling on notification records every frame and block the producer publishes, disk bandwidth permitting)
+		SamplingMode samplingMode;
+		
+		//The options the recorder uses to attach to the stream, and the options the replayer uses to republish it
+		ConsumerOptions consumerOptions;
+		ProducerOptions producerOptions;
+		
+		//The size of each write the recorder makes (rounded up to a multiple of 4096 bytes)
+		uint64_t writeSize;
+		
+		//Bypass the page cache when writing the recording, so that sustained recording does not evict everything else from memory
+		//(This uses O_DIRECT under Linux and F_NOCACHE under macOS, and falls back to regular writes where the file system does not support it)
+		bool directIO;
+		
+		//The maximum number of bytes of frame and sample data that the recorder copies while waiting for them to be written
+		//(Frames are held pinned in shared memory while that leaves the producer a free slot, and are copied once it would not,
+		//so this bounds the backlog when the disk falls behind; frames beyond it are dropped)
+		uint64_t maxQueuedBytes;
+		
+		//Republish frames and samples at the pace at which they were recorded, rather than as fast as possible
+		bool realTime;
+		
+		//The offset from the start of the recording at which the replayer begins, which it locates using the recording's index
+		std::chrono::milliseconds startOffset;
+};
+
+} //End MediaIPC
+
+#endif
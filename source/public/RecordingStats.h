@@ -0,0 +1,35 @@
+#ifndef _MEDIA_IPC_RECORDING_STATS
+#define _MEDIA_IPC_RECORDING_STATS
+
+#include <stdint.h>
+
+namespace MediaIPC {
+
+//Snapshot of the counters for a recorder or a replayer
+//(The recorder counts what it wrote to the file, and the replayer counts what it read from the file and republished)
+class RecordingStats
+{
+	public:
+		RecordingStats();
+		
+		//The number of video frames, blocks of audio samples and control block updates recorded or replayed
+		uint64_t videoFrames;
+		uint64_t audioBlocks;
+		uint64_t controlBlocks;
+		
+		//The number of bytes written to or read from the file, and the number of writes the recorder made
+		uint64_t bytes;
+		uint64_t writes;
+		
+		//The number of video frames the recorder dropped because the disk could not keep up, and the number it recorded
+		//after the producer had begun overwriting them (which only happens when every slot in the ring is pinned)
+		uint64_t videoFramesDropped;
+		uint64_t videoFramesTorn;
+		
+		//The number of bytes of frame and sample data that the recorder has copied and has yet to write (see RecordingOptions::maxQueuedBytes)
+		uint64_t queuedBytes;
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef _MEDIA_IPC_STREAM_STATS
+#define _MEDIA_IPC_STREAM_STATS
+
+#include "MediaBase.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace MediaIPC {
+
+//Snapshot of the telemetry counters maintained by a producer
+//(All counters are cumulative since the producer was created, so rates are computed by differencing two snapshots)
+class ProducerStats
+{
+	public:
+		ProducerStats();
+		
+		uint64_t videoFramesSubmitted;
+		uint64_t videoBytesCopied;
+		uint64_t audioBlocksSubmitted;
+		uint64_t audioBytesSubmitted;
+		uint64_t audioBytesCopied;
+		
+		//Video frames and audio blocks that were submitted while no consumers were attached, and so were never copied
+		uint64_t videoFramesUnobserved;
+		uint64_t audioBlocksUnobserved;
+		
+		//The number of times the producer found the status mutex locked, and the total time it spent waiting for it
+		uint64_t statusLockContentions;
+		uint64_t statusLockWaitNanoseconds;
+};
+
+//Snapshot of the telemetry counters maintained by a single consumer
+class ConsumerStats
+{
+	public:
+		ConsumerStats();
+		
+		//The process ID of the consumer, and the index of the counters it claimed in shared memory
+		uint32_t processId;
+		uint32_t index;
+		
+		//The std::chrono::steady_clock time at which one of the consumer's sampling loops last ran, in nanoseconds since the clock's epoch
+		//(Comparing this to the current time shows whether the consumer is still running, or is stalled in one of its delegates)
+		uint64_t heartbeat;
+		
+		//The sequence numbers of the video frame and audio block that the consumer most recently passed to a delegate
+		//(Comparing these to the latest sequence numbers published by the producer shows whether the consumer is keeping up)
+		uint64_t lastVideoSequence;
+		uint64_t lastAudioSequence;
+		
+		//The shortest interval at which the consumer polls for video and audio, in nanoseconds
+		//(This is zero when the consumer samples on notification, or has no tracks that transmit the media type)
+		uint64_t videoSamplingInterval;
+		uint64_t audioSamplingInterval;
+		
+		//Distinct video frames delivered to the delegate, frames delivered again because nothing new had been published,
+		//and frames the producer published that the consumer never sampled
+		uint64_t videoFramesConsumed;
+		uint64_t videoDuplicates;
+		uint64_t videoFramesSkipped;
+		uint64_t videoBytesCopied;
+		
+		uint64_t audioBuffersConsumed;
+		uint64_t audioBytesCopied;
+		uint64_t audioBytesLost;
+		uint64_t audioUnderruns;
+		
+		//The number of times the consumer found the status mutex locked, and the total time it spent waiting for it
+		uint64_t statusLockContentions;
+		uint64_t statusLockWaitNanoseconds;
+};
+
+//Snapshot of the telemetry counters for a stream
+class StreamStats
+{
+	public:
+		StreamStats();
+		
+		ProducerStats producer;
+		
+		//The counters for each consumer that is currently attached to the stream
+		std::vector<ConsumerStats> consumers;
+		
+		//The number of attached consumers that have no counters, because every set of counters in shared memory was already claimed
+		//(Only the first 64 such consumers are tracked, and any beyond that are not counted as attached)
+		uint32_t unregisteredConsumers;
+		
+		//The number of times the status mutex was recovered after a process died while holding it
+		uint64_t statusLockRecoveries;
+};
+
+//Attaches read-only to the telemetry counters of a stream, without registering as a consumer
+class StatsReader
+{
+	public:
+		
+		//Waits until the producer with the specified prefix has created its shared memory and then attaches to it
+		StatsReader(const std::string& prefix);
+		~StatsReader();
+		
+		//StatsReader objects cannot be copied, only moved
+		StatsReader(const StatsReader& other) = delete;
+		StatsReader& operator=(const StatsReader& other) = delete;
+		StatsReader(StatsReader&& other) = default;
+		StatsReader& operator=(StatsReader&& other) = default;
+		
+		//Reads the current values of the counters
+		StreamStats sample() const;
+		
+	private:
+		
+		//Control block shared memory (mapped read-only)
+		MemoryWrapperPtr controlBlockMemory;
+		
+		//Shared state pointer (points to the lock-free state that follows the control block in shared memory)
+		const SharedState* sharedState;
+};
+
+} //End MediaIPC
+
+#endif
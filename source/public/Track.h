@@ -0,0 +1,56 @@
+#ifndef _MEDIA_IPC_TRACK
+#define _MEDIA_IPC_TRACK
+
+#include "ControlBlock.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace MediaIPC {
+
+//The maximum number of tracks that a single producer can publish
+#define MEDIA_IPC_MAX_TRACKS 16
+
+//The maximum length of a track name in bytes, including the null terminator
+#define MEDIA_IPC_MAX_TRACK_NAME 64
+
+//A downscaled copy of a track's video stream, which the producer generates from each frame and publishes as a track of its own
+//(The divisor is the factor by which the width and height are reduced, which must be a power of two no smaller than 2,
+//and dimensions that are not a multiple of the divisor are rounded up)
+class Rendition
+{
+	public:
+		Rendition();
+		Rendition(const std::string& name, uint32_t divisor);
+		
+		//The name that consumers use to subscribe to the rendition
+		std::string name;
+		
+		//The factor by which the width and height of the track are reduced
+		uint32_t divisor;
+};
+
+//A named track published by a producer, such as a camera, a view or an audio language
+//(Each track carries its own video stream and/or audio stream, described by its control block, and setting the
+//video or audio format to None in the control block omits that stream from the track)
+class Track
+{
+	public:
+		Track();
+		Track(const std::string& name, const ControlBlock& controlBlock);
+		
+		//The name that consumers use to subscribe to the track
+		std::string name;
+		
+		//The video and audio parameters of the track
+		ControlBlock controlBlock;
+		
+		//Any downscaled renditions of the track's video stream, which are published as additional tracks after all of
+		//the tracks passed to the producer, in order (each has the video parameters of the track scaled down, and no audio)
+		//(The track's video format must be supported by FormatConverter::halve())
+		std::vector<Rendition> renditions;
+};
+
+} //End MediaIPC
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef _MEDIA_IPC_VIDEO_FRAME_VIEW
+#define _MEDIA_IPC_VIDEO_FRAME_VIEW
+
+#include "FrameDamage.h"
+#include "FrameInfo.h"
+#include <stdint.h>
+
+namespace MediaIPC {
+
+class FrameRing;
+
+//Read-only view of a video frame that is pinned directly in shared memory
+//(The producer will not overwrite the frame while the view holds its pin, which is released when the view is destroyed)
+//(Views must not outlive the MediaConsumer that produced them)
+class VideoFrameView
+{
+	public:
+		
+		//Creates an empty view
+		VideoFrameView();
+		~VideoFrameView();
+		
+		//Views cannot be copied, only moved (ownership of the pin is transferred to the new view)
+		VideoFrameView(const VideoFrameView& other) = delete;
+		VideoFrameView& operator=(const VideoFrameView& other) = delete;
+		VideoFrameView(VideoFrameView&& other);
+		VideoFrameView& operator=(VideoFrameView&& other);
+		
+		//Determines if the view refers to a frame
+		bool isValid() const;
+		
+		//Determines if the frame data is still intact
+		//(This can only become false if the producer ran out of unpinned slots while the view was held)
+		bool isIntact() const;
+		
+		//Returns a pointer to the frame data in shared memory
+		const uint8_t* data() const;
+		
+		//Returns the length of the frame data in bytes
+		uint64_t length() const;
+		
+		//Returns the sequence number of the frame
+		uint64_t sequence() const;
+		
+		//Returns the metadata for the frame (the sequence number, publish timestamp and presentation timestamp)
+		FrameInfo info() const;
+		
+		//Returns the regions of the frame that changed since the previous view that was passed to the delegate
+		const FrameDamage& damage() const;
+		
+		//Releases the pin on the frame, after which the view is empty
+		void release();
+		
+	private:
+		friend class MediaConsumer;
+		
+		//Creates a view of a slot that has already been pinned
+		VideoFrameView(const FrameRing* ring, uint32_t slot, uint32_t owner, uint64_t sequence, uint64_t length, const FrameDamage& damage);
+		
+		void moveFrom(VideoFrameView&& other);
+		
+		const FrameRing* ring;
+		uint32_t slot;
+		uint32_t owner;
+		uint64_t frameSequence;
+		uint64_t frameLength;
+		FrameDamage frameDamage;
+};
+
+} //End MediaIPC
+
+#endif
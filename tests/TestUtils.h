@@ -0,0 +1,57 @@
+#ifndef _MEDIA_IPC_TEST_UTILS
+#define _MEDIA_IPC_TEST_UTILS
+
+#include <stdint.h>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace MediaIPCTests {
+
+//Records the outcome of the checks made by a test, reporting each one that fails
+class TestResults
+{
+	public:
+		TestResults() : checks(0), failures(0) {}
+		
+		//Records a check, printing the description if it failed
+		bool check(bool passed, const std::string& description)
+		{
+			this->checks += 1;
+			if (passed == false)
+			{
+				this->failures += 1;
+				std::cerr << "FAILED: " << description << std::endl;
+			}
+			
+			return passed;
+		}
+		
+		//Prints a summary and returns the exit status for the test
+		int finish(const std::string& name) const
+		{
+			std::cout << name << ": " << (this->checks - this->failures) << " of " << this->checks << " checks passed" << std::endl;
+			return ((this->failures == 0) ? 0 : 1);
+		}
+		
+	private:
+		uint64_t checks;
+		uint64_t failures;
+};
+
+//Fills a buffer with pseudo-random bytes, using a fixed seed so that failures are reproducible
+inline std::vector<uint8_t> randomBytes(uint64_t length, uint32_t seed)
+{
+	std::mt19937 generator(seed);
+	std::vector<uint8_t> bytes((size_t)(length));
+	for (uint8_t& byte : bytes) {
+		byte = (uint8_t)(generator());
+	}
+	
+	return bytes;
+}
+
+} //End MediaIPCTests
+
+#endif
@@ -0,0 +1,195 @@
+#include "../source/public/AudioConverter.h"
+#include "TestUtils.h"
+#include <stdint.h>
+#include <cstring>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+using std::string;
+using std::vector;
+using MediaIPC::AudioConverter;
+using MediaIPC::AudioFormat;
+using MediaIPC::FormatDetails;
+using MediaIPCTests::TestResults;
+
+namespace
+{
+	//Every audio format, along with its identifier
+	struct NamedFormat
+	{
+		AudioFormat format;
+		string name;
+		bool isFloat;
+		bool bigEndian;
+	};
+	
+	const vector<NamedFormat> formats = {
+		#define AUDIO_FORMAT(name, bytes, description) { AudioFormat::name, #name, (string(#name).find("_F") != string::npos), (string(#name).find("BE") != string::npos) },
+		#include "../source/public/AudioFormats.inc"
+	};
+	
+	//Sample counts either side of the blocks that the SSE2 and AVX2 kernels process, and either side of the converter's chunk size
+	const vector<uint64_t> sampleCounts = { 1, 3, 4, 7, 8, 9, 15, 16, 17, 31, 33, 100, 1023, 1024, 1025, 2500 };
+	
+	//Generates samples in the specified format
+	//(Floating-point samples are generated as values, since random bytes could be NaNs or infinities, and some of them fall
+	//outside of the range [-1.0, 1.0] so that clamping is exercised)
+	vector<uint8_t> generateSamples(const NamedFormat& format, uint64_t samples, uint32_t seed)
+	{
+		uint8_t bytes = FormatDetails::bytesPerSample(format.format);
+		if (format.isFloat == false) {
+			return MediaIPCTests::randomBytes(samples * bytes, seed);
+		}
+		
+		std::mt19937 generator(seed);
+		std::uniform_real_distribution<double> distribution(-1.25, 1.25);
+		vector<uint8_t> data(samples * bytes);
+		for (uint64_t index = 0; index < samples; ++index)
+		{
+			double value = distribution(generator);
+			float narrow = (float)(value);
+			uint8_t* sample = data.data() + (index * bytes);
+			std::memcpy(sample, ((bytes == sizeof(double)) ? (const void*)(&value) : (const void*)(&narrow)), bytes);
+			if (format.bigEndian == true)
+			{
+				for (uint8_t byte = 0; byte < bytes / 2; ++byte) {
+					std::swap(sample[byte], sample[bytes - 1 - byte]);
+				}
+			}
+		}
+		
+		return data;
+	}
+	
+	//Converts samples using the specified instruction set
+	vector<uint8_t> convertWith(const string& set, const vector<uint8_t>& source, const NamedFormat& sourceFormat, const NamedFormat& destFormat, uint64_t samples)
+	{
+		AudioConverter::setInstructionSet(set);
+		vector<uint8_t> dest(samples * FormatDetails::bytesPerSample(destFormat.format), 0xCD);
+		if (AudioConverter::convert(source.data(), sourceFormat.format, dest.data(), destFormat.format, samples) == false) {
+			dest.clear();
+		}
+		
+		return dest;
+	}
+	
+	//Splits interleaved samples into planes and then interleaves them again using the specified instruction set, returning the planes followed by the interleaved samples
+	vector<uint8_t> splitAndJoinWith(const string& set, const vector<uint8_t>& source, const NamedFormat& sourceFormat, const NamedFormat& destFormat, uint32_t channels, uint64_t frames)
+	{
+		AudioConverter::setInstructionSet(set);
+		uint64_t planeSize = frames * FormatDetails::bytesPerSample(destFormat.format);
+		vector<uint8_t> output((planeSize * channels) + (frames * channels * FormatDetails::bytesPerSample(sourceFormat.format)), 0xCD);
+		vector<uint8_t*> planes;
+		for (uint32_t channel = 0; channel < channels; ++channel) {
+			planes.push_back(output.data() + (channel * planeSize));
+		}
+		
+		if (AudioConverter::deinterleave(source.data(), sourceFormat.format, planes.data(), destFormat.format, channels, frames) == false ||
+			AudioConverter::interleave(planes.data(), destFormat.format, output.data() + (planeSize * channels), sourceFormat.format, channels, frames) == false)
+		{
+			output.clear();
+		}
+		
+		return output;
+	}
+	
+	//Verifies that the SIMD kernels produce exactly the same output as the scalar kernels for every pair of formats
+	void compareKernels(TestResults& results, const vector<string>& sets)
+	{
+		uint32_t seed = 1;
+		for (const NamedFormat& sourceFormat : formats)
+		{
+			for (const NamedFormat& destFormat : formats)
+			{
+				for (uint64_t samples : sampleCounts)
+				{
+					vector<uint8_t> source = generateSamples(sourceFormat, samples, seed++);
+					vector<uint8_t> expected = convertWith("Scalar", source, sourceFormat, destFormat, samples);
+					string name = sourceFormat.name + " to " + destFormat.name + " with " + std::to_string(samples) + " samples";
+					results.check(expected.empty() == false, "scalar conversion of " + name);
+					for (const string& set : sets) {
+						results.check(convertWith(set, source, sourceFormat, destFormat, samples) == expected, set + " conversion of " + name);
+					}
+				}
+				
+				//Channel counts either side of the SIMD kernels' specialised layouts, with frame counts that leave remainders
+				for (uint32_t channels : { 1, 2, 3, 6, 8 })
+				{
+					for (uint64_t frames : { 1, 5, 300 })
+					{
+						vector<uint8_t> source = generateSamples(sourceFormat, channels * frames, seed++);
+						vector<uint8_t> expected = splitAndJoinWith("Scalar", source, sourceFormat, destFormat, channels, frames);
+						string name = sourceFormat.name + " to " + destFormat.name + " with " + std::to_string(channels) + " channels of " + std::to_string(frames) + " frames";
+						results.check(expected.empty() == false, "scalar deinterleaving of " + name);
+						for (const string& set : sets) {
+							results.check(splitAndJoinWith(set, source, sourceFormat, destFormat, channels, frames) == expected, set + " deinterleaving of " + name);
+						}
+					}
+				}
+			}
+		}
+	}
+	
+	//Verifies conversions whose results are known exactly
+	void checkKnownValues(TestResults& results, const string& set)
+	{
+		AudioConverter::setInstructionSet(set);
+		
+		//Signed and unsigned formats differ only in the sign bit
+		int16_t signedSamples[4] = { 0, -32768, 32767, -1 };
+		uint16_t unsignedSamples[4] = { 0 };
+		AudioConverter::convert((const uint8_t*)(signedSamples), AudioFormat::PCM_S16LE, (uint8_t*)(unsignedSamples), AudioFormat::PCM_U16LE, 4);
+		results.check(unsignedSamples[0] == 32768 && unsignedSamples[1] == 0 && unsignedSamples[2] == 65535 && unsignedSamples[3] == 32767, set + " S16LE to U16LE flips the sign bit");
+		
+		//Full scale maps to -1.0 and silence maps to 0.0
+		float floats[4] = { 0.0f };
+		AudioConverter::convert((const uint8_t*)(signedSamples), AudioFormat::PCM_S16LE, (uint8_t*)(floats), AudioFormat::PCM_F32LE, 4);
+		results.check(floats[0] == 0.0f && floats[1] == -1.0f && floats[2] > 0.9999f && floats[2] < 1.0f, set + " S16LE to F32LE scales to the range [-1.0, 1.0)");
+		
+		//Values outside of the range [-1.0, 1.0] are clamped
+		float loud[2] = { 2.0f, -3.0f };
+		AudioConverter::convert((const uint8_t*)(loud), AudioFormat::PCM_F32LE, (uint8_t*)(signedSamples), AudioFormat::PCM_S16LE, 2);
+		results.check(signedSamples[0] == 32767 && signedSamples[1] == -32768, set + " F32LE to S16LE clamps out-of-range values");
+		
+		//64-bit floats hold every 32-bit integer exactly, so converting there and back is lossless
+		vector<uint8_t> integers = MediaIPCTests::randomBytes(1027 * sizeof(int32_t), 5);
+		vector<uint8_t> doubles(1027 * sizeof(double));
+		vector<uint8_t> restored(integers.size());
+		AudioConverter::convert(integers.data(), AudioFormat::PCM_S32LE, doubles.data(), AudioFormat::PCM_F64BE, 1027);
+		AudioConverter::convert(doubles.data(), AudioFormat::PCM_F64BE, restored.data(), AudioFormat::PCM_S32LE, 1027);
+		results.check(restored == integers, set + " S32LE to F64BE and back is lossless");
+		
+		//Swapping the byte order of 64-bit floats preserves every bit
+		vector<uint8_t> source = generateSamples(formats.back(), 99, 6);
+		vector<uint8_t> swapped(source.size());
+		AudioConverter::convert(source.data(), AudioFormat::PCM_F64LE, swapped.data(), AudioFormat::PCM_F64BE, 99);
+		AudioConverter::convert(swapped.data(), AudioFormat::PCM_F64BE, restored.data(), AudioFormat::PCM_F64LE, 99);
+		results.check(swapped[0] == source[7] && swapped[7] == source[0] && std::memcmp(restored.data(), source.data(), source.size()) == 0, set + " F64LE to F64BE swaps the byte order");
+	}
+}
+
+int main (int argc, char* argv[])
+{
+	TestResults results;
+	
+	//Compare every instruction set that the build and the CPU support against the scalar kernels
+	vector<string> sets;
+	for (string set : { "SSE2", "AVX2" })
+	{
+		if (AudioConverter::setInstructionSet(set) == true) {
+			sets.push_back(set);
+		}
+		else {
+			std::cout << "Skipping the " << set << " kernels, which this build or CPU does not support" << std::endl;
+		}
+	}
+	
+	compareKernels(results, sets);
+	checkKnownValues(results, "Scalar");
+	for (const string& set : sets) {
+		checkKnownValues(results, set);
+	}
+	
+	return results.finish("audio_kernels");
+}
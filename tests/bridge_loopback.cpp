@@ -0,0 +1,236 @@
+#include "../source/public/BridgeReceiver.h"
+#include "../source/public/BridgeSender.h"
+#include "../source/public/MediaConsumer.h"
+#include "../source/public/MediaProducer.h"
+#include "TestUtils.h"
+#include <stdint.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+using std::string;
+using std::vector;
+using namespace MediaIPC;
+using MediaIPCTests::TestResults;
+
+namespace
+{
+	//The number of frames we publish, and the number of audio samples in each block
+	const uint32_t FrameCount = 60;
+	const uint32_t SamplesPerBuffer = 480;
+	
+	ControlBlock streamParameters()
+	{
+		ControlBlock cb;
+		cb.width = 320;
+		cb.height = 180;
+		cb.frameRate = 60;
+		cb.videoFormat = VideoFormat::RGBA;
+		cb.videoSlots = 4;
+		cb.channels = 2;
+		cb.sampleRate = 48000;
+		cb.samplesPerBuffer = SamplesPerBuffer;
+		cb.audioFormat = AudioFormat::PCM_S16LE;
+		return cb;
+	}
+	
+	//The number of control blocks, frames and blocks of samples that arrived, and the number of those that were not intact
+	struct ArrivalCounts
+	{
+		std::atomic<uint32_t> controlBlocks;
+		std::atomic<uint32_t> videoFrames;
+		std::atomic<uint32_t> badFrames;
+		std::atomic<uint32_t> audioBlocks;
+		std::atomic<uint32_t> badBlocks;
+	};
+	
+	//Verifies the stream republished by the receiver, in which every video frame and every block of samples is filled with a single byte value
+	//(The counts outlive the delegate, which the consumer destroys once the stream ends)
+	class VerifyingDelegate : public ConsumerDelegate
+	{
+		public:
+			VerifyingDelegate(ArrivalCounts& counts) : counts(counts), lastSequence(0), lastValue(-1), expectedLength(0) {}
+			
+			void controlBlockReceived(const ControlBlock& cb)
+			{
+				this->expectedLength = cb.calculateVideoBufsize();
+				this->counts.controlBlocks += 1;
+			}
+			
+			void videoFrameReceived(const uint8_t* buffer, uint64_t length) {}
+			
+			void videoFrameInfoReceived(const uint8_t* buffer, uint64_t length, const FrameInfo& info)
+			{
+				//The stream starts with a blank frame before the first frame is relayed
+				if (info.sequence == 0) {
+					return;
+				}
+				
+				this->counts.videoFrames += 1;
+				bool uniform = (length == this->expectedLength);
+				for (uint64_t offset = 0; uniform == true && offset < length; ++offset) {
+					uniform = (buffer[offset] == buffer[0]);
+				}
+				
+				//Frames may be skipped, but must never arrive out of order
+				if (uniform == false || info.sequence <= this->lastSequence || (int32_t)(buffer[0]) < this->lastValue) {
+					this->counts.badFrames += 1;
+				}
+				
+				this->lastSequence = info.sequence;
+				this->lastValue = buffer[0];
+			}
+			
+			void audioSamplesReceived(const uint8_t* buffer, uint64_t length)
+			{
+				this->counts.audioBlocks += 1;
+				bool uniform = (length == SamplesPerBuffer * 4);
+				for (uint64_t offset = 0; uniform == true && offset < length; ++offset) {
+					uniform = (buffer[offset] == buffer[0]);
+				}
+				
+				if (uniform == false) {
+					this->counts.badBlocks += 1;
+				}
+			}
+			
+		private:
+			ArrivalCounts& counts;
+			uint64_t lastSequence;
+			int32_t lastValue;
+			uint64_t expectedLength;
+	};
+	
+	//Relays a stream from a producer through a sender and a receiver to a consumer of the republished stream
+	class Loopback
+	{
+		public:
+			Loopback(const string& endpoint, const string& suffix) :
+				inputPrefix("BridgeTestIn" + suffix), outputPrefix("BridgeTestOut" + suffix), endpoint(endpoint)
+			{
+				this->counts.controlBlocks.store(0);
+				this->counts.videoFrames.store(0);
+				this->counts.badFrames.store(0);
+				this->counts.audioBlocks.store(0);
+				this->counts.badBlocks.store(0);
+			}
+			
+			void run(TestResults& results, const string& name)
+			{
+				BridgeOptions options;
+				MediaProducer producer(this->inputPrefix, streamParameters());
+				BridgeReceiver receiver(this->endpoint, this->outputPrefix, options);
+				
+				//When listening on TCP port zero, the sender connects to whichever port the receiver was given
+				string target = ((receiver.port() != 0) ? "tcp:127.0.0.1:" + std::to_string(receiver.port()) : this->endpoint);
+				std::thread consumerThread(std::bind(&Loopback::consume, this));
+				std::thread receiverThread(std::bind(&Loopback::receive, this, std::ref(receiver)));
+				BridgeSender sender(this->inputPrefix, target, options);
+				std::thread senderThread(std::bind(&Loopback::send, this, std::ref(sender)));
+				
+				//Wait for the republished stream to reach the consumer before we start publishing
+				std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+				while (this->counts.controlBlocks.load() == 0 && std::chrono::steady_clock::now() < deadline) {
+					std::this_thread::sleep_for(std::chrono::milliseconds(5));
+				}
+				
+				results.check(this->counts.controlBlocks.load() > 0, name + " relays the control block");
+				for (uint32_t frame = 0; frame < FrameCount; ++frame)
+				{
+					vector<uint8_t> video(streamParameters().calculateVideoBufsize(), (uint8_t)(frame));
+					vector<uint8_t> audio(SamplesPerBuffer * 4, (uint8_t)(frame));
+					producer.submitVideoFrame(video.data(), video.size());
+					producer.submitAudioSamples(audio.data(), audio.size());
+					std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				}
+				
+				//Give the final frame time to arrive, then end the stream, which ends the relay and the republished stream in turn
+				std::this_thread::sleep_for(std::chrono::milliseconds(200));
+				producer.stop();
+				senderThread.join();
+				receiverThread.join();
+				consumerThread.join();
+				
+				std::lock_guard<std::mutex> lock(this->mutex);
+				results.check(this->failures.empty() == true, name + " completes without errors" + (this->failures.empty() ? "" : ": " + this->failures));
+				results.check(this->counts.videoFrames.load() > 0 && this->counts.badFrames.load() == 0, name + " delivers intact video frames in order");
+				results.check(this->counts.audioBlocks.load() > 0 && this->counts.badBlocks.load() == 0, name + " delivers intact audio samples");
+				results.check(this->counts.audioBlocks.load() >= FrameCount / 2, name + " delivers most of the audio samples");
+				
+				BridgeStats sent = sender.stats();
+				BridgeStats received = receiver.stats();
+				results.check(sent.videoFrames > 0 && sent.videoFrames == received.videoFrames, name + " receives every video frame that was sent");
+				results.check(sent.audioBlocks == received.audioBlocks, name + " receives every audio block that was sent");
+				results.check(sent.videoFramesTorn == 0, name + " sends no torn video frames");
+			}
+			
+		private:
+			
+			//Consumes the republished stream until it ends
+			void consume()
+			{
+				try {
+					MediaConsumer consumer(this->outputPrefix, std::unique_ptr<ConsumerDelegate>(new VerifyingDelegate(this->counts)), SamplingMode::Notification);
+				}
+				catch (std::runtime_error& e) {
+					this->fail(string("consumer: ") + e.what());
+				}
+			}
+			
+			void receive(BridgeReceiver& receiver)
+			{
+				try {
+					receiver.run();
+				}
+				catch (std::runtime_error& e) {
+					this->fail(string("receiver: ") + e.what());
+				}
+			}
+			
+			void send(BridgeSender& sender)
+			{
+				try {
+					sender.run();
+				}
+				catch (std::runtime_error& e) {
+					this->fail(string("sender: ") + e.what());
+				}
+			}
+			
+			void fail(const string& failure)
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->failures += failure + " ";
+			}
+			
+			string inputPrefix;
+			string outputPrefix;
+			string endpoint;
+			ArrivalCounts counts;
+			std::mutex mutex;
+			string failures;
+	};
+}
+
+int main (int argc, char* argv[])
+{
+	TestResults results;
+	
+	//Relay over a Unix domain socket and over TCP loopback, using names unique to this process so that concurrent runs do not collide
+	string suffix = std::to_string(getpid());
+	string socketPath = "/tmp/mediaipc_bridge_test_" + suffix;
+	unlink(socketPath.c_str());
+	Loopback overUnix("unix:" + socketPath, "Unix" + suffix);
+	overUnix.run(results, "Unix domain socket");
+	unlink(socketPath.c_str());
+	
+	Loopback overTcp("tcp:127.0.0.1:0", "Tcp" + suffix);
+	overTcp.run(results, "TCP loopback");
+	return results.finish("bridge_loopback");
+}
@@ -0,0 +1,187 @@
+#include "../source/private/DamageList.h"
+#include "TestUtils.h"
+#include <stdint.h>
+#include <cstring>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+using MediaIPC::ControlBlock;
+using MediaIPC::DamageCopier;
+using MediaIPC::DamageList;
+using MediaIPC::DamageRect;
+using MediaIPC::FormatDetails;
+using MediaIPC::PlaneLayout;
+using MediaIPC::VideoFormat;
+using MediaIPCTests::TestResults;
+
+namespace
+{
+	//The number of pixels horizontally and vertically that share each sample of a plane, and the size of each sample
+	struct SampleShape
+	{
+		uint32_t pixelsX;
+		uint32_t pixelsY;
+		uint32_t bytes;
+	};
+	
+	//A format along with the shape of the samples in each of its planes, spelled out independently of the copier
+	struct FormatShape
+	{
+		VideoFormat format;
+		string name;
+		vector<SampleShape> planes;
+	};
+	
+	const vector<FormatShape> shapes = {
+		{ VideoFormat::GRAY8, "GRAY8", { {1, 1, 1} } },
+		{ VideoFormat::RGB,   "RGB",   { {1, 1, 3} } },
+		{ VideoFormat::RGBA,  "RGBA",  { {1, 1, 4} } },
+		{ VideoFormat::I420,  "I420",  { {1, 1, 1}, {2, 2, 1}, {2, 2, 1} } },
+		{ VideoFormat::NV12,  "NV12",  { {1, 1, 1}, {2, 2, 2} } },
+		{ VideoFormat::YUY2,  "YUY2",  { {2, 1, 4} } },
+		{ VideoFormat::P010,  "P010",  { {1, 1, 2}, {2, 2, 4} } }
+	};
+	
+	//Copies a rectangle the slow way, by testing whether each sample of each plane covers any of the rectangle's pixels
+	uint64_t referenceCopy(const ControlBlock& cb, const FormatShape& shape, uint8_t* dest, const uint8_t* source, const DamageRect& rect)
+	{
+		uint64_t copied = 0;
+		for (uint8_t plane = 0; plane < shape.planes.size(); ++plane)
+		{
+			const SampleShape& sample = shape.planes[plane];
+			PlaneLayout layout = cb.calculateVideoPlaneLayout(plane);
+			uint32_t columns = (cb.width + sample.pixelsX - 1) / sample.pixelsX;
+			for (uint32_t row = 0; row < layout.rows; ++row)
+			{
+				for (uint32_t column = 0; column < columns; ++column)
+				{
+					bool coversX = (column * sample.pixelsX < rect.x + rect.width) && ((column + 1) * sample.pixelsX > rect.x);
+					bool coversY = (row * sample.pixelsY < rect.y + rect.height) && ((row + 1) * sample.pixelsY > rect.y);
+					if (coversX == true && coversY == true)
+					{
+						uint64_t offset = layout.offset + (row * layout.stride) + (column * sample.bytes);
+						std::memcpy(dest + offset, source + offset, sample.bytes);
+						copied += sample.bytes;
+					}
+				}
+			}
+		}
+		
+		return copied;
+	}
+	
+	//Verifies that the copier copies exactly the samples covered by each rectangle, for frames with and without padded rows
+	void checkRectangles(TestResults& results)
+	{
+		uint32_t seed = 1;
+		for (const FormatShape& shape : shapes)
+		{
+			for (uint32_t width : { 1, 7, 16, 33 })
+			{
+				for (uint32_t height : { 1, 5, 8 })
+				{
+					for (uint32_t alignment : { 1, 64 })
+					{
+						ControlBlock cb;
+						cb.width = width;
+						cb.height = height;
+						cb.videoFormat = shape.format;
+						cb.videoStride = ((alignment > 1) ? FormatDetails::alignedStride(shape.format, width, alignment) : 0);
+						DamageCopier copier(cb);
+						uint64_t frameSize = cb.calculateVideoBufsize();
+						vector<uint8_t> source = MediaIPCTests::randomBytes(frameSize, seed++);
+						string name = shape.name + " at " + std::to_string(width) + "x" + std::to_string(height) + " with alignment " + std::to_string(alignment);
+						
+						//Rectangles at each corner, in the middle, and overhanging the edges of the frame
+						vector<DamageRect> rects = {
+							DamageRect(0, 0, 1, 1),
+							DamageRect(width - 1, height - 1, 1, 1),
+							DamageRect(width / 2, height / 3, 3, 2),
+							DamageRect(1, 1, width, height),
+							DamageRect(0, 0, width, height)
+						};
+						
+						bool matches = true;
+						bool counted = true;
+						for (DamageRect rect : rects)
+						{
+							if (copier.clamp(rect) == false) {
+								continue;
+							}
+							
+							DamageList damage;
+							damage.clear();
+							damage.add(rect);
+							vector<uint8_t> actual(frameSize, 0);
+							vector<uint8_t> expected(frameSize, 0);
+							uint64_t copied = copier.copy(actual.data(), source.data(), damage);
+							uint64_t expectedCopied = referenceCopy(cb, shape, expected.data(), source.data(), rect);
+							matches = matches && (actual == expected);
+							counted = counted && (copied == expectedCopied);
+						}
+						
+						results.check(matches, "rectangles of " + name + " copy exactly the samples they cover");
+						results.check(counted, "rectangles of " + name + " report the number of bytes they copy");
+						
+						//Full damage copies the entire frame, including any padding
+						DamageList full;
+						full.setFull();
+						vector<uint8_t> whole(frameSize, 0);
+						results.check(copier.copy(whole.data(), source.data(), full) == frameSize && whole == source, "full damage of " + name + " copies the whole frame");
+					}
+				}
+			}
+		}
+	}
+	
+	//Verifies the clamping of rectangles and the bookkeeping of damage lists
+	void checkLists(TestResults& results)
+	{
+		ControlBlock cb;
+		cb.width = 20;
+		cb.height = 10;
+		cb.videoFormat = VideoFormat::RGBA;
+		DamageCopier copier(cb);
+		
+		DamageRect overhanging(15, 8, 10, 10);
+		results.check(copier.clamp(overhanging) == true && overhanging.width == 5 && overhanging.height == 2, "clamping trims a rectangle to the frame");
+		DamageRect outside(20, 0, 5, 5);
+		results.check(copier.clamp(outside) == false, "clamping rejects a rectangle outside the frame");
+		DamageRect empty(3, 3, 0, 4);
+		results.check(copier.clamp(empty) == false, "clamping rejects an empty rectangle");
+		
+		//Adding rectangles beyond capacity collapses the list into their bounding box
+		DamageList list;
+		list.clear();
+		for (uint32_t index = 0; index <= MEDIA_IPC_MAX_DAMAGE_RECTS; ++index) {
+			list.add(DamageRect(index, index * 2, 1, 1));
+		}
+		
+		results.check(list.full == 0 && list.count == 1, "a list at capacity collapses into one rectangle");
+		results.check(list.rects[0].x == 0 && list.rects[0].y == 0 && list.rects[0].width == MEDIA_IPC_MAX_DAMAGE_RECTS + 1 && list.rects[0].height == (MEDIA_IPC_MAX_DAMAGE_RECTS * 2) + 1, "the collapsed rectangle bounds every rectangle");
+		
+		//Merging a full list marks everything as damaged, and nothing can be added to a full list
+		DamageList full;
+		full.setFull();
+		list.merge(full);
+		list.add(DamageRect(1, 1, 1, 1));
+		results.check(list.full != 0, "merging a full list makes the list full");
+		
+		//A copier for frames without video copies nothing
+		DamageCopier none;
+		DamageList one;
+		one.clear();
+		one.add(DamageRect(0, 0, 4, 4));
+		uint8_t buffer[4] = { 0 };
+		results.check(none.copy(buffer, buffer, one) == 0, "a copier without video copies nothing");
+	}
+}
+
+int main (int argc, char* argv[])
+{
+	TestResults results;
+	checkRectangles(results);
+	checkLists(results);
+	return results.finish("damage_copier");
+}
@@ -0,0 +1,172 @@
+#include "../source/public/FormatConverter.h"
+#include "TestUtils.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+using MediaIPC::FormatConverter;
+using MediaIPC::FormatDetails;
+using MediaIPC::VideoFormat;
+using MediaIPCTests::TestResults;
+
+namespace
+{
+	//The formats that the conversion kernels read, and the formats they write
+	const vector<VideoFormat> packedFormats = { VideoFormat::RGB, VideoFormat::BGR, VideoFormat::RGBA, VideoFormat::BGRA, VideoFormat::ARGB, VideoFormat::ABGR };
+	const vector<VideoFormat> destFormats = { VideoFormat::RGB, VideoFormat::BGR, VideoFormat::RGBA, VideoFormat::BGRA, VideoFormat::ARGB, VideoFormat::ABGR, VideoFormat::I420, VideoFormat::NV12, VideoFormat::YUY2 };
+	const vector<VideoFormat> halvedFormats = { VideoFormat::GRAY8, VideoFormat::RGB, VideoFormat::RGBA, VideoFormat::ABGR, VideoFormat::I420, VideoFormat::NV12 };
+	
+	//Widths either side of the 16 and 32 pixel blocks that the SSE2 and AVX2 kernels process, so that every remainder path runs
+	const vector<uint32_t> widths = { 1, 2, 3, 7, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100 };
+	const vector<uint32_t> heights = { 1, 2, 5 };
+	
+	//Returns the identifier of a video format, since some formats share a description
+	string formatName(VideoFormat format)
+	{
+		switch (format)
+		{
+			#define VIDEO_FORMAT(name, bytes, planes, subsampleX, subsampleY, description) case VideoFormat::name: return #name;
+			#include "../source/public/VideoFormats.inc"
+			
+			default:
+				return "None";
+		}
+	}
+	
+	//Converts a frame using the specified instruction set, with padding at the end of each source row
+	vector<uint8_t> convertWith(const string& set, const vector<uint8_t>& source, VideoFormat sourceFormat, VideoFormat destFormat, uint32_t width, uint32_t height)
+	{
+		FormatConverter::setInstructionSet(set);
+		uint64_t sourceStride = FormatDetails::alignedStride(sourceFormat, width, 1) + 5;
+		vector<uint8_t> dest(FormatDetails::frameSize(destFormat, width, height, 0), 0xCD);
+		if (FormatConverter::convert(source.data(), sourceFormat, sourceStride, dest.data(), destFormat, 0, width, height) == false) {
+			dest.clear();
+		}
+		
+		return dest;
+	}
+	
+	//Halves a frame using the specified instruction set
+	vector<uint8_t> halveWith(const string& set, const vector<uint8_t>& source, VideoFormat format, uint32_t width, uint32_t height)
+	{
+		FormatConverter::setInstructionSet(set);
+		vector<uint8_t> dest(FormatDetails::frameSize(format, (width + 1) / 2, (height + 1) / 2, 0), 0xCD);
+		if (FormatConverter::halve(source.data(), format, 0, dest.data(), 0, width, height) == false) {
+			dest.clear();
+		}
+		
+		return dest;
+	}
+	
+	//Verifies that the SIMD kernels produce exactly the same output as the scalar kernels for every supported conversion
+	void compareKernels(TestResults& results, const vector<string>& sets)
+	{
+		uint32_t seed = 1;
+		for (VideoFormat sourceFormat : packedFormats)
+		{
+			for (VideoFormat destFormat : destFormats)
+			{
+				for (uint32_t width : widths)
+				{
+					for (uint32_t height : heights)
+					{
+						uint64_t sourceStride = FormatDetails::alignedStride(sourceFormat, width, 1) + 5;
+						vector<uint8_t> source = MediaIPCTests::randomBytes(sourceStride * height, seed++);
+						vector<uint8_t> expected = convertWith("Scalar", source, sourceFormat, destFormat, width, height);
+						string name = formatName(sourceFormat) + " to " + formatName(destFormat) + " at " + std::to_string(width) + "x" + std::to_string(height);
+						results.check(expected.empty() == false, "scalar conversion of " + name);
+						for (const string& set : sets) {
+							results.check(convertWith(set, source, sourceFormat, destFormat, width, height) == expected, set + " conversion of " + name);
+						}
+					}
+				}
+			}
+		}
+		
+		for (VideoFormat format : halvedFormats)
+		{
+			for (uint32_t width : widths)
+			{
+				for (uint32_t height : heights)
+				{
+					vector<uint8_t> source = MediaIPCTests::randomBytes(FormatDetails::frameSize(format, width, height, 0), seed++);
+					vector<uint8_t> expected = halveWith("Scalar", source, format, width, height);
+					string name = formatName(format) + " at " + std::to_string(width) + "x" + std::to_string(height);
+					results.check(expected.empty() == false, "scalar halving of " + name);
+					for (const string& set : sets) {
+						results.check(halveWith(set, source, format, width, height) == expected, set + " halving of " + name);
+					}
+				}
+			}
+		}
+	}
+	
+	//Verifies the results of the scalar kernels for frames of known colours
+	void checkKnownValues(TestResults& results)
+	{
+		FormatConverter::setInstructionSet("Scalar");
+		
+		//BT.601 limited range maps white to Y=235 and black to Y=16, with neutral chroma for both
+		vector<uint8_t> white(4 * 4 * 4, 255);
+		vector<uint8_t> black(4 * 4 * 3, 0);
+		vector<uint8_t> i420(FormatDetails::frameSize(VideoFormat::I420, 4, 4, 0));
+		FormatConverter::convert(white.data(), VideoFormat::RGBA, 0, i420.data(), VideoFormat::I420, 0, 4, 4);
+		results.check(i420[0] == 235 && i420[16] == 128 && i420[20] == 128, "white converts to Y=235 U=V=128");
+		FormatConverter::convert(black.data(), VideoFormat::RGB, 0, i420.data(), VideoFormat::I420, 0, 4, 4);
+		results.check(i420[0] == 16 && i420[16] == 128 && i420[20] == 128, "black converts to Y=16 U=V=128");
+		
+		//Swizzling to another layout and back restores the original pixels
+		vector<uint8_t> pixels = MediaIPCTests::randomBytes(9 * 3 * 4, 99);
+		vector<uint8_t> swizzled(pixels.size());
+		vector<uint8_t> restored(pixels.size());
+		FormatConverter::convert(pixels.data(), VideoFormat::RGBA, 0, swizzled.data(), VideoFormat::ARGB, 0, 9, 3);
+		FormatConverter::convert(swizzled.data(), VideoFormat::ARGB, 0, restored.data(), VideoFormat::RGBA, 0, 9, 3);
+		results.check(swizzled[0] == pixels[3] && swizzled[1] == pixels[0], "RGBA to ARGB moves the alpha channel to the front");
+		results.check(restored == pixels, "RGBA to ARGB and back is lossless");
+		
+		//Formats without an alpha channel produce opaque pixels
+		vector<uint8_t> rgb = MediaIPCTests::randomBytes(5 * 3, 7);
+		vector<uint8_t> bgra(5 * 4);
+		FormatConverter::convert(rgb.data(), VideoFormat::RGB, 0, bgra.data(), VideoFormat::BGRA, 0, 5, 1);
+		results.check(bgra[0] == rgb[2] && bgra[2] == rgb[0] && bgra[3] == 255 && bgra[19] == 255, "RGB to BGRA swaps red and blue and is opaque");
+		
+		//YUY2 shares each chroma sample between a pair of pixels, and its luma matches that of the planar conversion
+		vector<uint8_t> frame = MediaIPCTests::randomBytes(6 * 2 * 4, 11);
+		vector<uint8_t> yuy2(FormatDetails::frameSize(VideoFormat::YUY2, 6, 2, 0));
+		FormatConverter::convert(frame.data(), VideoFormat::RGBA, 0, yuy2.data(), VideoFormat::YUY2, 0, 6, 2);
+		FormatConverter::convert(frame.data(), VideoFormat::RGBA, 0, i420.data(), VideoFormat::I420, 0, 6, 2);
+		bool lumaMatches = true;
+		for (uint32_t pixel = 0; pixel < 12; ++pixel) {
+			lumaMatches = lumaMatches && (yuy2[pixel * 2] == i420[pixel]);
+		}
+		
+		results.check(lumaMatches, "YUY2 luma matches I420 luma");
+		
+		//Conversions between YUV formats are not supported
+		results.check(FormatConverter::canConvert(VideoFormat::I420, VideoFormat::RGBA) == false, "I420 cannot be converted to RGBA");
+		results.check(FormatConverter::canConvert(VideoFormat::YUY2, VideoFormat::I420) == false, "YUY2 cannot be converted to I420");
+		results.check(FormatConverter::canConvert(VideoFormat::YUY2, VideoFormat::YUY2) == true, "YUY2 can be copied");
+	}
+}
+
+int main (int argc, char* argv[])
+{
+	TestResults results;
+	
+	//Compare every instruction set that the build and the CPU support against the scalar kernels
+	vector<string> sets;
+	for (string set : { "SSE2", "AVX2" })
+	{
+		if (FormatConverter::setInstructionSet(set) == true) {
+			sets.push_back(set);
+		}
+		else {
+			std::cout << "Skipping the " << set << " kernels, which this build or CPU does not support" << std::endl;
+		}
+	}
+	
+	compareKernels(results, sets);
+	checkKnownValues(results);
+	return results.finish("format_kernels");
+}
@@ -0,0 +1,229 @@
+#include "../source/private/FrameRing.h"
+#include "TestUtils.h"
+#include <stdint.h>
+#include <cstring>
+#include <memory>
+#include <vector>
+using std::vector;
+using MediaIPC::ControlBlock;
+using MediaIPC::DamageCopier;
+using MediaIPC::DamageList;
+using MediaIPC::DamageRect;
+using MediaIPC::FrameInfo;
+using MediaIPC::FrameRing;
+using MediaIPC::VideoFormat;
+using MediaIPCTests::TestResults;
+
+namespace
+{
+	//The parameters of the frames held by the ring in each test
+	const uint32_t Slots = 4;
+	const uint32_t Width = 16;
+	const uint32_t Height = 8;
+	const uint32_t Owner = 3;
+	
+	//Holds the memory for a ring, aligned in the same way as a shared memory mapping
+	class RingMemory
+	{
+		public:
+			RingMemory(const ControlBlock& cb) :
+				storage(FrameRing::requiredSize(Slots, cb.calculateVideoBufsize()) + MEDIA_IPC_CACHE_LINE, 0)
+			{
+				uintptr_t address = (uintptr_t)(this->storage.data());
+				uint8_t* aligned = this->storage.data() + ((MEDIA_IPC_CACHE_LINE - (address % MEDIA_IPC_CACHE_LINE)) % MEDIA_IPC_CACHE_LINE);
+				this->ring.reset(new FrameRing(aligned, Slots, cb.calculateVideoBufsize()));
+				this->ring->reset();
+			}
+			
+			vector<uint8_t> storage;
+			std::unique_ptr<FrameRing> ring;
+	};
+	
+	ControlBlock videoParameters()
+	{
+		ControlBlock cb;
+		cb.width = Width;
+		cb.height = Height;
+		cb.videoFormat = VideoFormat::RGBA;
+		cb.videoSlots = Slots;
+		return cb;
+	}
+	
+	//Verifies that frames written to the ring are read back intact, along with their metadata
+	void checkWriteAndRead(TestResults& results)
+	{
+		ControlBlock cb = videoParameters();
+		RingMemory memory(cb);
+		FrameRing& ring = *memory.ring;
+		uint64_t frameSize = cb.calculateVideoBufsize();
+		vector<uint8_t> frame(frameSize);
+		results.check(ring.latestSequence() == 0, "an empty ring has no frames");
+		results.check(ring.read(frame.data(), frameSize) == 0, "reading an empty ring returns sequence zero");
+		
+		bool intact = true;
+		for (uint32_t index = 1; index <= 10; ++index)
+		{
+			vector<uint8_t> source = MediaIPCTests::randomBytes(frameSize, index);
+			uint64_t sequence = ring.write(source.data(), frameSize, index * 100);
+			FrameInfo info;
+			intact = intact && (sequence == index) && (ring.read(frame.data(), frameSize, &info) == index);
+			intact = intact && (frame == source) && (info.sequence == index) && (info.pts == (int64_t)(index * 100));
+		}
+		
+		results.check(intact, "each frame written is read back intact with its sequence number and pts");
+		results.check(ring.latestSequence() == 10, "the latest sequence number counts every frame written");
+		
+		//Frames can also be filled in place
+		uint8_t* data = ring.acquire();
+		results.check(data != nullptr && ring.acquire() == data && ring.pending() == data, "acquiring twice returns the same slot");
+		std::memset(data, 0x5A, frameSize);
+		results.check(ring.commit() == 11 && ring.pending() == nullptr, "committing an acquired slot publishes it");
+		ring.read(frame.data(), frameSize);
+		results.check(frame == vector<uint8_t>(frameSize, 0x5A), "a frame filled in place is read back intact");
+		results.check(ring.commit() == 0, "committing without acquiring publishes nothing");
+	}
+	
+	//Verifies that pinned frames survive while the producer keeps writing, and that releasing an owner's pins frees them
+	void checkPins(TestResults& results)
+	{
+		ControlBlock cb = videoParameters();
+		RingMemory memory(cb);
+		FrameRing& ring = *memory.ring;
+		uint64_t frameSize = cb.calculateVideoBufsize();
+		vector<uint8_t> pinnedFrame = MediaIPCTests::randomBytes(frameSize, 77);
+		uint32_t slot = 0;
+		results.check(ring.pin(slot, Owner) == 0, "pinning an empty ring pins nothing");
+		
+		ring.write(pinnedFrame.data(), frameSize);
+		uint64_t sequence = ring.pin(slot, Owner);
+		results.check(sequence == 1 && ring.pinnedLocally() == true, "pinning returns the latest frame");
+		for (uint32_t index = 0; index < Slots * 3; ++index)
+		{
+			vector<uint8_t> other(frameSize, (uint8_t)(index));
+			ring.write(other.data(), frameSize);
+		}
+		
+		results.check(ring.holds(slot, sequence) == true, "a pinned slot is not overwritten");
+		results.check(std::memcmp(ring.frameData(slot), pinnedFrame.data(), frameSize) == 0, "a pinned frame is unchanged");
+		results.check(ring.frameInfo(slot).sequence == sequence, "a pinned frame keeps its metadata");
+		ring.unpin(slot, Owner);
+		results.check(ring.pinnedLocally() == false, "unpinning releases the local pin");
+		for (uint32_t index = 0; index < Slots; ++index) {
+			ring.write(pinnedFrame.data(), frameSize);
+		}
+		
+		results.check(ring.holds(slot, sequence) == false, "an unpinned slot is reused");
+		
+		//The pins of a consumer that died are released by the producer
+		uint64_t orphaned = ring.pin(slot, Owner);
+		for (uint32_t index = 0; index < Slots * 2; ++index) {
+			ring.write(pinnedFrame.data(), frameSize);
+		}
+		
+		results.check(ring.holds(slot, orphaned) == true, "a slot pinned by a dead consumer is retained until its pins are released");
+		ring.releasePins(Owner);
+		for (uint32_t index = 0; index < Slots; ++index) {
+			ring.write(pinnedFrame.data(), frameSize);
+		}
+		
+		results.check(ring.holds(slot, orphaned) == false, "releasing an owner's pins allows its slots to be reused");
+	}
+	
+	//Verifies that damaged writes produce complete frames and that consumers can copy just the damaged regions
+	void checkDamage(TestResults& results)
+	{
+		ControlBlock cb = videoParameters();
+		RingMemory memory(cb);
+		FrameRing& ring = *memory.ring;
+		DamageCopier copier(cb);
+		uint64_t frameSize = cb.calculateVideoBufsize();
+		uint64_t stride = Width * 4;
+		
+		//The first frame is always copied in full, regardless of its damage
+		vector<uint8_t> expected = MediaIPCTests::randomBytes(frameSize, 1);
+		DamageList damage;
+		damage.clear();
+		damage.add(DamageRect(0, 0, 1, 1));
+		uint64_t bytesCopied = 0;
+		uint64_t first = ring.write(expected.data(), damage, copier, bytesCopied);
+		results.check(bytesCopied == frameSize, "the first damaged write copies the whole frame");
+		
+		//A consumer holding the first frame keeps up to date by copying only the damaged regions
+		vector<uint8_t> consumer(frameSize);
+		ring.read(consumer.data(), frameSize);
+		uint64_t lastSequence = first;
+		bool complete = true;
+		bool partial = true;
+		for (uint32_t index = 2; index <= 12; ++index)
+		{
+			//Each frame only differs from the previous frame in a single rectangle, so the rest of the source is garbage
+			vector<uint8_t> source = MediaIPCTests::randomBytes(frameSize, index);
+			DamageRect rect(index % Width, index % Height, 3, 2);
+			copier.clamp(rect);
+			for (uint32_t row = rect.y; row < rect.y + rect.height; ++row) {
+				std::memcpy(expected.data() + (row * stride) + (rect.x * 4), source.data() + (row * stride) + (rect.x * 4), rect.width * 4);
+			}
+			
+			damage.clear();
+			damage.add(rect);
+			bytesCopied = 0;
+			uint64_t sequence = ring.write(source.data(), damage, copier, bytesCopied);
+			vector<uint8_t> frame(frameSize);
+			ring.read(frame.data(), frameSize);
+			complete = complete && (frame == expected);
+			
+			//The consumer only catches up with every other frame
+			if (index % 2 == 0)
+			{
+				DamageList delta;
+				uint64_t consumerCopied = 0;
+				FrameInfo info;
+				complete = complete && (ring.readDelta(consumer.data(), lastSequence, copier, delta, &info, consumerCopied) == sequence);
+				complete = complete && (consumer == expected) && (info.sequence == sequence);
+				partial = partial && (delta.full == 0) && (consumerCopied < frameSize);
+				lastSequence = sequence;
+			}
+		}
+		
+		results.check(complete, "damaged writes and delta reads produce complete frames");
+		results.check(partial, "delta reads copy only the damaged regions");
+		
+		//Once the frames in between have been overwritten, everything is reported as damaged
+		DamageList since;
+		ring.damageSince(ring.latestSequence() - 1, ring.latestSequence(), since);
+		results.check(since.full == 0 && since.count == 1, "the damage since the previous frame is that frame's damage");
+		ring.damageSince(ring.latestSequence() - 2, ring.latestSequence(), since);
+		results.check(since.full == 0 && since.count == 2, "the damage since an earlier frame merges the damage of each frame");
+		ring.damageSince(ring.latestSequence() - (Slots + 1), ring.latestSequence(), since);
+		results.check(since.full != 0, "the damage since an overwritten frame is the whole frame");
+		ring.damageSince(0, ring.latestSequence(), since);
+		results.check(since.full != 0, "the damage since no frame is the whole frame");
+		
+		//A consumer with nothing to catch up on copies nothing
+		DamageList delta;
+		uint64_t consumerCopied = 0;
+		ring.readDelta(consumer.data(), ring.latestSequence(), copier, delta, nullptr, consumerCopied);
+		results.check(consumerCopied == 0 && delta.full == 0 && delta.count == 0, "a consumer that is up to date copies nothing");
+		
+		//The damage of discarded frames is included in the next frame that is published
+		DamageList skipped;
+		skipped.clear();
+		skipped.add(DamageRect(0, 0, 2, 2));
+		ring.discard(skipped);
+		damage.clear();
+		damage.add(DamageRect(10, 5, 2, 2));
+		vector<uint8_t> source = MediaIPCTests::randomBytes(frameSize, 99);
+		ring.write(source.data(), damage, copier, bytesCopied);
+		ring.damageSince(ring.latestSequence() - 1, ring.latestSequence(), since);
+		results.check(since.full == 0 && since.count == 2, "the damage of discarded frames is carried into the next frame");
+	}
+}
+
+int main (int argc, char* argv[])
+{
+	TestResults results;
+	checkWriteAndRead(results);
+	checkPins(results);
+	checkDamage(results);
+	return results.finish("frame_ring");
+}
@@ -0,0 +1,173 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <thread>
+using std::cout;
+using std::endl;
+using std::setw;
+
+#include "../source/public/BridgeReceiver.h"
+#include "../source/public/BridgeSender.h"
+
+namespace
+{
+	//Prints the column headings
+	void printHeader()
+	{
+		cout << std::right
+			<< setw(10) << "video/s"
+			<< setw(10) << "audio/s"
+			<< setw(10) << "MB/s"
+			<< setw(10) << "calls/s"
+			<< setw(10) << "drop/s"
+			<< setw(12) << "local ms"
+			<< setw(12) << "max ms"
+			<< setw(12) << "rtt ms"
+			<< setw(12) << "zc copied"
+			<< endl;
+	}
+	
+	//Determines the average latency in milliseconds over an interval, or zero if nothing was measured
+	double averageLatency(uint64_t total, uint64_t previousTotal, uint64_t samples, uint64_t previousSamples)
+	{
+		uint64_t count = samples - previousSamples;
+		return ((count > 0) ? ((total - previousTotal) / (double)(count)) / 1000000.0 : 0.0);
+	}
+	
+	//Prints the rates for a single interval
+	void printRow(const MediaIPC::BridgeStats& current, const MediaIPC::BridgeStats& previous, double elapsed)
+	{
+		cout << std::right << std::fixed << std::setprecision(1)
+			<< setw(10) << ((current.videoFrames - previous.videoFrames) / elapsed)
+			<< setw(10) << ((current.audioBlocks - previous.audioBlocks) / elapsed)
+			<< setw(10) << (((current.bytes - previous.bytes) / elapsed) / (1024.0 * 1024.0))
+			<< setw(10) << ((current.batches - previous.batches) / elapsed)
+			<< setw(10) << ((current.videoFramesDropped - previous.videoFramesDropped) / elapsed)
+			<< std::setprecision(3)
+			<< setw(12) << averageLatency(current.localLatencyNanoseconds, previous.localLatencyNanoseconds, current.localLatencySamples, previous.localLatencySamples)
+			<< setw(12) << (current.localLatencyMaxNanoseconds / 1000000.0)
+			<< setw(12) << averageLatency(current.roundTripNanoseconds, previous.roundTripNanoseconds, current.roundTripSamples, previous.roundTripSamples)
+			<< setw(12) << current.zeroCopyCopied
+			<< endl;
+	}
+	
+	//Prints the rates for each interval until the bridge finishes relaying the stream
+	void report(std::function<MediaIPC::BridgeStats()> sample, double interval, const std::atomic<bool>& finished)
+	{
+		MediaIPC::BridgeStats previous = sample();
+		auto previousTime = std::chrono::steady_clock::now();
+		auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(interval));
+		for (long row = 0; finished == false; ++row)
+		{
+			//Sleep in short increments so that we notice promptly when the stream ends
+			auto nextTime = previousTime + period;
+			while (finished == false && std::chrono::steady_clock::now() < nextTime) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+			
+			MediaIPC::BridgeStats current = sample();
+			auto currentTime = std::chrono::steady_clock::now();
+			if (row % 10 == 0) {
+				printHeader();
+			}
+			
+			printRow(current, previous, std::chrono::duration<double>(currentTime - previousTime).count());
+			previous = current;
+			previousTime = currentTime;
+		}
+	}
+	
+	//Runs a sender or receiver while reporting its throughput and latency, and prints its totals once the stream ends
+	template <typename BridgeType>
+	void relay(BridgeType& bridge, double interval)
+	{
+		std::atomic<bool> finished(false);
+		std::thread reporter(report, std::bind(&BridgeType::stats, &bridge), interval, std::cref(finished));
+		try {
+			bridge.run();
+		}
+		catch (std::runtime_error&)
+		{
+			finished = true;
+			reporter.join();
+			throw;
+		}
+		
+		finished = true;
+		reporter.join();
+		
+		MediaIPC::BridgeStats totals = bridge.stats();
+		cout << "Stream ended: " << totals.videoFrames << " video frames, " << totals.audioBlocks << " audio blocks, "
+			<< totals.controlBlocks << " control blocks, " << totals.bytes << " bytes in " << totals.batches << " system calls, "
+			<< totals.videoFramesDropped << " frames dropped, " << totals.videoFramesTorn << " frames torn" << endl;
+	}
+}
+
+int main (int argc, char* argv[])
+{
+	try
+	{
+		//Parse our command-line arguments
+		if (argc < 4 || (std::string(argv[1]) != "send" && std::string(argv[1]) != "receive"))
+		{
+			cout << "Usage:" << endl
+				<< "  " << argv[0] << " send PREFIX ENDPOINT [--zerocopy] [--interval SECONDS]" << endl
+				<< "  " << argv[0] << " receive ENDPOINT PREFIX [--interval SECONDS]" << endl
+				<< endl
+				<< "Endpoints are unix:PATH for a Unix domain socket, or tcp:HOST:PORT or HOST:PORT for TCP." << endl
+				<< "Receivers listen on every interface when the host is omitted, as in tcp::9000." << endl;
+			return 1;
+		}
+		
+		MediaIPC::BridgeOptions options;
+		double interval = 1.0;
+		for (int arg = 4; arg < argc; ++arg)
+		{
+			if (std::strcmp(argv[arg], "--zerocopy") == 0) {
+				options.zeroCopy = true;
+			}
+			else if (std::strcmp(argv[arg], "--interval") == 0 && arg + 1 < argc) {
+				interval = std::atof(argv[++arg]);
+			}
+			else {
+				throw std::runtime_error("unrecognised argument \"" + std::string(argv[arg]) + "\"");
+			}
+		}
+		
+		if (interval <= 0.0) {
+			throw std::runtime_error("the interval must be greater than zero");
+		}
+		
+		if (std::string(argv[1]) == "send")
+		{
+			cout << "Awaiting producer with prefix \"" << argv[2] << "\" and receiver at \"" << argv[3] << "\"..." << endl;
+			MediaIPC::BridgeSender sender(argv[2], argv[3], options);
+			relay(sender, interval);
+		}
+		else
+		{
+			MediaIPC::BridgeReceiver receiver(argv[2], argv[3], options);
+			cout << "Awaiting sender at \"" << argv[2] << "\"";
+			if (receiver.port() != 0) {
+				cout << " (port " << receiver.port() << ")";
+			}
+			
+			cout << ", to republish with prefix \"" << argv[3] << "\"..." << endl;
+			relay(receiver, interval);
+		}
+	}
+	catch (std::runtime_error& e)
+	{
+		cout << "Error: " << e.what() << endl;
+		return 1;
+	}
+	
+	return 0;
+}
@@ -0,0 +1,161 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <thread>
+using std::cout;
+using std::endl;
+using std::setw;
+
+#include "../source/public/MediaRecorder.h"
+#include "../source/public/MediaReplayer.h"
+
+namespace
+{
+	//Prints the column headings
+	void printHeader()
+	{
+		cout << std::right
+			<< setw(10) << "video/s"
+			<< setw(10) << "audio/s"
+			<< setw(10) << "MB/s"
+			<< setw(10) << "writes/s"
+			<< setw(10) << "drop/s"
+			<< setw(12) << "queued MB"
+			<< endl;
+	}
+	
+	//Prints the rates for a single interval
+	void printRow(const MediaIPC::RecordingStats& current, const MediaIPC::RecordingStats& previous, double elapsed)
+	{
+		cout << std::right << std::fixed << std::setprecision(1)
+			<< setw(10) << ((current.videoFrames - previous.videoFrames) / elapsed)
+			<< setw(10) << ((current.audioBlocks - previous.audioBlocks) / elapsed)
+			<< setw(10) << (((current.bytes - previous.bytes) / elapsed) / (1024.0 * 1024.0))
+			<< setw(10) << ((current.writes - previous.writes) / elapsed)
+			<< setw(10) << ((current.videoFramesDropped - previous.videoFramesDropped) / elapsed)
+			<< setw(12) << (current.queuedBytes / (1024.0 * 1024.0))
+			<< endl;
+	}
+	
+	//Prints the rates for each interval until the recorder or replayer reaches the end of the stream
+	void report(std::function<MediaIPC::RecordingStats()> sample, double interval, const std::atomic<bool>& finished)
+	{
+		MediaIPC::RecordingStats previous = sample();
+		auto previousTime = std::chrono::steady_clock::now();
+		auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(interval));
+		for (long row = 0; finished == false; ++row)
+		{
+			//Sleep in short increments so that we notice promptly when the stream ends
+			auto nextTime = previousTime + period;
+			while (finished == false && std::chrono::steady_clock::now() < nextTime) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+			
+			MediaIPC::RecordingStats current = sample();
+			auto currentTime = std::chrono::steady_clock::now();
+			if (row % 10 == 0) {
+				printHeader();
+			}
+			
+			printRow(current, previous, std::chrono::duration<double>(currentTime - previousTime).count());
+			previous = current;
+			previousTime = currentTime;
+		}
+	}
+	
+	//Runs a recorder or replayer while reporting its throughput, and prints its totals once the stream ends
+	template <typename RecordingType>
+	void process(RecordingType& recording, double interval)
+	{
+		std::atomic<bool> finished(false);
+		std::thread reporter(report, std::bind(&RecordingType::stats, &recording), interval, std::cref(finished));
+		try {
+			recording.run();
+		}
+		catch (std::runtime_error&)
+		{
+			finished = true;
+			reporter.join();
+			throw;
+		}
+		
+		finished = true;
+		reporter.join();
+		
+		MediaIPC::RecordingStats totals = recording.stats();
+		cout << "Stream ended: " << totals.videoFrames << " video frames, " << totals.audioBlocks << " audio blocks, "
+			<< totals.controlBlocks << " control blocks, " << totals.bytes << " bytes in " << totals.writes << " writes, "
+			<< totals.videoFramesDropped << " frames dropped, " << totals.videoFramesTorn << " frames torn" << endl;
+	}
+}
+
+int main (int argc, char* argv[])
+{
+	try
+	{
+		//Parse our command-line arguments
+		if (argc < 4 || (std::string(argv[1]) != "record" && std::string(argv[1]) != "replay"))
+		{
+			cout << "Usage:" << endl
+				<< "  " << argv[0] << " record PREFIX FILE [--buffered] [--interval SECONDS]" << endl
+				<< "  " << argv[0] << " replay FILE PREFIX [--fast] [--start SECONDS] [--interval SECONDS]" << endl
+				<< endl
+				<< "Recordings bypass the page cache unless --buffered is specified, and are replayed in real time unless --fast is specified." << endl;
+			return 1;
+		}
+		
+		MediaIPC::RecordingOptions options;
+		double interval = 1.0;
+		for (int arg = 4; arg < argc; ++arg)
+		{
+			if (std::strcmp(argv[arg], "--buffered") == 0) {
+				options.directIO = false;
+			}
+			else if (std::strcmp(argv[arg], "--fast") == 0) {
+				options.realTime = false;
+			}
+			else if (std::strcmp(argv[arg], "--start") == 0 && arg + 1 < argc) {
+				options.startOffset = std::chrono::milliseconds((int64_t)(std::atof(argv[++arg]) * 1000.0));
+			}
+			else if (std::strcmp(argv[arg], "--interval") == 0 && arg + 1 < argc) {
+				interval = std::atof(argv[++arg]);
+			}
+			else {
+				throw std::runtime_error("unrecognised argument \"" + std::string(argv[arg]) + "\"");
+			}
+		}
+		
+		if (interval <= 0.0) {
+			throw std::runtime_error("the interval must be greater than zero");
+		}
+		
+		if (std::string(argv[1]) == "record")
+		{
+			cout << "Awaiting producer with prefix \"" << argv[2] << "\" to record to \"" << argv[3] << "\"..." << endl;
+			MediaIPC::MediaRecorder recorder(argv[2], argv[3], options);
+			process(recorder, interval);
+		}
+		else
+		{
+			MediaIPC::MediaReplayer replayer(argv[2], argv[3], options);
+			cout << "Replaying " << replayer.tracks().size() << " tracks and "
+				<< std::fixed << std::setprecision(1) << (replayer.duration().count() / 1000000000.0)
+				<< " seconds from \"" << argv[2] << "\" with prefix \"" << argv[3] << "\"..." << endl;
+			process(replayer, interval);
+		}
+	}
+	catch (std::runtime_error& e)
+	{
+		cout << "Error: " << e.what() << endl;
+		return 1;
+	}
+	
+	return 0;
+}
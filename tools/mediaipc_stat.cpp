@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+using std::cout;
+using std::endl;
+using std::setw;
+
+#include "../source/public/StreamStats.h"
+
+namespace
+{
+	//Prints the column headings
+	void printHeader()
+	{
+		cout << std::left << setw(16) << "source" << std::right
+			<< setw(10) << "video/s"
+			<< setw(10) << "dup/s"
+			<< setw(10) << "skip/s"
+			<< setw(10) << "audio/s"
+			<< setw(12) << "lost B/s"
+			<< setw(10) << "under/s"
+			<< setw(12) << "copy MB/s"
+			<< setw(12) << "lock us/s"
+			<< setw(10) << "beat ms"
+			<< endl;
+	}
+	
+	//Prints a single row of rates, along with the age of a consumer's heartbeat
+	void printRow(const std::string& source, double video, double duplicates, double skipped, double audio, double lost, double underruns, double copied, double lockWait, double heartbeatAge)
+	{
+		cout << std::left << setw(16) << source << std::right << std::fixed << std::setprecision(1)
+			<< setw(10) << video
+			<< setw(10) << duplicates
+			<< setw(10) << skipped
+			<< setw(10) << audio
+			<< setw(12) << lost
+			<< setw(10) << underruns
+			<< setw(12) << (copied / (1024.0 * 1024.0))
+			<< setw(12) << (lockWait / 1000.0)
+			<< setw(10) << (heartbeatAge / 1000000.0)
+			<< endl;
+	}
+	
+	//Locates the previous sample for a consumer, if it was already attached at that time
+	const MediaIPC::ConsumerStats* findPrevious(const std::vector<MediaIPC::ConsumerStats>& previous, const MediaIPC::ConsumerStats& current)
+	{
+		for (const MediaIPC::ConsumerStats& candidate : previous)
+		{
+			if (candidate.index == current.index && candidate.processId == current.processId) {
+				return &candidate;
+			}
+		}
+		
+		return nullptr;
+	}
+}
+
+int main (int argc, char* argv[])
+{
+	try
+	{
+		//Parse our command-line arguments, in the style of vmstat
+		if (argc < 2)
+		{
+			cout << "Usage: " << argv[0] << " PREFIX [INTERVAL_SECONDS [COUNT]]" << endl;
+			return 1;
+		}
+		
+		std::string prefix = argv[1];
+		double interval = ((argc > 2) ? std::atof(argv[2]) : 1.0);
+		long count = ((argc > 3) ? std::atol(argv[3]) : 0);
+		if (interval <= 0.0) {
+			throw std::runtime_error("the interval must be greater than zero");
+		}
+		
+		//Attach to the stream's telemetry counters (this does not register us as a consumer)
+		cout << "Awaiting producer with prefix \"" << prefix << "\"..." << endl;
+		MediaIPC::StatsReader reader(prefix);
+		
+		MediaIPC::StreamStats previous = reader.sample();
+		auto previousTime = std::chrono::steady_clock::now();
+		auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(interval));
+		auto nextTime = previousTime + period;
+		
+		//Print the rates for each interval until we have printed the requested number of samples
+		for (long sample = 0; count == 0 || sample < count; ++sample)
+		{
+			std::this_thread::sleep_until(nextTime);
+			nextTime += period;
+			
+			MediaIPC::StreamStats current = reader.sample();
+			auto currentTime = std::chrono::steady_clock::now();
+			double elapsed = std::chrono::duration<double>(currentTime - previousTime).count();
+			
+			//Reprint the column headings periodically so they remain visible as the output scrolls
+			if (sample % 10 == 0) {
+				printHeader();
+			}
+			
+			//Heartbeats are recorded using the steady clock, in nanoseconds since its epoch
+			uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(currentTime.time_since_epoch()).count();
+			
+			const MediaIPC::ProducerStats& p = current.producer;
+			const MediaIPC::ProducerStats& pp = previous.producer;
+			printRow(
+				"producer",
+				(p.videoFramesSubmitted - pp.videoFramesSubmitted) / elapsed,
+				0.0,
+				0.0,
+				(p.audioBlocksSubmitted - pp.audioBlocksSubmitted) / elapsed,
+				0.0,
+				0.0,
+				((p.videoBytesCopied - pp.videoBytesCopied) + (p.audioBytesCopied - pp.audioBytesCopied)) / elapsed,
+				(p.statusLockWaitNanoseconds - pp.statusLockWaitNanoseconds) / elapsed,
+				0.0
+			);
+			
+			for (const MediaIPC::ConsumerStats& c : current.consumers)
+			{
+				//Consumers that attached during this interval are compared against zero
+				MediaIPC::ConsumerStats zero;
+				const MediaIPC::ConsumerStats* found = findPrevious(previous.consumers, c);
+				const MediaIPC::ConsumerStats& pc = ((found != nullptr) ? *found : zero);
+				
+				printRow(
+					"consumer " + std::to_string(c.processId),
+					(c.videoFramesConsumed - pc.videoFramesConsumed) / elapsed,
+					(c.videoDuplicates - pc.videoDuplicates) / elapsed,
+					(c.videoFramesSkipped - pc.videoFramesSkipped) / elapsed,
+					(c.audioBuffersConsumed - pc.audioBuffersConsumed) / elapsed,
+					(c.audioBytesLost - pc.audioBytesLost) / elapsed,
+					(c.audioUnderruns - pc.audioUnderruns) / elapsed,
+					((c.videoBytesCopied - pc.videoBytesCopied) + (c.audioBytesCopied - pc.audioBytesCopied)) / elapsed,
+					(c.statusLockWaitNanoseconds - pc.statusLockWaitNanoseconds) / elapsed,
+					(double)(now - std::min(now, c.heartbeat))
+				);
+			}
+			
+			cout << endl;
+			previous = current;
+			previousTime = currentTime;
+		}
+	}
+	catch (std::runtime_error& e) {
+		cout << "Error: " << e.what() << endl;
+	}
+	
+	return 0;
+}